@@ -51,6 +51,7 @@ use io
 use error
 use initializers
 use HDFsupport
+use stringconstants
 use EBSDmod
 use EBSDDImod
 use EBSDiomod
@@ -67,16 +68,18 @@ type(EBSDMasterNameListType)                :: mpnl
 integer(kind=irg)                           :: istat, res
 
 type(EBSDIndexingNameListType)              :: dinl
-type(EBSDDIdataType)                        :: EBSDDIdata
 type(EBSDMPdataType)                        :: EBSDMPdata
-real(kind=sgl),allocatable                  :: dplist(:,:), OSMlist(:,:), exptIQ(:), eangles(:,:,:), pfrac(:), pID(:), &
-                                               dpmap(:,:)
-integer(kind=irg),allocatable               :: phaseID(:), pnum(:)
-integer(kind=irg)                           :: ipf_wd, ipf_ht, irow, numpat, ml(1), ipar(4)
-integer(kind=irg)                           :: dims(1), hdferr, io_int(2), i, j, ii, numdp
-real(kind=sgl)                              :: io_real(1), mi, ma
-character(fnlen)                            :: fname, xtalname(5), infile, rdxtalname, TIFF_filename
-logical                                     :: f_exists, isTKD
+type(EBSDDotProductFileType)                :: DPFs(5)
+real(kind=sgl),allocatable                  :: dpb(:,:), OSMb(:,:), IQb(:), eb(:,:,:), pfrac(:), eu(:,:), dpsel(:)
+integer(kind=irg),allocatable               :: phaseID(:), pnum(:), osm(:), iq(:)
+integer(kind=irg)                           :: ipf_wd, ipf_ht, irow, numpat, ml(1), ipar(4), ROI(4), nr, npb, poff, ipass, &
+                                               LaueGroup(5)
+integer(kind=irg)                           :: hdferr, io_int(2), i, j, k, numdp
+integer(kind=irg),parameter                 :: nbandrows = 256
+real(kind=sgl)                              :: io_real(1), mi, ma, omi, oma, v
+character(fnlen)                            :: fname, xtalname(5), infile, rdxtalname, TIFF_filename, &
+                                               dpname, eaname, dataset
+logical                                     :: f_exists, isTKD, doctf, doang, dophase
 character(4)                                :: EBSDorTKD
 
 ! declare variables for use in object oriented image module
@@ -84,7 +87,7 @@ integer                                     :: iostat
 character(len=128)                          :: iomsg
 logical                                     :: isInteger
 type(image_t)                               :: im
-integer(int8), allocatable                  :: TIFF_image(:,:)
+integer(int8), allocatable                  :: TIFF_image(:,:), TIFF_imagew(:,:)
 integer(int8), parameter                    :: intmax = 127
 integer                                     :: dim2(2)
 integer(c_int32_t)                          :: result
@@ -125,49 +128,21 @@ call WriteValue('',io_int,1,"(' Found ',I2,' dot product file names'/)")
 call h5open_EMsoft(hdferr)
 
 if (dpmnl%indexingmode.eq.'DI') then 
-! loop over the input files and extract all the necessary data; at the same time, check to make 
-! sure that they cover the same data (after the first one has been read, allocate the data arrays) 
+! the merge is carried out in bands of nbandrows rows of the ROI, with all dot product files open
+! at the same time; only hyperslabs of the CI (or refined dot products), OSM, IQ and Euler angle
+! data sets are read, so that the memory footprint does not depend on the number of scan rows.
+  doctf = (trim(dpmnl%ctfname).ne.'undefined')
+  doang = (trim(dpmnl%angname).ne.'undefined')
+  dophase = (trim(dpmnl%phasemapnameweighted).ne.'undefined').or.(trim(dpmnl%phasemapname).ne.'undefined')
+
+! open each file, get its metadata and make sure that they all cover the same ROI
   do i=1,numdp
-    call Message(' Reading data from '//trim(dpmnl%dotproductfile(i)) )
-    if (isTKD.eqv..FALSE.) then 
-      if (trim(dpmnl%usedp).eq.'original') then ! read the original DI results
-        call readEBSDDotProductFile(dpmnl%dotproductfile(i), dinl, hdferr, EBSDDIdata, &
-                                    getEulerAngles = .TRUE., &
-                                    getIQ = .TRUE., &
-                                    getOSM = .TRUE., &
-                                    getCI = .TRUE., &
-                                    isTKD = .FALSE.)
-      else   ! read the results from the refinement run
-        call readEBSDDotProductFile(dpmnl%dotproductfile(i), dinl, hdferr, EBSDDIdata, &
-                                    getRefinedEulerAngles = .TRUE., &
-                                    getIQ = .TRUE., &
-                                    getOSM = .TRUE., &
-                                    getRefinedDotProducts = .TRUE., &
-                                    getCI = .TRUE., &
-                                    isTKD = .FALSE.)
-      end if
-    else 
-      if (trim(dpmnl%usedp).eq.'original') then ! read the original DI results
-        call readEBSDDotProductFile(dpmnl%dotproductfile(i), dinl, hdferr, EBSDDIdata, &
-                                    getEulerAngles = .TRUE., &
-                                    getIQ = .TRUE., &
-                                    getOSM = .TRUE., &
-                                    getCI = .TRUE., &
-                                    isTKD = .TRUE.)
-      else   ! read the results from the refinement run
-        call readEBSDDotProductFile(dpmnl%dotproductfile(i), dinl, hdferr, EBSDDIdata, &
-                                    getRefinedEulerAngles = .TRUE., &
-                                    getIQ = .TRUE., &
-                                    getOSM = .TRUE., &
-                                    getRefinedDotProducts = .TRUE., &
-                                    getCI = .TRUE., &
-                                    isTKD = .TRUE.)
-      end if
-    end if 
-
+    call Message(' Opening '//trim(dpmnl%dotproductfile(i)) )
+    call openEBSDDotProductFile(dpmnl%dotproductfile(i), dinl, DPFs(i), hdferr, isTKD = isTKD)
 
     if (i.eq.1) then 
-  ! get the ROI dimensions and allocate the arrays 
+  ! get the ROI dimensions 
+      ROI = dinl%ROI
       if (sum(dinl%ROI).ne.0) then 
         ipf_wd = dinl%ROI(3)
         ipf_ht = dinl%ROI(4)
@@ -176,31 +151,20 @@ if (dpmnl%indexingmode.eq.'DI') then
         ipf_ht = dinl%ipf_ht
       end if
       numpat = ipf_wd * ipf_ht 
-      allocate( dplist(numpat,numdp), OSMlist(numpat, numdp), exptIQ(numpat), eangles(3,numpat,numdp) ) 
     else 
-  ! check dimensions of the ROI; they must be the same.  if they are, then add the data to the various arrays
-      dims = shape(EBSDDIdata%CI)
-      if (dims(1).ne.numpat) then 
-        call FatalError('EMdpmerge','inconsistent ROI dimensions in dot product input files ' )
+  ! check dimensions of the ROI; they must be the same
+      if (sum(ROI).ne.0) then 
+        if (sum(abs(dinl%ROI(3:4)-ROI(3:4))).ne.0) then
+          call FatalError('EMdpmerge','inconsistent ROI dimensions in dot product input files ' )
+        end if 
+      else
+        if ((dinl%ipf_wd.ne.ipf_wd).or.(dinl%ipf_ht.ne.ipf_ht)) then
+          call FatalError('EMdpmerge','inconsistent ROI dimensions in dot product input files ' )
+        end if 
       end if 
     end if 
-! copy the data
-    do irow = 1, ipf_ht
-      OSMlist( (irow-1)*ipf_wd+1:irow*ipf_wd,i) = EBSDDIdata%OSM(1:ipf_wd,irow)
-    end do
-    exptIQ(:) = EBSDDIdata%IQ(:)
-    deallocate( EBSDDIdata%OSM, EBSDDIdata%IQ )
-    if (trim(dpmnl%usedp).eq.'original') then 
-      eangles(1:3,1:numpat,i) = EBSDDIdata%EulerAngles(1:3,1:numpat)
-      dplist(1:numpat,i) = EBSDDIdata%CI(1:numpat)
-      deallocate( EBSDDIdata%EulerAngles, EBSDDIdata%CI )
-    else 
-      eangles(1:3,1:numpat,i) = EBSDDIdata%RefinedEulerAngles(1:3,1:numpat) 
-      dplist(1:numpat,i) = EBSDDIdata%RefinedDotProducts(1:numpat)
-      deallocate( EBSDDIdata%RefinedEulerAngles, EBSDDIdata%RefinedDotProducts )
-    end if 
 
-! finally, get the name of the xtal file from the master pattern file
+! get the name of the xtal file from the master pattern file
 ! if that file can not be found, ask the user interactively to enter the xtalname parameter 
     infile = trim(EMsoft_getEMdatapathname())//trim(dinl%masterfile)
     infile = EMsoft_toNativePath(infile)
@@ -217,53 +181,204 @@ if (dpmnl%indexingmode.eq.'DI') then
       call ReadValue('  Enter crystal structure file name (with extension) ', rdxtalname)
       xtalname(i) = trim(rdxtalname)
     end if
-
   end do 
 
+  if (trim(dpmnl%usedp).eq.'original') then
+    dpname = SC_CI
+    eaname = SC_EulerAngles
+  else
+    dpname = SC_RefinedDotProducts
+    eaname = SC_RefinedEulerAngles
+  end if
 
-
-  ! determine which phase has the largest confidence index for each ROI sampling point
-  allocate(phaseID(numpat), pID(numdp))
-  do i=1,numpat 
-    pID(1:numdp) = dplist(i,1:numdp)
-    ml = maxloc(pID)
-    phaseID(i) = ml(1)
+  do i=1,numdp
+    if (EBSDDotProductDataExists(DPFs(i), dpname).eqv..FALSE.) then
+      call FatalError('EMdpmerge','data set '//trim(dpname)//' not found in '//trim(dpmnl%dotproductfile(i)))
+    end if
   end do
-  deallocate(pID)
 
-  ! determine the phase fractions and print that information 
-  allocate(pnum(numdp),pfrac(numdp))
-  pnum = 0
-  do i=1,numpat
-    pnum(phaseID(i)) = pnum(phaseID(i)) + 1
-  end do
-  pfrac = float(pnum)/float(numpat) * 100.0 
-  call Message(' Phase fractions :',"(/A)")
-  call Message(' -----------------')
-  do i=1,numdp 
-    io_real(1) = pfrac(i)
-    call WriteValue('  Phase '//trim(xtalname(i)), io_real, 1, "(F6.2)")
-  end do
+  allocate( dpb(nbandrows*ipf_wd,numdp), phaseID(nbandrows*ipf_wd), pnum(numdp), pfrac(numdp) )
+  if (doctf) allocate( OSMb(nbandrows*ipf_wd,numdp), osm(nbandrows*ipf_wd), iq(nbandrows*ipf_wd) )
+  if (doctf.or.doang) allocate( IQb(nbandrows*ipf_wd), eb(3,nbandrows*ipf_wd,numdp), &
+                                eu(3,nbandrows*ipf_wd), dpsel(nbandrows*ipf_wd) )
+  if (trim(dpmnl%phasemapnameweighted).ne.'undefined') then
+    allocate(TIFF_imagew(3*ipf_wd,ipf_ht))
+    TIFF_imagew = 0_int8
+  end if
+  if (trim(dpmnl%phasemapname).ne.'undefined') then
+    allocate(TIFF_image(3*ipf_wd,ipf_ht))
+    TIFF_image = 0_int8
+  end if
 
-  ! write a new .ctf file, if requested  
   ipar(1) = numpat
   ipar(2) = numdp 
   ipar(3) = ipf_wd 
   ipar(4) = ipf_ht 
 
-  if (trim(dpmnl%ctfname).ne.'undefined') then 
-    dinl%ctffile = trim(dpmnl%ctfname)
-    call ctfmerge_writeFile(dinl,xtalname,ipar,eangles, phaseID, dplist, OSMlist, exptIQ)
+! the first pass determines the phase fractions as well as the ranges of the dot products
+! and OSM values of the selected phases, which are needed for the intensity scaling;
+! the second pass writes the output files band by band.
+  pnum = 0
+  mi = huge(1.0)
+  ma = -huge(1.0)
+  omi = huge(1.0)
+  oma = -huge(1.0)
+  do ipass=1,2
+    if (ipass.eq.2) then 
+      if ((doctf.eqv..FALSE.).and.(doang.eqv..FALSE.).and.(dophase.eqv..FALSE.)) EXIT
+
+      if (doctf) then 
+        dinl%ctffile = trim(dpmnl%ctfname)
+        call ctfmerge_writeHeader(dinl,xtalname,ipar,dataunit2,LaueGroup)
+      end if
+      if (doang) then 
+        dinl%angfile = trim(dpmnl%angname)
+        call angmerge_writeHeader(dinl,xtalname,ipar,dataunit3)
+      end if
+    end if
+
+    do irow=1,ipf_ht,nbandrows
+      nr = min(nbandrows, ipf_ht-irow+1)
+      npb = nr * ipf_wd
+      poff = (irow-1) * ipf_wd
+
+      do i=1,numdp
+        dpb(1:npb,i) = readEBSDDotProductRows1D(DPFs(i), dpname, irow, nr)
+        if (doctf) then 
+          dataset = SC_OSM
+          OSMb(1:npb,i) = reshape( readEBSDDotProductMapRows(DPFs(i), dataset, irow, nr), (/ npb /) )
+        end if
+        if ((ipass.eq.2).and.(doctf.or.doang)) then 
+          eb(1:3,1:npb,i) = readEBSDDotProductRows2D(DPFs(i), eaname, 3, irow, nr)
+        end if
+      end do
+! as in the original merge, the pattern quality is taken from the last file
+      if ((ipass.eq.2).and.(doctf.or.doang)) then 
+        dataset = SC_IQ
+        IQb(1:npb) = readEBSDDotProductRows1D(DPFs(numdp), dataset, irow, nr)
+      end if
+
+  ! determine which phase has the largest confidence index for each sampling point
+      do k=1,npb
+        ml = maxloc(dpb(k,1:numdp))
+        phaseID(k) = ml(1)
+      end do
+
+      if (ipass.eq.1) then 
+        do k=1,npb
+          pnum(phaseID(k)) = pnum(phaseID(k)) + 1
+          mi = min(mi, dpb(k,phaseID(k)))
+          ma = max(ma, dpb(k,phaseID(k)))
+          if (doctf) then
+            omi = min(omi, OSMb(k,phaseID(k)))
+            oma = max(oma, OSMb(k,phaseID(k)))
+          end if
+        end do
+      else
+        if (doctf.or.doang) then 
+          do k=1,npb
+            eu(1:3,k) = eb(1:3,k,phaseID(k))
+            dpsel(k) = dpb(k,phaseID(k))
+          end do
+        end if
+
+        if (doctf) then 
+          do k=1,npb
+            osm(k) = nint(255.0 * (OSMb(k,phaseID(k))-omi)/(oma-omi))
+          end do
+          iq(1:npb) = nint(255.0 * IQb(1:npb))
+          call ctfmerge_writeRows(dinl,dataunit2,LaueGroup,poff,npb,eu,phaseID,dpsel,osm,iq)
+        end if
+
+        if (doang) then 
+          call angmerge_writeRows(dinl,dataunit3,poff,npb,eu,phaseID,dpsel,IQb)
+        end if
+
+! the pre-defined colors are red, green, blue, yellow, cyan, fushia, and white 
+! in the weighted map, each color is scaled by the maximum dot product value to make 
+! the image a bit more realistic
+        if (dophase) then
+          do k=1,npb
+            i = mod(k-1,ipf_wd) + 1
+            j = irow + (k-1)/ipf_wd
+            if (allocated(TIFF_imagew)) then 
+              v = 255*(dpb(k,phaseID(k))-mi)/(ma-mi)
+              select case(dpmnl%phasecolors(phaseID(k)))
+                case(1) 
+                  TIFF_imagew(1+3*(i-1),j) = v
+                case(2) 
+                  TIFF_imagew(2+3*(i-1),j) = v
+                case(3) 
+                  TIFF_imagew(3+3*(i-1),j) = v
+                case(4) 
+                  TIFF_imagew(1+3*(i-1),j) = v
+                  TIFF_imagew(2+3*(i-1),j) = v
+                case(5) 
+                  TIFF_imagew(2+3*(i-1),j) = v
+                  TIFF_imagew(3+3*(i-1),j) = v
+                case(6) 
+                  TIFF_imagew(1+3*(i-1),j) = v
+                  TIFF_imagew(3+3*(i-1),j) = v
+                case(7) 
+                  TIFF_imagew(1+3*(i-1),j) = v
+                  TIFF_imagew(2+3*(i-1),j) = v
+                  TIFF_imagew(3+3*(i-1),j) = v
+              end select 
+            end if
+            if (allocated(TIFF_image)) then 
+              select case(dpmnl%phasecolors(phaseID(k)))
+                case(1) 
+                  TIFF_image(1+3*(i-1),j) = intmax
+                case(2) 
+                  TIFF_image(2+3*(i-1),j) = intmax
+                case(3) 
+                  TIFF_image(3+3*(i-1),j) = intmax
+                case(4) 
+                  TIFF_image(1+3*(i-1),j) = intmax
+                  TIFF_image(2+3*(i-1),j) = intmax
+                case(5) 
+                  TIFF_image(2+3*(i-1),j) = intmax
+                  TIFF_image(3+3*(i-1),j) = intmax
+                case(6) 
+                  TIFF_image(1+3*(i-1),j) = intmax
+                  TIFF_image(3+3*(i-1),j) = intmax
+                case(7) 
+                  TIFF_image(1+3*(i-1),j) = intmax
+                  TIFF_image(2+3*(i-1),j) = intmax
+                  TIFF_image(3+3*(i-1),j) = intmax
+              end select 
+            end if
+          end do
+        end if
+      end if
+    end do
+
+    if (ipass.eq.1) then 
+  ! print the phase fractions 
+      pfrac = float(pnum)/float(numpat) * 100.0 
+      call Message(' Phase fractions :',"(/A)")
+      call Message(' -----------------')
+      do i=1,numdp 
+        io_real(1) = pfrac(i)
+        call WriteValue('  Phase '//trim(xtalname(i)), io_real, 1, "(F6.2)")
+      end do
+    end if
+  end do
+
+  if (doctf) then 
+    close(dataunit2,status='keep')
     call Message('Merged orientation data stored in ctf file : '//trim(dpmnl%ctfname))
   end if 
 
-! write a new .ang file, if requested 
-  if (trim(dpmnl%angname).ne.'undefined') then 
-    dinl%angfile = trim(dpmnl%angname)
-    call angmerge_writeFile(dinl,xtalname,ipar,eangles, phaseID, dplist, exptIQ)
+  if (doang) then 
+    close(dataunit3,status='keep')
     call Message('Merged orientation data stored in ang file : '//trim(dpmnl%angname))
   end if 
 
+  do i=1,numdp
+    call closeEBSDDotProductFile(DPFs(i))
+  end do
+
 else ! indexing mode must be SI
 ! the files are Spherical Indexing files, so they do not have an OSM map in them, and some other
 ! things are different, so we need a somewhat different approach.
@@ -271,67 +386,14 @@ else ! indexing mode must be SI
 
 end if 
 
-if (trim(dpmnl%phasemapnameweighted).ne.'undefined') then 
-  ! output the phase map as a tiff/bmp/ file 
+if (allocated(TIFF_imagew)) then 
+  ! output the weighted phase map as a tiff/bmp/ file 
   fname = trim(EMsoft_getEMdatapathname())//trim(dpmnl%phasemapnameweighted)
   fname = EMsoft_toNativePath(fname)
   TIFF_filename = trim(fname)
 
-  ! allocate memory for a color image; each pixel has 3 bytes [RGB]
-  allocate(TIFF_image(3*ipf_wd,ipf_ht))
-  TIFF_image = 0_int8
-
-  ! fill the image with whatever data you have (between 0 and 255)
-  allocate( dpmap(ipf_wd, ipf_ht) )
-  do j=1,ipf_ht
-   do i=1,ipf_wd
-    ii = (j-1) * ipf_wd + i 
-    dpmap(i,j) = dplist(ii,phaseID(ii))
-   end do 
-  end do 
-
-! first the weighted phasemap 
-  ma = maxval(dpmap)
-  mi = minval(dpmap)
-  dpmap = 255*(dpmap-mi)/(ma-mi) 
-
-! the pre-defined colors are red, green, blue, yellow, cyan, fushia, and white 
-! each color is weighted by the maximum dot product value to make the image a bit more realistic
-  do j=1,ipf_ht
-   do i=1,ipf_wd
-    ii = (j-1) * ipf_wd + i 
-    select case(dpmnl%phasecolors(phaseID(ii)))
-      case(1) 
-        TIFF_image(1+3*(i-1),j) = dpmap(i,j)
-
-      case(2) 
-        TIFF_image(2+3*(i-1),j) = dpmap(i,j)
-
-      case(3) 
-        TIFF_image(3+3*(i-1),j) = dpmap(i,j)
-
-      case(4) 
-        TIFF_image(1+3*(i-1),j) = dpmap(i,j)
-        TIFF_image(2+3*(i-1),j) = dpmap(i,j)
-
-      case(5) 
-        TIFF_image(2+3*(i-1),j) = dpmap(i,j)
-        TIFF_image(3+3*(i-1),j) = dpmap(i,j)
-
-      case(6) 
-        TIFF_image(1+3*(i-1),j) = dpmap(i,j)
-        TIFF_image(3+3*(i-1),j) = dpmap(i,j)
-
-      case(7) 
-        TIFF_image(1+3*(i-1),j) = dpmap(i,j)
-        TIFF_image(2+3*(i-1),j) = dpmap(i,j)
-        TIFF_image(3+3*(i-1),j) = dpmap(i,j)
-     end select 
-   end do
-  end do
-
   ! set up the image_t structure
-  im = image_t(TIFF_image)
+  im = image_t(TIFF_imagew)
   im%dims = (/ ipf_wd, ipf_ht /)
   im%samplesPerPixel = 3
   if(im%empty()) call Message("EMdpmerge: failed to convert array to rgb image")
@@ -343,55 +405,15 @@ if (trim(dpmnl%phasemapnameweighted).ne.'undefined') then
   else  
     call Message(' Color phase map written to '//trim(TIFF_filename))
   end if 
-  deallocate(TIFF_image)
+  deallocate(TIFF_imagew)
 end if
 
 ! then the regular phase map with saturated colors 
-if (trim(dpmnl%phasemapname).ne.'undefined') then 
+if (allocated(TIFF_image)) then 
   fname = trim(EMsoft_getEMdatapathname())//trim(dpmnl%phasemapname)
   fname = EMsoft_toNativePath(fname)
   TIFF_filename = trim(fname)
 
-  ! allocate memory for a color image; each pixel has 3 bytes [RGB]
-  allocate(TIFF_image(3*ipf_wd,ipf_ht))
-  TIFF_image = 0_int8
-
-! the pre-defined colors are red, green, blue, yellow, cyan, fushia, and white 
-! each color is weighted by the maximum dot product value to make the image a bit more realistic
-  TIFF_image = 0
-  do j=1,ipf_ht
-   do i=1,ipf_wd
-    ii = (j-1) * ipf_wd + i 
-    select case(dpmnl%phasecolors(phaseID(ii)))
-      case(1) 
-        TIFF_image(1+3*(i-1),j) = intmax
-
-      case(2) 
-        TIFF_image(2+3*(i-1),j) = intmax
-
-      case(3) 
-        TIFF_image(3+3*(i-1),j) = intmax
-
-      case(4) 
-        TIFF_image(1+3*(i-1),j) = intmax
-        TIFF_image(2+3*(i-1),j) = intmax
-
-      case(5) 
-        TIFF_image(2+3*(i-1),j) = intmax
-        TIFF_image(3+3*(i-1),j) = intmax
-
-      case(6) 
-        TIFF_image(1+3*(i-1),j) = intmax
-        TIFF_image(3+3*(i-1),j) = intmax
-
-      case(7) 
-        TIFF_image(1+3*(i-1),j) = intmax
-        TIFF_image(2+3*(i-1),j) = intmax
-        TIFF_image(3+3*(i-1),j) = intmax
-     end select 
-   end do
-  end do
-
   ! set up the image_t structure
   im = image_t(TIFF_image)
   im%dims = (/ ipf_wd, ipf_ht /)
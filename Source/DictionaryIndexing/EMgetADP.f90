@@ -336,12 +336,13 @@ open(unit=itmpexpt,file=trim(fname),&
 ! use the getADPmap routine in the filters module
 if (ROIselected.eqv..TRUE.) then
   allocate(dpmap(adpnl%ROI(3)*adpnl%ROI(4)))
-  call getADPmap(itmpexpt, adpnl%ROI(3)*adpnl%ROI(4), L, adpnl%ROI(3), adpnl%ROI(4), dpmap)
+  call getADPmap(itmpexpt, adpnl%ROI(3)*adpnl%ROI(4), L, adpnl%ROI(3), adpnl%ROI(4), dpmap, &
+                 adpnl%nbtype, adpnl%radius)
   TIFF_nx = adpnl%ROI(3)
   TIFF_ny = adpnl%ROI(4)
 else
   allocate(dpmap(totnumexpt))
-  call getADPmap(itmpexpt, totnumexpt, L, adpnl%ipf_wd, adpnl%ipf_ht, dpmap)
+  call getADPmap(itmpexpt, totnumexpt, L, adpnl%ipf_wd, adpnl%ipf_ht, dpmap, adpnl%nbtype, adpnl%radius)
   TIFF_nx = adpnl%ipf_wd
   TIFF_ny = adpnl%ipf_ht
 end if
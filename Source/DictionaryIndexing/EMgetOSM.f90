@@ -51,6 +51,7 @@ use error
 use initializers
 use HDF5
 use HDFsupport
+use stringconstants
 use EBSDmod
 use EBSDDImod
 use commonmod
@@ -65,11 +66,11 @@ type(OSMNameListType)                       :: osmnl
 integer(kind=irg)                           :: istat, res
 
 type(EBSDIndexingNameListType)              :: dinl
-type(EBSDDIdataType)                        :: EBSDDIdata
-real(kind=sgl),allocatable                  :: OSMmap(:,:)
-integer(kind=irg)                           :: dims(2), dimsOSM(2), hdferr, io_int(2), osmnum, i
+type(EBSDDotProductFileType)                :: DPF
+real(kind=sgl),allocatable                  :: OSMmap(:,:), OSMmaps(:,:,:), OSMdw(:,:,:)
+integer(kind=irg)                           :: dimsOSM(2), hdferr, io_int(2), osmnum, i, iv, nvar
 character(fnlen)                            :: fname, TIFF_filename, dpfile, groupname, dataset
-character(2)                                :: fnum
+character(2)                                :: fnum, vprefix
 real(kind=sgl)                              :: ma, mi
 type(HDFobjectStackType),pointer            :: HDF_head
 
@@ -100,13 +101,11 @@ else
 end if
 
 
-! open the fortran HDF interface and read the TopMatchIndices data set 
+! open the fortran HDF interface and the dot product file; the TopMatchIndices are 
+! read in bands of rows while the maps are computed 
 call h5open_EMsoft(hdferr)
 
-call readEBSDDotProductFile(osmnl%dotproductfile, dinl, hdferr, EBSDDIdata, &
-                            getTopMatchIndices = .TRUE.)
-
-call h5close_EMsoft(hdferr)
+call openEBSDDotProductFile(osmnl%dotproductfile, dinl, DPF, hdferr)
 
 ! first get the number of different OSM values in the list (non-zero entries)
 osmnum = 0
@@ -115,37 +114,56 @@ do i=1,5
 end do
 
 ! check to ake sure that the requested osmnl%nmatch values is <= the available number
-dims = shape( EBSDDIdata%TopMatchIndices )
 do i=1,osmnum
-  if (osmnl%nmatch(i).gt.dinl%nnk) then 
+  if (osmnl%nmatch(i).gt.DPF%nnk) then 
    io_int(1) = osmnl%nmatch(i)
-   io_int(2) = dims(1)
+   io_int(2) = DPF%nnk
    call WriteValue(' Number of requested OSM levels = ',io_int, 2, "(I3,'; available number = ',I3)")
    call Message('   --> Resetting requested number to maximum available')
-   osmnl%nmatch(i) = dims(1)
+   osmnl%nmatch(i) = DPF%nnk
   end if
 end do
 
-if (sum(dinl%ROI).ne.0) then
-  allocate(OSMmap( dinl%ROI(3), dinl%ROI(4) ) )
+dimsOSM = (/ DPF%wd, DPF%ht /)
+allocate(OSMmaps( dimsOSM(1), dimsOSM(2), osmnum ), OSMmap( dimsOSM(1), dimsOSM(2) ) )
+OSMmaps = 0.0
+
+! compute all requested Orientation Similarity Maps in a single pass
+! inverse-distance weighting only changes the maps if the neighbors are not all at unit distance
+nvar = 1
+if ((osmnl%distweight.eq.'y').and.(osmnl%nbtype.eq.4).and.(osmnl%radius.eq.1)) then
+  call Message(' distweight has no effect for the 4-neighborhood with radius 1; no OSMdw maps will be generated')
+else if (osmnl%distweight.eq.'y') then
+  nvar = 2
+  allocate(OSMdw( dimsOSM(1), dimsOSM(2), osmnum ))
+  call EBSDDotProductOSMMaps(DPF, osmnum, osmnl%nmatch(1:osmnum), OSMmaps, osmnl%nbtype, osmnl%radius, OSMdw)
 else
-  allocate(OSMmap( dinl%ipf_wd, dinl%ipf_ht ) )
+  call EBSDDotProductOSMMaps(DPF, osmnum, osmnl%nmatch(1:osmnum), OSMmaps, osmnl%nbtype, osmnl%radius)
 end if
-OSMmap = 0.0
+
+call closeEBSDDotProductFile(DPF)
+call h5close_EMsoft(hdferr)
 
 ! allocate memory for image
-dimsOSM = shape(OSMmap)
 allocate(TIFF_image( dimsOSM(1), dimsOSM(2) ))
 
+! the maps are also added to the dot product file
+dpfile = trim(EMsoft_getEMdatapathname())//trim(osmnl%dotproductfile)
+dpfile = EMsoft_toNativePath(dpfile)
+
 do i=1,osmnum
-! compute the Orientation Similarity Map
-  if (sum(dinl%ROI).ne.0) then
-    call EBSDgetOrientationSimilarityMap( dims, EBSDDIdata%TopMatchIndices, osmnl%nmatch(i), dinl%ROI(3), dinl%ROI(4), OSMmap)
+ do iv=1,nvar
+  if (iv.eq.1) then
+    OSMmap = OSMmaps(:,:,i)
+    vprefix = ''
+    dataset = trim(SC_OSM)//'_'
   else
-    call EBSDgetOrientationSimilarityMap( dims, EBSDDIdata%TopMatchIndices, osmnl%nmatch(i), dinl%ipf_wd, dinl%ipf_ht, OSMmap)
+    OSMmap = OSMdw(:,:,i)
+    vprefix = 'dw'
+    dataset = trim(SC_OSMdw)//'_'
   end if
 
-  ! output the ADP map as a tiff file 
+  ! output the OSM map as a tiff file 
   write(fnum,"(I2.2)") osmnl%nmatch(i)
 
 ! we need to add this as a dataset to the dot product file so that it becomes available 
@@ -153,26 +171,22 @@ do i=1,osmnum
 
   call h5open_EMsoft(hdferr)
 
-  dpfile = trim(EMsoft_getEMdatapathname())//trim(osmnl%dotproductfile)
-  dpfile = EMsoft_toNativePath(dpfile)
-
   nullify(HDF_head)
   hdferr =  HDF_openFile(dpfile, HDF_head)
+  call HDFerror_check('EMgetOSM:HDF_openFile:'//trim(dpfile), hdferr, .TRUE.)
 
 ! open the Scan 1/EBSD/Data group; dictionary indexing files only have one "scan" in them...
-  groupname = 'Scan 1'
+  groupname = SC_Scan1
     hdferr = HDF_openGroup(groupname, HDF_head)
   groupname = SC_EBSD
     hdferr = HDF_openGroup(groupname, HDF_head)
   groupname = SC_Data
     hdferr = HDF_openGroup(groupname, HDF_head)
 
-  dataset = 'OSM_'//fnum
-  if (sum(dinl%ROI).ne.0) then
-    hdferr = HDF_writeDatasetFloatArray2D(dataset, OSMmap, dinl%ROI(3), dinl%ROI(4), HDF_head)
-  else
-    hdferr = HDF_writeDatasetFloatArray2D(dataset, OSMmap, dinl%ipf_wd, dinl%ipf_ht, HDF_head)
-  end if
+! a previous run may have created the same map already
+  dataset = trim(dataset)//fnum
+  hdferr = HDF_writeDatasetFloatArray2D(dataset, OSMmap, dimsOSM(1), dimsOSM(2), HDF_head, overwrite=.TRUE.)
+  call HDFerror_check('EMgetOSM:HDF_writeDatasetFloatArray2D:'//trim(dataset), hdferr)
 
 ! and close the HDF5 dot product file
   call HDF_pop(HDF_head,.TRUE.)
@@ -180,7 +194,7 @@ do i=1,osmnum
   call h5close_EMsoft(hdferr)
 
   
-  fname = trim(EMsoft_getEMdatapathname())//trim(osmnl%tiffname)//fnum//'.tiff'
+  fname = trim(EMsoft_getEMdatapathname())//trim(osmnl%tiffname)//trim(vprefix)//fnum//'.tiff'
   fname = EMsoft_toNativePath(fname)
   TIFF_filename = trim(fname)
 
@@ -201,8 +215,33 @@ do i=1,osmnum
   end if 
 
   call im%clear()
-  OSMmap = 0.0
+ end do
 end do
 
+! record the neighborhood that was used for these maps
+call h5open_EMsoft(hdferr)
+
+nullify(HDF_head)
+hdferr =  HDF_openFile(dpfile, HDF_head)
+call HDFerror_check('EMgetOSM:HDF_openFile:'//trim(dpfile), hdferr, .TRUE.)
+
+groupname = SC_Scan1
+  hdferr = HDF_openGroup(groupname, HDF_head)
+groupname = SC_EBSD
+  hdferr = HDF_openGroup(groupname, HDF_head)
+groupname = SC_Data
+  hdferr = HDF_openGroup(groupname, HDF_head)
+
+dataset = SC_OSMnbtype
+hdferr = HDF_writeDatasetInteger(dataset, osmnl%nbtype, HDF_head, overwrite=.TRUE.)
+call HDFerror_check('EMgetOSM:HDF_writeDatasetInteger:'//trim(dataset), hdferr)
+dataset = SC_OSMradius
+hdferr = HDF_writeDatasetInteger(dataset, osmnl%radius, HDF_head, overwrite=.TRUE.)
+call HDFerror_check('EMgetOSM:HDF_writeDatasetInteger:'//trim(dataset), hdferr)
+
+call HDF_pop(HDF_head,.TRUE.)
+
+call h5close_EMsoft(hdferr)
+
 end program EMgetOSM
 
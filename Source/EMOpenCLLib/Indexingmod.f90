@@ -275,8 +275,12 @@ real(kind=sgl)                                      :: dc(3),quat(4),ixy(2),bind
 integer(kind=irg)                                   :: nix,niy,nixp,niyp
 real(kind=sgl)                                      :: euler(3)
 integer(kind=irg)                                   :: indx
-integer(kind=irg)                                   :: correctsize
-logical                                             :: f_exists, init, ROIselected, Clinked, cancelled 
+integer(kind=irg)                                   :: correctsize, veclen, kdim, nsamples
+integer(kind=irg),parameter                         :: itmpexptP = 44
+real(kind=sgl),allocatable                          :: PCAbasis(:,:), PCAsample(:,:), rexpt(:), rdict(:)
+real(kind=sgl),allocatable, target                  :: exptP(:)
+real(kind=sgl)                                      :: rdmax, rbound, efrac
+logical                                             :: f_exists, init, ROIselected, Clinked, cancelled, usePCA
 
 integer(kind=irg)                                   :: ipar(10)
 
@@ -507,9 +511,23 @@ else
     correctsize = L
 end if
 
+! in low-rank mode the GPU operates on the projections of the patterns onto the
+! leading PCAdim eigen-patterns, padded to a multiple of 16, instead of on the full patterns
+usePCA = .FALSE.
+veclen = correctsize
+if (dinl%PCAdim.gt.0) then
+    if (16*ceiling(float(dinl%PCAdim)/16.0).lt.correctsize) then
+        usePCA = .TRUE.
+        veclen = 16*ceiling(float(dinl%PCAdim)/16.0)
+    else
+        call Message('--> PCAdim is not smaller than the pattern size; using full-length dot products')
+        dinl%PCAdim = 0
+    end if
+end if
+
 ! determine the experimental and dictionary sizes in bytes
-size_in_bytes_dict = Nd*correctsize*sizeof(correctsize)
-size_in_bytes_expt = Ne*correctsize*sizeof(correctsize)
+size_in_bytes_dict = Nd*veclen*sizeof(correctsize)
+size_in_bytes_expt = Ne*veclen*sizeof(correctsize)
 recordsize_correct = correctsize*4
 patsz              = correctsize
 
@@ -518,6 +536,7 @@ write (*,*) '==================='
 write (*,*) 'Ne           : ', Ne 
 write (*,*) 'Nd           : ', Nd 
 write (*,*) 'L            : ', L 
+if (usePCA.eqv..TRUE.) write (*,*) 'veclen       : ', veclen
 write (*,*) 'size result array  : ', Ne * Nd * 4 
 write (*,*) 'size_in_bytes_dict : ', size_in_bytes_dict
 write (*,*) 'size_in_bytes_expt : ', size_in_bytes_expt
@@ -1012,6 +1031,81 @@ end if
 Nval = 1.0/float(binx*biny)
 Nval2 = 1.0/float(binx*biny-1)
 
+!=====================================================
+! LOW-RANK MATCHING SET-UP
+! The eigen-pattern basis is a truncated SVD of a strided sample of the 
+! dictionary, obtained from the eigen-decomposition of the (small) Gram matrix
+! of the sample.  All experimental patterns are projected once onto this basis
+! and stored in a second temporary file, along with the norm of the part of 
+! each pattern that lies outside the basis.  Since the basis is orthonormal,
+! the full dot product differs from the projected one by at most the product 
+! of the residual norms of the two patterns.
+!=====================================================
+if (usePCA.eqv..TRUE.) then
+  nsamples = min(dinl%PCAsamples, FZcnt)
+  kdim = min(dinl%PCAdim, nsamples)
+  io_int(1:3) = (/ kdim, veclen, nsamples /)
+  call WriteValue(' -> Low-rank matching: eigen-patterns/vector length/samples ',io_int,3,"(I5,'/',I5,'/',I8)")
+
+  allocate(PCAsample(correctsize,nsamples), PCAbasis(correctsize,veclen), stat=istat)
+  if (istat .ne. 0) stop 'could not allocate eigen-pattern arrays'
+  PCAsample = 0.0
+
+  if (trim(dinl%indexingmode).eq.'dynamic') then
+!$OMP PARALLEL DO SCHEDULE(DYNAMIC) DEFAULT(SHARED) PRIVATE(pp,jjj,quat)
+    do pp = 1,nsamples
+      jjj = int(dble(pp-1)*dble(FZcnt)/dble(nsamples)) + 1
+      quat = ro2qu(FZarray(1:4,jjj))
+      call DIDictionaryPattern(dinl,jpar,quat,accum_e_MC,mLPNH,mLPSH,EBSDdetector%rgx,EBSDdetector%rgy, &
+                               EBSDdetector%rgz,Emin,Emax,mask,masklin,prefactor,correctsize,PCAsample(1:correctsize,pp))
+    end do
+!$OMP END PARALLEL DO
+  else
+    dataset = SC_EBSDpatterns
+    dims2 = (/ correctsize, 1 /)
+    do pp = 1,nsamples
+      jjj = int(dble(pp-1)*dble(FZcnt)/dble(nsamples)) + 1
+      offset2 = (/ 0, jjj-1 /)
+      if(allocated(EBSDdictpatflt)) deallocate(EBSDdictpatflt)
+      EBSDdictpatflt = HDF_readHyperslabFloatArray2D(dataset, offset2, dims2, HDF_head)
+      PCAsample(1:correctsize,pp) = EBSDdictpatflt(1:correctsize,1)
+    end do
+  end if
+
+  call DIEigenPatternBasis(PCAsample, correctsize, nsamples, kdim, veclen, PCAbasis, efrac)
+  deallocate(PCAsample)
+  io_real(1) = 100.0*efrac
+  call WriteValue(' -> Fraction of sampled dictionary energy captured by the basis (%) ',io_real,1,"(F8.3)")
+
+! project all the experimental patterns onto the basis
+  allocate(exptP(Ne*veclen), rexpt(totnumexpt), rdict(Nd), stat=istat)
+  if (istat .ne. 0) stop 'could not allocate projected pattern arrays'
+  open(unit=itmpexptP,file=trim(fname)//'.pca',&
+       status='unknown',form='unformatted',access='direct',recl=veclen*4,iostat=ierr)
+
+  do jj = 1,cratioE
+    expt = 0.0
+    do pp = 1,ppendE(jj)
+      read(itmpexpt,rec=(jj-1)*Ne+pp) tmpimageexpt
+      expt((pp-1)*correctsize+1:pp*correctsize) = tmpimageexpt
+    end do
+!$OMP PARALLEL DO SCHEDULE(DYNAMIC) DEFAULT(SHARED) PRIVATE(pp,ll)
+    do pp = 1,ppendE(jj)
+      do ll = 1,veclen
+        exptP((pp-1)*veclen+ll) = dot_product(expt((pp-1)*correctsize+1:pp*correctsize), PCAbasis(1:correctsize,ll))
+      end do
+      rexpt((jj-1)*Ne+pp) = sqrt(max(0.0, dot_product(expt((pp-1)*correctsize+1:pp*correctsize), &
+                                                      expt((pp-1)*correctsize+1:pp*correctsize)) - &
+                                          dot_product(exptP((pp-1)*veclen+1:pp*veclen), exptP((pp-1)*veclen+1:pp*veclen)) ))
+    end do
+!$OMP END PARALLEL DO
+    do pp = 1,ppendE(jj)
+      write(itmpexptP,rec=(jj-1)*Ne+pp) exptP((pp-1)*veclen+1:pp*veclen)
+    end do
+  end do
+  call Message(' -> completed projection of experimental patterns')
+end if
+
 
 dictionaryloop: do ii = 1,cratio+1
     results = 0.0
@@ -1053,16 +1147,34 @@ dictionaryloop: do ii = 1,cratio+1
         end if
       end if
 
-      allocate(dicttranspose(Nd*correctsize))
+      allocate(dicttranspose(Nd*veclen))
       dicttranspose = 0.0
       
+      if (usePCA.eqv..TRUE.) then
+! project the dictionary chunk and keep the largest residual norm for the re-scoring test
 !$OMP PARALLEL DO DEFAULT(SHARED) PRIVATE(ll,mm) SCHEDULE(DYNAMIC)
-      do ll = 1,correctsize
         do mm = 1,Nd
-            dicttranspose((ll-1)*Nd+mm) = T0dict((mm-1)*correctsize+ll)
+          do ll = 1,veclen
+            dicttranspose((ll-1)*Nd+mm) = dot_product(T0dict((mm-1)*correctsize+1:mm*correctsize), &
+                                                      PCAbasis(1:correctsize,ll))
+          end do
+          rdict(mm) = sqrt(max(0.0, dot_product(T0dict((mm-1)*correctsize+1:mm*correctsize), &
+                                                T0dict((mm-1)*correctsize+1:mm*correctsize)) - &
+                                    sum(dicttranspose(mm:(veclen-1)*Nd+mm:Nd)**2) ))
         end do
-      end do
 !$OMP END PARALLEL DO 
+        rdmax = maxval(rdict)
+        rbound = rdmax
+        if (dinl%similaritymetric.eq.'ncc') rbound = rdmax * Nval
+      else
+!$OMP PARALLEL DO DEFAULT(SHARED) PRIVATE(ll,mm) SCHEDULE(DYNAMIC)
+        do ll = 1,correctsize
+          do mm = 1,Nd
+              dicttranspose((ll-1)*Nd+mm) = T0dict((mm-1)*correctsize+ll)
+          end do
+        end do
+!$OMP END PARALLEL DO 
+      end if
      
       ierr = clEnqueueWriteBuffer(command_queue, cl_dict, CL_TRUE, 0_8, size_in_bytes_dict, C_LOC(dicttranspose(1)), &
                                   0, C_NULL_PTR, C_NULL_PTR)
@@ -1080,11 +1192,20 @@ dictionaryloop: do ii = 1,cratio+1
           expt((pp-1)*correctsize+1:pp*correctsize) = tmpimageexpt
         end do
 
-        ierr = clEnqueueWriteBuffer(command_queue, cl_expt, CL_TRUE, 0_8, size_in_bytes_expt, C_LOC(expt(1)), &
-                                    0, C_NULL_PTR, C_NULL_PTR)
+        if (usePCA.eqv..TRUE.) then
+          exptP = 0.0
+          do pp = 1,ppendE(jj)
+            read(itmpexptP,rec=(jj-1)*Ne+pp) exptP((pp-1)*veclen+1:pp*veclen)
+          end do
+          ierr = clEnqueueWriteBuffer(command_queue, cl_expt, CL_TRUE, 0_8, size_in_bytes_expt, C_LOC(exptP(1)), &
+                                      0, C_NULL_PTR, C_NULL_PTR)
+        else
+          ierr = clEnqueueWriteBuffer(command_queue, cl_expt, CL_TRUE, 0_8, size_in_bytes_expt, C_LOC(expt(1)), &
+                                      0, C_NULL_PTR, C_NULL_PTR)
+        end if
         call CLerror_check('EBSDDISubroutine:clEnqueueWriteBuffer:cl_expt', ierr)
         
-        call InnerProdGPU(cl_expt,cl_dict,Ne,Nd,correctsize,results,numd,dinl%devid,kernel,context,command_queue)
+        call InnerProdGPU(cl_expt,cl_dict,Ne,Nd,veclen,results,numd,dinl%devid,kernel,context,command_queue)
         
         if (dinl%similaritymetric.eq.'ncc') results = results * Nval
 
@@ -1102,15 +1223,26 @@ dictionaryloop: do ii = 1,cratio+1
 ! sorting is conditional on the max value of the new dot products [suggested by D. Rowenhorst]
 ! this causes an overall program speed up by a factor of 2 (does depend on data set a little)
        
-!$OMP PARALLEL DO DEFAULT(SHARED) PRIVATE(qq,jjj,resultarray,indexarray ) SCHEDULE(DYNAMIC)
+!$OMP PARALLEL DO DEFAULT(SHARED) PRIVATE(qq,jjj,ll,mm,resultarray,indexarray ) SCHEDULE(DYNAMIC)
         do qq = 1,ppendE(jj)
             jjj = (jj-1)*Ne+qq
             maxsortarr(jjj) = maxval(results((qq-1)*Nd+1:qq*Nd))
+! in low-rank mode, a projected value can underestimate the full one by at most rexpt*rdmax
+            if (usePCA.eqv..TRUE.) maxsortarr(jjj) = maxsortarr(jjj) + rexpt(jjj)*rbound
             if (maxsortarr(jjj).gt.minsortarr(jjj)) then
               resultarray(1:Nd) = results((qq-1)*Nd+1:qq*Nd)
               indexarray(1:Nd) = indexlist((iii-1)*Nd+1:iii*Nd)
 
               call SSORT(resultarray,indexarray,Nd,-2)
+! re-score the top nnk projected candidates with full-length dot products
+              if (usePCA.eqv..TRUE.) then
+                do ll = 1,nnk
+                  mm = indexarray(ll) - (iii-1)*Nd
+                  resultarray(ll) = dot_product(expt((qq-1)*correctsize+1:qq*correctsize), &
+                                                T0dict((mm-1)*correctsize+1:mm*correctsize))
+                end do
+                if (dinl%similaritymetric.eq.'ncc') resultarray(1:nnk) = resultarray(1:nnk) * Nval
+              end if
               resulttmp(nnk+1:2*nnk,jjj) = resultarray(1:nnk)
               indextmp(nnk+1:2*nnk,jjj) = indexarray(1:nnk)
 
@@ -1192,11 +1324,6 @@ dictionaryloop: do ii = 1,cratio+1
 
 ! here we carry out the dictionary pattern computation, unless we are in the ii=cratio+1 step
 !$OMP SECTION
-    allocate(EBSDpatterninteger(binx,biny))
-    EBSDpatterninteger = 0
-    allocate(EBSDpatternad(binx,biny),EBSDpatternintd(binx,biny))
-    EBSDpatternad = 0.0
-    EBSDpatternintd = 0.0
     allocate(imagedictflt(correctsize),imagedictfltflip(correctsize))
 
 
@@ -1210,66 +1337,13 @@ dictionaryloop: do ii = 1,cratio+1
      end if
 
      if (trim(dinl%indexingmode).eq.'dynamic') then
-      allocate(binned(binx,biny))
-      
-!$OMP PARALLEL DO SCHEDULE(DYNAMIC) DEFAULT(SHARED) PRIVATE(qq,binned, quat,TID,iii,jj,ll,mm,pp,ierr,io_int, &
-!$OMP& vlen,  EBSDdictpatflt, ma, mi, &
-!$OMP& EBSDpatternintd, EBSDpatterninteger, EBSDpatternad, imagedictflt, imagedictfltflip,  &
-!$OMP& mean, sdev)
+!$OMP PARALLEL DO SCHEDULE(DYNAMIC) DEFAULT(SHARED) PRIVATE(pp, quat, imagedictflt)
       do pp = 1,ppend(ii)  !Nd or MODULO(FZcnt,Nd)
        if (cancelled.eqv..FALSE.) then
-         binned = 0.0
          quat = ro2qu(FZarray(1:4,(ii-1)*Nd+pp))
 
-         call CalcEBSDPatternSingleFull(jpar,quat,accum_e_MC,mLPNH,mLPSH,EBSDdetector%rgx,&
-                                        EBSDdetector%rgy,EBSDdetector%rgz,binned,Emin,Emax,mask,prefactor)
-
-
-         if (dinl%scalingmode .eq. 'gam') then
-           binned = binned**dinl%gammavalue
-         end if
-
-! hi pass filtering (disabled)
-!      rdata = dble(binned)
-!      fdata = HiPassFilter(rdata,dims,w)
-!      binned = sngl(fdata)
-
-
-         if (dinl%similaritymetric.eq.'ndp') then 
-! adaptive histogram equalization
-           ma = maxval(binned)
-           mi = minval(binned)
-           
-           EBSDpatternintd = ((binned - mi)/ (ma-mi))
-           EBSDpatterninteger = nint(EBSDpatternintd*255.0)
-           EBSDpatternad =  adhisteq(dinl%nregions,binx,biny,EBSDpatterninteger)
-           binned = float(EBSDpatternad)
-         else  ! use normalized cross correlation 
-           binned = binned * mask
-           mean = sum(binned) * Nval
-           binned = binned - mean 
-           sdev = sqrt(Nval2 * sum( binned*binned ))
-           binned = binned / sdev 
-         end if 
-
-         imagedictflt = 0.0
-         imagedictfltflip = 0.0
-         do ll = 1,biny
-           do mm = 1,binx
-             imagedictflt((ll-1)*binx+mm) = binned(mm,ll)
-           end do
-         end do
-
-! normalize and apply circular mask 
-         if (dinl%similaritymetric.eq.'ndp') then 
-           imagedictflt(1:L) = imagedictflt(1:L) * masklin(1:L)
-           vlen = vecnorm(imagedictflt(1:correctsize))
-           if (vlen.ne.0.0) then
-             imagedictflt(1:correctsize) = imagedictflt(1:correctsize)/vlen
-           else
-             imagedictflt(1:correctsize) = 0.0
-           end if
-         end if 
+         call DIDictionaryPattern(dinl,jpar,quat,accum_e_MC,mLPNH,mLPSH,EBSDdetector%rgx,EBSDdetector%rgy, &
+                                  EBSDdetector%rgz,Emin,Emax,mask,masklin,prefactor,correctsize,imagedictflt)
          
          dict((pp-1)*correctsize+1:pp*correctsize) = imagedictflt(1:correctsize)
 
@@ -1278,7 +1352,6 @@ dictionaryloop: do ii = 1,cratio+1
       end do
 !$OMP END PARALLEL DO
      
-      deallocate(binned)
     else  ! we are doing static indexing, so only 2 threads in total
 
 ! get a set of patterns from the precomputed dictionary file... 
@@ -1310,7 +1383,7 @@ dictionaryloop: do ii = 1,cratio+1
     end if
    end if
 
-   deallocate(EBSDpatterninteger,EBSDpatternad,EBSDpatternintd,imagedictflt,imagedictfltflip)
+   deallocate(imagedictflt,imagedictfltflip)
 
 ! and we end the parallel section here (all threads will synchronize).
 !$OMP END SECTIONS NOWAIT
@@ -1336,6 +1409,7 @@ if (cancelled.eqv..FALSE.) then
   else
       close(itmpexpt,status='keep')
   end if
+  if (usePCA.eqv..TRUE.) close(itmpexptP,status='delete')
 
 ! release the OpenCL kernel
   ierr = clReleaseKernel(kernel)
@@ -1422,6 +1496,201 @@ end if
   
 end subroutine EBSDDIdriver
 
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE:DIDictionaryPattern
+!
+!> @brief compute a single pre-processed dictionary pattern for dynamic indexing
+!
+!> @details This applies the same intensity scaling, histogram equalization (ndp) or 
+!> mean/standard deviation normalization (ncc), masking and vector normalization that 
+!> are applied to the experimental patterns; the pattern is returned as a vector of 
+!> length correctsize, padded with zeroes.
+!
+!> @param dinl indexing name list
+!> @param jpar integer parameter array for CalcEBSDPatternSingleFull
+!> @param quat orientation quaternion
+!> @param accum_e_MC detector energy weights
+!> @param mLPNH Northern hemisphere master pattern
+!> @param mLPSH Southern hemisphere master pattern
+!> @param rgx, rgy, rgz detector direction cosine arrays
+!> @param Emin, Emax energy integration range
+!> @param mask 2D pattern mask
+!> @param masklin linear pattern mask
+!> @param prefactor intensity prefactor
+!> @param correctsize padded pattern vector length
+!> @param imagedictflt output pattern vector
+!--------------------------------------------------------------------------
+recursive subroutine DIDictionaryPattern(dinl, jpar, quat, accum_e_MC, mLPNH, mLPSH, rgx, rgy, rgz, Emin, Emax, &
+                                         mask, masklin, prefactor, correctsize, imagedictflt)
+!DEC$ ATTRIBUTES DLLEXPORT :: DIDictionaryPattern
+
+use local
+use EBSDmod
+use filters
+use math
+
+IMPLICIT NONE
+
+type(EBSDIndexingNameListType),INTENT(IN)       :: dinl
+integer(kind=irg),INTENT(IN)                    :: jpar(7)
+real(kind=sgl),INTENT(IN)                       :: quat(4)
+real(kind=sgl),INTENT(IN)                       :: accum_e_MC(jpar(6),jpar(2),jpar(3))
+real(kind=sgl),INTENT(IN)                       :: mLPNH(-jpar(4):jpar(4),-jpar(5):jpar(5),jpar(7))
+real(kind=sgl),INTENT(IN)                       :: mLPSH(-jpar(4):jpar(4),-jpar(5):jpar(5),jpar(7))
+real(kind=sgl),INTENT(IN)                       :: rgx(jpar(2),jpar(3))
+real(kind=sgl),INTENT(IN)                       :: rgy(jpar(2),jpar(3))
+real(kind=sgl),INTENT(IN)                       :: rgz(jpar(2),jpar(3))
+integer(kind=irg),INTENT(IN)                    :: Emin, Emax
+real(kind=sgl),INTENT(IN)                       :: mask(jpar(2),jpar(3))
+real(kind=sgl),INTENT(IN)                       :: masklin(jpar(2)*jpar(3))
+real(kind=dbl),INTENT(IN)                       :: prefactor
+integer(kind=irg),INTENT(IN)                    :: correctsize
+real(kind=sgl),INTENT(OUT)                      :: imagedictflt(correctsize)
+
+real(kind=sgl),allocatable                      :: binned(:,:), EBSDpatternintd(:,:)
+integer(kind=irg),allocatable                   :: EBSDpatterninteger(:,:), EBSDpatternad(:,:)
+integer(kind=irg)                               :: binx, biny, L, ll, mm
+real(kind=sgl)                                  :: ma, mi, mean, sdev, vlen, Nval, Nval2
+
+binx = jpar(2)
+biny = jpar(3)
+L = binx*biny
+Nval = 1.0/float(L)
+Nval2 = 1.0/float(L-1)
+
+allocate(binned(binx,biny))
+binned = 0.0
+
+call CalcEBSDPatternSingleFull(jpar,quat,accum_e_MC,mLPNH,mLPSH,rgx,rgy,rgz,binned,Emin,Emax,mask,prefactor)
+
+if (dinl%scalingmode .eq. 'gam') then
+  binned = binned**dinl%gammavalue
+end if
+
+if (dinl%similaritymetric.eq.'ndp') then 
+! adaptive histogram equalization
+  allocate(EBSDpatternintd(binx,biny), EBSDpatterninteger(binx,biny), EBSDpatternad(binx,biny))
+  ma = maxval(binned)
+  mi = minval(binned)
+
+  EBSDpatternintd = ((binned - mi)/ (ma-mi))
+  EBSDpatterninteger = nint(EBSDpatternintd*255.0)
+  EBSDpatternad =  adhisteq(dinl%nregions,binx,biny,EBSDpatterninteger)
+  binned = float(EBSDpatternad)
+  deallocate(EBSDpatternintd, EBSDpatterninteger, EBSDpatternad)
+else  ! use normalized cross correlation 
+  binned = binned * mask
+  mean = sum(binned) * Nval
+  binned = binned - mean 
+  sdev = sqrt(Nval2 * sum( binned*binned ))
+  binned = binned / sdev 
+end if 
+
+imagedictflt = 0.0
+do ll = 1,biny
+  do mm = 1,binx
+    imagedictflt((ll-1)*binx+mm) = binned(mm,ll)
+  end do
+end do
+deallocate(binned)
+
+! normalize and apply circular mask 
+if (dinl%similaritymetric.eq.'ndp') then 
+  imagedictflt(1:L) = imagedictflt(1:L) * masklin(1:L)
+  vlen = vecnorm(imagedictflt(1:correctsize))
+  if (vlen.ne.0.0) then
+    imagedictflt(1:correctsize) = imagedictflt(1:correctsize)/vlen
+  else
+    imagedictflt(1:correctsize) = 0.0
+  end if
+end if 
+
+end subroutine DIDictionaryPattern
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE:DIEigenPatternBasis
+!
+!> @brief compute an orthonormal eigen-pattern basis from a sample of dictionary patterns
+!
+!> @details The basis vectors are the leading left singular vectors of the sample matrix; 
+!> they are obtained from the eigenvectors of the nsamples x nsamples Gram matrix, 
+!> which is much smaller than the pattern covariance matrix.  No mean is subtracted,
+!> since the basis must preserve dot products.  Basis vectors beyond kdim (padding up to 
+!> veclen) and vectors belonging to vanishing eigenvalues are set to zero.
+!
+!> @param S sample patterns, one per column
+!> @param correctsize padded pattern vector length
+!> @param nsamples number of sample patterns
+!> @param kdim number of eigen-patterns to keep
+!> @param veclen number of columns in the basis array (kdim padded to a multiple of 16)
+!> @param U output basis
+!> @param efrac fraction of the sample energy captured by the basis
+!--------------------------------------------------------------------------
+recursive subroutine DIEigenPatternBasis(S, correctsize, nsamples, kdim, veclen, U, efrac)
+!DEC$ ATTRIBUTES DLLEXPORT :: DIEigenPatternBasis
+
+use local
+use error
+
+IMPLICIT NONE
+
+integer(kind=irg),INTENT(IN)                    :: correctsize
+integer(kind=irg),INTENT(IN)                    :: nsamples
+integer(kind=irg),INTENT(IN)                    :: kdim
+integer(kind=irg),INTENT(IN)                    :: veclen
+real(kind=sgl),INTENT(IN)                       :: S(correctsize,nsamples)
+real(kind=sgl),INTENT(OUT)                      :: U(correctsize,veclen)
+real(kind=sgl),INTENT(OUT)                      :: efrac
+
+real(kind=dbl),allocatable                      :: Sd(:,:), G(:,:), W(:), WORK(:), v(:)
+real(kind=dbl)                                  :: wquery(1)
+integer(kind=irg)                               :: i, j, LWORK, INFO
+character                                       :: JOBZ, UPLO
+
+allocate(Sd(correctsize,nsamples), G(nsamples,nsamples), W(nsamples), v(correctsize))
+Sd = dble(S)
+
+! upper triangle of the Gram matrix
+!$OMP PARALLEL DO DEFAULT(SHARED) PRIVATE(i,j) SCHEDULE(DYNAMIC)
+do j = 1,nsamples
+  do i = 1,j
+    G(i,j) = dot_product(Sd(1:correctsize,i), Sd(1:correctsize,j))
+  end do
+end do
+!$OMP END PARALLEL DO
+
+! eigenvalues are returned in ascending order
+JOBZ = 'V'
+UPLO = 'U'
+LWORK = -1
+call DSYEV(JOBZ, UPLO, nsamples, G, nsamples, W, wquery, LWORK, INFO)
+LWORK = int(wquery(1))
+allocate(WORK(LWORK))
+call DSYEV(JOBZ, UPLO, nsamples, G, nsamples, W, WORK, LWORK, INFO)
+if (INFO.ne.0) call FatalError('DIEigenPatternBasis','eigenvalue decomposition of the Gram matrix failed')
+deallocate(WORK)
+
+U = 0.0
+do j = 1,kdim
+  i = nsamples-j+1
+  if (W(i).gt.W(nsamples)*1.D-12) then 
+    v = matmul(Sd, G(1:nsamples,i))
+    U(1:correctsize,j) = sngl(v/dsqrt(W(i)))
+  end if
+end do
+
+if (sum(W).gt.0.D0) then
+  efrac = sngl(sum(W(nsamples-kdim+1:nsamples))/sum(W))
+else
+  efrac = 0.0
+end if
+
+deallocate(Sd, G, W, v)
+
+end subroutine DIEigenPatternBasis
+
 
 !--------------------------------------------------------------------------
 !
@@ -45,9 +45,17 @@ use math
 use local
 use typedefs
 use stringconstants
+use HDFsupport, only : HDFobjectStackType
 
 IMPLICIT NONE
 
+! handle for an open dot product file; the HDF stack is positioned in the Data group so that
+! row ranges of the individual data sets can be read on demand (see openEBSDDotProductFile)
+type EBSDDotProductFileType
+        type(HDFobjectStackType)        :: HDF_head
+        integer(kind=irg)               :: wd=0, ht=0, nnk=0, FZcnt=0, pgnum=0
+        logical                         :: isopen=.FALSE.
+end type EBSDDotProductFileType
 
 contains
 
@@ -97,7 +105,7 @@ use EBSDiomod
 use files
 use dictmod
 use bobyqa_refinement,only:bobyqa
-use FitOrientations,only:EMFitOrientationcalfunEBSD
+use FitOrientations,only:EMFitOrientationcalfunEBSD, EMFitOrientationLMEBSD
 use stringconstants
 use commonmod
 
@@ -116,6 +124,8 @@ type(EBSDNameListType)                    :: ebsdnl, myebsdnl
 type(EBSDMCdataType)                      :: EBSDMCdata
 type(EBSDMPdataType)                      :: EBSDMPdata
 type(EBSDDetectorType)                    :: EBSDdetector, myEBSDdetector
+type(EBSDDetectorCacheType)               :: mycache
+type(EBSDEnergyClusterType)               :: energyclusters
 type(EBSDDIdataType)                      :: EBSDDIdata
   
 logical                                   :: stat, readonly, noindex, ROIselected
@@ -130,7 +140,8 @@ real(kind=dbl)                            :: rhozero(4), hipassw
   
 real(kind=sgl),allocatable                :: euPS(:,:), euler_bestmatch(:,:,:), CIlist(:), CMarray(:,:,:)
 integer(kind=irg),allocatable             :: indexmain(:,:) 
-real(kind=sgl),allocatable                :: resultmain(:,:), DPCX(:), DPCY(:), DPCL(:) 
+real(kind=sgl),allocatable                :: resultmain(:,:), DPCX(:), DPCY(:), DPCL(:), pcinit(:,:)
+real(kind=dbl)                            :: pcm(6,3)
 integer(HSIZE_T)                          :: dims(1),dims2D(2),dims3(3),offset3(3) 
 
 character(fnlen, KIND=c_char),allocatable,TARGET    :: stringarray(:)
@@ -145,6 +156,7 @@ real(kind=sgl),allocatable                :: INITMEANVAL(:)
 real(kind=dbl)                            :: RHOBEG, RHOEND
 integer(kind=irg)                         :: NPT, N, IPRINT, NSTEP, NINIT
 integer(kind=irg),parameter               :: MAXFUN = 10000
+integer(kind=irg),parameter               :: MAXLMEVAL = 12
 logical                                   :: verbose
   
 logical                                   :: f_exists, init, g_exists, overwrite
@@ -165,7 +177,7 @@ real(kind=sgl)                            :: quat(4), quat2(4), qq(4), ma, mi, d
                                              vlen, avec(3), dtor, alpha, ca, sa, c2a, s2a, nn(3), omega, dx, dy, rho
 real(kind=dbl)                            :: qu(4), rod(4) 
 integer(kind=irg)                         :: ipar(10), Emin, Emax, nthreads, TID, io_int(2), tickstart, ierr, L, nvar, niter,i,j, &
-                                             samplex, sampley, maxeindex, unchanged
+                                             samplex, sampley, maxeindex, unchanged, pcwd, pcht
 integer(kind=irg)                         :: ll, mm, jpar(7), Nexp, pgnum, FZcnt, nlines, dims2(2), correctsize, totnumexpt, mystat
   
 real(kind=dbl)                            :: prefactor, F, angleaxis(4)
@@ -290,6 +302,16 @@ else
     totnumexpt = dinl%ipf_wd*dinl%ipf_ht
 end if
 
+! the pattern center model refinement revisits its sample patterns in every iteration
+if (trim(ronl%PCmodel).ne.'none') then
+  if ((trim(ronl%PCmodel).ne.'plane').and.(trim(ronl%PCmodel).ne.'quadratic')) then
+    call FatalError('EMEBSDrefinement','PCmodel must be one of none, plane, or quadratic')
+  end if
+  if (ronl%inRAM.eqv..FALSE.) then
+    call FatalError('EMEBSDrefinement','the pattern center model refinement requires inRAM = .TRUE.')
+  end if
+end if
+
 !===================================================================================
 !===============READ MASTER AND MC FILE=============================================
 !===================================================================================
@@ -367,6 +389,25 @@ jpar(6) = EBSDMCdata%numEbins
 jpar(7) = EBSDMCdata%numEbins
 !jpar(7) = dinl%nE
 
+! optionally replace the energy bins by a few effective energy clusters; the collapsed master
+! patterns and detector weights are used for all pattern computations below
+if (ronl%energyaverage.gt.0) then
+  call InitEBSDEnergyClusters(jpar,EBSDdetector%accum_e_detector,EBSDMPdata%mLPNH,EBSDMPdata%mLPSH,Emin,Emax, &
+                              ronl%energyaverage,energyclusters)
+  io_int(1:2) = (/ Emax-Emin+1, energyclusters%nclus /)
+  call WriteValue(' Number of energy bins collapsed onto number of energy clusters : ',io_int,2,"(I4,' -> ',I4)")
+  io_real(1:2) = (/ energyclusters%meanerr, energyclusters%maxerr /)
+  call WriteValue(' Energy cluster weight misfit (mean, max) : ',io_real,2)
+
+  call move_alloc(energyclusters%accum, EBSDdetector%accum_e_detector)
+  call move_alloc(energyclusters%mLPNH, EBSDMPdata%mLPNH)
+  call move_alloc(energyclusters%mLPSH, EBSDMPdata%mLPSH)
+  jpar(6) = energyclusters%nclus
+  jpar(7) = energyclusters%nclus
+  Emin = 1
+  Emax = energyclusters%nclus
+end if
+
 IPAR2(1:7) = jpar(1:7)
 IPAR2(8) = Emin
 IPAR2(9) = Emax
@@ -691,7 +732,8 @@ unchanged = 0
 ! end if 
 
 ! depending on the ronl%method, we perform the optimization with different routines...
-if (ronl%method.eq.'FIT') then 
+! ('LMA' follows the 'FIT' path, but replaces bobyqa by the gradient-based Levenberg-Marquardt solver)
+if ((ronl%method.eq.'FIT').or.(ronl%method.eq.'LMA')) then 
 
     call Message(' --> Starting regular refinement loop')
 
@@ -709,7 +751,7 @@ if (ronl%method.eq.'FIT') then
         
     !$OMP PARALLEL DEFAULT(SHARED) PRIVATE(TID,ii,tmpimageexpt,jj,qu,qq,quat,quat2,binned,ma,mi,eindex) &
     !$OMP& PRIVATE(EBSDpatternintd,EBSDpatterninteger,EBSDpatternad,imagedictflt,kk,ll,mm, myebsdnl) &
-    !$OMP& PRIVATE(X,XL,XU,STEPSIZE,INITMEANVAL,dpPS,eulerPS,eurfz,euinp,pos, mystat, myEBSDdetector) &
+    !$OMP& PRIVATE(X,XL,XU,STEPSIZE,INITMEANVAL,dpPS,eulerPS,eurfz,euinp,pos, mystat, myEBSDdetector, mycache) &
     !$OMP& PRIVATE(samplex, sampley, dx, dy, rho, nn, omega)
           
           allocate(X(N),XL(N),XU(N),INITMEANVAL(N),STEPSIZE(N))
@@ -735,6 +777,7 @@ if (ronl%method.eq.'FIT') then
                      myEBSDdetector%rgy(binx,biny), &
                      myEBSDdetector%rgz(binx,biny), &
                      myEBSDdetector%accum_e_detector(EBSDMCdata%numEbins,binx,biny), stat=mystat)
+            call InitEBSDDetectorCache(mycache, ronl%PCcachesize, ronl%PCquantum, EBSDMCdata%numEbins, binx, biny)
           end if 
 
           TID = OMP_GET_THREAD_NUM()
@@ -753,6 +796,27 @@ if (ronl%method.eq.'FIT') then
                 tmpimageexpt = exptpatterns(:,jj)
             end if
 
+! the pattern center correction depends only on the sampling point, so the corresponding
+! detector is generated once per pattern (energy weights from the per-thread detector cache)
+            if (trim(ronl%PCcorrection).eq.'on') then 
+              if (ROIselected.eqv..TRUE.) then 
+                samplex = mod(eindex-1, dinl%ROI(3))+1
+                sampley = (eindex-1)/dinl%ROI(3)+1
+              else 
+                samplex = mod(eindex-1, dinl%ipf_wd)+1
+                sampley = (eindex-1)/dinl%ipf_wd+1
+              end if 
+              myebsdnl = ebsdnl 
+              dx = DPCX(samplex)
+              dy = DPCY(sampley)
+              myebsdnl%xpc = ebsdnl%xpc - dx
+              myebsdnl%ypc = ebsdnl%ypc - dy
+              myebsdnl%L = ebsdnl%L - DPCL(sampley)
+              call GetCachedEBSDDetector(myebsdnl, mcnl, EBSDMCdata, mycache, myEBSDdetector)
+              if (ronl%energyaverage.gt.0) call CollapseEBSDEnergyWeights(energyclusters, EBSDMCdata%numEbins, &
+                                                                          binx, biny, myEBSDdetector%accum_e_detector)
+            end if
+
     ! calculate the dot product for each of the orientations in the neighborhood of the best match
     ! including the pseudosymmetric variant; do this for all the selected top matches (matchdepth)
             do kk = 1, ronl%matchdepth    
@@ -772,10 +836,16 @@ if (ronl%method.eq.'FIT') then
                     INITMEANVAL(1:3) = eu2ho(eurfz(1:3)) 
                     
                     X = 0.5D0
-                    call bobyqa (IPAR2, INITMEANVAL, tmpimageexpt, N, NPT, X, XL,&
+                    if (ronl%method.eq.'LMA') then
+                      call EMFitOrientationLMEBSD(IPAR2, INITMEANVAL, tmpimageexpt, EBSDdetector%accum_e_detector, &
+                               EBSDMPdata%mLPNH, EBSDMPdata%mLPSH, N, X, mask, prefactor, EBSDdetector%rgx, &
+                               EBSDdetector%rgy, EBSDdetector%rgz, STEPSIZE, dinl%gammavalue, MAXLMEVAL)
+                    else
+                      call bobyqa (IPAR2, INITMEANVAL, tmpimageexpt, N, NPT, X, XL,&
                              XU, RHOBEG, RHOEND, IPRINT, MAXFUN, EMFitOrientationcalfunEBSD, EBSDdetector%accum_e_detector,&
                              EBSDMPdata%mLPNH, EBSDMPdata%mLPSH, mask, prefactor, EBSDdetector%rgx, EBSDdetector%rgy, &
                              EBSDdetector%rgz, STEPSIZE, dinl%gammavalue, verbose)
+                    end if
                 
                     eulerPS(1:3,kk,ll) = ho2eu((/X(1)*2.0*STEPSIZE(1) - STEPSIZE(1) + INITMEANVAL(1), &
                                                  X(2)*2.0*STEPSIZE(2) - STEPSIZE(2) + INITMEANVAL(2), &
@@ -793,22 +863,6 @@ if (ronl%method.eq.'FIT') then
 ! to get the final corrected orientation.  At the end, we make sure the new orientation falls in 
 ! the appropriate RFZ.
                     if ( (trim(ronl%PCcorrection).eq.'on') .and. (eindex.le.maxeindex) ) then 
-! get the corrected pattern center coordinates
-                      if (ROIselected.eqv..TRUE.) then 
-                        samplex = mod(eindex-1, dinl%ROI(3))+1
-                        sampley = (eindex-1)/dinl%ROI(3)+1
-                      else 
-                        samplex = mod(eindex-1, dinl%ipf_wd)+1
-                        sampley = (eindex-1)/dinl%ipf_wd+1
-                      end if 
-                      myebsdnl = ebsdnl 
-                      dx = DPCX(samplex)
-                      dy = DPCY(sampley)
-                      myebsdnl%xpc = ebsdnl%xpc - dx
-                      myebsdnl%ypc = ebsdnl%ypc - dy
-                      myebsdnl%L = ebsdnl%L - DPCL(sampley)
-                      call GenerateEBSDDetector(myebsdnl, mcnl, EBSDMCdata, myEBSDdetector, verbose=.FALSE.)
-
 ! first undo the pattern center shift by an equivalent rotation (see J. Appl. Cryst. (2017). 50, 1664–1676, eq.15)
                       if ((dx.ne.0.0).or.(dy.ne.0.0)) then 
                         qu = eu2qu(eulerPS(1:3,kk,ll))
@@ -824,16 +878,25 @@ if (ronl%method.eq.'FIT') then
 
 ! refine the orientation using the new detector array and initial orientation 
                       X = 0.5D0
-                      call bobyqa (IPAR2, INITMEANVAL, tmpimageexpt, N, NPT, X, XL,&
-                               XU, RHOBEG, RHOEND, IPRINT, MAXFUN, EMFitOrientationcalfunEBSD, myEBSDdetector%accum_e_detector,&
+                      if (ronl%method.eq.'LMA') then
+                        call EMFitOrientationLMEBSD(IPAR2, INITMEANVAL, tmpimageexpt, &
+                               myEBSDdetector%accum_e_detector(1:IPAR2(6),:,:), &
+                               EBSDMPdata%mLPNH, EBSDMPdata%mLPSH, N, X, mask, prefactor, myEBSDdetector%rgx, &
+                               myEBSDdetector%rgy, myEBSDdetector%rgz, STEPSIZE, dinl%gammavalue, MAXLMEVAL)
+                      else
+                        call bobyqa (IPAR2, INITMEANVAL, tmpimageexpt, N, NPT, X, XL,&
+                               XU, RHOBEG, RHOEND, IPRINT, MAXFUN, EMFitOrientationcalfunEBSD, &
+                               myEBSDdetector%accum_e_detector(1:IPAR2(6),:,:), &
                                EBSDMPdata%mLPNH, EBSDMPdata%mLPSH, mask, prefactor, myEBSDdetector%rgx, myEBSDdetector%rgy, &
                                myEBSDdetector%rgz, STEPSIZE, dinl%gammavalue, verbose)
+                      end if
                   
                       eulerPS(1:3,kk,ll) = ho2eu((/X(1)*2.0*STEPSIZE(1) - STEPSIZE(1) + INITMEANVAL(1), &
                                                    X(2)*2.0*STEPSIZE(2) - STEPSIZE(2) + INITMEANVAL(2), &
                                                    X(3)*2.0*STEPSIZE(3) - STEPSIZE(3) + INITMEANVAL(3)/)) 
 
-                      call EMFitOrientationcalfunEBSD(IPAR2, INITMEANVAL, tmpimageexpt, myEBSDdetector%accum_e_detector, &
+                      call EMFitOrientationcalfunEBSD(IPAR2, INITMEANVAL, tmpimageexpt, &
+                                          myEBSDdetector%accum_e_detector(1:IPAR2(6),:,:), &
                                           EBSDMPdata%mLPNH, EBSDMPdata%mLPSH, N, X, F, mask, prefactor, &
                                           myEBSDdetector%rgx, myEBSDdetector%rgy, myEBSDdetector%rgz, STEPSIZE, &
                                           dinl%gammavalue, verbose)
@@ -876,6 +939,7 @@ if (ronl%method.eq.'FIT') then
         if (trim(ronl%PCcorrection).eq.'on') then
           deallocate(myEBSDdetector%rgx, myEBSDdetector%rgy)
           deallocate(myEBSDdetector%rgz, myEBSDdetector%accum_e_detector)
+          call DeleteEBSDDetectorCache(mycache)
         end if
 
     !$OMP BARRIER
@@ -991,6 +1055,36 @@ else  ! sub-divide the cubochoric grid in half steps and determine for which gri
 
 end if
 
+!===============================================================
+!========Scan-wide pattern center model refinement==============
+!===============================================================
+if (trim(ronl%PCmodel).ne.'none') then
+  if (ROIselected.eqv..TRUE.) then
+    pcwd = dinl%ROI(3)
+    pcht = dinl%ROI(4)
+  else
+    pcwd = dinl%ipf_wd
+    pcht = dinl%ipf_ht
+  end if
+! initial pattern centers, including the geometric correction when requested
+  allocate(pcinit(3,totnumexpt))
+  pcinit(1,:) = ebsdnl%xpc
+  pcinit(2,:) = ebsdnl%ypc
+  pcinit(3,:) = ebsdnl%L
+  if (trim(ronl%PCcorrection).eq.'on') then
+    do eindex=1,totnumexpt
+      samplex = mod(eindex-1, pcwd)+1
+      sampley = (eindex-1)/pcwd+1
+      pcinit(1:3,eindex) = (/ ebsdnl%xpc - DPCX(samplex), ebsdnl%ypc - DPCY(sampley), ebsdnl%L - DPCL(sampley) /)
+    end do
+  end if
+  call Message(' --> Starting pattern center model refinement')
+  call EBSDRefinePCModel(ronl, ebsdnl, mcnl, EBSDMCdata, EBSDMPdata, energyclusters, IPAR2, mask, prefactor, &
+                         dinl%gammavalue, correctsize, pcwd, pcht, epatterns, pcinit, euler_best, CIlist, dict, &
+                         FZtype, FZorder, pcm)
+  deallocate(pcinit)
+end if
+
 if (ronl%inRAM.eqv..FALSE.) then
    close(unit=itmpexpt, status='delete')
 end if
@@ -1036,6 +1130,17 @@ if (g_exists) then
 else
   hdferr = HDF_writeDatasetFloatArray2D(dataset, sngl(euler_best*cPi/180.0), 3, Nexp, HDF_head)
 end if
+
+! coefficients of the pattern center model (rows: 1, x, y, x^2, xy, y^2; columns: xpc, ypc, L)
+if (trim(ronl%PCmodel).ne.'none') then
+  dataset = SC_RefinedPCmodel
+  call H5Lexists_f(HDF_head%next%objectID,trim(dataset),g_exists, hdferr)
+  if (g_exists) then 
+    hdferr = HDF_writeDatasetFloatArray2D(dataset, sngl(pcm), 6, 3, HDF_head, overwrite)
+  else
+    hdferr = HDF_writeDatasetFloatArray2D(dataset, sngl(pcm), 6, 3, HDF_head)
+  end if
+end if
  
 call HDF_pop(HDF_head,.TRUE.) 
 
@@ -1085,6 +1190,482 @@ call h5close_EMsoft(hdferr)
 
 end subroutine EMEBSDrefinement
 
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE:EBSDRefinePCModel
+!
+!> @brief joint refinement of the orientations and a scan-wide pattern center model
+!
+!> @details The pattern center (xpc, ypc and L/delta, all in detector pixels) is described by a
+!> plane or a quadratic polynomial in the normalized sampling coordinates.  The model is first fit 
+!> to the initial pattern centers pcinit.  Each iteration then alternates between a parallel 
+!> Levenberg-Marquardt refinement of the orientations of a regular grid of sample patterns and a 
+!> damped Gauss-Newton update of the model coefficients.  In the latter, the orientation of each
+!> sample pattern is eliminated through its 3x3 Schur complement, so that the strong coupling 
+!> between pattern center shifts and rotations is accounted for.  The pattern center derivatives 
+!> are obtained by central differences of the detector direction cosines.  Finally, all 
+!> orientations are refined with the pattern centers of the converged model.  All patterns must
+!> be available in RAM.
+!
+!> @param ronl refinement name list
+!> @param ebsdnl EBSD name list with the detector parameters
+!> @param mcnl Monte Carlo name list
+!> @param EBSDMCdata Monte Carlo data
+!> @param EBSDMPdata master pattern data
+!> @param energyclusters energy clusters (used when ronl%energyaverage > 0)
+!> @param IPAR2 integer parameters for the pattern routines
+!> @param mask pattern mask
+!> @param prefactor intensity prefactor
+!> @param gammaval intensity gamma value
+!> @param correctsize padded pattern size
+!> @param wd width of the scan (or ROI)
+!> @param ht height of the scan (or ROI)
+!> @param epatterns preprocessed experimental patterns
+!> @param pcinit initial pattern centers (xpc, ypc in pixels, L in microns) for all patterns
+!> @param euler_best refined Euler angles [degrees], updated on output
+!> @param CIlist dot products, updated on output
+!> @param dict dictionary structure for the reduction to the RFZ
+!> @param FZtype fundamental zone type
+!> @param FZorder fundamental zone order
+!> @param pcm (output) model coefficients for xpc, ypc and L/delta
+!--------------------------------------------------------------------------
+subroutine EBSDRefinePCModel(ronl, ebsdnl, mcnl, EBSDMCdata, EBSDMPdata, energyclusters, IPAR2, mask, prefactor, &
+                             gammaval, correctsize, wd, ht, epatterns, pcinit, euler_best, CIlist, dict, FZtype, FZorder, pcm)
+!DEC$ ATTRIBUTES DLLEXPORT :: EBSDRefinePCModel
+
+use NameListTypedefs
+use constants
+use rotations
+use detectors
+use EBSDmod
+use dictmod
+use error
+use io
+use FitOrientations,only:LMEvalEBSD, LMResidualEBSD, LMPrepareExperimentEBSD, LMSolve3
+
+use ISO_C_BINDING
+
+IMPLICIT NONE
+
+type(RefineOrientationtype),INTENT(IN)    :: ronl
+type(EBSDNameListType),INTENT(IN)         :: ebsdnl
+type(MCCLNameListType),INTENT(INOUT)      :: mcnl
+type(EBSDMCdataType),INTENT(INOUT)        :: EBSDMCdata
+type(EBSDMPdataType),INTENT(IN)           :: EBSDMPdata
+type(EBSDEnergyClusterType),INTENT(IN)    :: energyclusters
+integer(c_size_t),INTENT(IN)              :: IPAR2(10)
+real(kind=sgl),INTENT(IN)                 :: mask(IPAR2(2)/IPAR2(1),IPAR2(3)/IPAR2(1))
+real(kind=dbl),INTENT(IN)                 :: prefactor
+real(kind=sgl),INTENT(IN)                 :: gammaval
+integer(kind=irg),INTENT(IN)              :: correctsize
+integer(kind=irg),INTENT(IN)              :: wd
+integer(kind=irg),INTENT(IN)              :: ht
+real(kind=sgl),INTENT(IN)                 :: epatterns(correctsize,wd*ht)
+real(kind=sgl),INTENT(IN)                 :: pcinit(3,wd*ht)
+real(kind=sgl),INTENT(INOUT)              :: euler_best(3,wd*ht)
+real(kind=sgl),INTENT(INOUT)              :: CIlist(wd*ht)
+type(dicttype),INTENT(IN)                 :: dict
+integer(kind=irg),INTENT(IN)              :: FZtype
+integer(kind=irg),INTENT(IN)              :: FZorder
+real(kind=dbl),INTENT(OUT)                :: pcm(6,3)
+
+real(kind=dbl),parameter                  :: dpc = 0.1D0     ! pattern center step for the derivatives [pixels]
+type(EBSDNameListType)                    :: pnl
+type(EBSDDetectorType)                    :: det, pdet
+type(EBSDDetectorCacheType)               :: cache
+integer(kind=irg),allocatable             :: sidx(:), allidx(:)
+real(kind=dbl),allocatable                :: hos(:,:), hot(:,:), cost(:), costt(:), es(:,:), r(:), rpl(:), rmi(:), &
+                                             Jo(:,:), Jp(:,:), hoall(:,:), dpall(:)
+real(kind=dbl)                            :: Nm(6,6), Rm(6,3), H(18,18), G(18), Hl(18,18), Gl(18), A(18,18), st(18), &
+                                             pcmt(6,3), b(6), pc(3), pscale(3), Aoo(3,3), Aop(3,3), App(3,3), go(3), gp(3), &
+                                             Z(3,3), zo(3), S(3,3), gs(3), c, costsum, costtsum, lambda, eu(3), eurfz(3)
+real(kind=sgl)                            :: io_real(6)
+integer(kind=irg)                         :: nb, npat, npix, ns, nsx, nsy, i, j, k, k1, k2, b1, b2, it, try, ipiv(18), info, &
+                                             e, io_int(2)
+logical                                   :: accepted
+
+nb = 3
+if (trim(ronl%PCmodel).eq.'quadratic') nb = 6
+npat = wd*ht
+npix = IPAR2(2)*IPAR2(3)/IPAR2(1)**2
+pscale = (/ 1.D0, 1.D0, dble(ebsdnl%delta) /)
+
+! least squares fit of the model to the initial pattern centers
+Nm = 0.D0
+Rm = 0.D0
+do e=1,npat
+  b = EBSDPCModelBasis(nb, wd, ht, e)
+  do b1=1,nb
+    Nm(b1,1:nb) = Nm(b1,1:nb) + b(b1)*b(1:nb)
+    Rm(b1,1:3) = Rm(b1,1:3) + b(b1)*dble(pcinit(1:3,e))/pscale
+  end do
+end do
+if (nb.gt.npat) call FatalError('EBSDRefinePCModel','not enough patterns for the pattern center model')
+call dgesv(nb, 3, Nm, 6, ipiv, Rm, 6, info)
+if (info.ne.0) call FatalError('EBSDRefinePCModel','singular matrix in initial pattern center fit')
+pcm = 0.D0
+pcm(1:nb,1:3) = Rm(1:nb,1:3)
+
+! regular grid of sample patterns
+nsx = max(1, min(wd, nint(sqrt(float(ronl%PCmodelsamples)*float(wd)/float(ht)))))
+nsy = max(1, min(ht, ronl%PCmodelsamples/nsx))
+ns = nsx*nsy
+allocate(sidx(ns), hos(3,ns), hot(3,ns), cost(ns), costt(ns), es(npix,ns))
+do j=1,nsy
+  do i=1,nsx
+    k = (j-1)*nsx+i
+    sidx(k) = (min(ht, 1+int((float(j)-0.5)*float(ht)/float(nsy)))-1)*wd + min(wd, 1+int((float(i)-0.5)*float(wd)/float(nsx)))
+  end do
+end do
+do k=1,ns
+  hos(1:3,k) = eu2ho(dble(euler_best(1:3,sidx(k)))*cPi/180.D0)
+  call LMPrepareExperimentEBSD(npix, epatterns(1:npix,sidx(k)), mask, es(1:npix,k))
+end do
+
+io_int(1) = ns
+call WriteValue(' Pattern center model refinement; number of sample patterns = ',io_int,1)
+
+call EBSDPCModelOrientations(ronl, ebsdnl, mcnl, EBSDMCdata, EBSDMPdata, energyclusters, IPAR2, mask, prefactor, &
+                             gammaval, correctsize, wd, ht, epatterns, nb, pcm, ns, sidx, hos, cost)
+costsum = sum(cost)
+lambda = 1.0D-3
+
+do it=1,ronl%PCmodeliter
+! normal equations for the model coefficients, with the sample orientations eliminated
+  H = 0.D0
+  G = 0.D0
+!$OMP PARALLEL DEFAULT(SHARED) PRIVATE(pnl,det,pdet,cache,r,rpl,rmi,Jo,Jp,Hl,Gl,k,k1,k2,b1,b2,b,pc,c) &
+!$OMP& PRIVATE(Aoo,Aop,App,go,gp,Z,zo,S,gs)
+  allocate(det%rgx(IPAR2(2),IPAR2(3)), det%rgy(IPAR2(2),IPAR2(3)), det%rgz(IPAR2(2),IPAR2(3)), &
+           det%accum_e_detector(EBSDMCdata%numEbins,IPAR2(2),IPAR2(3)))
+  allocate(pdet%rgx(IPAR2(2),IPAR2(3)), pdet%rgy(IPAR2(2),IPAR2(3)), pdet%rgz(IPAR2(2),IPAR2(3)))
+  allocate(r(npix), rpl(npix), rmi(npix), Jo(npix,3), Jp(npix,3))
+  call InitEBSDDetectorCache(cache, ronl%PCcachesize, ronl%PCquantum, EBSDMCdata%numEbins, int(IPAR2(2)), int(IPAR2(3)))
+  Hl = 0.D0
+  Gl = 0.D0
+
+!$OMP DO SCHEDULE(DYNAMIC)
+  do k=1,ns
+    b = EBSDPCModelBasis(nb, wd, ht, sidx(k))
+    pc = matmul(b(1:nb), pcm(1:nb,1:3))
+    call EBSDPCModelDetector(ronl, ebsdnl, mcnl, EBSDMCdata, energyclusters, cache, det, pc, pnl)
+    call LMEvalEBSD(IPAR2, hos(1:3,k), es(1:npix,k), det%accum_e_detector(1:IPAR2(6),:,:), EBSDMPdata%mLPNH, &
+                    EBSDMPdata%mLPSH, mask, prefactor, det%rgx, det%rgy, det%rgz, gammaval, npix, r, Jo, c)
+
+! pattern center derivatives; the energy weights do not change noticeably over such a small step
+    do k1=1,3
+      pnl%xpc = sngl(pc(1))
+      pnl%ypc = sngl(pc(2))
+      pnl%L = sngl(pc(3)*pscale(3))
+      if (k1.eq.1) pnl%xpc = sngl(pc(1)+dpc)
+      if (k1.eq.2) pnl%ypc = sngl(pc(2)+dpc)
+      if (k1.eq.3) pnl%L = sngl((pc(3)+dpc)*pscale(3))
+      call EBSDDetectorDirectionCosines(pnl, mcnl, pdet%rgx, pdet%rgy, pdet%rgz)
+      call LMResidualEBSD(IPAR2, hos(1:3,k), es(1:npix,k), det%accum_e_detector(1:IPAR2(6),:,:), EBSDMPdata%mLPNH, &
+                          EBSDMPdata%mLPSH, mask, prefactor, pdet%rgx, pdet%rgy, pdet%rgz, gammaval, npix, rpl, c)
+      if (k1.eq.1) pnl%xpc = sngl(pc(1)-dpc)
+      if (k1.eq.2) pnl%ypc = sngl(pc(2)-dpc)
+      if (k1.eq.3) pnl%L = sngl((pc(3)-dpc)*pscale(3))
+      call EBSDDetectorDirectionCosines(pnl, mcnl, pdet%rgx, pdet%rgy, pdet%rgz)
+      call LMResidualEBSD(IPAR2, hos(1:3,k), es(1:npix,k), det%accum_e_detector(1:IPAR2(6),:,:), EBSDMPdata%mLPNH, &
+                          EBSDMPdata%mLPSH, mask, prefactor, pdet%rgx, pdet%rgy, pdet%rgz, gammaval, npix, rmi, c)
+      Jp(1:npix,k1) = (rpl - rmi)/(2.D0*dpc)
+    end do
+
+! Schur complement of the orientation block
+    Aoo = matmul(transpose(Jo), Jo)
+    Aop = matmul(transpose(Jo), Jp)
+    App = matmul(transpose(Jp), Jp)
+    go = matmul(transpose(Jo), r)
+    gp = matmul(transpose(Jp), r)
+    do k1=1,3
+      call LMSolve3(Aoo, Aop(1:3,k1), Z(1:3,k1))
+    end do
+    call LMSolve3(Aoo, go, zo)
+    S = App - matmul(transpose(Aop), Z)
+    gs = gp - matmul(transpose(Aop), zo)
+
+    do k1=1,3
+      do b1=1,nb
+        Gl((k1-1)*nb+b1) = Gl((k1-1)*nb+b1) + b(b1)*gs(k1)
+        do k2=1,3
+          do b2=1,nb
+            Hl((k1-1)*nb+b1,(k2-1)*nb+b2) = Hl((k1-1)*nb+b1,(k2-1)*nb+b2) + b(b1)*b(b2)*S(k1,k2)
+          end do
+        end do
+      end do
+    end do
+  end do
+!$OMP END DO
+
+!$OMP CRITICAL
+  H = H + Hl
+  G = G + Gl
+!$OMP END CRITICAL
+
+  deallocate(det%rgx, det%rgy, det%rgz, det%accum_e_detector, pdet%rgx, pdet%rgy, pdet%rgz)
+  deallocate(r, rpl, rmi, Jo, Jp)
+  call DeleteEBSDDetectorCache(cache)
+!$OMP END PARALLEL
+
+! damped step; it is accepted only if it lowers the total cost of the re-refined sample patterns
+  accepted = .FALSE.
+  do try=1,5
+    A = H
+    do k=1,3*nb
+      A(k,k) = H(k,k)*(1.D0+lambda)
+    end do
+    st = -G
+    call dgesv(3*nb, 1, A, 18, ipiv, st, 18, info)
+    if (info.ne.0) EXIT
+    pcmt = pcm
+    pcmt(1:nb,1:3) = pcm(1:nb,1:3) + reshape(st(1:3*nb), (/ nb, 3 /))
+    hot = hos
+    call EBSDPCModelOrientations(ronl, ebsdnl, mcnl, EBSDMCdata, EBSDMPdata, energyclusters, IPAR2, mask, prefactor, &
+                                 gammaval, correctsize, wd, ht, epatterns, nb, pcmt, ns, sidx, hot, costt)
+    costtsum = sum(costt)
+    if (costtsum.lt.costsum) then
+      accepted = .TRUE.
+      pcm = pcmt
+      hos = hot
+      costsum = costtsum
+      lambda = max(lambda*0.1D0, 1.0D-7)
+      EXIT
+    end if
+    lambda = lambda*10.D0
+  end do
+
+  b = EBSDPCModelBasis(nb, wd, ht, (ht/2)*wd + wd/2 + 1)
+  pc = matmul(b(1:nb), pcm(1:nb,1:3))
+  io_real(1:4) = (/ sngl(costsum/dble(ns)), sngl(pc(1)), sngl(pc(2)), sngl(pc(3)*pscale(3)) /)
+  io_int(1) = it
+  call WriteValue(' PC model iteration ',io_int,1,"(I3,$)")
+  call WriteValue(' : mean cost, scan center xpc, ypc, L = ',io_real,4)
+  if (accepted.eqv..FALSE.) EXIT
+  if (maxval(abs(st(1:3*nb))).lt.1.0D-3) EXIT
+end do
+
+! final orientations of all patterns for the refined pattern center model
+deallocate(cost)
+allocate(allidx(npat), hoall(3,npat), dpall(npat), cost(npat))
+do e=1,npat
+  allidx(e) = e
+  hoall(1:3,e) = eu2ho(dble(euler_best(1:3,e))*cPi/180.D0)
+end do
+call EBSDPCModelOrientations(ronl, ebsdnl, mcnl, EBSDMCdata, EBSDMPdata, energyclusters, IPAR2, mask, prefactor, &
+                             gammaval, correctsize, wd, ht, epatterns, nb, pcm, npat, allidx, hoall, cost, dpall)
+
+do e=1,npat
+  eu = ho2eu(hoall(1:3,e))
+  call ReduceOrientationtoRFZ(eu, dict, FZtype, FZorder, eurfz)
+  euler_best(1:3,e) = sngl(eurfz*180.D0/cPi)
+  CIlist(e) = sngl(dpall(e))
+end do
+
+! model coefficients with L in microns
+pcm(1:nb,3) = pcm(1:nb,3)*pscale(3)
+
+deallocate(sidx, hos, hot, cost, costt, es, allidx, hoall, dpall)
+
+end subroutine EBSDRefinePCModel
+
+!--------------------------------------------------------------------------
+!
+! FUNCTION:EBSDPCModelBasis
+!
+!> @brief basis functions of the pattern center model for a given sampling point
+!
+!> @param nb number of basis functions (3 = plane, 6 = quadratic)
+!> @param wd width of the scan
+!> @param ht height of the scan
+!> @param e pattern index
+!--------------------------------------------------------------------------
+recursive function EBSDPCModelBasis(nb, wd, ht, e) result(b)
+!DEC$ ATTRIBUTES DLLEXPORT :: EBSDPCModelBasis
+
+IMPLICIT NONE
+
+integer(kind=irg),INTENT(IN)              :: nb
+integer(kind=irg),INTENT(IN)              :: wd
+integer(kind=irg),INTENT(IN)              :: ht
+integer(kind=irg),INTENT(IN)              :: e
+real(kind=dbl)                            :: b(6)
+
+real(kind=dbl)                            :: u, v
+
+! sampling coordinates normalized to [-1,1]
+u = dble(2*(mod(e-1,wd)+1) - wd - 1)/dble(max(wd-1,1))
+v = dble(2*((e-1)/wd+1) - ht - 1)/dble(max(ht-1,1))
+
+b = 0.D0
+b(1:3) = (/ 1.D0, u, v /)
+if (nb.eq.6) b(4:6) = (/ u*u, u*v, v*v /)
+
+end function EBSDPCModelBasis
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE:EBSDPCModelDetector
+!
+!> @brief detector arrays for a pattern center (xpc, ypc, L/delta) of the pattern center model
+!
+!> @param ronl refinement name list
+!> @param ebsdnl EBSD name list with the detector parameters
+!> @param mcnl Monte Carlo name list
+!> @param EBSDMCdata Monte Carlo data
+!> @param energyclusters energy clusters (used when ronl%energyaverage > 0)
+!> @param cache detector cache
+!> @param det detector arrays (allocated by the caller)
+!> @param pc pattern center
+!> @param pnl (output) EBSD name list for this pattern center
+!--------------------------------------------------------------------------
+recursive subroutine EBSDPCModelDetector(ronl, ebsdnl, mcnl, EBSDMCdata, energyclusters, cache, det, pc, pnl)
+!DEC$ ATTRIBUTES DLLEXPORT :: EBSDPCModelDetector
+
+use NameListTypedefs
+use detectors
+use EBSDmod
+
+IMPLICIT NONE
+
+type(RefineOrientationtype),INTENT(IN)    :: ronl
+type(EBSDNameListType),INTENT(IN)         :: ebsdnl
+type(MCCLNameListType),INTENT(INOUT)      :: mcnl
+type(EBSDMCdataType),INTENT(INOUT)        :: EBSDMCdata
+type(EBSDEnergyClusterType),INTENT(IN)    :: energyclusters
+type(EBSDDetectorCacheType),INTENT(INOUT) :: cache
+type(EBSDDetectorType),INTENT(INOUT)      :: det
+real(kind=dbl),INTENT(IN)                 :: pc(3)
+type(EBSDNameListType),INTENT(OUT)        :: pnl
+
+pnl = ebsdnl
+pnl%xpc = sngl(pc(1))
+pnl%ypc = sngl(pc(2))
+pnl%L = sngl(pc(3))*ebsdnl%delta
+call GetCachedEBSDDetector(pnl, mcnl, EBSDMCdata, cache, det)
+if (ronl%energyaverage.gt.0) call CollapseEBSDEnergyWeights(energyclusters, EBSDMCdata%numEbins, &
+                                                            ebsdnl%numsx, ebsdnl%numsy, det%accum_e_detector)
+
+end subroutine EBSDPCModelDetector
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE:EBSDPCModelOrientations
+!
+!> @brief parallel Levenberg-Marquardt refinement of a set of orientations for a pattern center model
+!
+!> @param ronl refinement name list
+!> @param ebsdnl EBSD name list with the detector parameters
+!> @param mcnl Monte Carlo name list
+!> @param EBSDMCdata Monte Carlo data
+!> @param EBSDMPdata master pattern data
+!> @param energyclusters energy clusters (used when ronl%energyaverage > 0)
+!> @param IPAR2 integer parameters for the pattern routines
+!> @param mask pattern mask
+!> @param prefactor intensity prefactor
+!> @param gammaval intensity gamma value
+!> @param correctsize padded pattern size
+!> @param wd width of the scan
+!> @param ht height of the scan
+!> @param epatterns preprocessed experimental patterns
+!> @param nb number of basis functions of the model
+!> @param pcm model coefficients
+!> @param nidx number of patterns to refine
+!> @param idx pattern indices
+!> @param ho homochoric orientations, refined on output
+!> @param cost residual cost for each pattern
+!> @param dp (optional) dot product for each pattern, as used by the regular refinement
+!--------------------------------------------------------------------------
+recursive subroutine EBSDPCModelOrientations(ronl, ebsdnl, mcnl, EBSDMCdata, EBSDMPdata, energyclusters, IPAR2, mask, &
+                                             prefactor, gammaval, correctsize, wd, ht, epatterns, nb, pcm, nidx, idx, ho, cost, dp)
+!DEC$ ATTRIBUTES DLLEXPORT :: EBSDPCModelOrientations
+
+use NameListTypedefs
+use detectors
+use EBSDmod
+use FitOrientations,only:EMFitOrientationcalfunEBSD, EMFitOrientationLMEBSD, LMResidualEBSD, LMPrepareExperimentEBSD
+
+use ISO_C_BINDING
+
+IMPLICIT NONE
+
+type(RefineOrientationtype),INTENT(IN)    :: ronl
+type(EBSDNameListType),INTENT(IN)         :: ebsdnl
+type(MCCLNameListType),INTENT(INOUT)      :: mcnl
+type(EBSDMCdataType),INTENT(INOUT)        :: EBSDMCdata
+type(EBSDMPdataType),INTENT(IN)           :: EBSDMPdata
+type(EBSDEnergyClusterType),INTENT(IN)    :: energyclusters
+integer(c_size_t),INTENT(IN)              :: IPAR2(10)
+real(kind=sgl),INTENT(IN)                 :: mask(IPAR2(2)/IPAR2(1),IPAR2(3)/IPAR2(1))
+real(kind=dbl),INTENT(IN)                 :: prefactor
+real(kind=sgl),INTENT(IN)                 :: gammaval
+integer(kind=irg),INTENT(IN)              :: correctsize
+integer(kind=irg),INTENT(IN)              :: wd
+integer(kind=irg),INTENT(IN)              :: ht
+real(kind=sgl),INTENT(IN)                 :: epatterns(correctsize,wd*ht)
+integer(kind=irg),INTENT(IN)              :: nb
+real(kind=dbl),INTENT(IN)                 :: pcm(6,3)
+integer(kind=irg),INTENT(IN)              :: nidx
+integer(kind=irg),INTENT(IN)              :: idx(nidx)
+real(kind=dbl),INTENT(INOUT)              :: ho(3,nidx)
+real(kind=dbl),INTENT(OUT)                :: cost(nidx)
+real(kind=dbl),INTENT(OUT),OPTIONAL       :: dp(nidx)
+
+integer(kind=irg),parameter               :: MAXLMEVAL = 12
+type(EBSDNameListType)                    :: pnl
+type(EBSDDetectorType)                    :: det
+type(EBSDDetectorCacheType)               :: cache
+real(kind=sgl),allocatable                :: expt(:)
+real(kind=dbl),allocatable                :: e(:), r(:)
+real(kind=sgl)                            :: INITMEANVAL(3), STEPSIZE(3)
+real(kind=dbl)                            :: X(3), F, b(6), pc(3)
+integer(kind=irg)                         :: i, npix
+
+npix = IPAR2(2)*IPAR2(3)/IPAR2(1)**2
+STEPSIZE = ronl%step
+
+!$OMP PARALLEL DEFAULT(SHARED) PRIVATE(pnl,det,cache,expt,e,r,INITMEANVAL,X,F,b,pc,i)
+allocate(det%rgx(IPAR2(2),IPAR2(3)), det%rgy(IPAR2(2),IPAR2(3)), det%rgz(IPAR2(2),IPAR2(3)), &
+         det%accum_e_detector(EBSDMCdata%numEbins,IPAR2(2),IPAR2(3)))
+allocate(expt(npix), e(npix), r(npix))
+call InitEBSDDetectorCache(cache, ronl%PCcachesize, ronl%PCquantum, EBSDMCdata%numEbins, int(IPAR2(2)), int(IPAR2(3)))
+
+!$OMP DO SCHEDULE(DYNAMIC)
+do i=1,nidx
+  b = EBSDPCModelBasis(nb, wd, ht, idx(i))
+  pc = matmul(b(1:nb), pcm(1:nb,1:3))
+  call EBSDPCModelDetector(ronl, ebsdnl, mcnl, EBSDMCdata, energyclusters, cache, det, pc, pnl)
+
+  expt = epatterns(1:npix,idx(i))
+  expt = expt/vecnorm(expt)
+  INITMEANVAL = sngl(ho(1:3,i))
+  X = 0.5D0
+  call EMFitOrientationLMEBSD(IPAR2, INITMEANVAL, expt, det%accum_e_detector(1:IPAR2(6),:,:), EBSDMPdata%mLPNH, &
+                              EBSDMPdata%mLPSH, 3, X, mask, prefactor, det%rgx, det%rgy, det%rgz, STEPSIZE, &
+                              gammaval, MAXLMEVAL)
+  ho(1:3,i) = dble(INITMEANVAL) + (2.D0*X - 1.D0)*dble(STEPSIZE)
+
+  call LMPrepareExperimentEBSD(npix, expt, mask, e)
+  call LMResidualEBSD(IPAR2, ho(1:3,i), e, det%accum_e_detector(1:IPAR2(6),:,:), EBSDMPdata%mLPNH, EBSDMPdata%mLPSH, &
+                      mask, prefactor, det%rgx, det%rgy, det%rgz, gammaval, npix, r, cost(i))
+
+  if (present(dp)) then
+    INITMEANVAL = sngl(ho(1:3,i))
+    X = 0.5D0
+    call EMFitOrientationcalfunEBSD(IPAR2, INITMEANVAL, expt, det%accum_e_detector(1:IPAR2(6),:,:), &
+                                    EBSDMPdata%mLPNH, EBSDMPdata%mLPSH, 3, X, F, mask, prefactor, &
+                                    det%rgx, det%rgy, det%rgz, STEPSIZE, gammaval)
+    dp(i) = 1.D0 - F
+  end if
+end do
+!$OMP END DO
+
+deallocate(det%rgx, det%rgy, det%rgz, det%accum_e_detector, expt, e, r)
+call DeleteEBSDDetectorCache(cache)
+!$OMP END PARALLEL
+
+end subroutine EBSDPCModelOrientations
+
 
 !--------------------------------------------------------------------------
 !
@@ -2895,4 +3476,402 @@ nullify(HDF_head%next)
  
 end subroutine readEBSDDotProductFile
 
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: openEBSDDotProductFile
+!
+!> @brief open a Dot Product File for lazy access to row ranges of its data sets
+!
+!> @details The namelist parameters are read with readEBSDDotProductFile (without any 
+!> data sets), after which the file is kept open at the Data group.  The ROI (or full 
+!> scan) dimensions are stored in the handle; rows are numbered 1..ht inside the ROI.
+!
+!> @param dpfile filename of the EBSD dot product file
+!> @param ebsdnl EBSDIndexingNamelist
+!> @param DPF file handle
+!> @param hdferr error code
+!> @param presentFolder (optional) turn off standard path handling
+!> @param isTKD (optional) TKD instead of EBSD file
+!--------------------------------------------------------------------------
+recursive subroutine openEBSDDotProductFile(dpfile, ebsdnl, DPF, hdferr, presentFolder, isTKD)
+!DEC$ ATTRIBUTES DLLEXPORT :: openEBSDDotProductFile
+
+use NameListTypedefs
+use error
+use HDF5
+use HDFsupport
+
+IMPLICIT NONE
+
+character(fnlen),INTENT(IN)                         :: dpfile
+type(EBSDIndexingNameListType),INTENT(INOUT)        :: ebsdnl
+!f2py intent(in,out) ::  ebsdnl
+type(EBSDDotProductFileType),INTENT(INOUT)          :: DPF
+!f2py intent(in,out) ::  DPF
+integer(kind=irg),INTENT(OUT)                       :: hdferr
+logical,INTENT(IN),OPTIONAL                         :: presentFolder 
+logical,INTENT(IN),OPTIONAL                         :: isTKD
+
+type(EBSDDIdataType)                                :: EBSDDIdata
+character(fnlen)                                    :: infile, groupname
+logical                                             :: TKD, readonly
+
+TKD = .FALSE.
+if (present(isTKD)) TKD = isTKD
+
+if (DPF%isopen.eqv..TRUE.) call closeEBSDDotProductFile(DPF)
+
+! get the namelist parameters and header information 
+if (present(presentFolder)) then 
+  call readEBSDDotProductFile(dpfile, ebsdnl, hdferr, EBSDDIdata, presentFolder=presentFolder, isTKD=TKD)
+  infile = trim(dpfile)
+else 
+  call readEBSDDotProductFile(dpfile, ebsdnl, hdferr, EBSDDIdata, isTKD=TKD)
+  infile = trim(EMsoft_getEMdatapathname())//trim(dpfile)
+  infile = EMsoft_toNativePath(infile)
+end if
+
+if (sum(ebsdnl%ROI).ne.0) then 
+  DPF%wd = ebsdnl%ROI(3)
+  DPF%ht = ebsdnl%ROI(4)
+else
+  DPF%wd = ebsdnl%ipf_wd
+  DPF%ht = ebsdnl%ipf_ht
+end if
+DPF%nnk = ebsdnl%nnk
+DPF%FZcnt = EBSDDIdata%FZcnt
+DPF%pgnum = EBSDDIdata%pgnum
+
+! open the file and descend into the Data group
+nullify(DPF%HDF_head%next)
+readonly = .TRUE.
+hdferr =  HDF_openFile(infile, DPF%HDF_head, readonly)
+
+groupname = 'Scan 1'
+    hdferr = HDF_openGroup(groupname, DPF%HDF_head)
+groupname = SC_EBSD
+if (TKD.eqv..TRUE.) groupname = SC_TKD
+    hdferr = HDF_openGroup(groupname, DPF%HDF_head)
+groupname = SC_Data
+    hdferr = HDF_openGroup(groupname, DPF%HDF_head)
+
+DPF%isopen = .TRUE.
+
+end subroutine openEBSDDotProductFile
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: closeEBSDDotProductFile
+!
+!> @brief close a Dot Product File opened with openEBSDDotProductFile
+!
+!> @param DPF file handle
+!--------------------------------------------------------------------------
+recursive subroutine closeEBSDDotProductFile(DPF)
+!DEC$ ATTRIBUTES DLLEXPORT :: closeEBSDDotProductFile
+
+use HDFsupport
+
+IMPLICIT NONE
+
+type(EBSDDotProductFileType),INTENT(INOUT)          :: DPF
+!f2py intent(in,out) ::  DPF
+
+if (DPF%isopen.eqv..TRUE.) then 
+  call HDF_pop(DPF%HDF_head,.TRUE.)
+  nullify(DPF%HDF_head%next)
+  DPF%isopen = .FALSE.
+end if
+
+end subroutine closeEBSDDotProductFile
+
+!--------------------------------------------------------------------------
+!
+! FUNCTION: EBSDDotProductDataExists
+!
+!> @brief check whether a data set is present in an open Dot Product File
+!
+!> @param DPF file handle
+!> @param dataset data set name
+!--------------------------------------------------------------------------
+recursive function EBSDDotProductDataExists(DPF, dataset) result(g_exists)
+!DEC$ ATTRIBUTES DLLEXPORT :: EBSDDotProductDataExists
+
+use HDF5
+use HDFsupport
+
+IMPLICIT NONE
+
+type(EBSDDotProductFileType),INTENT(INOUT)          :: DPF
+!f2py intent(in,out) ::  DPF
+character(fnlen),INTENT(IN)                         :: dataset
+logical                                             :: g_exists
+
+integer(kind=irg)                                   :: hdferr
+
+call H5Lexists_f(DPF%HDF_head%next%objectID,trim(dataset),g_exists, hdferr)
+
+end function EBSDDotProductDataExists
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: checkEBSDDotProductRows
+!
+!> @brief make sure that a row range lies inside the ROI of an open Dot Product File
+!
+!> @param DPF file handle
+!> @param row1 first row 
+!> @param nrows number of rows
+!--------------------------------------------------------------------------
+recursive subroutine checkEBSDDotProductRows(DPF, row1, nrows)
+!DEC$ ATTRIBUTES DLLEXPORT :: checkEBSDDotProductRows
+
+use error
+
+IMPLICIT NONE
+
+type(EBSDDotProductFileType),INTENT(IN)             :: DPF
+integer(kind=irg),INTENT(IN)                        :: row1
+integer(kind=irg),INTENT(IN)                        :: nrows
+
+if (DPF%isopen.eqv..FALSE.) then 
+  call FatalError('checkEBSDDotProductRows','dot product file has not been opened')
+end if
+if ((row1.lt.1).or.(nrows.lt.1).or.(row1+nrows-1.gt.DPF%ht)) then 
+  call FatalError('checkEBSDDotProductRows','requested row range lies outside the scan')
+end if
+
+end subroutine checkEBSDDotProductRows
+
+!--------------------------------------------------------------------------
+!
+! FUNCTION: readEBSDDotProductRows1D
+!
+!> @brief read a row range of a per-pattern data set (CI, IQ, Fit, RefinedDotProducts, ...)
+!
+!> @param DPF file handle
+!> @param dataset data set name
+!> @param row1 first row 
+!> @param nrows number of rows
+!--------------------------------------------------------------------------
+recursive function readEBSDDotProductRows1D(DPF, dataset, row1, nrows) result(rdata)
+!DEC$ ATTRIBUTES DLLEXPORT :: readEBSDDotProductRows1D
+
+use HDF5
+use HDFsupport
+
+IMPLICIT NONE
+
+type(EBSDDotProductFileType),INTENT(INOUT)          :: DPF
+!f2py intent(in,out) ::  DPF
+character(fnlen),INTENT(IN)                         :: dataset
+integer(kind=irg),INTENT(IN)                        :: row1
+integer(kind=irg),INTENT(IN)                        :: nrows
+real(kind=sgl),allocatable                          :: rdata(:)
+
+integer(HSIZE_T)                                    :: offset(1), dims(1)
+
+call checkEBSDDotProductRows(DPF, row1, nrows)
+
+offset = (/ (row1-1)*DPF%wd /)
+dims = (/ nrows*DPF%wd /)
+rdata = HDF_readHyperslabFloatArray1D(dataset, offset, dims, DPF%HDF_head)
+
+end function readEBSDDotProductRows1D
+
+!--------------------------------------------------------------------------
+!
+! FUNCTION: readEBSDDotProductRows2D
+!
+!> @brief read a row range of a data set with n1 values per pattern 
+!> (EulerAngles, RefinedEulerAngles with n1=3; TopDotProductList with n1<=nnk, which 
+!> returns the n1 best dot products)
+!
+!> @param DPF file handle
+!> @param dataset data set name
+!> @param n1 number of values per pattern
+!> @param row1 first row 
+!> @param nrows number of rows
+!--------------------------------------------------------------------------
+recursive function readEBSDDotProductRows2D(DPF, dataset, n1, row1, nrows) result(rdata)
+!DEC$ ATTRIBUTES DLLEXPORT :: readEBSDDotProductRows2D
+
+use HDF5
+use HDFsupport
+
+IMPLICIT NONE
+
+type(EBSDDotProductFileType),INTENT(INOUT)          :: DPF
+!f2py intent(in,out) ::  DPF
+character(fnlen),INTENT(IN)                         :: dataset
+integer(kind=irg),INTENT(IN)                        :: n1
+integer(kind=irg),INTENT(IN)                        :: row1
+integer(kind=irg),INTENT(IN)                        :: nrows
+real(kind=sgl),allocatable                          :: rdata(:,:)
+
+integer(HSIZE_T)                                    :: offset(2), dims(2)
+
+call checkEBSDDotProductRows(DPF, row1, nrows)
+
+offset = (/ 0, (row1-1)*DPF%wd /)
+dims = (/ n1, nrows*DPF%wd /)
+rdata = HDF_readHyperslabFloatArray2D(dataset, offset, dims, DPF%HDF_head)
+
+end function readEBSDDotProductRows2D
+
+!--------------------------------------------------------------------------
+!
+! FUNCTION: readEBSDDotProductTopMatches
+!
+!> @brief read the TopMatchIndices for a row range; the result has dimensions (nm, nrows*wd)
+!
+!> @param DPF file handle
+!> @param row1 first row 
+!> @param nrows number of rows
+!> @param nm (optional) number of best matches to read (default nnk)
+!--------------------------------------------------------------------------
+recursive function readEBSDDotProductTopMatches(DPF, row1, nrows, nm) result(rdata)
+!DEC$ ATTRIBUTES DLLEXPORT :: readEBSDDotProductTopMatches
+
+use HDF5
+use HDFsupport
+
+IMPLICIT NONE
+
+type(EBSDDotProductFileType),INTENT(INOUT)          :: DPF
+!f2py intent(in,out) ::  DPF
+integer(kind=irg),INTENT(IN)                        :: row1
+integer(kind=irg),INTENT(IN)                        :: nrows
+integer(kind=irg),INTENT(IN),OPTIONAL               :: nm
+integer(kind=irg),allocatable                       :: rdata(:,:)
+
+character(fnlen)                                    :: dataset
+integer(HSIZE_T)                                    :: offset(2), dims(2)
+integer(kind=irg)                                   :: lnm
+
+call checkEBSDDotProductRows(DPF, row1, nrows)
+
+lnm = DPF%nnk
+if (present(nm)) lnm = min(nm, DPF%nnk)
+
+dataset = SC_TopMatchIndices
+offset = (/ 0, (row1-1)*DPF%wd /)
+dims = (/ lnm, nrows*DPF%wd /)
+rdata = HDF_readHyperslabIntegerArray2D(dataset, offset, dims, DPF%HDF_head)
+
+end function readEBSDDotProductTopMatches
+
+!--------------------------------------------------------------------------
+!
+! FUNCTION: readEBSDDotProductMapRows
+!
+!> @brief read a row range of a real-valued map data set (OSM); the result has dimensions (wd, nrows)
+!
+!> @param DPF file handle
+!> @param dataset data set name
+!> @param row1 first row 
+!> @param nrows number of rows
+!--------------------------------------------------------------------------
+recursive function readEBSDDotProductMapRows(DPF, dataset, row1, nrows) result(rdata)
+!DEC$ ATTRIBUTES DLLEXPORT :: readEBSDDotProductMapRows
+
+use HDF5
+use HDFsupport
+
+IMPLICIT NONE
+
+type(EBSDDotProductFileType),INTENT(INOUT)          :: DPF
+!f2py intent(in,out) ::  DPF
+character(fnlen),INTENT(IN)                         :: dataset
+integer(kind=irg),INTENT(IN)                        :: row1
+integer(kind=irg),INTENT(IN)                        :: nrows
+real(kind=sgl),allocatable                          :: rdata(:,:)
+
+integer(HSIZE_T)                                    :: offset(2), dims(2)
+
+call checkEBSDDotProductRows(DPF, row1, nrows)
+
+offset = (/ 0, row1-1 /)
+dims = (/ DPF%wd, nrows /)
+rdata = HDF_readHyperslabFloatArray2D(dataset, offset, dims, DPF%HDF_head)
+
+end function readEBSDDotProductMapRows
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: EBSDDotProductOSMMaps
+!
+!> @brief compute Orientation Similarity Maps from an open Dot Product File
+!
+!> @details Same result as EBSDgetOrientationSimilarityMaps, but the TopMatchIndices are 
+!> read in bands of rows (plus the radius rows below each band that the neighbor pairs 
+!> refer to), and only the first max(nms) entries of each list are read, so that the 
+!> full top match array is never held in memory.
+!
+!> @param DPF file handle
+!> @param nlev number of OSM levels
+!> @param nms number of matches to use for each level
+!> @param osm (returned) Orientation Similarity Maps, one per level
+!> @param nbtype neighborhood type (4 or 8)
+!> @param radius neighborhood radius
+!> @param osmdw (optional, returned) distance-weighted Orientation Similarity Maps
+!--------------------------------------------------------------------------
+recursive subroutine EBSDDotProductOSMMaps(DPF, nlev, nms, osm, nbtype, radius, osmdw)
+!DEC$ ATTRIBUTES DLLEXPORT :: EBSDDotProductOSMMaps
+
+use commonmod
+use neighborhood
+use io
+
+IMPLICIT NONE
+
+type(EBSDDotProductFileType),INTENT(INOUT)          :: DPF
+!f2py intent(in,out) ::  DPF
+integer(kind=irg),INTENT(IN)                        :: nlev
+integer(kind=irg),INTENT(IN)                        :: nms(nlev)
+real(kind=sgl),INTENT(OUT)                          :: osm(DPF%wd,DPF%ht,nlev)
+integer(kind=irg),INTENT(IN)                        :: nbtype
+integer(kind=irg),INTENT(IN)                        :: radius
+real(kind=sgl),INTENT(OUT),OPTIONAL                 :: osmdw(DPF%wd,DPF%ht,nlev)
+
+type(NeighborhoodType)                              :: nb
+real(kind=sgl),allocatable                          :: pv(:,:,:)
+integer(kind=irg),allocatable                       :: tmi(:,:)
+integer(kind=irg)                                   :: l, lnm, lnms(nlev), row1, nrows, nbuf, nband, io_int(2)
+
+! make sure that the requested numbers of near-matches are smaller than/equal to the available number
+do l=1,nlev
+  if (nms(l).gt.DPF%nnk) then
+    io_int(1) = nms(l)
+    io_int(2) = DPF%nnk
+    call WriteValue('Requested number of near matches is too large: ',io_int,2,"(I4,' > ',I4)")
+    call Message(' --> Resetting requested number to maximum available')
+    lnms(l) = DPF%nnk
+  else
+    lnms(l) = nms(l)
+  end if
+end do
+lnm = maxval(lnms)
+
+call NB_Init(nb, DPF%wd, DPF%ht, nbtype, radius)
+
+allocate(pv(DPF%wd*DPF%ht,nb%noff,nlev))
+pv = 0.0
+
+! bands of about 256k patterns, but never fewer rows than the halo
+nband = max(262144/DPF%wd, radius, 1)
+do row1=1,DPF%ht,nband
+  nrows = min(nband, DPF%ht-row1+1)
+  nbuf = min(nrows+radius, DPF%ht-row1+1)
+  tmi = readEBSDDotProductTopMatches(DPF, row1, nbuf, lnm)
+  call EBSDOSMPairValues(nb, lnm, nbuf, tmi, row1, nrows, nlev, lnms, pv)
+  deallocate(tmi)
+end do
+
+call EBSDOSMGather(nb, nlev, pv, osm, osmdw)
+
+deallocate(pv)
+
+end subroutine EBSDDotProductOSMMaps
+
 end module EBSDDImod
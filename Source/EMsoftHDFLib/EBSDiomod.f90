@@ -932,8 +932,6 @@ recursive subroutine ctfmerge_writeFile(ebsdnl,xtalname,ipar,eangles,phaseID,dpl
 
 use NameListTypedefs
 use typedefs
-use symmetry
-use constants
 use error
 
 IMPLICIT NONE
@@ -942,23 +940,16 @@ type(EBSDIndexingNameListType),INTENT(INOUT)        :: ebsdnl
 !f2py intent(in,out) ::  ebsdnl
 character(fnlen),INTENT(IN)                         :: xtalname(5)
 integer(kind=irg),INTENT(IN)                        :: ipar(4)
-real(kind=sgl),INTENT(INOUT)                        :: eangles(3,ipar(1),ipar(2))
-!f2py intent(in,out) ::  eangles
+real(kind=sgl),INTENT(IN)                           :: eangles(3,ipar(1),ipar(2))
 integer(kind=irg),INTENT(IN)                        :: phaseID(ipar(1))
 real(kind=sgl),INTENT(IN)                           :: dplist(ipar(1),ipar(2))
 real(kind=sgl),INTENT(IN)                           :: OSMlist(ipar(1),ipar(2))
 real(kind=sgl),INTENT(IN)                           :: IQmap(ipar(1))
 
-integer(kind=irg)                                   :: ierr, i, ii, indx, hdferr, SGnum, LaueGroup(5), BCval, BSval, iph
-character(fnlen)                                    :: ctfname, xtn
-character                                           :: TAB = CHAR(9)
-character(1)                                        :: np
-character(fnlen)                                    :: str1,str2,str3,str4,str5,str6,str7,str8,str9,str10, st
-real(kind=sgl)                                      :: euler(3), eu, mi, ma
-logical                                             :: donotuseindexarray
-real(kind=dbl)                                      :: cellparams(6)
+integer(kind=irg)                                   :: i, LaueGroup(5)
+real(kind=sgl)                                      :: mi, ma
 integer(kind=irg),allocatable                       :: osm(:), iq(:)
-real(kind=sgl),allocatable                          :: osmr(:)
+real(kind=sgl),allocatable                          :: osmr(:), eu(:,:), dp(:)
 
 ! get the OSMmap into 1D format and scale to the range [0..255]
 allocate(osm(ipar(1)), osmr(ipar(1)))
@@ -974,36 +965,93 @@ deallocate(osmr)
 allocate(iq(ipar(1)))
 iq = nint(255.0 * IQmap)
 
+! extract the orientation and dot product of the selected phase for each sampling point
+allocate(eu(3,ipar(1)), dp(ipar(1)))
+do i=1,ipar(1)
+  eu(1:3,i) = eangles(1:3,i,phaseID(i))
+  dp(i) = dplist(i,phaseID(i))
+end do
+
+call ctfmerge_writeHeader(ebsdnl,xtalname,ipar,dataunit2,LaueGroup)
+call ctfmerge_writeRows(ebsdnl,dataunit2,LaueGroup,0,ipar(1),eu,phaseID,dp,osm,iq)
+
+close(dataunit2,status='keep')
+
+deallocate(eu, dp, osm, iq)
+
+end subroutine ctfmerge_writeFile
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE:ctfmerge_writeHeader
+!
+!> @brief open a merged *.ctf file and write its header, including all phase lines
+!
+!> @details The file remains open on unit funit so that the data rows can be appended 
+!> with ctfmerge_writeRows; the caller closes the unit.
+!
+!> @param ebsdnl namelist
+!> @param xtalname crystal structure file names for all phases
+!> @param ipar  series of integer dimensions (numpat, numdp, wd, ht)
+!> @param funit output unit number
+!> @param LaueGroup Laue group number for each phase (output)
+!--------------------------------------------------------------------------
+recursive subroutine ctfmerge_writeHeader(ebsdnl,xtalname,ipar,funit,LaueGroup)
+!DEC$ ATTRIBUTES DLLEXPORT :: ctfmerge_writeHeader
+
+use NameListTypedefs
+use typedefs
+use symmetry
+use error
+
+IMPLICIT NONE
+
+type(EBSDIndexingNameListType),INTENT(INOUT)        :: ebsdnl
+!f2py intent(in,out) ::  ebsdnl
+character(fnlen),INTENT(IN)                         :: xtalname(5)
+integer(kind=irg),INTENT(IN)                        :: ipar(4)
+integer(kind=irg),INTENT(IN)                        :: funit
+integer(kind=irg),INTENT(OUT)                       :: LaueGroup(5)
+
+integer(kind=irg)                                   :: ierr, i, ii, SGnum, iph
+character(fnlen)                                    :: ctfname, xtn
+character                                           :: TAB = CHAR(9)
+character(1)                                        :: np
+character(fnlen)                                    :: str1,str2,str3,str4,str5,str6, st
+real(kind=dbl)                                      :: cellparams(6)
+
+LaueGroup = 0
+
 ! open the file (overwrite old one if it exists)
 ctfname = trim(EMsoft_getEMdatapathname())//trim(ebsdnl%ctffile)
 ctfname = EMsoft_toNativePath(ctfname)
-open(unit=dataunit2,file=trim(ctfname),status='unknown',action='write',iostat=ierr)
+open(unit=funit,file=trim(ctfname),status='unknown',action='write',iostat=ierr)
 
-write(dataunit2,'(A)') 'Channel Text File'
-write(dataunit2,'(A)') 'EMsoft'//TAB//' v. '//trim(EMsoft_getEMsoftversion())//'; BANDS=pattern index, MAD=CI, BC=OSM, BS=IQ'
-write(dataunit2,'(A)') 'Author  '//trim(EMsoft_getUsername())
-write(dataunit2,'(A)') 'JobMode Grid'
+write(funit,'(A)') 'Channel Text File'
+write(funit,'(A)') 'EMsoft'//TAB//' v. '//trim(EMsoft_getEMsoftversion())//'; BANDS=pattern index, MAD=CI, BC=OSM, BS=IQ'
+write(funit,'(A)') 'Author  '//trim(EMsoft_getUsername())
+write(funit,'(A)') 'JobMode Grid'
 write(st,"(I5)") ipar(3)
-write(dataunit2,'(A)') 'XCells'//TAB//trim(adjustl(st))
+write(funit,'(A)') 'XCells'//TAB//trim(adjustl(st))
 write(st,"(I5)") ipar(4)
-write(dataunit2,'(A)') 'YCells'//TAB//trim(adjustl(st))
+write(funit,'(A)') 'YCells'//TAB//trim(adjustl(st))
 write(st,"(F8.4)") ebsdnl%StepX
-write(dataunit2,'(2A,F8.4)') 'XStep'//TAB//trim(adjustl(st))
+write(funit,'(2A,F8.4)') 'XStep'//TAB//trim(adjustl(st))
 write(st,"(F8.4)") ebsdnl%StepY
-write(dataunit2,'(2A,F8.4)') 'YStep'//TAB//trim(adjustl(st))
-write(dataunit2,'(A)') 'AcqE1'//TAB//'0'
-write(dataunit2,'(A)') 'AcqE2'//TAB//'0'
-write(dataunit2,'(A)') 'AcqE3'//TAB//'0'
-write(dataunit2,'(A,A)',ADVANCE='No') 'Euler angles refer to Sample Coordinate system (CS0)!',TAB
+write(funit,'(2A,F8.4)') 'YStep'//TAB//trim(adjustl(st))
+write(funit,'(A)') 'AcqE1'//TAB//'0'
+write(funit,'(A)') 'AcqE2'//TAB//'0'
+write(funit,'(A)') 'AcqE3'//TAB//'0'
+write(funit,'(A,A)',ADVANCE='No') 'Euler angles refer to Sample Coordinate system (CS0)!',TAB
 str1 = 'Mag'//TAB//'30'//TAB//'Coverage'//TAB//'100'//TAB//'Device'//TAB//'0'//TAB//'KV'
 write(str2,'(F4.1)') ebsdnl%EkeV
 str1 = trim(str1)//TAB//trim(str2)//TAB//'TiltAngle'
 write(str2,'(F5.2)') ebsdnl%MCsig
 str2 = adjustl(str2)
 str1 = trim(str1)//TAB//trim(str2)//TAB//'TiltAxis'//TAB//'0'
-write(dataunit2,'(A)') trim(str1)
+write(funit,'(A)') trim(str1)
 write(np,"(I1)") ipar(2)
-write(dataunit2,'(A)') 'Phases'//TAB//np
+write(funit,'(A)') 'Phases'//TAB//np
 
 do iph=1,ipar(2)
 ! here we need to read each .xtal file and extract the lattice parameters, Laue group and space group numbers
@@ -1050,71 +1098,109 @@ do iph=1,ipar(2)
   str1 = trim(str1)//TAB//trim(adjustl(str2))
 
 ! and now collect them all into a single string
-  write(dataunit2,'(A)') trim(str1)
+  write(funit,'(A)') trim(str1)
 end do 
 
 ! this is the table header
-write(dataunit2,'(A)') 'Phase'//TAB//'X'//TAB//'Y'//TAB//'Bands'//TAB//'Error'//TAB//'Euler1'//TAB//'Euler2'//TAB//'Euler3' &
+write(funit,'(A)') 'Phase'//TAB//'X'//TAB//'Y'//TAB//'Bands'//TAB//'Error'//TAB//'Euler1'//TAB//'Euler2'//TAB//'Euler3' &
                       //TAB//'MAD'//TAB//'BC'//TAB//'BS'
 
-! Euler angles are always in degrees 
-eangles = eangles * 180.0/sngl(cPi)
+end subroutine ctfmerge_writeHeader
 
-! go through the entire array and write one line per sampling point
-do ii = 1,ipar(1)
-    BCval = osm(ii)
-    BSval = iq(ii)
-    euler = eangles(1:3,ii,phaseID(ii))
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE:ctfmerge_writeRows
+!
+!> @brief append a block of consecutive sampling points to a merged *.ctf file
+!
+!> @param ebsdnl namelist
+!> @param funit output unit number (opened by ctfmerge_writeHeader)
+!> @param LaueGroup Laue group number for each phase
+!> @param ioff number of sampling points preceding this block in the scan
+!> @param npat number of sampling points in this block
+!> @param eu Euler angles (radians) of the selected phase
+!> @param phaseID phase identifier array
+!> @param dp dot product of the selected phase
+!> @param osm OSM value scaled to [0..255]
+!> @param iq IQ value scaled to [0..255]
+!--------------------------------------------------------------------------
+recursive subroutine ctfmerge_writeRows(ebsdnl,funit,LaueGroup,ioff,npat,eu,phaseID,dp,osm,iq)
+!DEC$ ATTRIBUTES DLLEXPORT :: ctfmerge_writeRows
+
+use NameListTypedefs
+use constants
+
+IMPLICIT NONE
+
+type(EBSDIndexingNameListType),INTENT(INOUT)        :: ebsdnl
+!f2py intent(in,out) ::  ebsdnl
+integer(kind=irg),INTENT(IN)                        :: funit
+integer(kind=irg),INTENT(IN)                        :: LaueGroup(5)
+integer(kind=irg),INTENT(IN)                        :: ioff
+integer(kind=irg),INTENT(IN)                        :: npat
+real(kind=sgl),INTENT(IN)                           :: eu(3,npat)
+integer(kind=irg),INTENT(IN)                        :: phaseID(npat)
+real(kind=sgl),INTENT(IN)                           :: dp(npat)
+integer(kind=irg),INTENT(IN)                        :: osm(npat)
+integer(kind=irg),INTENT(IN)                        :: iq(npat)
+
+integer(kind=irg)                                   :: i, ii, wd
+character                                           :: TAB = CHAR(9)
+character(1)                                        :: np
+character(fnlen)                                    :: str1,str2,str3,str4,str5,str6,str7,str8,str9,str10
+real(kind=sgl)                                      :: euler(3), e
+
+if (sum(ebsdnl%ROI).ne.0) then
+  wd = ebsdnl%ROI(3)
+else
+  wd = ebsdnl%ipf_wd
+end if
+
+! go through the block and write one line per sampling point
+do i = 1,npat
+    ii = ioff + i
+! Euler angles are always in degrees 
+    euler = eu(1:3,i) * 180.0/sngl(cPi)
 
 ! changed order of coordinates to conform with ctf standard
-    if (sum(ebsdnl%ROI).ne.0) then
-      write(str2,'(F12.3)') float(floor(float(ii-1)/float(ebsdnl%ROI(3))))*ebsdnl%StepY
-      write(str1,'(F12.3)') float(MODULO(ii-1,ebsdnl%ROI(3)))*ebsdnl%StepX
-    else
-      write(str2,'(F12.3)') float(floor(float(ii-1)/float(ebsdnl%ipf_wd)))*ebsdnl%StepY
-      write(str1,'(F12.3)') float(MODULO(ii-1,ebsdnl%ipf_wd))*ebsdnl%StepX
-    end if 
+    write(str2,'(F12.3)') float(floor(float(ii-1)/float(wd)))*ebsdnl%StepY
+    write(str1,'(F12.3)') float(MODULO(ii-1,wd))*ebsdnl%StepX
 
     write(str3,'(I8)') 0
     write(str8,'(I8)') 0 ! integer zero error; was indx, which is now moved to BANDS
-    eu = euler(1) - 90.0 ! conversion from TSL to Oxford convention
-    if (eu.lt.0) eu = eu + 360.0
-    write(str5,'(F12.3)') eu  
-    eu = euler(2)
-    if (eu.lt.0) eu = eu + 360.0
-    write(str6,'(F12.3)') eu
+    e = euler(1) - 90.0 ! conversion from TSL to Oxford convention
+    if (e.lt.0) e = e + 360.0
+    write(str5,'(F12.3)') e  
+    e = euler(2)
+    if (e.lt.0) e = e + 360.0
+    write(str6,'(F12.3)') e
 ! intercept the hexagonal case, for which we need to subtract 30° from the third Euler angle
 ! Note: after working with Lionel Germain, we concluded that we do not need to subtract 30° 
 ! in the ctf file, because the fundamental zone is already oriented according to the Oxford
 ! convention... That means that we need to subtract the angle for the .ang file (to be implemented)
 ! [modified by MDG on 3/5/18]
-    if ((LaueGroup(phaseID(ii)).eq.8).or.(LaueGroup(phaseID(ii)).eq.9)) euler(3) = euler(3) - 30.0
-    eu = euler(3)
-    if (eu.lt.0) eu = eu + 360.0
-    write(str7,'(F12.3)') eu
-    write(str4,'(F12.6)') dplist(ii,phaseID(ii))   ! this replaces MAD
+    if ((LaueGroup(phaseID(i)).eq.8).or.(LaueGroup(phaseID(i)).eq.9)) euler(3) = euler(3) - 30.0
+    e = euler(3)
+    if (e.lt.0) e = e + 360.0
+    write(str7,'(F12.3)') e
+    write(str4,'(F12.6)') dp(i)   ! this replaces MAD
 ! the following two parameters need to be modified to contain more meaningful information
-    write(str9,'(I8)') BCval   ! OSM value in range [0..255]
-    write(str10,'(I8)') BSval  !  IQ value in range [0..255]
+    write(str9,'(I8)') osm(i)   ! OSM value in range [0..255]
+    write(str10,'(I8)') iq(i)  !  IQ value in range [0..255]
 ! Oxford 3D files have four additional integer columns;
 ! GrainIndex
 ! GrainRandomColourR
 ! GrainRandomColourG
 ! GrainRandomColourB
 !
-    write(np,"(I1)") phaseID(ii)
-    write(dataunit2,'(A,A,A,A,A,A,A,A,A,A,A,A,A,A,A,A,A,A,A,A,A)') np,TAB,trim(adjustl(str1)),TAB,&
+    write(np,"(I1)") phaseID(i)
+    write(funit,'(A,A,A,A,A,A,A,A,A,A,A,A,A,A,A,A,A,A,A,A,A)') np,TAB,trim(adjustl(str1)),TAB,&
     trim(adjustl(str2)),TAB,trim(adjustl(str3)),TAB,trim(adjustl(str8)),TAB,trim(adjustl(str5)),&
     TAB,trim(adjustl(str6)),TAB,trim(adjustl(str7)),TAB,trim(adjustl(str4)),TAB,trim(adjustl(str9)),&
     TAB,trim(adjustl(str10))
 end do
 
-close(dataunit2,status='keep')
-
-! reset the Euler angles to radians
-eangles = eangles * sngl(cPi)/180.0
-
-end subroutine ctfmerge_writeFile
+end subroutine ctfmerge_writeRows
 
 !--------------------------------------------------------------------------
 !
@@ -1137,8 +1223,6 @@ recursive subroutine angmerge_writeFile(ebsdnl,xtalname,ipar,eangles,phaseID,dpl
 !DEC$ ATTRIBUTES DLLEXPORT :: angmerge_writeFile
 
 use NameListTypedefs
-use constants 
-
 
 IMPLICIT NONE
 
@@ -1151,51 +1235,94 @@ integer(kind=irg),INTENT(IN)                        :: phaseID(ipar(1))
 real(kind=sgl),INTENT(IN)                           :: dplist(ipar(1),ipar(2))
 real(kind=sgl),INTENT(IN)                           :: IQmap(ipar(1))
 
-integer(kind=irg)                                   :: ierr, ii, indx, SGnum, iph
+integer(kind=irg)                                   :: i
+real(kind=sgl),allocatable                          :: eu(:,:), dp(:)
+
+! extract the orientation and dot product of the selected phase for each sampling point
+allocate(eu(3,ipar(1)), dp(ipar(1)))
+do i=1,ipar(1)
+  eu(1:3,i) = eangles(1:3,i,phaseID(i))
+  dp(i) = dplist(i,phaseID(i))
+end do
+
+call angmerge_writeHeader(ebsdnl,xtalname,ipar,dataunit2)
+call angmerge_writeRows(ebsdnl,dataunit2,0,ipar(1),eu,phaseID,dp,IQmap)
+
+close(dataunit2,status='keep')
+
+deallocate(eu, dp)
+
+end subroutine angmerge_writeFile
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE:angmerge_writeHeader
+!
+!> @brief open a merged *.ang file and write its header, including all phase blocks
+!
+!> @details The file remains open on unit funit so that the data rows can be appended 
+!> with angmerge_writeRows; the caller closes the unit.
+!
+!> @param ebsdnl namelist
+!> @param xtalname crystal structure file names for all phases
+!> @param ipar  series of integer dimensions (numpat, numdp, wd, ht)
+!> @param funit output unit number
+!--------------------------------------------------------------------------
+recursive subroutine angmerge_writeHeader(ebsdnl,xtalname,ipar,funit)
+!DEC$ ATTRIBUTES DLLEXPORT :: angmerge_writeHeader
+
+use NameListTypedefs
+
+IMPLICIT NONE
+
+type(EBSDIndexingNameListType),INTENT(INOUT)        :: ebsdnl
+!f2py intent(in,out) ::  ebsdnl
+character(fnlen),INTENT(IN)                         :: xtalname(5)
+integer(kind=irg),INTENT(IN)                        :: ipar(4)
+integer(kind=irg),INTENT(IN)                        :: funit
+
+integer(kind=irg)                                   :: ierr, ii, SGnum, iph
 character(fnlen)                                    :: angname, xtn
-character(fnlen)                                    :: str1,str2,str3,str4,str5,str6,str7,str8,str9,str10
+character(fnlen)                                    :: str1,str2,str3,str4,str5,str6
 character(1)                                        :: np
 character                                           :: TAB = CHAR(9)
 character(2)                                        :: TSLsymmetry
-real(kind=sgl)                                      :: euler(3), s, BSval
-real(kind=dbl)                                      :: cellparams(6), dtor
-logical                                             :: donotuseindexarray
-
-dtor = cPi/180.D0
+real(kind=sgl)                                      :: s
+real(kind=dbl)                                      :: cellparams(6)
 
 ! open the file (overwrite old one if it exists)
 angname = trim(EMsoft_getEMdatapathname())//trim(ebsdnl%angfile)
 angname = EMsoft_toNativePath(angname)
-open(unit=dataunit2,file=trim(angname),status='unknown',action='write',iostat=ierr)
+open(unit=funit,file=trim(angname),status='unknown',action='write',iostat=ierr)
 
 ! this requires a lot of information...
-write(dataunit2,'(A)') '# TEM_PIXperUM          1.000000'
+write(funit,'(A)') '# TEM_PIXperUM          1.000000'
 s = ( float(ebsdnl%numsx)*0.5 + ebsdnl%xpc ) / float(ebsdnl%numsx)      ! x-star
-write(dataunit2,'(A,F9.6)') '# x-star                ', s
+write(funit,'(A,F9.6)') '# x-star                ', s
 s = ( float(ebsdnl%numsy)*0.5 + ebsdnl%ypc ) / float(ebsdnl%numsy)      ! y-star
-write(dataunit2,'(A,F9.6)') '# y-star                ', s
+write(funit,'(A,F9.6)') '# y-star                ', s
 s = ebsdnl%L / ( ebsdnl%delta * float(ebsdnl%numsx) )                   ! z-star
-write(dataunit2,'(A,F9.6)') '# z-star                ', s 
-write(dataunit2,'(A,F9.6)') '# WorkingDistance       ', ebsdnl%WD       ! this quantity is not used in EMsoft
-write(dataunit2,'(A)') '#'
+write(funit,'(A,F9.6)') '# z-star                ', s 
+write(funit,'(A,F9.6)') '# WorkingDistance       ', ebsdnl%WD       ! this quantity is not used in EMsoft
+write(funit,'(A)') '#'
 
 do iph=1,ipar(2)
   write (np,"(I1)") iph
-  write(dataunit2,'(A)') '# Phase '//np
+  write(funit,'(A)') '# Phase '//np
 
   xtn = trim(xtalname(iph))
   ii = scan(xtn,'.')
   angname = xtn(1:ii-1)
-  write(dataunit2,'(A)') '# MaterialName    '//trim(angname)
-  write(dataunit2,'(A)') '# Formula       '//trim(angname)
-  write(dataunit2,'(A)') '# Info          patterns indexed using EMsoft::EMEBSDDI'
+  write(funit,'(A)') '# MaterialName    '//trim(angname)
+  write(funit,'(A)') '# Formula       '//trim(angname)
+  write(funit,'(A)') '# Info          patterns indexed using EMsoft::EMEBSDDI'
 
   !==========================
   ! get space group, lattice parameters, and TSL symmetry string
   call getXtalData(xtalname(iph),cellparams,SGnum,TSLsymmetry)
 
   ! symmetry string
-  write(dataunit2,'(A)') '# Symmetry              '//TSLsymmetry
+  write(funit,'(A)') '# Symmetry              '//TSLsymmetry
 
   ! lattice parameters
   cellparams(1:3) = cellparams(1:3)*10.0  ! convert to Angstrom
@@ -1216,32 +1343,71 @@ do iph=1,ipar(2)
   str6 = adjustl(str6)
   str1 = trim(str1)//TAB//trim(str4)//' '//trim(str5)//' '//trim(str6)
 
-  write(dataunit2,'(A)') '# LatticeConstants      '//trim(str1)
+  write(funit,'(A)') '# LatticeConstants      '//trim(str1)
   !==========================
 
   ! next we need to get the hklFamilies ranked by kinematical intensity, going out to some value
   ! this is probably not necessary [based on Stuart's feedback], so we comment it all out
-  write(dataunit2,'(A)') '# NumberFamilies        0'
-  ! write(dataunit2,'(A)') '# hklFamilies      3  1  1 1 0.000000'
+  write(funit,'(A)') '# NumberFamilies        0'
+  ! write(funit,'(A)') '# hklFamilies      3  1  1 1 0.000000'
 
 end do 
 
 !==========================
-! write(dataunit2,'(A)') '# Categories 0 0 0 0 0'
-! write(dataunit2,'(A)') '#'
-write(dataunit2,'(A)') '# GRID: SqrGrid'
-write(dataunit2,'(A,F12.6)') '# XSTEP: ', ebsdnl%StepX
-write(dataunit2,'(A,F12.6)') '# YSTEP: ', ebsdnl%StepY
-write(dataunit2,'(A,I5)') '# NCOLS_ODD: ',ipar(3)
-write(dataunit2,'(A,I5)') '# NCOLS_EVEN: ',ipar(3)
-write(dataunit2,'(A,I5)') '# NROWS: ', ipar(4)
-write(dataunit2,'(A)') '#'
-write(dataunit2,'(A,A)') '# OPERATOR:   ', trim(EMsoft_getUsername())
-write(dataunit2,'(A)') '#'
-write(dataunit2,'(A)') '# SAMPLEID:'
-write(dataunit2,'(A)') '#'
-write(dataunit2,'(A)') '# SCANID:'
-write(dataunit2,'(A)') '#'
+! write(funit,'(A)') '# Categories 0 0 0 0 0'
+! write(funit,'(A)') '#'
+write(funit,'(A)') '# GRID: SqrGrid'
+write(funit,'(A,F12.6)') '# XSTEP: ', ebsdnl%StepX
+write(funit,'(A,F12.6)') '# YSTEP: ', ebsdnl%StepY
+write(funit,'(A,I5)') '# NCOLS_ODD: ',ipar(3)
+write(funit,'(A,I5)') '# NCOLS_EVEN: ',ipar(3)
+write(funit,'(A,I5)') '# NROWS: ', ipar(4)
+write(funit,'(A)') '#'
+write(funit,'(A,A)') '# OPERATOR:   ', trim(EMsoft_getUsername())
+write(funit,'(A)') '#'
+write(funit,'(A)') '# SAMPLEID:'
+write(funit,'(A)') '#'
+write(funit,'(A)') '# SCANID:'
+write(funit,'(A)') '#'
+
+end subroutine angmerge_writeHeader
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE:angmerge_writeRows
+!
+!> @brief append a block of consecutive sampling points to a merged *.ang file
+!
+!> @param ebsdnl namelist
+!> @param funit output unit number (opened by angmerge_writeHeader)
+!> @param ioff number of sampling points preceding this block in the scan
+!> @param npat number of sampling points in this block
+!> @param eu Euler angles (radians) of the selected phase
+!> @param phaseID phase identifier array
+!> @param dp dot product of the selected phase
+!> @param IQmap pattern quality array
+!--------------------------------------------------------------------------
+recursive subroutine angmerge_writeRows(ebsdnl,funit,ioff,npat,eu,phaseID,dp,IQmap)
+!DEC$ ATTRIBUTES DLLEXPORT :: angmerge_writeRows
+
+use NameListTypedefs
+
+IMPLICIT NONE
+
+type(EBSDIndexingNameListType),INTENT(INOUT)        :: ebsdnl
+!f2py intent(in,out) ::  ebsdnl
+integer(kind=irg),INTENT(IN)                        :: funit
+integer(kind=irg),INTENT(IN)                        :: ioff
+integer(kind=irg),INTENT(IN)                        :: npat
+real(kind=sgl),INTENT(IN)                           :: eu(3,npat)
+integer(kind=irg),INTENT(IN)                        :: phaseID(npat)
+real(kind=sgl),INTENT(IN)                           :: dp(npat)
+real(kind=sgl),INTENT(IN)                           :: IQmap(npat)
+
+integer(kind=irg)                                   :: i, ii, wd
+character(fnlen)                                    :: str1,str2,str3,str4,str5,str6,str7,str8
+character(1)                                        :: np
+real(kind=sgl)                                      :: BSval
 
 ! ok, next we have the actual data, which is in the following order
 ! * phi1                      -> Phi1
@@ -1255,36 +1421,34 @@ write(dataunit2,'(A)') '#'
 ! the second entry after the arrow is the EMsoft parameter that we write into that location
 ! these 8 entries must be present; they represent Version 3 of the EDAX/TSL .ang format
 
-! go through the entire array and write one line per sampling point
-do ii = 1,ipar(1)
-    write (np,"(I1)") phaseID(ii)
-    BSval = 255.0 * IQmap(ii)
-! should we use the index array or not?
-    euler = eangles(1:3,ii,phaseID(ii))
-    write(str1,'(A,F8.5)') ' ',euler(1)
-    write(str2,'(A,F8.5)') ' ',euler(2)
-    write(str3,'(A,F8.5)') ' ',euler(3)
+if (sum(ebsdnl%ROI).ne.0) then
+  wd = ebsdnl%ROI(3)
+else
+  wd = ebsdnl%ipf_wd
+end if
+
+! go through the block and write one line per sampling point
+do i = 1,npat
+    ii = ioff + i
+    write (np,"(I1)") phaseID(i)
+    BSval = 255.0 * IQmap(i)
+    write(str1,'(A,F8.5)') ' ',eu(1,i)
+    write(str2,'(A,F8.5)') ' ',eu(2,i)
+    write(str3,'(A,F8.5)') ' ',eu(3,i)
 ! sampling coordinates [interchanged x and y on 05/28/19, MDG] 
-    if (sum(ebsdnl%ROI).ne.0) then
-      write(str4,'(A,F12.5)') ' ',float(MODULO(ii-1,ebsdnl%ROI(3)))*ebsdnl%StepX
-      write(str5,'(A,F12.5)') ' ',float(floor(float(ii-1)/float(ebsdnl%ROI(3))))*ebsdnl%StepY
-    else
-      write(str4,'(A,F12.5)') ' ',float(MODULO(ii-1,ebsdnl%ipf_wd))*ebsdnl%StepX
-      write(str5,'(A,F12.5)') ' ',float(floor(float(ii-1)/float(ebsdnl%ipf_wd)))*ebsdnl%StepY
-    end if 
+    write(str4,'(A,F12.5)') ' ',float(MODULO(ii-1,wd))*ebsdnl%StepX
+    write(str5,'(A,F12.5)') ' ',float(floor(float(ii-1)/float(wd)))*ebsdnl%StepY
 ! Image Quality (using the Krieger Lassen pattern sharpness parameter iq)
     write(str6,'(A,F6.1)') ' ',BSval  !  IQ value in range [0.0 .. 255.0]
-    write(str7,'(A,F6.3)') ' ',dplist(ii,phaseID(ii))   ! this replaces MAD
+    write(str7,'(A,F6.3)') ' ',dp(i)   ! this replaces MAD
     write(str8,'(A)') '  '//np 
 !
-    write(dataunit2,"(A,' ',A,' ',A,' ',A,' ',A,' ',A,' ',A,' ',A)") trim(adjustl(str1)),trim(adjustl(str2)),&
+    write(funit,"(A,' ',A,' ',A,' ',A,' ',A,' ',A,' ',A,' ',A)") trim(adjustl(str1)),trim(adjustl(str2)),&
                                             trim(adjustl(str3)),trim(adjustl(str4)),trim(adjustl(str5)),&
                                             trim(adjustl(str6)),trim(adjustl(str7)),trim(adjustl(str8))
 end do
 
-close(dataunit2,status='keep')
-
-end subroutine angmerge_writeFile
+end subroutine angmerge_writeRows
 
 
 
@@ -72,6 +72,26 @@ type EBSDMasterType
         real(kind=sgl),allocatable      :: rgx(:,:), rgy(:,:), rgz(:,:)          ! auxiliary detector arrays needed for interpolation
 end type EBSDMasterType
 
+! detector pixel table for CalcEBSDPatternMultiFull: pixel direction cosines and the
+! energy weights for the selected energy range, packed in pixel order
+type EBSDPixelTableType
+        integer(kind=irg)               :: npix, Emin, Emax
+        real(kind=sgl),allocatable      :: dcx(:), dcy(:), dcz(:)
+        real(kind=sgl),allocatable      :: ew(:,:)
+end type EBSDPixelTableType
+
+! master pattern collapsed onto a small number of energy clusters (contiguous groups of energy bins);
+! the key identifies the detector geometry and energy weights the clusters were computed for
+type EBSDEnergyClusterType
+        integer(kind=irg)               :: nclus=0, numsx=0, numsy=0, npx=0, npy=0, Emin=0, Emax=0
+        logical                         :: nobg=.FALSE.
+        real(kind=dbl)                  :: key=0.D0
+        real(kind=sgl)                  :: maxerr, meanerr
+        integer(kind=irg),allocatable   :: kfirst(:), klast(:)
+        real(kind=sgl),allocatable      :: accum(:,:,:)
+        real(kind=sgl),allocatable      :: mLPNH(:,:,:), mLPSH(:,:,:)
+end type EBSDEnergyClusterType
+
 type EBSDSEMArray
         real(kind=sgl)                  :: Step_X
         real(kind=sgl)                  :: Step_Y
@@ -1317,6 +1337,629 @@ deallocate(EBSDpattern)
 
 end subroutine CalcEBSDPatternSingleFull
 
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: CalcEBSDPatternSingleJacobian
+!
+!> @brief compute a single EBSD pattern along with its derivatives with respect to the 
+!> three homochoric orientation parameters
+!
+!> @details The derivatives are obtained in the same pass as the pattern by differentiating the
+!> bilinear Lambert interpolation; the energy loop accumulates the interpolated intensity and its 
+!> two gradient components in the square Lambert grid from the same four master pattern values.  
+!> The (cheap) derivatives of the Lambert grid coordinates of each detector pixel with respect to
+!> the homochoric parameters are obtained by central differences of the projection.  The output
+!> patterns are binned and masked in the same way as in CalcEBSDPatternSingleFull; no deformation
+!> tensor or noise options are available here.
+!
+!> @param ipar integer parameters (same as for CalcEBSDPatternSingleFull)
+!> @param ho homochoric orientation vector
+!> @param accum energy weight array
+!> @param mLPNH Northern hemisphere master pattern
+!> @param mLPSH Southern hemisphere master pattern
+!> @param rgx, rgy, rgz detector direction cosines
+!> @param binned output pattern
+!> @param dbinned derivatives of the output pattern with respect to ho(1:3)
+!> @param Emin, Emax energy range
+!> @param mask pattern mask
+!> @param prefactor intensity prefactor
+!--------------------------------------------------------------------------
+recursive subroutine CalcEBSDPatternSingleJacobian(ipar,ho,accum,mLPNH,mLPSH,rgx,rgy,rgz,binned,dbinned,Emin,Emax, &
+                                                   mask,prefactor)
+!DEC$ ATTRIBUTES DLLEXPORT :: CalcEBSDPatternSingleJacobian
+
+use local
+use Lambert
+use quaternions
+use rotations
+
+IMPLICIT NONE
+
+integer(kind=irg),INTENT(IN)                    :: ipar(7)
+real(kind=dbl),INTENT(IN)                       :: ho(3)
+real(kind=sgl),INTENT(IN)                       :: accum(ipar(6),ipar(2),ipar(3))
+real(kind=sgl),INTENT(IN)                       :: mLPNH(-ipar(4):ipar(4),-ipar(5):ipar(5),ipar(7))
+real(kind=sgl),INTENT(IN)                       :: mLPSH(-ipar(4):ipar(4),-ipar(5):ipar(5),ipar(7))
+real(kind=sgl),INTENT(IN)                       :: rgx(ipar(2),ipar(3))
+real(kind=sgl),INTENT(IN)                       :: rgy(ipar(2),ipar(3))
+real(kind=sgl),INTENT(IN)                       :: rgz(ipar(2),ipar(3))
+real(kind=sgl),INTENT(OUT)                      :: binned(ipar(2)/ipar(1),ipar(3)/ipar(1))
+real(kind=sgl),INTENT(OUT)                      :: dbinned(ipar(2)/ipar(1),ipar(3)/ipar(1),3)
+integer(kind=irg),INTENT(IN)                    :: Emin, Emax
+real(kind=sgl),INTENT(IN)                       :: mask(ipar(2)/ipar(1),ipar(3)/ipar(1))
+real(kind=dbl),INTENT(IN)                       :: prefactor
+
+real(kind=dbl),parameter                        :: dh = 1.0D-4
+real(kind=sgl),allocatable                      :: EBSDpattern(:,:), dEBSDpattern(:,:,:)
+real(kind=dbl)                                  :: qu(4), qp(4,3), qm(4,3), hp(3), dcd(3), v(3), xyp(2), xym(2), &
+                                                   dxy(2,3)
+real(kind=sgl)                                  :: dc(3), scl, dx, dy, dxm, dym, s, sx, sy, m00, m10, m01, m11
+integer(kind=irg)                               :: ii, jj, kk, k, istat, ierr, nb
+integer(kind=irg)                               :: nix, niy, nixp, niyp
+
+allocate(EBSDpattern(ipar(2),ipar(3)), dEBSDpattern(ipar(2),ipar(3),3), stat=istat)
+
+scl = float(ipar(4)) 
+
+! rotations for the central differences of the projection coordinates
+qu = ho2qu(ho)
+do k=1,3
+  hp = ho
+  hp(k) = ho(k) + dh
+  qp(1:4,k) = ho2qu(hp)
+  hp(k) = ho(k) - dh
+  qm(1:4,k) = ho2qu(hp)
+end do
+
+do jj = 1,ipar(3)
+    do ii = 1,ipar(2)
+        dcd = (/ dble(rgx(ii,jj)), dble(rgy(ii,jj)), dble(rgz(ii,jj)) /)
+        v = quat_Lp(qu, dcd)
+        dc = sngl(v/sqrt(sum(v**2)))
+
+        call LambertgetInterpolation(dc, scl, ipar(4), ipar(5), nix, niy, nixp, niyp, dx, dy, dxm, dym)
+
+! derivatives of the Lambert grid coordinates with respect to the homochoric parameters
+        do k=1,3
+          v = quat_Lp(qp(1:4,k), dcd)
+          xyp = dble(scl) * LambertSphereToSquare(v/sqrt(sum(v**2)), ierr)
+          v = quat_Lp(qm(1:4,k), dcd)
+          xym = dble(scl) * LambertSphereToSquare(v/sqrt(sum(v**2)), ierr)
+          dxy(1:2,k) = (xyp - xym) / (2.D0*dh)
+        end do
+
+! interpolated intensity and its gradient in the Lambert grid
+        s = 0.0
+        sx = 0.0
+        sy = 0.0
+        if (dc(3) .ge. 0.0) then
+          do kk = Emin, Emax
+            m00 = accum(kk,ii,jj) * mLPNH(nix,niy,kk)
+            m10 = accum(kk,ii,jj) * mLPNH(nixp,niy,kk)
+            m01 = accum(kk,ii,jj) * mLPNH(nix,niyp,kk)
+            m11 = accum(kk,ii,jj) * mLPNH(nixp,niyp,kk)
+            s = s + m00 * dxm * dym + m10 * dx * dym + m01 * dxm * dy + m11 * dx * dy
+            sx = sx + (m10 - m00) * dym + (m11 - m01) * dy
+            sy = sy + (m01 - m00) * dxm + (m11 - m10) * dx
+          end do
+        else
+          do kk = Emin, Emax
+            m00 = accum(kk,ii,jj) * mLPSH(nix,niy,kk)
+            m10 = accum(kk,ii,jj) * mLPSH(nixp,niy,kk)
+            m01 = accum(kk,ii,jj) * mLPSH(nix,niyp,kk)
+            m11 = accum(kk,ii,jj) * mLPSH(nixp,niyp,kk)
+            s = s + m00 * dxm * dym + m10 * dx * dym + m01 * dxm * dy + m11 * dx * dy
+            sx = sx + (m10 - m00) * dym + (m11 - m01) * dy
+            sy = sy + (m01 - m00) * dxm + (m11 - m10) * dx
+          end do
+        end if
+        EBSDpattern(ii,jj) = s
+        dEBSDpattern(ii,jj,1:3) = sx * sngl(dxy(1,1:3)) + sy * sngl(dxy(2,1:3))
+    end do
+end do
+
+EBSDpattern = prefactor * EBSDpattern
+dEBSDpattern = prefactor * dEBSDpattern
+
+! bin the pattern and its derivatives
+nb = ipar(1)
+if (nb .ne. 1) then
+    binned = 0.0
+    dbinned = 0.0
+    do ii=1,ipar(2),nb
+        do jj=1,ipar(3),nb
+            binned(ii/nb+1,jj/nb+1) = sum(EBSDpattern(ii:ii+nb-1,jj:jj+nb-1))
+            do k=1,3
+              dbinned(ii/nb+1,jj/nb+1,k) = sum(dEBSDpattern(ii:ii+nb-1,jj:jj+nb-1,k))
+            end do
+        end do
+    end do
+else
+    binned = EBSDpattern
+    dbinned = dEBSDpattern
+end if
+
+binned = binned * mask
+do k=1,3
+  dbinned(:,:,k) = dbinned(:,:,k) * mask
+end do
+
+deallocate(EBSDpattern, dEBSDpattern)
+
+end subroutine CalcEBSDPatternSingleJacobian
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: InitEBSDPixelTable
+!
+!> @brief pack the detector direction cosines and energy weights for CalcEBSDPatternMultiFull
+!
+!> @details the energy weights are the accum values for Emin..Emax, stored contiguously for each
+!> pixel; without background they are all equal to 1.  The table only depends on the detector 
+!> geometry, so it can be reused for any number of orientations.
+!
+!> @param ipar integer parameters (same as for CalcEBSDPatternSingleFull)
+!> @param accum energy weight array
+!> @param rgx, rgy, rgz detector direction cosines
+!> @param Emin, Emax energy range
+!> @param ptab pixel table
+!> @param removebackground (optional) 'y' to ignore the energy weights
+!--------------------------------------------------------------------------
+recursive subroutine InitEBSDPixelTable(ipar,accum,rgx,rgy,rgz,Emin,Emax,ptab,removebackground)
+!DEC$ ATTRIBUTES DLLEXPORT :: InitEBSDPixelTable
+
+use local
+
+IMPLICIT NONE
+
+integer(kind=irg),INTENT(IN)                    :: ipar(7)
+real(kind=sgl),INTENT(IN)                       :: accum(ipar(6),ipar(2),ipar(3))
+real(kind=sgl),INTENT(IN)                       :: rgx(ipar(2),ipar(3))
+real(kind=sgl),INTENT(IN)                       :: rgy(ipar(2),ipar(3))
+real(kind=sgl),INTENT(IN)                       :: rgz(ipar(2),ipar(3))
+integer(kind=irg),INTENT(IN)                    :: Emin, Emax
+type(EBSDPixelTableType),INTENT(INOUT)          :: ptab
+character(1),INTENT(IN),OPTIONAL                :: removebackground
+
+integer(kind=irg)                               :: ii, jj, ip
+logical                                         :: nobg
+
+nobg = .FALSE.
+if (present(removebackground)) then
+  if (removebackground.eq.'y') nobg = .TRUE.
+end if
+
+if (allocated(ptab%dcx)) deallocate(ptab%dcx, ptab%dcy, ptab%dcz, ptab%ew)
+
+ptab%npix = ipar(2)*ipar(3)
+ptab%Emin = Emin
+ptab%Emax = Emax
+allocate(ptab%dcx(ptab%npix), ptab%dcy(ptab%npix), ptab%dcz(ptab%npix), ptab%ew(Emin:Emax,ptab%npix))
+
+ip = 0
+do jj=1,ipar(3)
+  do ii=1,ipar(2)
+    ip = ip+1
+    ptab%dcx(ip) = rgx(ii,jj)
+    ptab%dcy(ip) = rgy(ii,jj)
+    ptab%dcz(ip) = rgz(ii,jj)
+    if (nobg.eqv..TRUE.) then 
+      ptab%ew(Emin:Emax,ip) = 1.0
+    else
+      ptab%ew(Emin:Emax,ip) = accum(Emin:Emax,ii,jj)
+    end if
+  end do
+end do
+
+end subroutine InitEBSDPixelTable
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: CalcEBSDPatternMultiFull
+!
+!> @brief compute nq EBSD patterns at once; same result as nq calls to CalcEBSDPatternSingleFull
+!> without a deformation tensor
+!
+!> @details The detector is processed in tiles of pixels; for each tile all nq orientations are
+!> handled before moving on, so that the packed energy weights of the tile stay in cache.  For
+!> each orientation, the rotation (as a matrix) and the forward Lambert mapping are carried out in 
+!> a SIMD loop over the pixels of the tile, followed by the interpolation and energy summation.
+!
+!> @param ipar integer parameters (same as for CalcEBSDPatternSingleFull)
+!> @param ptab pixel table from InitEBSDPixelTable
+!> @param nq number of orientations
+!> @param qu orientation quaternions
+!> @param mLPNH, mLPSH master patterns
+!> @param binned output patterns
+!> @param mask pattern mask
+!> @param prefactor intensity scale factor
+!> @param applynoise (optional) Poisson noise seed, as in CalcEBSDPatternSingleFull
+!--------------------------------------------------------------------------
+recursive subroutine CalcEBSDPatternMultiFull(ipar,ptab,nq,qu,mLPNH,mLPSH,binned,mask,prefactor,applynoise)
+!DEC$ ATTRIBUTES DLLEXPORT :: CalcEBSDPatternMultiFull
+
+use local
+use Lambert
+use quaternions
+use filters
+
+IMPLICIT NONE
+
+integer, parameter                              :: K4B=selected_int_kind(9)
+
+integer(kind=irg),INTENT(IN)                    :: ipar(7)
+type(EBSDPixelTableType),INTENT(IN)             :: ptab
+integer(kind=irg),INTENT(IN)                    :: nq
+real(kind=sgl),INTENT(IN)                       :: qu(4,nq) 
+real(kind=sgl),INTENT(IN)                       :: mLPNH(-ipar(4):ipar(4),-ipar(5):ipar(5),ipar(7))
+real(kind=sgl),INTENT(IN)                       :: mLPSH(-ipar(4):ipar(4),-ipar(5):ipar(5),ipar(7))
+real(kind=sgl),INTENT(OUT)                      :: binned(ipar(2)/ipar(1),ipar(3)/ipar(1),nq)
+real(kind=sgl),INTENT(IN)                       :: mask(ipar(2)/ipar(1),ipar(3)/ipar(1))
+real(kind=dbl),INTENT(IN)                       :: prefactor
+integer(K4B),INTENT(INOUT),OPTIONAL             :: applynoise
+!f2py intent(in,out) ::  applynoise
+
+integer(kind=irg),parameter                     :: ntile = 256
+
+real(kind=sgl),allocatable                      :: EBSDpattern(:,:,:)
+real(kind=sgl)                                  :: rm(3,3,nq), e(3,3), scl, sPi2, sPio2
+real(kind=sgl)                                  :: x, y, z, r, q, xy1, xy2, sm
+real(kind=sgl)                                  :: dx(ntile), dy(ntile), dxm(ntile), dym(ntile)
+integer(kind=irg)                               :: nix(ntile), niy(ntile), nixp(ntile), niyp(ntile)
+logical                                         :: north(ntile), noise
+integer(kind=irg)                               :: i, ii, jj, kk, iq, ip, p0, np, npx, npy, istat
+
+! ipar(1) = ebsdnl%binning
+! ipar(2) = ebsdnl%numsx
+! ipar(3) = ebsdnl%numsy
+! ipar(4) = ebsdnl%npx
+! ipar(5) = ebsdnl%npy
+! ipar(6) = ebsdnl%numEbins
+! ipar(7) = ebsdnl%nE
+
+noise = .FALSE.
+if (present(applynoise)) then
+  if (applynoise.ne.0_K4B) noise = .TRUE.
+end if
+
+npx = ipar(4)
+npy = ipar(5)
+scl = float(npx) 
+sPi2 = sngl(LPs%sPi2)
+sPio2 = sngl(LPs%sPio2)
+
+! the rotation matrices follow from rotating the unit vectors with quat_Lp, so that they
+! obey the same convention as CalcEBSDPatternSingleFull
+e = 0.0
+e(1,1) = 1.0
+e(2,2) = 1.0
+e(3,3) = 1.0
+do iq=1,nq
+  do i=1,3
+    rm(1:3,i,iq) = quat_Lp(qu(1:4,iq), e(1:3,i))
+  end do
+end do
+
+allocate(EBSDpattern(ipar(2),ipar(3),nq),stat=istat)
+
+do p0 = 1, ptab%npix, ntile
+  np = min(ntile, ptab%npix-p0+1)
+  do iq = 1, nq
+
+! rotation and Lambert forward mapping for all pixels in the tile
+!$OMP SIMD PRIVATE(x,y,z,r,q,xy1,xy2)
+    do i=1,np
+      x = rm(1,1,iq)*ptab%dcx(p0+i-1) + rm(1,2,iq)*ptab%dcy(p0+i-1) + rm(1,3,iq)*ptab%dcz(p0+i-1)
+      y = rm(2,1,iq)*ptab%dcx(p0+i-1) + rm(2,2,iq)*ptab%dcy(p0+i-1) + rm(2,3,iq)*ptab%dcz(p0+i-1)
+      z = rm(3,1,iq)*ptab%dcx(p0+i-1) + rm(3,2,iq)*ptab%dcy(p0+i-1) + rm(3,3,iq)*ptab%dcz(p0+i-1)
+      r = 1.0/sqrt(x*x+y*y+z*z)
+      x = x*r
+      y = y*r
+      z = z*r
+      north(i) = (z.ge.0.0)
+      if (abs(z).eq.1.0) then
+        xy1 = 0.0
+        xy2 = 0.0
+      else if (abs(y).le.abs(x)) then
+        q = sign(1.0,x) * sqrt(2.0*(1.0-abs(z)))
+        xy1 = q * sPi2
+        xy2 = q * atan(y/x)/sPi2
+      else
+        q = sign(1.0,y) * sqrt(2.0*(1.0-abs(z)))
+        xy1 = q * atan(x/y)/sPi2
+        xy2 = q * sPi2
+      end if
+      xy1 = scl * (xy1 / sPio2)
+      xy2 = scl * (xy2 / sPio2)
+      nix(i) = int(npx+xy1)-npx
+      niy(i) = int(npy+xy2)-npy
+      nixp(i) = nix(i)+1
+      niyp(i) = niy(i)+1
+      if (nixp(i).gt.npx) nixp(i) = nix(i)
+      if (niyp(i).gt.npy) niyp(i) = niy(i)
+      if (nix(i).lt.-npx) nix(i) = nixp(i)
+      if (niy(i).lt.-npy) niy(i) = niyp(i)
+      dx(i) = xy1-nix(i)
+      dy(i) = xy2-niy(i)
+      dxm(i) = 1.0-dx(i)
+      dym(i) = 1.0-dy(i)
+    end do
+
+! interpolation and energy summation
+    do i=1,np
+      ip = p0+i-1
+      sm = 0.0
+      if (north(i)) then
+        do kk = ptab%Emin, ptab%Emax
+          sm = sm + ptab%ew(kk,ip) * ( mLPNH(nix(i),niy(i),kk) * dxm(i) * dym(i) + &
+                    mLPNH(nixp(i),niy(i),kk) * dx(i) * dym(i) + mLPNH(nix(i),niyp(i),kk) * dxm(i) * dy(i) + &
+                    mLPNH(nixp(i),niyp(i),kk) * dx(i) * dy(i) )
+        end do
+      else
+        do kk = ptab%Emin, ptab%Emax
+          sm = sm + ptab%ew(kk,ip) * ( mLPSH(nix(i),niy(i),kk) * dxm(i) * dym(i) + &
+                    mLPSH(nixp(i),niy(i),kk) * dx(i) * dym(i) + mLPSH(nix(i),niyp(i),kk) * dxm(i) * dy(i) + &
+                    mLPSH(nixp(i),niyp(i),kk) * dx(i) * dy(i) )
+        end do
+      end if
+      ii = mod(ip-1,ipar(2))+1
+      jj = (ip-1)/ipar(2)+1
+      EBSDpattern(ii,jj,iq) = sm
+    end do
+  end do
+end do
+
+! intensity scaling, noise, binning and mask, as in CalcEBSDPatternSingleFull
+do iq=1,nq
+  EBSDpattern(:,:,iq) = prefactor * EBSDpattern(:,:,iq)
+
+  if (noise.eqv..TRUE.) then 
+    EBSDpattern(:,:,iq) = applyPoissonNoise( EBSDpattern(:,:,iq), ipar(2), ipar(3), applynoise )
+  end if
+
+  if (ipar(1) .ne. 1) then
+    binned(:,:,iq) = 0.0
+    do ii=1,ipar(2),ipar(1)
+      do jj=1,ipar(3),ipar(1)
+        binned(ii/ipar(1)+1,jj/ipar(1)+1,iq) = sum(EBSDpattern(ii:ii+ipar(1)-1,jj:jj+ipar(1)-1,iq))
+      end do
+    end do
+  else
+    binned(:,:,iq) = EBSDpattern(:,:,iq)
+  end if
+
+  binned(:,:,iq) = binned(:,:,iq) * mask
+end do
+
+deallocate(EBSDpattern)
+
+end subroutine CalcEBSDPatternMultiFull
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: InitEBSDEnergyClusters
+!
+!> @brief collapse the energy dimension of the master pattern onto nclus effective energy clusters
+!
+!> @details The energy bins Emin..Emax are split into nclus contiguous clusters that each carry
+!> (approximately) the same fraction of the detector-averaged energy weight.  For each cluster, the 
+!> master pattern is the weighted average of its energy bins, and the per-pixel weight is the sum of the 
+!> accum values of those bins.  The result can be used in place of the full arrays in 
+!> CalcEBSDPatternSingleFull or InitEBSDPixelTable, with ipar(6) = ipar(7) = ec%nclus, Emin = 1 and 
+!> Emax = ec%nclus, and the same removebackground argument; this reduces the cost of the energy 
+!> summation by a factor (Emax-Emin+1)/nclus.
+!>
+!> The approximation is exact when the energy spectrum within a cluster has the same shape for every
+!> detector pixel; without background it is always exact.  ec%maxerr and ec%meanerr are the largest 
+!> and average fraction of the energy weight in a pixel that is assigned to the wrong energy bin; the 
+!> relative intensity error in that pixel is bounded by this fraction times the relative contrast of 
+!> the master pattern across the cluster.
+!>
+!> When ec already holds clusters for the same detector weights, master patterns, energy range and 
+!> nclus, nothing is recomputed; both arrays enter a checksum that is stored in ec%key.
+!
+!> @param ipar integer parameters (same as for CalcEBSDPatternSingleFull)
+!> @param accum energy weight array
+!> @param mLPNH, mLPSH master patterns
+!> @param Emin, Emax energy range
+!> @param nclus requested number of energy clusters
+!> @param ec energy cluster structure
+!> @param removebackground (optional) 'y' to ignore the energy weights
+!> @param reused (optional) returns .TRUE. if the cached clusters were reused
+!--------------------------------------------------------------------------
+recursive subroutine InitEBSDEnergyClusters(ipar,accum,mLPNH,mLPSH,Emin,Emax,nclus,ec,removebackground,reused)
+!DEC$ ATTRIBUTES DLLEXPORT :: InitEBSDEnergyClusters
+
+use local
+
+IMPLICIT NONE
+
+integer(kind=irg),INTENT(IN)                    :: ipar(7)
+real(kind=sgl),INTENT(IN)                       :: accum(ipar(6),ipar(2),ipar(3))
+real(kind=sgl),INTENT(IN)                       :: mLPNH(-ipar(4):ipar(4),-ipar(5):ipar(5),ipar(7))
+real(kind=sgl),INTENT(IN)                       :: mLPSH(-ipar(4):ipar(4),-ipar(5):ipar(5),ipar(7))
+integer(kind=irg),INTENT(IN)                    :: Emin, Emax
+integer(kind=irg),INTENT(IN)                    :: nclus
+type(EBSDEnergyClusterType),INTENT(INOUT)       :: ec
+character(1),INTENT(IN),OPTIONAL                :: removebackground
+logical,INTENT(OUT),OPTIONAL                    :: reused
+
+real(kind=dbl),allocatable                      :: wbar(:), wc(:)
+real(kind=dbl)                                  :: key, tot, cum, err, psum, esum, wsum
+integer(kind=irg)                               :: nc, c, k, ii, jj
+logical                                         :: nobg
+
+nobg = .FALSE.
+if (present(removebackground)) then
+  if (removebackground.eq.'y') nobg = .TRUE.
+end if
+if (present(reused)) reused = .FALSE.
+
+nc = max(1, min(nclus, Emax-Emin+1))
+
+! checksum of the energy weights and the master patterns over the selected range
+key = 0.D0
+do jj=1,ipar(3)
+  do ii=1,ipar(2)
+    do k=Emin,Emax
+      key = key + dble(accum(k,ii,jj)) * (1.D0 + 0.1D0*k + 0.01D0*ii + 0.001D0*jj)
+    end do
+  end do
+end do
+do k=Emin,Emax
+  do jj=-ipar(5),ipar(5)
+    do ii=-ipar(4),ipar(4)
+      key = key + (dble(mLPNH(ii,jj,k)) + 2.D0*dble(mLPSH(ii,jj,k))) * (1.D0 + 0.1D0*k + 0.01D0*ii + 0.001D0*jj)
+    end do
+  end do
+end do
+
+if ((ec%nclus.eq.nc).and.(ec%numsx.eq.ipar(2)).and.(ec%numsy.eq.ipar(3)).and.(ec%npx.eq.ipar(4)).and. &
+    (ec%npy.eq.ipar(5)).and.(ec%Emin.eq.Emin).and.(ec%Emax.eq.Emax).and.(ec%nobg.eqv.nobg).and.(ec%key.eq.key)) then
+  if (present(reused)) reused = .TRUE.
+  return
+end if
+
+if (allocated(ec%kfirst)) deallocate(ec%kfirst, ec%klast, ec%accum, ec%mLPNH, ec%mLPSH)
+
+ec%nclus = nc
+ec%numsx = ipar(2)
+ec%numsy = ipar(3)
+ec%npx = ipar(4)
+ec%npy = ipar(5)
+ec%Emin = Emin
+ec%Emax = Emax
+ec%nobg = nobg
+ec%key = key
+
+! detector-averaged energy spectrum
+allocate(wbar(Emin:Emax), wc(nc))
+if (nobg.eqv..TRUE.) then
+  wbar = 1.D0
+else
+  do k=Emin,Emax
+    wbar(k) = sum(dble(accum(k,:,:)))
+  end do
+end if
+tot = sum(wbar)
+
+! split the energy range into contiguous clusters with equal shares of the total weight; a new 
+! cluster is also started when the remaining bins are needed to fill the remaining clusters
+allocate(ec%kfirst(nc), ec%klast(nc))
+c = 1
+ec%kfirst(1) = Emin
+cum = wbar(Emin)
+do k=Emin+1,Emax
+  if (c.lt.nc) then
+    if ((cum.ge.dble(c)*tot/dble(nc)).or.(Emax-k+1.eq.nc-c)) then
+      ec%klast(c) = k-1
+      c = c+1
+      ec%kfirst(c) = k
+    end if
+  end if
+  cum = cum + wbar(k)
+end do
+ec%klast(nc) = Emax
+
+! collapsed master patterns and cluster weights; without background the energy weights are all 
+! equal to 1, so the bins are simply added together
+allocate(ec%mLPNH(-ipar(4):ipar(4),-ipar(5):ipar(5),nc), ec%mLPSH(-ipar(4):ipar(4),-ipar(5):ipar(5),nc))
+allocate(ec%accum(nc,ipar(2),ipar(3)))
+ec%mLPNH = 0.0
+ec%mLPSH = 0.0
+do c=1,nc
+  wc(c) = sum(wbar(ec%kfirst(c):ec%klast(c)))
+  do k=ec%kfirst(c),ec%klast(c)
+    if (nobg.eqv..TRUE.) then
+      ec%mLPNH(:,:,c) = ec%mLPNH(:,:,c) + mLPNH(:,:,k)
+      ec%mLPSH(:,:,c) = ec%mLPSH(:,:,c) + mLPSH(:,:,k)
+    else if (wc(c).gt.0.D0) then
+      ec%mLPNH(:,:,c) = ec%mLPNH(:,:,c) + sngl(wbar(k)/wc(c)) * mLPNH(:,:,k)
+      ec%mLPSH(:,:,c) = ec%mLPSH(:,:,c) + sngl(wbar(k)/wc(c)) * mLPSH(:,:,k)
+    end if
+  end do
+  if (nobg.eqv..TRUE.) then
+    ec%accum(c,:,:) = 1.0
+  else
+    ec%accum(c,:,:) = sum(accum(ec%kfirst(c):ec%klast(c),:,:),1)
+  end if
+end do
+
+! accuracy estimate: fraction of the energy weight in each pixel that deviates from the 
+! detector-averaged spectrum shape within its cluster
+ec%maxerr = 0.0
+ec%meanerr = 0.0
+if (nobg.eqv..FALSE.) then
+  esum = 0.D0
+  wsum = 0.D0
+  do jj=1,ipar(3)
+    do ii=1,ipar(2)
+      psum = sum(dble(accum(Emin:Emax,ii,jj)))
+      if (psum.le.0.D0) CYCLE
+      err = 0.D0
+      do c=1,nc
+        if (wc(c).le.0.D0) CYCLE
+        do k=ec%kfirst(c),ec%klast(c)
+          err = err + abs(dble(accum(k,ii,jj)) - dble(ec%accum(c,ii,jj))*wbar(k)/wc(c))
+        end do
+      end do
+      err = 0.5D0*err/psum
+      ec%maxerr = max(ec%maxerr, sngl(err))
+      esum = esum + err*psum
+      wsum = wsum + psum
+    end do
+  end do
+  if (wsum.gt.0.D0) ec%meanerr = sngl(esum/wsum)
+end if
+
+deallocate(wbar, wc)
+
+end subroutine InitEBSDEnergyClusters
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: CollapseEBSDEnergyWeights
+!
+!> @brief replace the first ec%nclus energy entries of a detector weight array by the cluster weights
+!
+!> @details used when a detector array is regenerated (e.g., for a pattern center correction) while 
+!> the collapsed master patterns in ec are kept; the array section accum(1:ec%nclus,:,:) can then be 
+!> used with ipar(6) = ipar(7) = ec%nclus.
+!
+!> @param ec energy cluster structure from InitEBSDEnergyClusters
+!> @param nE number of energy bins in accum
+!> @param numsx, numsy detector dimensions
+!> @param accum energy weight array
+!--------------------------------------------------------------------------
+recursive subroutine CollapseEBSDEnergyWeights(ec, nE, numsx, numsy, accum)
+!DEC$ ATTRIBUTES DLLEXPORT :: CollapseEBSDEnergyWeights
+
+use local
+
+IMPLICIT NONE
+
+type(EBSDEnergyClusterType),INTENT(IN)          :: ec
+integer(kind=irg),INTENT(IN)                    :: nE, numsx, numsy
+real(kind=sgl),INTENT(INOUT)                    :: accum(nE,numsx,numsy)
+
+real(kind=sgl)                                  :: wc(ec%nclus)
+integer(kind=irg)                               :: c, ii, jj
+
+do jj=1,numsy
+  do ii=1,numsx
+    do c=1,ec%nclus
+      if (ec%nobg.eqv..TRUE.) then
+        wc(c) = 1.0
+      else
+        wc(c) = sum(accum(ec%kfirst(c):ec%klast(c),ii,jj))
+      end if
+    end do
+    accum(1:ec%nclus,ii,jj) = wc(1:ec%nclus)
+  end do
+end do
+
+end subroutine CollapseEBSDEnergyWeights
+
 !--------------------------------------------------------------------------
 !
 ! SUBROUTINE: CalcEBSDPatternDefect_zint
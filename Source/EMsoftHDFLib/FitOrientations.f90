@@ -254,6 +254,370 @@ end if
 
 end subroutine EMFitOrientationcalfunEBSD
 
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE:EMFitOrientationLMEBSD
+!
+!> @brief refine the orientation of an EBSD pattern with a Levenberg-Marquardt solver
+!
+!> @details Alternative to bobyqa with EMFitOrientationcalfunEBSD.  The pattern and its 
+!> derivatives with respect to the homochoric parameters are computed in a single pass 
+!> by CalcEBSDPatternSingleJacobian, and the residual between the normalized, zero-mean 
+!> (within the mask) simulated and experimental patterns is minimized; this is equivalent to 
+!> maximizing their normalized dot product.  The histogram equalization of the calfun routine 
+!> is not differentiable and is left out here, so the caller should evaluate the final
+!> orientation with EMFitOrientationcalfunEBSD.  The interface follows that of bobyqa, so
+!> that x(1:3) in [0,1] maps onto initmeanval +/- stepsize; the solution is kept inside this box.
+!> Convergence typically takes a handful of pattern evaluations.
+!
+!> @param ipar array with integer input parameters (see EMFitOrientationcalfunEBSD)
+!> @param initmeanval center of search space (homochoric)
+!> @param expt preprocessed and normalized experimental pattern
+!> @param accum energy weight array
+!> @param mLPNH Northern hemisphere master pattern
+!> @param mLPSH Southern hemisphere master pattern
+!> @param n number of parameters (3)
+!> @param x starting point on input, solution on output
+!> @param mask pattern mask
+!> @param prefactor intensity prefactor
+!> @param rgx, rgy, rgz detector direction cosines
+!> @param stepsize half width of the search space
+!> @param gammaval gamma correction factor
+!> @param maxeval maximum number of pattern evaluations
+!> @param nfeval (optional) number of pattern evaluations used
+!--------------------------------------------------------------------------
+recursive subroutine EMFitOrientationLMEBSD(ipar, initmeanval, expt, accum, mLPNH, mLPSH, n, x, mask, prefactor, &
+                                            rgx, rgy, rgz, stepsize, gammaval, maxeval, nfeval)
+!DEC$ ATTRIBUTES DLLEXPORT :: EMFitOrientationLMEBSD
+
+use local
+
+use,INTRINSIC :: ISO_C_BINDING
+
+IMPLICIT NONE
+
+integer(c_size_t),intent(in)            :: ipar(10)
+real(sgl),intent(in)                    :: initmeanval(3)
+real(c_float),intent(in)                :: expt(ipar(2)*ipar(3)/ipar(1)**2)
+real(kind=sgl),INTENT(IN)               :: accum(ipar(6),ipar(2),ipar(3))
+real(kind=sgl),INTENT(IN)               :: mLPNH(-ipar(4):ipar(4),-ipar(5):ipar(5),ipar(7))
+real(kind=sgl),INTENT(IN)               :: mLPSH(-ipar(4):ipar(4),-ipar(5):ipar(5),ipar(7))
+integer(irg),intent(in)                 :: n
+real(dbl),dimension(:),intent(inout)    :: x
+real(kind=sgl),INTENT(IN)               :: mask(ipar(2)/ipar(1),ipar(3)/ipar(1))
+real(kind=dbl),INTENT(IN)               :: prefactor
+real(kind=sgl),INTENT(IN)               :: rgx(ipar(2),ipar(3))
+real(kind=sgl),INTENT(IN)               :: rgy(ipar(2),ipar(3))
+real(kind=sgl),INTENT(IN)               :: rgz(ipar(2),ipar(3))
+real(sgl),intent(in)                    :: stepsize(3)
+real(kind=sgl),intent(IN)               :: gammaval
+integer(kind=irg),INTENT(IN)            :: maxeval
+integer(kind=irg),INTENT(OUT),OPTIONAL  :: nfeval
+
+real(kind=dbl),parameter                :: tolstep = 1.0D-6, tolcost = 1.0D-10
+real(kind=dbl),allocatable              :: e(:), r(:), J(:,:), rt(:), Jt(:,:)
+real(kind=dbl)                          :: ho(3), hot(3), lo(3), hi(3), A(3,3), At(3,3), g(3), gt(3), dh(3), &
+                                           cost, costt, lambda
+integer(kind=irg)                       :: npix, neval
+logical                                 :: accepted
+
+npix = ipar(2)*ipar(3)/ipar(1)**2
+allocate(e(npix), r(npix), J(npix,3), rt(npix), Jt(npix,3))
+
+call LMPrepareExperimentEBSD(npix, expt, mask, e)
+
+lo = dble(initmeanval - stepsize)
+hi = dble(initmeanval + stepsize)
+ho = dble(initmeanval) + (2.D0*x(1:3) - 1.D0)*dble(stepsize)
+
+call LMEvalEBSD(ipar, ho, e, accum, mLPNH, mLPSH, mask, prefactor, rgx, rgy, rgz, gammaval, npix, r, J, cost)
+neval = 1
+A = matmul(transpose(J), J)
+g = matmul(transpose(J), r)
+lambda = 1.0D-3
+
+do while (neval.lt.maxeval)
+! solve the damped normal equations and keep the new point inside the search box
+  At = A
+  At(1,1) = A(1,1)*(1.D0+lambda)
+  At(2,2) = A(2,2)*(1.D0+lambda)
+  At(3,3) = A(3,3)*(1.D0+lambda)
+  call LMSolve3(At, -g, dh)
+  hot = min(max(ho + dh, lo), hi)
+  dh = hot - ho
+  if (sqrt(sum(dh**2)).lt.tolstep) EXIT
+
+  call LMEvalEBSD(ipar, hot, e, accum, mLPNH, mLPSH, mask, prefactor, rgx, rgy, rgz, gammaval, npix, rt, Jt, costt)
+  neval = neval + 1
+
+  accepted = (costt.lt.cost)
+  if (accepted.eqv..TRUE.) then
+    ho = hot
+    r = rt
+    J = Jt
+    A = matmul(transpose(J), J)
+    g = matmul(transpose(J), r)
+    lambda = max(lambda*0.1D0, 1.0D-7)
+    if ((cost-costt).lt.tolcost*cost) then
+      cost = costt
+      EXIT
+    end if
+    cost = costt
+  else
+    lambda = lambda*10.D0
+    if (lambda.gt.1.0D7) EXIT
+  end if
+end do
+
+x(1:3) = (ho - dble(initmeanval) + dble(stepsize))/(2.D0*dble(stepsize))
+if (present(nfeval)) nfeval = neval
+
+deallocate(e, r, J, rt, Jt)
+
+end subroutine EMFitOrientationLMEBSD
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE:LMPrepareExperimentEBSD
+!
+!> @brief zero-mean (within the mask) and normalized experimental pattern for the LM routines
+!
+!> @param npix number of pattern pixels
+!> @param expt experimental pattern
+!> @param mask pattern mask
+!> @param e prepared pattern
+!--------------------------------------------------------------------------
+recursive subroutine LMPrepareExperimentEBSD(npix, expt, mask, e)
+!DEC$ ATTRIBUTES DLLEXPORT :: LMPrepareExperimentEBSD
+
+use local
+
+IMPLICIT NONE
+
+integer(kind=irg),INTENT(IN)            :: npix
+real(kind=sgl),INTENT(IN)               :: expt(npix)
+real(kind=sgl),INTENT(IN)               :: mask(npix)
+real(kind=dbl),INTENT(OUT)              :: e(npix)
+
+e = dble(mask) * (dble(expt) - sum(dble(expt)*dble(mask))/sum(dble(mask)))
+e = e/sqrt(sum(e**2))
+
+end subroutine LMPrepareExperimentEBSD
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE:LMEvalEBSD
+!
+!> @brief residual and Jacobian for EMFitOrientationLMEBSD
+!
+!> @details residual r = p/|p| - e, where p is the zero-mean (within the mask) gamma-corrected 
+!> simulated pattern and e the zero-mean normalized experimental pattern; the columns of J are 
+!> the derivatives of p/|p| with respect to the homochoric parameters.
+!
+!> @param ipar array with integer input parameters
+!> @param ho homochoric orientation
+!> @param e zero-mean normalized experimental pattern
+!> @param accum energy weight array
+!> @param mLPNH Northern hemisphere master pattern
+!> @param mLPSH Southern hemisphere master pattern
+!> @param mask pattern mask
+!> @param prefactor intensity prefactor
+!> @param rgx, rgy, rgz detector direction cosines
+!> @param gammaval gamma correction factor
+!> @param npix number of pattern pixels
+!> @param r residual
+!> @param J Jacobian
+!> @param cost sum of squared residuals
+!--------------------------------------------------------------------------
+recursive subroutine LMEvalEBSD(ipar, ho, e, accum, mLPNH, mLPSH, mask, prefactor, rgx, rgy, rgz, gammaval, &
+                                npix, r, J, cost)
+!DEC$ ATTRIBUTES DLLEXPORT :: LMEvalEBSD
+
+use local
+use EBSDmod
+use error
+
+use,INTRINSIC :: ISO_C_BINDING
+
+IMPLICIT NONE
+
+integer(c_size_t),intent(in)            :: ipar(10)
+real(kind=dbl),INTENT(IN)               :: ho(3)
+integer(kind=irg),INTENT(IN)            :: npix
+real(kind=dbl),INTENT(IN)               :: e(npix)
+real(kind=sgl),INTENT(IN)               :: accum(ipar(6),ipar(2),ipar(3))
+real(kind=sgl),INTENT(IN)               :: mLPNH(-ipar(4):ipar(4),-ipar(5):ipar(5),ipar(7))
+real(kind=sgl),INTENT(IN)               :: mLPSH(-ipar(4):ipar(4),-ipar(5):ipar(5),ipar(7))
+real(kind=sgl),INTENT(IN)               :: mask(ipar(2)/ipar(1),ipar(3)/ipar(1))
+real(kind=dbl),INTENT(IN)               :: prefactor
+real(kind=sgl),INTENT(IN)               :: rgx(ipar(2),ipar(3))
+real(kind=sgl),INTENT(IN)               :: rgy(ipar(2),ipar(3))
+real(kind=sgl),INTENT(IN)               :: rgz(ipar(2),ipar(3))
+real(kind=sgl),intent(IN)               :: gammaval
+real(kind=dbl),INTENT(OUT)              :: r(npix)
+real(kind=dbl),INTENT(OUT)              :: J(npix,3)
+real(kind=dbl),INTENT(OUT)              :: cost
+
+real(kind=sgl)                          :: binned(ipar(2)/ipar(1),ipar(3)/ipar(1)), &
+                                           dbinned(ipar(2)/ipar(1),ipar(3)/ipar(1),3)
+real(kind=dbl)                          :: m(npix), p(npix), pn, msum, c
+integer(kind=irg)                       :: jpar(7), k
+
+jpar(1:7) = ipar(1:7)
+call CalcEBSDPatternSingleJacobian(jpar, ho, accum, mLPNH, mLPSH, rgx, rgy, rgz, binned, dbinned, &
+                                   int(ipar(8)), int(ipar(9)), mask, prefactor)
+
+m = dble(reshape(mask,(/npix/)))
+msum = sum(m)
+p = dble(reshape(binned,(/npix/)))
+do k=1,3
+  J(1:npix,k) = dble(reshape(dbinned(:,:,k),(/npix/)))
+end do
+
+! gamma correction
+if (gammaval.ne.1.0) then
+  do k=1,3
+    where (p.gt.0.D0) 
+      J(1:npix,k) = dble(gammaval) * p**(gammaval-1.0) * J(1:npix,k)
+    elsewhere
+      J(1:npix,k) = 0.D0
+    end where
+  end do
+  where (p.gt.0.D0) p = p**gammaval
+end if
+
+! zero mean within the mask, then normalize
+p = m * (p - sum(m*p)/msum)
+pn = sqrt(sum(p**2))
+if (pn.eq.0.D0) call FatalError('LMEvalEBSD:','Norm of calculated pattern is zero...check input data.')
+p = p/pn
+do k=1,3
+  J(1:npix,k) = m * (J(1:npix,k) - sum(m*J(1:npix,k))/msum)
+  c = sum(p*J(1:npix,k))
+  J(1:npix,k) = (J(1:npix,k) - c*p)/pn
+end do
+
+r = p - e
+cost = sum(r**2)
+
+end subroutine LMEvalEBSD
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE:LMResidualEBSD
+!
+!> @brief residual of LMEvalEBSD without the Jacobian
+!
+!> @details used for finite difference derivatives with respect to detector parameters
+!
+!> @param ipar array with integer input parameters
+!> @param ho homochoric orientation
+!> @param e zero-mean normalized experimental pattern
+!> @param accum energy weight array
+!> @param mLPNH Northern hemisphere master pattern
+!> @param mLPSH Southern hemisphere master pattern
+!> @param mask pattern mask
+!> @param prefactor intensity prefactor
+!> @param rgx, rgy, rgz detector direction cosines
+!> @param gammaval gamma correction factor
+!> @param npix number of pattern pixels
+!> @param r residual
+!> @param cost sum of squared residuals
+!--------------------------------------------------------------------------
+recursive subroutine LMResidualEBSD(ipar, ho, e, accum, mLPNH, mLPSH, mask, prefactor, rgx, rgy, rgz, gammaval, &
+                                    npix, r, cost)
+!DEC$ ATTRIBUTES DLLEXPORT :: LMResidualEBSD
+
+use local
+use rotations
+use EBSDmod
+use error
+
+use,INTRINSIC :: ISO_C_BINDING
+
+IMPLICIT NONE
+
+integer(c_size_t),intent(in)            :: ipar(10)
+real(kind=dbl),INTENT(IN)               :: ho(3)
+integer(kind=irg),INTENT(IN)            :: npix
+real(kind=dbl),INTENT(IN)               :: e(npix)
+real(kind=sgl),INTENT(IN)               :: accum(ipar(6),ipar(2),ipar(3))
+real(kind=sgl),INTENT(IN)               :: mLPNH(-ipar(4):ipar(4),-ipar(5):ipar(5),ipar(7))
+real(kind=sgl),INTENT(IN)               :: mLPSH(-ipar(4):ipar(4),-ipar(5):ipar(5),ipar(7))
+real(kind=sgl),INTENT(IN)               :: mask(ipar(2)/ipar(1),ipar(3)/ipar(1))
+real(kind=dbl),INTENT(IN)               :: prefactor
+real(kind=sgl),INTENT(IN)               :: rgx(ipar(2),ipar(3))
+real(kind=sgl),INTENT(IN)               :: rgy(ipar(2),ipar(3))
+real(kind=sgl),INTENT(IN)               :: rgz(ipar(2),ipar(3))
+real(kind=sgl),intent(IN)               :: gammaval
+real(kind=dbl),INTENT(OUT)              :: r(npix)
+real(kind=dbl),INTENT(OUT)              :: cost
+
+real(kind=sgl)                          :: binned(ipar(2)/ipar(1),ipar(3)/ipar(1)), quat(4)
+real(kind=dbl)                          :: m(npix), p(npix), pn, msum
+integer(kind=irg)                       :: jpar(7)
+
+jpar(1:7) = ipar(1:7)
+quat = sngl(ho2qu(ho))
+call CalcEBSDPatternSingleFull(jpar, quat, accum, mLPNH, mLPSH, rgx, rgy, rgz, binned, int(ipar(8)), int(ipar(9)), &
+                               mask, prefactor)
+
+m = dble(reshape(mask,(/npix/)))
+msum = sum(m)
+p = dble(reshape(binned,(/npix/)))
+if (gammaval.ne.1.0) then
+  where (p.gt.0.D0) p = p**gammaval
+end if
+
+p = m * (p - sum(m*p)/msum)
+pn = sqrt(sum(p**2))
+if (pn.eq.0.D0) call FatalError('LMResidualEBSD:','Norm of calculated pattern is zero...check input data.')
+
+r = p/pn - e
+cost = sum(r**2)
+
+end subroutine LMResidualEBSD
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE:LMSolve3
+!
+!> @brief solve a 3x3 linear system by Cramer's rule (zero solution for a singular matrix)
+!
+!> @param A matrix
+!> @param b right hand side
+!> @param x solution
+!--------------------------------------------------------------------------
+recursive subroutine LMSolve3(A, b, x)
+!DEC$ ATTRIBUTES DLLEXPORT :: LMSolve3
+
+use local
+
+IMPLICIT NONE
+
+real(kind=dbl),INTENT(IN)               :: A(3,3)
+real(kind=dbl),INTENT(IN)               :: b(3)
+real(kind=dbl),INTENT(OUT)              :: x(3)
+
+real(kind=dbl)                          :: d, M(3,3)
+integer(kind=irg)                       :: k
+
+d = A(1,1)*(A(2,2)*A(3,3)-A(2,3)*A(3,2)) - A(1,2)*(A(2,1)*A(3,3)-A(2,3)*A(3,1)) + &
+    A(1,3)*(A(2,1)*A(3,2)-A(2,2)*A(3,1))
+if (abs(d).lt.tiny(d)) then
+  x = 0.D0
+  return
+end if
+
+do k=1,3
+  M = A
+  M(1:3,k) = b
+  x(k) = ( M(1,1)*(M(2,2)*M(3,3)-M(2,3)*M(3,2)) - M(1,2)*(M(2,1)*M(3,3)-M(2,3)*M(3,1)) + &
+           M(1,3)*(M(2,1)*M(3,2)-M(2,2)*M(3,1)) ) / d
+end do
+
+end subroutine LMSolve3
+
 !--------------------------------------------------------------------------
 !
 ! SUBROUTINE:EMFitOrientationcalfunECP
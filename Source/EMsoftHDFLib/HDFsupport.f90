@@ -5696,6 +5696,9 @@ call HDFerror_check('HDF_readHyperslabCharArray2D:h5dread_f:'//trim(dataname), h
 call h5sclose_f(space, hdferr)
 call HDFerror_check('HDF_readHyperslabCharArray2D:h5sclose_f:'//trim(dataname), hdferr)
 
+call h5sclose_f(memspace, hdferr)
+call HDFerror_check('HDF_readHyperslabCharArray2D:h5sclose_f:'//trim(dataname), hdferr)
+
 call h5dclose_f(dset, hdferr)
 call HDFerror_check('HDF_readHyperslabCharArray2D:h5dclose_f:'//trim(dataname), hdferr)
 
@@ -5761,6 +5764,9 @@ call HDFerror_check('HDF_readHyperslabCharArray3D:h5dread_f:'//trim(dataname), h
 call h5sclose_f(space, hdferr)
 call HDFerror_check('HDF_readHyperslabCharArray3D:h5sclose_f:'//trim(dataname), hdferr)
 
+call h5sclose_f(memspace, hdferr)
+call HDFerror_check('HDF_readHyperslabCharArray3D:h5sclose_f:'//trim(dataname), hdferr)
+
 call h5dclose_f(dset, hdferr)
 call HDFerror_check('HDF_readHyperslabCharArray3D:h5dclose_f:'//trim(dataname), hdferr)
 
@@ -5830,6 +5836,9 @@ call HDFerror_check('HDF_readHyperslabCharArray4D:h5dread_f:'//trim(dataname), h
 call h5sclose_f(space, hdferr)
 call HDFerror_check('HDF_readHyperslabCharArray4D:h5sclose_f:'//trim(dataname), hdferr)
 
+call h5sclose_f(memspace, hdferr)
+call HDFerror_check('HDF_readHyperslabCharArray4D:h5sclose_f:'//trim(dataname), hdferr)
+
 call h5dclose_f(dset, hdferr)
 call HDFerror_check('HDF_readHyperslabCharArray4D:h5dclose_f:'//trim(dataname), hdferr)
 
@@ -5896,6 +5905,9 @@ call HDFerror_check('HDF_readHyperslabIntegerArray2D:h5dread_f:'//trim(dataname)
 call h5sclose_f(space, hdferr)
 call HDFerror_check('HDF_readHyperslabIntegerArray2D:h5sclose_f:'//trim(dataname), hdferr)
 
+call h5sclose_f(memspace, hdferr)
+call HDFerror_check('HDF_readHyperslabIntegerArray2D:h5sclose_f:'//trim(dataname), hdferr)
+
 call h5dclose_f(dset, hdferr)
 call HDFerror_check('HDF_readHyperslabIntegerArray2D:h5dclose_f:'//trim(dataname), hdferr)
 
@@ -5961,6 +5973,9 @@ call HDFerror_check('HDF_readHyperslabIntegerArray3D:h5dread_f:'//trim(dataname)
 call h5sclose_f(space, hdferr)
 call HDFerror_check('HDF_readHyperslabIntegerArray3D:h5sclose_f:'//trim(dataname), hdferr)
 
+call h5sclose_f(memspace, hdferr)
+call HDFerror_check('HDF_readHyperslabIntegerArray3D:h5sclose_f:'//trim(dataname), hdferr)
+
 call h5dclose_f(dset, hdferr)
 call HDFerror_check('HDF_readHyperslabIntegerArray3D:h5dclose_f:'//trim(dataname), hdferr)
 
@@ -6026,12 +6041,80 @@ call HDFerror_check('HDF_readHyperslabIntegerArray4D:h5dread_f:'//trim(dataname)
 call h5sclose_f(space, hdferr)
 call HDFerror_check('HDF_readHyperslabIntegerArray4D:h5sclose_f:'//trim(dataname), hdferr)
 
+call h5sclose_f(memspace, hdferr)
+call HDFerror_check('HDF_readHyperslabIntegerArray4D:h5sclose_f:'//trim(dataname), hdferr)
+
 call h5dclose_f(dset, hdferr)
 call HDFerror_check('HDF_readHyperslabIntegerArray4D:h5dclose_f:'//trim(dataname), hdferr)
 
 
 end function HDF_readHyperslabIntegerArray4D
 
+!--------------------------------------------------------------------------
+!
+! FUNCTION:HDF_readHyperslabFloatArray1D
+!
+!> @brief reads and returns a 1D hyperslab from the current file or group ID 
+!
+!> @note Note that this routine uses fortran-2003 options
+!
+!> @param dataname dataset name (string)
+!> @param offset offset of the hyperslab
+!> @param dims dimensions of the hyperslab
+!> @param HDF_head
+!--------------------------------------------------------------------------
+recursive function HDF_readHyperslabFloatArray1D(dataname, offset, dims, HDF_head) result(rdata)
+!DEC$ ATTRIBUTES DLLEXPORT :: HDF_readHyperslabFloatArray1D
+
+IMPLICIT NONE
+
+
+character(fnlen),INTENT(IN)                             :: dataname
+integer(HSIZE_T),INTENT(IN)                             :: offset(1)
+integer(HSIZE_T),INTENT(IN)                             :: dims(1)
+type(HDFobjectStackType),INTENT(INOUT)                  :: HDF_head
+!f2py intent(in,out) ::  HDF_head
+real(real_kind_7), dimension(:), allocatable, TARGET    :: rdata
+
+integer(HID_T)                                          :: memspace, space, dset ! Handles
+integer(HSIZE_T)                                        :: hdims(1), max_dims(1)
+integer                                                 :: hdferr, rnk
+
+call h5dopen_f(HDF_head%next%objectID, cstringify(dataname), dset, hdferr)
+call HDFerror_check('HDF_readHyperslabFloatArray1D:h5dopen_f:'//trim(dataname), hdferr)
+
+call h5dget_space_f(dset, space, hdferr)
+call HDFerror_check('HDF_readHyperslabFloatArray1D:h5dget_space_f:'//trim(dataname), hdferr)
+
+call h5sget_simple_extent_dims_f(space, hdims, max_dims, hdferr)
+call HDFerror_check('HDF_readHyperslabFloatArray1D:h5sget_simple_extent_dims_f:'//trim(dataname), hdferr)
+
+
+rnk = 1
+call h5sselect_hyperslab_f(space, H5S_SELECT_SET_F, offset, dims, hdferr) 
+call HDFerror_check('HDF_readHyperslabFloatArray1D:h5sselect_hyperslab_f:'//trim(dataname), hdferr)
+
+call h5screate_simple_f(rnk, dims, memspace, hdferr)
+call HDFerror_check('HDF_readHyperslabFloatArray1D:h5screate_simple_f:'//trim(dataname), hdferr)
+
+
+allocate(rdata(dims(1)))
+call h5dread_f(dset, H5T_NATIVE_REAL, rdata, hdims, hdferr, memspace, space)
+call HDFerror_check('HDF_readHyperslabFloatArray1D:h5dread_f:'//trim(dataname), hdferr)
+
+
+call h5sclose_f(space, hdferr)
+call HDFerror_check('HDF_readHyperslabFloatArray1D:h5sclose_f:'//trim(dataname), hdferr)
+
+call h5sclose_f(memspace, hdferr)
+call HDFerror_check('HDF_readHyperslabFloatArray1D:h5sclose_f:'//trim(dataname), hdferr)
+
+call h5dclose_f(dset, hdferr)
+call HDFerror_check('HDF_readHyperslabFloatArray1D:h5dclose_f:'//trim(dataname), hdferr)
+
+
+end function HDF_readHyperslabFloatArray1D
+
 !--------------------------------------------------------------------------
 !
 ! FUNCTION:HDF_readHyperslabFloatArray2D
@@ -6092,6 +6175,9 @@ call HDFerror_check('HDF_readHyperslabFloatArray2D:h5dread_f:'//trim(dataname),
 call h5sclose_f(space, hdferr)
 call HDFerror_check('HDF_readHyperslabFloatArray2D:h5sclose_f:'//trim(dataname), hdferr)
 
+call h5sclose_f(memspace, hdferr)
+call HDFerror_check('HDF_readHyperslabFloatArray2D:h5sclose_f:'//trim(dataname), hdferr)
+
 call h5dclose_f(dset, hdferr)
 call HDFerror_check('HDF_readHyperslabFloatArray2D:h5dclose_f:'//trim(dataname), hdferr)
 
@@ -6158,6 +6244,9 @@ call HDFerror_check('HDF_readHyperslabFloatArray3D:h5dread_f:'//trim(dataname),
 call h5sclose_f(space, hdferr)
 call HDFerror_check('HDF_readHyperslabFloatArray3D:h5sclose_f:'//trim(dataname), hdferr)
 
+call h5sclose_f(memspace, hdferr)
+call HDFerror_check('HDF_readHyperslabFloatArray3D:h5sclose_f:'//trim(dataname), hdferr)
+
 call h5dclose_f(dset, hdferr)
 call HDFerror_check('HDF_readHyperslabFloatArray3D:h5dclose_f:'//trim(dataname), hdferr)
 
@@ -6224,6 +6313,9 @@ call HDFerror_check('HDF_readHyperslabFloatArray4D:h5dread_f:'//trim(dataname),
 call h5sclose_f(space, hdferr)
 call HDFerror_check('HDF_readHyperslabFloatArray4D:h5sclose_f:'//trim(dataname), hdferr)
 
+call h5sclose_f(memspace, hdferr)
+call HDFerror_check('HDF_readHyperslabFloatArray4D:h5sclose_f:'//trim(dataname), hdferr)
+
 call h5dclose_f(dset, hdferr)
 call HDFerror_check('HDF_readHyperslabFloatArray4D:h5dclose_f:'//trim(dataname), hdferr)
 
@@ -6290,6 +6382,9 @@ call HDFerror_check('HDF_readHyperslabDoubleArray2D:h5dread_f:'//trim(dataname),
 call h5sclose_f(space, hdferr)
 call HDFerror_check('HDF_readHyperslabDoubleArray2D:h5sclose_f:'//trim(dataname), hdferr)
 
+call h5sclose_f(memspace, hdferr)
+call HDFerror_check('HDF_readHyperslabDoubleArray2D:h5sclose_f:'//trim(dataname), hdferr)
+
 call h5dclose_f(dset, hdferr)
 call HDFerror_check('HDF_readHyperslabDoubleArray2D:h5dclose_f:'//trim(dataname), hdferr)
 
@@ -6356,6 +6451,9 @@ call HDFerror_check('HDF_readHyperslabDoubleArray3D:h5dread_f:'//trim(dataname),
 call h5sclose_f(space, hdferr)
 call HDFerror_check('HDF_readHyperslabDoubleArray3D:h5sclose_f:'//trim(dataname), hdferr)
 
+call h5sclose_f(memspace, hdferr)
+call HDFerror_check('HDF_readHyperslabDoubleArray3D:h5sclose_f:'//trim(dataname), hdferr)
+
 call h5dclose_f(dset, hdferr)
 call HDFerror_check('HDF_readHyperslabDoubleArray3D:h5dclose_f:'//trim(dataname), hdferr)
 
@@ -6422,6 +6520,9 @@ call HDFerror_check('hdf_readHyperslabDoubleArray4D:h5dread_f:'//trim(dataname),
 call h5sclose_f(space, hdferr)
 call HDFerror_check('hdf_readHyperslabDoubleArray4D:h5sclose_f:'//trim(dataname), hdferr)
 
+call h5sclose_f(memspace, hdferr)
+call HDFerror_check('hdf_readHyperslabDoubleArray4D:h5sclose_f:'//trim(dataname), hdferr)
+
 call h5dclose_f(dset, hdferr)
 call HDFerror_check('hdf_readHyperslabDoubleArray4D:h5dclose_f:'//trim(dataname), hdferr)
 
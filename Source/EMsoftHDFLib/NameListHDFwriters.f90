@@ -922,7 +922,7 @@ type(HDFobjectStackType),INTENT(INOUT)                    :: HDF_head
 type(MCNameListType),INTENT(INOUT)                    :: mcnl
 !f2py intent(in,out) ::  mcnl
 
-integer(kind=irg),parameter                           :: n_int = 6, n_real = 7
+integer(kind=irg),parameter                           :: n_int = 9, n_real = 7
 integer(kind=irg)                                     :: hdferr,  io_int(n_int)
 real(kind=dbl)                                        :: io_real(n_real)
 character(20)                                         :: intlist(n_int), reallist(n_real)
@@ -935,13 +935,17 @@ groupname = SC_MCCLNameList
 hdferr = HDF_createGroup(groupname,HDF_head)
 
 ! write all the single integers
-io_int = (/ mcnl%stdout, mcnl%numsx, mcnl%primeseed, mcnl%num_el, mcnl%nthreads, mcnl%totnum_el /)
+io_int = (/ mcnl%stdout, mcnl%numsx, mcnl%primeseed, mcnl%num_el, mcnl%nthreads, mcnl%totnum_el, mcnl%blocksize, &
+           mcnl%firstbatch, mcnl%nbatches /)
 intlist(1) = 'stdout'
 intlist(2) = 'numsx'
 intlist(3) = 'primeseed'
 intlist(4) = 'num_el'
 intlist(5) = 'nthreads'
 intlist(6) = 'totnum_el'
+intlist(7) = 'blocksize'
+intlist(8) = 'firstbatch'
+intlist(9) = 'nbatches'
 call HDF_writeNMLintegers(HDF_head, io_int, intlist, n_int)
 
 ! write all the single doubles
@@ -961,6 +965,11 @@ sval(1) = mcnl%MCmode
 hdferr = HDF_writeDatasetStringArray(dataset, sval, 1, HDF_head)
 if (hdferr.ne.0) call HDF_handleError(hdferr,'HDFwriteMCNameList: unable to create MCmode dataset',.TRUE.)
 
+dataset = SC_rngmode
+sval(1) = mcnl%rngmode
+hdferr = HDF_writeDatasetStringArray(dataset, sval, 1, HDF_head)
+if (hdferr.ne.0) call HDF_handleError(hdferr,'HDFwriteMCNameList: unable to create rngmode dataset',.TRUE.)
+
 dataset = SC_xtalname
 line2(1) = mcnl%xtalname
 hdferr = HDF_writeDatasetStringArray(dataset, line2, 1, HDF_head)
@@ -1298,7 +1307,7 @@ type(HDFobjectStackType),INTENT(INOUT)                    :: HDF_head
 type(EBSDMasterNameListType),INTENT(INOUT)            :: emnl
 !f2py intent(in,out) ::  emnl
 
-integer(kind=irg),parameter                           :: n_int = 9, n_real = 1
+integer(kind=irg),parameter                           :: n_int = 13, n_real = 1
 integer(kind=irg)                                     :: hdferr,  io_int(n_int), restart, uniform, combinesites, &
                                                          useEnergyWeighting, Legendre
 real(kind=sgl)                                        :: io_real(n_real)
@@ -1337,7 +1346,8 @@ if (emnl%doLegendre) then
 else 
   Legendre = 0
 end if
-io_int = (/ emnl%stdout, emnl%npx, emnl%Esel, emnl%nthreads, combinesites, restart, uniform, useEnergyWeighting, Legendre /)
+io_int = (/ emnl%stdout, emnl%npx, emnl%Esel, emnl%nthreads, combinesites, restart, uniform, useEnergyWeighting, Legendre, &
+            emnl%checkpoint, emnl%Econcurrent, emnl%nshards, emnl%shard /)
 intlist(1) = 'stdout'
 intlist(2) = 'npx'
 intlist(3) = 'Esel'
@@ -1347,6 +1357,10 @@ intlist(6) = 'restart'
 intlist(7) = 'uniform'
 intlist(8) = 'useEnergyWeighting'
 intlist(9) = 'doLegendre'
+intlist(10) = 'checkpoint'
+intlist(11) = 'Econcurrent'
+intlist(12) = 'nshards'
+intlist(13) = 'shard'
 call HDF_writeNMLintegers(HDF_head, io_int, intlist, n_int)
 
 ! write a single real
@@ -2156,7 +2170,7 @@ type(HDFobjectStackType),INTENT(INOUT)                    :: HDF_head
 type(TKDMasterNameListType),INTENT(INOUT)            :: emnl
 !f2py intent(in,out) ::  emnl
 
-integer(kind=irg),parameter                           :: n_int = 7, n_real = 1
+integer(kind=irg),parameter                           :: n_int = 9, n_real = 1
 integer(kind=irg)                                     :: hdferr,  io_int(n_int), restart, uniform, combinesites
 real(kind=sgl)                                        :: io_real(n_real)
 character(20)                                         :: intlist(n_int), reallist(n_real)
@@ -2184,7 +2198,8 @@ if (emnl%combinesites) then
 else 
   combinesites = 0
 end if
-io_int = (/ emnl%stdout, emnl%npx, emnl%Esel, emnl%nthreads, restart, uniform, combinesites /)
+io_int = (/ emnl%stdout, emnl%npx, emnl%Esel, emnl%nthreads, restart, uniform, combinesites, &
+           emnl%nshards, emnl%shard /)
 intlist(1) = 'stdout'
 intlist(2) = 'npx'
 intlist(3) = 'Esel'
@@ -2192,6 +2207,8 @@ intlist(4) = 'nthreads'
 intlist(5) = 'restart'
 intlist(6) = 'uniform'
 intlist(7) = 'combinesites'
+intlist(8) = 'nshards'
+intlist(9) = 'shard'
 call HDF_writeNMLintegers(HDF_head, io_int, intlist, n_int)
 
 ! write a single real
@@ -2643,7 +2660,7 @@ type(HDFobjectStackType),INTENT(INOUT)                :: HDF_head
 type(ECPMasterNameListType),INTENT(INOUT)             :: ecpnl
 !f2py intent(in,out) ::  ecpnl
 
-integer(kind=irg),parameter                           :: n_int = 5, n_real = 1
+integer(kind=irg),parameter                           :: n_int = 7, n_real = 1
 integer(kind=irg)                                     :: hdferr, io_int(n_int), distort, combinesites
 real(kind=dbl)                                        :: io_real(n_real)
 character(20)                                         :: intlist(n_int), reallist(n_real)
@@ -2662,12 +2679,14 @@ else
   combinesites = 0
 end if
 
-io_int = (/ ecpnl%stdout, ecpnl%Esel, ecpnl%npx, ecpnl%nthreads, combinesites /)
+io_int = (/ ecpnl%stdout, ecpnl%Esel, ecpnl%npx, ecpnl%nthreads, combinesites, ecpnl%nshards, ecpnl%shard /)
 intlist(1) = 'stdout'
 intlist(2) = 'Esel'
 intlist(3) = 'npx'
 intlist(4) = 'nthreads'
 intlist(5) = 'combinesites'
+intlist(6) = 'nshards'
+intlist(7) = 'shard'
 call HDF_writeNMLintegers(HDF_head, io_int, intlist, n_int)
 
 
@@ -4448,7 +4467,7 @@ type(HDFobjectStackType),INTENT(INOUT)                :: HDF_head
 type(EBSDIndexingNameListType),INTENT(INOUT)          :: ebsdnl
 !f2py intent(in,out) ::  ebsdnl
 
-integer(kind=irg),parameter                           :: n_int = 22, n_real = 12, n_reald = 3
+integer(kind=irg),parameter                           :: n_int = 24, n_real = 12, n_reald = 3
 integer(kind=irg)                                     :: hdferr,  io_int(n_int)
 real(kind=sgl)                                        :: io_real(n_real)
 real(kind=dbl)                                        :: io_reald(n_reald)
@@ -4465,7 +4484,8 @@ hdferr = HDF_createGroup(groupname,HDF_head)
 io_int = (/ ebsdnl%ncubochoric, ebsdnl%numexptsingle, ebsdnl%numdictsingle, ebsdnl%ipf_ht, &
             ebsdnl%ipf_wd, ebsdnl%nnk, ebsdnl%maskradius, ebsdnl%numsx, ebsdnl%numsy, ebsdnl%binning, &
             ebsdnl%nthreads, ebsdnl%energyaverage, ebsdnl%devid, ebsdnl%platid, ebsdnl%nregions, ebsdnl%nnav, &
-            ebsdnl%nosm, ebsdnl%nlines, ebsdnl%usenumd, ebsdnl%nism, ebsdnl%exptnumsx, ebsdnl%exptnumsy /)
+            ebsdnl%nosm, ebsdnl%nlines, ebsdnl%usenumd, ebsdnl%nism, ebsdnl%exptnumsx, ebsdnl%exptnumsy, &
+            ebsdnl%PCAdim, ebsdnl%PCAsamples /)
 intlist(1) = 'Ncubochoric'
 intlist(2) = 'numexptsingle'
 intlist(3) = 'numdictsingle'
@@ -4488,6 +4508,8 @@ intlist(19) = 'usenumd'
 intlist(20) = 'nism'
 intlist(21) = 'exptnumsx'
 intlist(22) = 'exptnumsy'
+intlist(23) = 'PCAdim'
+intlist(24) = 'PCAsamples'
 call HDF_writeNMLintegers(HDF_head, io_int, intlist, n_int)
 
 io_real = (/ ebsdnl%L, ebsdnl%thetac, ebsdnl%delta, ebsdnl%omega, ebsdnl%xpc, &
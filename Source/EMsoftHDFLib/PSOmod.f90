@@ -178,18 +178,27 @@ contains
         real(kind=4), intent(inout) :: w 
         real(kind=4), intent(in) :: w_damp, c1, c2
         real(kind=4) :: v_ideal, v_ave, v_start, maxVelocity(Dim_XC), minVelocity(Dim_XC)
-        real(kind=4) :: value(size(swarm),Dim_XC), rand_step_1, rand_step_2, objval(size(swarm))
+        real(kind=4) :: value(size(swarm),Dim_XC), rand_step_1, rand_step_2, objval(size(swarm)), &
+                        bestcost(size(swarm)), medcost
         
-        integer :: i,j,k,s,iter, iloc
+        integer :: i,j,k,s,iter, iloc, nact, nstall(size(swarm)), act(size(swarm))
+        logical :: retired(size(swarm))
         
         iter=1
         v_start=0.0
         maxVelocity=0.1*(maximum-minimum)
         minVelocity=-maxVelocity
+        nstall = 0
+        retired = .FALSE.
 
         do i=1, de%itermax
                 value=0.0              
+                nact=0
             do j=1,size(swarm)
+                ! retired particles are neither moved nor evaluated
+                if (retired(j)) CYCLE
+                nact=nact+1
+                act(nact)=j
                 call random_number(rand_step_1)
                 call random_number(rand_step_2)
                 swarm(j)%velocity = de%w*swarm(j)%velocity + de%c1*rand_step_1*(best%parameters - swarm(j)%parameters) &
@@ -199,26 +208,45 @@ contains
                 swarm(j)%velocity =max(min(swarm(j)%velocity,maxVelocity),minVelocity)
                 ! Confine invidual particle in the lower-upper bound
                 swarm(j)%parameters=max(min(swarm(j)%parameters,maximum),minimum)
-                value(j,1:Dim_XC)=swarm(j)%parameters
+                value(nact,1:Dim_XC)=swarm(j)%parameters
             end do
 
-            call objective_function(offset3, value, st_initial, objval, Dim_XC, &
-            enl, patterndata, size(swarm), de%objective, mcnl, mpnl, EBSDMCdata, EBSDMPdata)
+            ! all active particles are evaluated together, in parallel
+            call objective_function(offset3, value(1:nact,1:Dim_XC), st_initial, objval(1:nact), Dim_XC, &
+            enl, patterndata, nact, de%objective, mcnl, mpnl, EBSDMCdata, EBSDMPdata)
             
             ! updates the inertia weight
             de%w = de%w*de%w_damp  
           
-            do k=1,size(swarm)
-              swarm(k)%current_cost=objval(k)
-              if (swarm(k)%best_cost > swarm(k)%current_cost) then
-                swarm(k)%best_cost = swarm(k)%current_cost
-                swarm(k)%best_parameters = swarm(k)%parameters      
+            do k=1,nact
+              j=act(k)
+              swarm(j)%current_cost=objval(k)
+              if (swarm(j)%best_cost > swarm(j)%current_cost) then
+                swarm(j)%best_cost = swarm(j)%current_cost
+                swarm(j)%best_parameters = swarm(j)%parameters      
+                nstall(j) = 0
+              else
+                nstall(j) = nstall(j) + 1
               end if
             end do
-            iloc=minloc(objval,1)
+            iloc=act(minloc(objval(1:nact),1))
             best = swarm(iloc)
             iter=iter+1
 
+            ! early termination of dominated particles: a particle whose personal best has not improved
+            ! for de%stall iterations and lies in the worse half of the swarm is retired
+            if (de%stall.gt.0) then
+              bestcost = swarm(:)%best_cost
+              medcost = -HUGE(1.0)
+              do k=1,size(swarm)
+                if (count(bestcost.lt.bestcost(k)).le.(size(swarm)-1)/2) medcost = max(medcost, bestcost(k))
+              end do
+              do k=1,nact
+                j=act(k)
+                if ((nstall(j).ge.de%stall).and.(swarm(j)%best_cost.gt.medcost).and.(j.ne.iloc)) retired(j) = .TRUE.
+              end do
+            end if
+
             if( (de%refresh > 0) .and. (mod(iter,de%refresh)==0)) then
               write(*,*)
               print *,"# Iteration:",iter,": Objective function value:", best%best_cost 
@@ -293,16 +321,15 @@ subroutine objective_function(offset3, value,st_initial, objval, &
     real(kind=sgl),allocatable              :: energywf(:), eulerangles(:,:)
     
     ! arrays for each OpenMP thread
-    real(kind=sgl),allocatable              :: tmLPNH(:,:,:) , tmLPSH(:,:,:)
     real(kind=sgl),allocatable              :: trgx(:,:), trgy(:,:), trgz(:,:)          ! auxiliary detector arrays needed for interpolation
-    real(kind=sgl),allocatable              :: taccum(:,:,:)
+    real(kind=sgl),allocatable              :: taccum(:,:,:), pvec(:)
     
     ! various items
     integer(kind=irg)                       :: i, j, ii, jj, iang, jang, k, hdferr, dim2, recordsize         ! various counters
     integer(kind=irg)                       :: iunitexpt, istat, istats, ipar(7), L, correctsize
     integer(kind=irg)                       :: nix, niy, binx, biny, nixp, niyp     ! various parameters
     integer(kind=irg)                       :: nthreads,maskradius
-    real(kind=sgl)                          :: norm_target,norm_pattern(numangles)
+    real(kind=sgl)                          :: norm_target
     real(kind=sgl)                          :: ma, mi, tstart, tstop, io_real(3),temp_objval, max_p
     real(kind=sgl),parameter                :: dtor = 0.0174533  ! convert from degrees to radians
     real(kind=dbl),parameter                :: nAmpere = 6.241D+18   ! Coulomb per second
@@ -312,9 +339,8 @@ subroutine objective_function(offset3, value,st_initial, objval, &
     real(kind=dbl)                          :: sx, dx, dxm, dy, dym, rhos, x         ! various parameters
     real(kind=dbl)                          :: ixy(2), tmp
     real(kind=sgl),allocatable              :: mask(:,:), masklin(:), lx(:), ly(:), binnedvec(:), targetpattern(:)
-    character(kind=c_char),allocatable      :: batchpatterns(:,:,:), bpat(:,:)
-    integer(kind=irg),allocatable           :: batchpatternsint(:,:,:), bpatint(:,:)
-    real(kind=sgl),allocatable              :: batchpatterns32(:,:,:), batchpatterns32lin(:,:)
+    character(kind=c_char),allocatable      :: bpat(:,:)
+    integer(kind=irg),allocatable           :: bpatint(:,:)
     integer(kind=irg),allocatable           :: acc_array(:,:)
     real(kind=sgl),allocatable              :: master_arrayNH(:,:), master_arraySH(:,:), wf(:) 
     character(len=3)                        :: outputformat
@@ -479,19 +505,6 @@ subroutine objective_function(offset3, value,st_initial, objval, &
           correctsize = L
       end if
 
-    ! and allocate the batchpatterns array for hyperslab writing [modified 8/25/17 for different output formats]
-    if (trim(bitmode).eq.'char') then 
-      allocate(batchpatterns(binx,biny,numangles),stat=istat)
-    end if
-    if (trim(bitmode).eq.'int') then 
-      allocate(batchpatternsint(binx,biny,numangles),stat=istat)
-    end if
-    if (trim(bitmode).eq.'float') then 
-      allocate(batchpatterns32(binx,biny,numangles),stat=istat)
-    end if
-    if (trim(bitmode).eq.'dict') then 
-      allocate(batchpatterns32lin(correctsize,numangles),stat=istat)
-    end if
     !====================================
     ! here we also create a mask if necessary
       allocate(mask(binx,biny), masklin(L), stat=istat)
@@ -533,6 +546,10 @@ subroutine objective_function(offset3, value,st_initial, objval, &
     ipar(6) = EBSDMCdata%numEbins
     ipar(7) = EBSDMCdata%numEbins
     
+    ! the norm of the target pattern is needed for the normalized dot product
+    norm_target=norm2(targetpattern(1:L))
+    if ((objective.ne.1).and.(objective.ne.2)) print *,"Undefined Objective Function"
+
     !====================================
     ! set the number of OpenMP threads 
     call OMP_SET_NUM_THREADS(nthreads)
@@ -540,22 +557,20 @@ subroutine objective_function(offset3, value,st_initial, objval, &
     !====================================
     !====================================
 
-    ! use OpenMP to run on multiple cores ... 
+    ! use OpenMP to run on multiple cores; all population members are independent full pattern
+    ! simulations, and each member's objective function value is computed by the thread that
+    ! simulated it, so that objval does not depend on the number of threads or on the scheduling
     !$OMP PARALLEL default(shared)  PRIVATE(iang,i,j,istat,EBSDpattern,binned,idum,bpat,ma,mi,bpatint)&
-    !$OMP& PRIVATE(tmLPNH, tmLPSH, trgx, trgy, trgz, taccum, prefactor)&
+    !$OMP& PRIVATE(trgx, trgy, trgz, taccum, prefactor, pvec)&
     !$OMP& PRIVATE(Fmatrix_inverse, nel, Fmatrix, binnedvec)
 
-    ! each thread needs a private copy of the master and accum arrays; not having
-    ! those can produce poor scaling... in addition, they need to be recomputed for each pattern !
+    ! each thread needs its own detector arrays, since these are recomputed for each member;
+    ! the master pattern arrays are only read, so all threads share them
       allocate(trgx(enl%numsx,enl%numsy), trgy(enl%numsx,enl%numsy), trgz(enl%numsx,enl%numsy))
       allocate(taccum(EBSDMCdata%numEbins,enl%numsx,enl%numsy))
-      allocate(tmLPNH(enl%numsx,enl%numsy,EBSDMCdata%numEbins), tmLPSH(enl%numsx,enl%numsy,EBSDMCdata%numEbins))
-    ! and copy the data in
-      tmLPNH = EBSDMPdata%mLPNH
-      tmLPSH = EBSDMPdata%mLPSH
     
     ! allocate the arrays that will hold the computed pattern
-      allocate(binned(binx,biny),stat=istat)
+      allocate(binned(binx,biny), pvec(L), stat=istat)
       if (trim(bitmode).eq.'char') then 
         allocate(bpat(binx,biny),stat=istat)
       end if
@@ -594,18 +609,18 @@ subroutine objective_function(offset3, value,st_initial, objval, &
             
         if (includeFmatrix.eqv..TRUE.) then 
          if (enl%includebackground.eq.'y') then
-          call CalcEBSDPatternSingleFull(ipar,q_c(iang,1:4),taccum,tmLPNH,tmLPSH,trgx,trgy,trgz,binned, &
+          call CalcEBSDPatternSingleFull(ipar,q_c(iang,1:4),taccum,EBSDMPdata%mLPNH,EBSDMPdata%mLPSH,trgx,trgy,trgz,binned, &
                                          Emin,Emax,mask,prefactor,Fmatrix_inverse)
          else
-          call CalcEBSDPatternSingleFull(ipar,q_c(iang,1:4),taccum,tmLPNH,tmLPSH,trgx,trgy,trgz,binned, &
+          call CalcEBSDPatternSingleFull(ipar,q_c(iang,1:4),taccum,EBSDMPdata%mLPNH,EBSDMPdata%mLPSH,trgx,trgy,trgz,binned, &
                                          Emin,Emax,mask,prefactor,Fmatrix_inverse,removebackground='y')
          end if
         else
          if (enl%includebackground.eq.'y') then
-          call CalcEBSDPatternSingleFull(ipar,q_c(iang,1:4),taccum,tmLPNH,tmLPSH,trgx,trgy,trgz,binned, &
+          call CalcEBSDPatternSingleFull(ipar,q_c(iang,1:4),taccum,EBSDMPdata%mLPNH,EBSDMPdata%mLPSH,trgx,trgy,trgz,binned, &
                                          Emin,Emax,mask,prefactor)
          else
-          call CalcEBSDPatternSingleFull(ipar,q_c(iang,1:4),taccum,tmLPNH,tmLPSH,trgx,trgy,trgz,binned, &
+          call CalcEBSDPatternSingleFull(ipar,q_c(iang,1:4),taccum,EBSDMPdata%mLPNH,EBSDMPdata%mLPSH,trgx,trgy,trgz,binned, &
                                          Emin,Emax,mask,prefactor,removebackground='y')
          end if
         end if
@@ -614,6 +629,7 @@ subroutine objective_function(offset3, value,st_initial, objval, &
             binned = binned**enl%gammavalue
         end if
 
+    ! convert the pattern to the requested output format; pvec holds the pattern as it would be stored
         if (trim(bitmode).eq.'dict') then  ! pre-process the patterns for dictionary indexing
           ! this step includes adaptive histogram equalization, masking, and normalization
           
@@ -633,16 +649,14 @@ subroutine objective_function(offset3, value,st_initial, objval, &
           ! apply circular mask and normalize
                   binnedvec(1:L) = binnedvec(1:L) * masklin(1:L)
                   binnedvec(1:correctsize) = binnedvec(1:correctsize)/vecnorm(binnedvec(1:correctsize))
-          
-          ! store in array for hyperslab writing
-                  batchpatterns32lin(1:correctsize, iang) = binnedvec
+                  pvec = binnedvec(1:L)
         else
           if (trim(bitmode).eq.'char') then 
             ma = maxval(binned)
             mi = minval(binned)
             binned = mask * ((binned - mi)/ (ma-mi))
             bpat = char(nint(bitrange*binned))
-            batchpatterns(1:binx,1:biny, iang) = bpat
+            pvec = float(reshape(ichar(bpat),(/ L /)))
           end if
       
           if (trim(bitmode).eq.'int') then 
@@ -650,26 +664,32 @@ subroutine objective_function(offset3, value,st_initial, objval, &
             mi = minval(binned)
             binned = mask * ((binned - mi)/ (ma-mi))
             bpatint = nint(bitrange*binned)
-            batchpatternsint(1:binx,1:biny, iang) = bpatint
+            pvec = float(reshape(bpatint,(/ L /)))
           end if
 
           if (trim(bitmode).eq.'float') then 
-            batchpatterns32(1:binx,1:biny, iang) = binned
+            pvec = reshape(binned,(/ L /))
           end if
         end if
 
+    ! objective function value for this member: normalized dot product (NDP) or root mean square error (RMSE)
+        objval(iang) = 0.0
+        if (objective .eq. 1) then
+          objval(iang) = -dot_product(targetpattern(1:L)/norm_target, pvec/norm2(pvec))
+        else if (objective .eq. 2) then
+          objval(iang) = sqrt(sum((pvec-targetpattern(1:L))**2)/L)
+        end if
+
       end do ! end of iang loop
      
       !$OMP END DO
       
       ! deallocate arrays to free memory
-      deallocate(tmLPSH)
-      deallocate(tmLPNH)
       deallocate(taccum)
       deallocate(trgx)
       deallocate(trgy)
       deallocate(trgz)  
-      deallocate(binned)
+      deallocate(binned, pvec)
 
       if (trim(bitmode).eq.'char') then 
         deallocate(bpat)     
@@ -680,83 +700,13 @@ subroutine objective_function(offset3, value,st_initial, objval, &
       end if
 
       if (trim(bitmode).eq.'dict') then 
-        deallocate(binnedvec)
+        deallocate(bpatint, binnedvec)
       end if
     
     !$OMP END PARALLEL
 
-
-    ! Calculate the objective functions values (normalized dot product and root mean square error)
-    ! normalized dot product (NDP)
-    if (objective .eq. 1) then
-      norm_target=norm2(targetpattern)
-      do i=1,numangles
-        if (trim(bitmode).eq.'char') then 
-          norm_pattern(i)=norm2(float(reshape(ichar(batchpatterns(:,:,i)),(/ L /))))
-          objval(i)=-dot_product(targetpattern/norm_target, & 
-          float(reshape(ichar(batchpatterns(:,:,i)),(/ L /)))/norm_pattern(i))
-        end if
-      
-        if (trim(bitmode).eq.'int') then 
-          norm_pattern(i)=norm2(float(reshape(batchpatternsint(:,:,i),(/ L /))))
-          objval(i)=-dot_product(targetpattern/norm_target,& 
-          float(reshape(batchpatternsint(:,:,i),(/ L /)))/norm_pattern(i))
-        end if
-      
-        if (trim(bitmode).eq.'float') then 
-          norm_pattern(i)=norm2(reshape(batchpatterns32(:,:,i),(/ L /)))
-          objval(i)=-dot_product(targetpattern/norm_target,& 
-          reshape(batchpatterns32(:,:,i),(/ L /))/norm_pattern(i))
-        end if
-
-        if (trim(bitmode).eq.'dict') then 
-          norm_pattern(i)=norm2(batchpatterns32lin(:,i))
-          objval(i)=-dot_product(targetpattern/norm_target,& 
-          reshape(batchpatterns32lin(:,i),(/ L /))/norm_pattern(i))
-        end if
-      end do
-
-      ! root mean square error (RMSE)
-    else if (objective .eq. 2) then
-      do i=1,numangles
-        if (trim(bitmode).eq.'char') then
-          objval(i)=sqrt(sum((float(reshape(ichar(batchpatterns(:,:,i)),(/ L /)))-targetpattern)**2)/L)
-        end if
-
-        if (trim(bitmode).eq.'int') then
-          objval(i)=sqrt(sum((float(reshape(batchpatternsint(:,:,i),(/ L /)))-targetpattern)**2)/L)
-        end if
-
-        if (trim(bitmode).eq.'float') then
-          objval(i)=sqrt(sum((reshape(batchpatterns32(:,:,i),(/ L /))-targetpattern)**2)/L)
-        end if
-
-        if (trim(bitmode).eq.'dict') then
-          objval(i)=sqrt(sum((reshape(batchpatterns32lin(:,i),(/ L /))-targetpattern)**2)/L)
-        end if
-      end do
-    else
-      print *,"Undefined Objective Function"
-    end if
-      
       ! deallocate arrays
       deallocate(targetpattern)
-
-      if (trim(bitmode).eq.'char') then 
-        deallocate(batchpatterns) 
-      end if
-      
-      if (trim(bitmode).eq.'int') then 
-        deallocate(batchpatternsint)
-      end if
-      
-      if (trim(bitmode).eq.'float') then 
-        deallocate(batchpatterns32)
-      end if
-       
-      if (trim(bitmode).eq.'dict') then 
-        deallocate(batchpatterns32lin)
-      end if
 end subroutine objective_function
 
 
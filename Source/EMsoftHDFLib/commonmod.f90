@@ -344,15 +344,14 @@ end subroutine EBSDgetAverageOrientations
 !> @param ipf_wd width of the ROI
 !> @param ipf_ht height of the ROI
 !> @param osm (returned) Orientation Similarity Map (1D array)
+!> @param nbtype (optional) neighborhood type (4 or 8, default 4)
+!> @param radius (optional) neighborhood radius (default 1)
 !
 !> @date 07/28/16 MDG 1.0 original
 !--------------------------------------------------------------------------
-recursive subroutine EBSDgetOrientationSimilarityMap(idims, tmi, nm, ipf_wd, ipf_ht, osm)
+recursive subroutine EBSDgetOrientationSimilarityMap(idims, tmi, nm, ipf_wd, ipf_ht, osm, nbtype, radius)
 !DEC$ ATTRIBUTES DLLEXPORT :: EBSDgetOrientationSimilarityMap
 
-use math
-use io
-
 IMPLICIT NONE
 
 integer(kind=irg),INTENT(IN)     :: idims(2)
@@ -361,90 +360,215 @@ integer(kind=irg),INTENT(IN)     :: nm
 integer(kind=irg),INTENT(IN)     :: ipf_wd
 integer(kind=irg),INTENT(IN)     :: ipf_ht
 real(kind=sgl),INTENT(OUT)       :: osm(ipf_wd,ipf_ht)
+integer(kind=irg),INTENT(IN),OPTIONAL :: nbtype
+integer(kind=irg),INTENT(IN),OPTIONAL :: radius
 
-real(kind=sgl),allocatable       :: localosm(:)
-integer(kind=irg),allocatable    :: lstore(:,:), pstore(:,:), cp(:), lp(:)
-integer(kind=irg)                :: ii, jj, iii , dp, lnm, io_int(2), totnumexpt
+real(kind=sgl),allocatable       :: osml(:,:,:)
 
-osm = 0.0
-totnumexpt = ipf_wd * ipf_ht
+allocate(osml(ipf_wd,ipf_ht,1))
+call EBSDgetOrientationSimilarityMaps(idims, tmi, 1, (/ nm /), ipf_wd, ipf_ht, osml, nbtype, radius)
+osm = osml(:,:,1)
+deallocate(osml)
 
-! make sure that the requested number of near-matches is smaller than/equal to the available number
-if (nm.gt.idims(1)) then
-  io_int(1) = nm
-  io_int(2) = idims(1)
-  call WriteValue('Requested number of near matches is too large: ',io_int,2,"(I4,' > ',I4)")
-  call Message(' --> Resetting requested number to maximum available')
-  lnm = idims(1)
-else
-  lnm = nm
-end if
+end subroutine EBSDgetOrientationSimilarityMap
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: EBSDgetOrientationSimilarityMaps
+!
+!> @brief compute OSMs for several numbers of near matches in a single pass
+!
+!> @details Each top match list is sorted once (keeping the rank of every entry), after
+!> which a single merge per neighbor pair produces the number of common entries for all
+!> requested levels; this replaces the quadratic vectormatch calls for each level separately.
+!> The optional osmdw array receives the same maps with the neighbor contributions weighted 
+!> by the inverse of the neighbor distance, which only differs from osm for radius > 1 or 
+!> the 8-neighborhood.
+!
+!> @param idims dimensions of TopMatchIndices (tmi) array
+!> @param tmi Top Match Indices array
+!> @param nlev number of OSM levels
+!> @param nms number of matches to use for each level
+!> @param ipf_wd width of the ROI
+!> @param ipf_ht height of the ROI
+!> @param osm (returned) Orientation Similarity Maps, one per level
+!> @param nbtype (optional) neighborhood type (4 or 8, default 4)
+!> @param radius (optional) neighborhood radius (default 1)
+!> @param osmdw (optional, returned) distance-weighted Orientation Similarity Maps
+!--------------------------------------------------------------------------
+recursive subroutine EBSDgetOrientationSimilarityMaps(idims, tmi, nlev, nms, ipf_wd, ipf_ht, osm, nbtype, radius, osmdw)
+!DEC$ ATTRIBUTES DLLEXPORT :: EBSDgetOrientationSimilarityMaps
+
+use math
+use io
+use neighborhood
 
-allocate(lstore(lnm, ipf_wd), pstore(lnm, ipf_wd), cp(lnm), lp(lnm), localosm(ipf_wd*ipf_ht))
-
-localosm = 0.0
-lstore = 0
-pstore = 0
-cp = 0
-lp = 0
-
-! we'll do this computation on the 1D array, in the same way 
-! as the ADP (Average Dot Product) map in the EBSDDI.f90 program
-do iii = 1,totnumexpt
-    ii = mod(iii,ipf_wd)
-    if (ii.eq.0) ii = ipf_wd
-    jj = iii/ipf_wd+1
-! do we need to copy pstore into lstore ?
-    if ((ii.eq.1).and.(jj.gt.1)) lstore = pstore
-! determine to which osm entries we need to add the similarity count
-    if (ii.eq.1) then
-      cp(1:lnm) = tmi(1:lnm, iii)
-      pstore(1:lnm,ii) = cp(1:lnm)
-    else
-      lp = cp
-      cp(1:lnm) = tmi(1:lnm, iii)
-      pstore(1:lnm,ii) = cp(1:lnm)
-      dp = vectormatch(lnm, cp, lp)
-      localosm(iii-1) = localosm(iii-1) + dp
-      localosm(iii) = localosm(iii) + dp
-    end if
-    if (jj.gt.1) then
-      dp = vectormatch(lnm,lstore(1:lnm,ii),cp)
-      localosm(iii-ipf_wd+1) = localosm(iii-ipf_wd+1) + dp
-      localosm(iii) = localosm(iii) + dp
-    end if
+IMPLICIT NONE
+
+integer(kind=irg),INTENT(IN)     :: idims(2)
+integer(kind=irg),INTENT(IN)     :: tmi(idims(1),idims(2))
+integer(kind=irg),INTENT(IN)     :: nlev
+integer(kind=irg),INTENT(IN)     :: nms(nlev)
+integer(kind=irg),INTENT(IN)     :: ipf_wd
+integer(kind=irg),INTENT(IN)     :: ipf_ht
+real(kind=sgl),INTENT(OUT)       :: osm(ipf_wd,ipf_ht,nlev)
+integer(kind=irg),INTENT(IN),OPTIONAL :: nbtype
+integer(kind=irg),INTENT(IN),OPTIONAL :: radius
+real(kind=sgl),INTENT(OUT),OPTIONAL :: osmdw(ipf_wd,ipf_ht,nlev)
+
+type(NeighborhoodType)           :: nb
+real(kind=sgl),allocatable       :: pv(:,:,:)
+integer(kind=irg)                :: l, io_int(2), ntype, rad, lnms(nlev)
+
+! make sure that the requested numbers of near-matches are smaller than/equal to the available number
+do l=1,nlev
+  if (nms(l).gt.idims(1)) then
+    io_int(1) = nms(l)
+    io_int(2) = idims(1)
+    call WriteValue('Requested number of near matches is too large: ',io_int,2,"(I4,' > ',I4)")
+    call Message(' --> Resetting requested number to maximum available')
+    lnms(l) = idims(1)
+  else
+    lnms(l) = nms(l)
+  end if
 end do
 
-! correct the osm values depending on inside, edge, or corner pixels
-! divide by 4
-localosm = localosm*0.25
+ntype = 4
+if (present(nbtype)) ntype = nbtype
+rad = 1
+if (present(radius)) rad = radius
+call NB_Init(nb, ipf_wd, ipf_ht, ntype, rad)
+
+! the whole map is a single band
+allocate(pv(ipf_wd*ipf_ht,nb%noff,nlev))
+pv = 0.0
+call EBSDOSMPairValues(nb, idims(1), ipf_ht, tmi, 1, ipf_ht, nlev, lnms, pv)
+
+call EBSDOSMGather(nb, nlev, pv, osm, osmdw)
+
+deallocate(pv)
 
-! correct the straight segments  THIS NEEDS TO BE VERIFIED !!!!!
-localosm(2:ipf_wd-1) = localosm(2:ipf_wd-1) * 4.0/3.0
-localosm(totnumexpt-ipf_wd+2:totnumexpt-1) = localosm(totnumexpt-ipf_wd+2:totnumexpt-1) * 4.0/3.0
-do jj=1,ipf_ht-2
-  localosm(ipf_wd*jj+1) = localosm(ipf_wd*jj+1) * 4.0/3.0
+end subroutine EBSDgetOrientationSimilarityMaps
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: EBSDOSMPairValues
+!
+!> @brief number of common near matches for the neighbor pairs of a band of rows
+!
+!> @details The pair values of rows row1..row1+nrows-1 are stored in the pv array of the 
+!> full map, so that an OSM can be built up one band at a time.  Since all neighbor offsets
+!> point forward, tmi must hold the top matches of the band plus the nb%radius rows that 
+!> follow it (as far as they lie inside the map); nbuf is the total number of rows in tmi.
+!
+!> @param nb neighborhood structure for the full map
+!> @param nnm number of top matches per pattern in tmi
+!> @param nbuf number of rows in tmi, starting at row1
+!> @param tmi Top Match Indices for rows row1..row1+nbuf-1
+!> @param row1 first row of the band
+!> @param nrows number of rows in the band
+!> @param nlev number of OSM levels
+!> @param lnms number of matches for each level (at most nnm)
+!> @param pv pair values for the full map (wd*ht, noff, nlev)
+!--------------------------------------------------------------------------
+recursive subroutine EBSDOSMPairValues(nb, nnm, nbuf, tmi, row1, nrows, nlev, lnms, pv)
+!DEC$ ATTRIBUTES DLLEXPORT :: EBSDOSMPairValues
+
+use math
+use neighborhood
+
+IMPLICIT NONE
+
+type(NeighborhoodType),INTENT(IN) :: nb
+integer(kind=irg),INTENT(IN)     :: nnm
+integer(kind=irg),INTENT(IN)     :: nbuf
+integer(kind=irg),INTENT(IN)     :: tmi(nnm,nb%wd*nbuf)
+integer(kind=irg),INTENT(IN)     :: row1
+integer(kind=irg),INTENT(IN)     :: nrows
+integer(kind=irg),INTENT(IN)     :: nlev
+integer(kind=irg),INTENT(IN)     :: lnms(nlev)
+real(kind=sgl),INTENT(INOUT)     :: pv(nb%wd*nb%ht,nb%noff,nlev)
+
+integer(kind=irg),allocatable    :: stmi(:,:), srnk(:,:)
+integer(kind=irg)                :: ii, jj, k, p, q, lnm, nbp, off, nce(nlev)
+
+lnm = maxval(lnms)
+nbp = nb%wd*nbuf
+off = nb%wd*(row1-1)
+
+! sort the top lnm matches of every pattern in the buffer once
+allocate(stmi(lnm,nbp), srnk(lnm,nbp))
+!$OMP PARALLEL DO DEFAULT(SHARED) PRIVATE(p) SCHEDULE(STATIC)
+do p=1,nbp
+  call sortmatchlist(lnm, tmi(1:lnm,p), stmi(1:lnm,p), srnk(1:lnm,p))
 end do
-do jj=2,ipf_ht-1
-  localosm(ipf_wd*jj) = localosm(ipf_wd*jj) * 4.0/3.0
+!$OMP END PARALLEL DO
+
+! number of common near matches for each neighbor pair and each level; the rows are independent
+!$OMP PARALLEL DO DEFAULT(SHARED) PRIVATE(ii,jj,k,p,q,nce) SCHEDULE(DYNAMIC)
+do jj=row1,row1+nrows-1
+  do ii=1,nb%wd
+    p = nb%wd*(jj-1)+ii
+    do k=1,nb%noff
+      q = NB_Partner(nb, k, ii, jj)
+      if (q.ne.0) then
+        call vectormatchranked(lnm, stmi(1:lnm,p-off), srnk(1:lnm,p-off), stmi(1:lnm,q-off), srnk(1:lnm,q-off), &
+                               nlev, lnms, nce)
+        pv(p,k,1:nlev) = float(nce(1:nlev))
+      end if
+    end do
+  end do
 end do
+!$OMP END PARALLEL DO
 
-! and the corners
-localosm(1) = localosm(1) * 4.0
-localosm(ipf_wd) = localosm(ipf_wd) * 2.0
-localosm(totnumexpt) = localosm(totnumexpt) * 2.0
-localosm(totnumexpt-ipf_wd+1) = localosm(totnumexpt-ipf_wd+1) * 4.0/3.0
+deallocate(stmi, srnk)
 
-! and we deallocate the auxiliary variables 
-deallocate(lstore,pstore,lp,cp)
+end subroutine EBSDOSMPairValues
 
-do ii=1,ipf_wd
-  do jj=1,ipf_ht
-    osm(ii,jj) = localosm(ipf_wd*(jj-1)+ii)
-  end do
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: EBSDOSMGather
+!
+!> @brief turn the pair values of EBSDOSMPairValues into (distance-weighted) OSMs
+!
+!> @param nb neighborhood structure
+!> @param nlev number of OSM levels
+!> @param pv pair values (wd*ht, noff, nlev)
+!> @param osm (returned) Orientation Similarity Maps, one per level
+!> @param osmdw (optional, returned) distance-weighted Orientation Similarity Maps
+!--------------------------------------------------------------------------
+recursive subroutine EBSDOSMGather(nb, nlev, pv, osm, osmdw)
+!DEC$ ATTRIBUTES DLLEXPORT :: EBSDOSMGather
+
+use neighborhood
+
+IMPLICIT NONE
+
+type(NeighborhoodType),INTENT(IN) :: nb
+integer(kind=irg),INTENT(IN)     :: nlev
+real(kind=sgl),INTENT(IN)        :: pv(nb%wd*nb%ht,nb%noff,nlev)
+real(kind=sgl),INTENT(OUT)       :: osm(nb%wd,nb%ht,nlev)
+real(kind=sgl),INTENT(OUT),OPTIONAL :: osmdw(nb%wd,nb%ht,nlev)
+
+real(kind=sgl),allocatable       :: wdist(:)
+integer(kind=irg)                :: l
+
+osm = 0.0
+do l=1,nlev
+  call NB_Gather(nb, pv(:,:,l), osm(:,:,l))
 end do
 
-end subroutine EBSDgetOrientationSimilarityMap
+if (present(osmdw)) then
+  osmdw = 0.0
+  allocate(wdist(nb%noff))
+  wdist = 1.0/nb%dist
+  do l=1,nlev
+    call NB_Gather(nb, pv(:,:,l), osmdw(:,:,l), wdist)
+  end do
+  deallocate(wdist)
+end if
+
+end subroutine EBSDOSMGather
 
 !--------------------------------------------------------------------------
 !
@@ -546,15 +670,23 @@ end subroutine EBSDgetIndexingSuccessMap
 !> @param dict dict structure
 !> @param Pmdims number of symmetry operators
 !> @param kam (returned) Kernel Average Misorientation Map (2D array, radians)
+!> @param nbtype (optional) neighborhood type (4 or 8, default 4)
+!> @param radius (optional) neighborhood radius (default 1)
+!
+!> @details for each neighbor offset, the disorientations of all pixel pairs are obtained with a single 
+!> call to the batched getDisorientationAngles routine on two shifted slices of the quaternion array; 
+!> the neighborhood module then averages over the neighbors that lie inside the map.
 !
 !> @date 07/30/16 MDG 1.0 original
 !--------------------------------------------------------------------------
-recursive subroutine EBSDgetKAMMap(numeu, eulers, ipf_wd, ipf_ht, dict, kam)
+recursive subroutine EBSDgetKAMMap(numeu, eulers, ipf_wd, ipf_ht, dict, kam, nbtype, radius)
 !DEC$ ATTRIBUTES DLLEXPORT :: EBSDgetKAMMap
 
 use math
 use io
 use dictmod
+use rotations
+use neighborhood
 
 IMPLICIT NONE
 
@@ -567,78 +699,41 @@ integer(kind=irg),INTENT(IN)     :: ipf_ht
 type(dicttype),INTENT(INOUT):: dict
 !f2py intent(in,out) ::  dict
 real(kind=sgl),INTENT(OUT)       :: kam(ipf_wd,ipf_ht)
+integer(kind=irg),INTENT(IN),OPTIONAL :: nbtype
+integer(kind=irg),INTENT(IN),OPTIONAL :: radius
 
-real(kind=sgl),allocatable       :: localkam(:)
-real(kind=sgl),allocatable       :: lstore(:,:), pstore(:,:)
-real(kind=sgl)                   :: cp(3), lp(3)
-integer(kind=irg)                :: ii, jj, iii 
-real(kind=sgl)                   :: dp
+type(NeighborhoodType)           :: nb
+real(kind=sgl),allocatable       :: qu(:,:), pv(:,:)
+integer(kind=irg)                :: iii, k, n, ns, ntype, rad
 
 kam = 0.0
-
-allocate(lstore(3,ipf_wd), pstore(3,ipf_wd), localkam(numeu))
-
-localkam = 0.0
-lstore = 0
-pstore = 0
-cp = 0
-lp = 0
-
-! we'll do this computation on the 1D array, in the same way 
-! as the ADP (Average Dot Product) map in the EBSDDI.f90 program
-do iii = 1,numeu
-    ii = mod(iii,ipf_wd)
-    if (ii.eq.0) ii = ipf_wd
-    jj = iii/ipf_wd+1
-! do we need to copy pstore into lstore ?
-    if ((ii.eq.1).and.(jj.gt.1)) lstore = pstore
-! determine to which kam entries we need to add the next disorientation value
-    if (ii.eq.1) then
-      cp = eulers(1:3,iii)
-      pstore(1:3,ii) = cp
-    else
-      lp = cp
-      cp = eulers(1:3,iii)
-      pstore(1:3,ii) = cp
-      call getDisorientationAngle(lp, cp, dict, dp)
-      localkam(iii-1) = localkam(iii-1) + dp
-      localkam(iii) = localkam(iii) + dp
-    end if
-    if (jj.gt.1) then
-      call getDisorientationAngle(lstore(1:3,ii), cp, dict, dp)
-      localkam(iii-ipf_wd+1) = localkam(iii-ipf_wd+1) + dp
-      localkam(iii) = localkam(iii) + dp
-    end if
+n = ipf_wd*ipf_ht
+
+ntype = 4
+if (present(nbtype)) ntype = nbtype
+rad = 1
+if (present(radius)) rad = radius
+call NB_Init(nb, ipf_wd, ipf_ht, ntype, rad)
+
+! convert all orientations to quaternions once
+allocate(qu(4,n), pv(n,nb%noff))
+!$OMP PARALLEL DO DEFAULT(SHARED) PRIVATE(iii)
+do iii=1,n
+  qu(1:4,iii) = eu2qu(eulers(1:3,iii))
 end do
-
-! correct the kam values depending on inside, edge, or corner pixels
-! divide by 4
-localkam = localkam*0.25
-
-! correct the straight segments  
-localkam(2:ipf_wd-1) = localkam(2:ipf_wd-1) * 4.0/3.0
-localkam(numeu-ipf_wd+2:numeu-1) = localkam(numeu-ipf_wd+2:numeu-1) * 4.0/3.0
-do jj=1,ipf_ht-2
-  localkam(ipf_wd*jj+1) = localkam(ipf_wd*jj+1) * 4.0/3.0
+!$OMP END PARALLEL DO
+
+! pixel p and its forward neighbor k are always nb%shift(k) entries apart; pairs that wrap 
+! around a row end are computed as well, but they are ignored by NB_Gather
+pv = 0.0
+do k=1,nb%noff
+  ns = n - nb%shift(k)
+  if ((ns.gt.0).and.(ns.le.n)) call getDisorientationAngles(ns, qu(1:4,1:ns), qu(1:4,nb%shift(k)+1:n), dict, pv(1:ns,k))
 end do
-do jj=2,ipf_ht-1
-  localkam(ipf_wd*jj) = localkam(ipf_wd*jj) * 4.0/3.0
-end do
-
-! and the corners
-localkam(1) = localkam(1) * 4.0
-localkam(ipf_wd) = localkam(ipf_wd) * 2.0
-localkam(numeu) = localkam(numeu) * 2.0
-localkam(numeu-ipf_wd+1) = localkam(numeu-ipf_wd+1) * 4.0/3.0
 
-! and we deallocate the auxiliary variables 
-deallocate(lstore,pstore)
+call NB_Gather(nb, pv, kam)
 
-do ii=1,ipf_wd
-  do jj=1,ipf_ht
-    kam(ii,jj) = localkam(ipf_wd*(jj-1)+ii)
-  end do
-end do
+deallocate(qu, pv)
 
 end subroutine EBSDgetKAMMap
 
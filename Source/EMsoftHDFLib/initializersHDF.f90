@@ -64,6 +64,9 @@ contains
 !> @date 07/02/18 SS  5.3 added initLUT optional variable
 !> @date 08/09/18 MDG 5.4 added FSCATT interpolation option
 !< @date 03/02/21 MDG 5.5 added OpenMP parallel option for LUT computation (tested on Ni for nthreads=8)
+!
+!> @details when the EMSOFTLUTCACHE environment variable is set, the lookup tables for a given 
+!> structure, voltage and table size are computed only once and then taken from the LUTcache files
 !--------------------------------------------------------------------------
 recursive subroutine Initialize_Cell(cell,Dyn,rlp,xtalname, dmin, voltage, &
                                      verbose, existingHDFhead, nthreads, initLUT, noLUT, interpolate)
@@ -79,6 +82,7 @@ use error
 use gvectors
 use diffraction
 use HDFsupport
+use LUTcache
 use omp_lib
 
 IMPLICIT NONE
@@ -103,7 +107,8 @@ type(gnode)                                :: myrlp
 integer(kind=irg)                          :: istat, io_int(3), skip
 integer(kind=irg)                          :: imh, imk, iml, gg(3), ix, iy, iz
 real(kind=sgl)                             :: dhkl, io_real(3), ddt
-logical                                    :: loadingfile, justinit, interp, compute
+logical                                    :: loadingfile, justinit, interp, compute, cached
+character(16)                              :: cachekey
 real(kind=sgl),parameter                   :: gstepsize = 0.001  ! [nm^-1] interpolation stepsize
 
 ! !$OMP THREADPRIVATE(myrlp) 
@@ -228,6 +233,18 @@ if (compute) then
  cell%LUT(0,0,0) = rlp%Ucg
  cell%LUTqg(0,0,0) = rlp%qg
 
+! the remainder of the table may be available from an earlier run with the same parameters
+ cachekey = LUTcache_key(cell, 'UcgLUT', (/ imh, imk, iml, merge(1,0,interp) /), (/ cell%voltage /) )
+ call LUTcache_readLUT(cell, cachekey, cached)
+ if (cached) then
+  if (present(verbose)) then
+   if (verbose) then
+    call Message(' Fourier coefficient lookup table loaded from cache', frm = "(/A/)")
+   end if
+  end if
+  return
+ end if
+
  if (present(verbose)) then
   if (verbose) then
    call Message(' Generating Fourier coefficient lookup table ... ', frm = "(/A)",advance="no")
@@ -294,6 +311,8 @@ if (compute) then
       end do ixl
  end if
 
+ call LUTcache_writeLUT(cell, cachekey)
+
   if (present(verbose)) then
    if (verbose) then
     call Message(' Done', frm = "(A/)")
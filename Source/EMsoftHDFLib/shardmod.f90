@@ -0,0 +1,365 @@
+! ###################################################################
+! Copyright (c) 2013-2024, Marc De Graef Research Group/Carnegie Mellon University
+! All rights reserved.
+!
+! Redistribution and use in source and binary forms, with or without modification, are 
+! permitted provided that the following conditions are met:
+!
+!     - Redistributions of source code must retain the above copyright notice, this list 
+!        of conditions and the following disclaimer.
+!     - Redistributions in binary form must reproduce the above copyright notice, this 
+!        list of conditions and the following disclaimer in the documentation and/or 
+!        other materials provided with the distribution.
+!     - Neither the names of Marc De Graef, Carnegie Mellon University nor the names 
+!        of its contributors may be used to endorse or promote products derived from 
+!        this software without specific prior written permission.
+!
+! THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+! AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+! IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+! ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+! LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+! DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+! SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+! CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+! OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE 
+! USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+! ###################################################################
+
+!--------------------------------------------------------------------------
+! EMsoft:shardmod.f90
+!--------------------------------------------------------------------------
+!
+! MODULE: shardmod
+!
+!> @brief support routines for master pattern computations that are split over several 
+!> independent processes (shards)
+!
+!> @details For a sharded run, each process computes only the beam directions that belong to
+!> its own shard and stores the unprocessed (i.e., before any hexagonal-to-square interpolation)
+!> master pattern arrays in a separate shard file.  Since every Lambert pixel is set by exactly 
+!> one beam direction, the final master pattern is the sum of all shard arrays; the merge step 
+!> of the master pattern program reads and sums the shard files for each energy and then 
+!> performs the regular post-processing and output.  No communication between the shards is
+!> required, so they can be run as separate jobs on any number of nodes.
+!--------------------------------------------------------------------------
+module shardmod
+
+use local
+use stringconstants
+
+IMPLICIT NONE
+
+contains
+
+!--------------------------------------------------------------------------
+!
+! FUNCTION:getMasterShardName
+!
+!> @brief generate the file name for a master pattern shard file
+!
+!> @param outname name of the master pattern output file
+!> @param shard shard number (1..nshards)
+!> @param nshards total number of shards
+!--------------------------------------------------------------------------
+recursive function getMasterShardName(outname, shard, nshards) result(shardname)
+!DEC$ ATTRIBUTES DLLEXPORT :: getMasterShardName
+
+IMPLICIT NONE
+
+character(fnlen),INTENT(IN)             :: outname
+integer(kind=irg),INTENT(IN)            :: shard
+integer(kind=irg),INTENT(IN)            :: nshards
+character(fnlen)                        :: shardname
+
+character(fnlen)                        :: base
+integer(kind=irg)                       :: l
+
+base = trim(outname)
+l = len_trim(base)
+if (l.gt.3) then 
+  if (base(l-2:l).eq.'.h5') base = base(1:l-3)
+end if
+write (shardname,"(A,'_shard',I4.4,'of',I4.4,'.h5')") trim(base), shard, nshards
+
+end function getMasterShardName
+
+!--------------------------------------------------------------------------
+!
+! FUNCTION:inMasterShard
+!
+!> @brief does a beam direction belong to a given shard ?
+!
+!> @details The beam directions are distributed by interleaving the Lambert grid points, so that
+!> each shard receives a similar mix of expensive and inexpensive beam directions.
+!
+!> @param ipx x-coordinate of beam direction on Lambert grid
+!> @param ipy y-coordinate of beam direction on Lambert grid
+!> @param npx half size of Lambert grid
+!> @param shard shard number (1..nshards)
+!> @param nshards total number of shards
+!--------------------------------------------------------------------------
+recursive function inMasterShard(ipx, ipy, npx, shard, nshards) result(inshard)
+!DEC$ ATTRIBUTES DLLEXPORT :: inMasterShard
+
+IMPLICIT NONE
+
+integer(kind=irg),INTENT(IN)            :: ipx
+integer(kind=irg),INTENT(IN)            :: ipy
+integer(kind=irg),INTENT(IN)            :: npx
+integer(kind=irg),INTENT(IN)            :: shard
+integer(kind=irg),INTENT(IN)            :: nshards
+logical                                 :: inshard
+
+inshard = (modulo(ipx + (2*npx+1)*ipy, nshards).eq.(shard-1))
+
+end function inMasterShard
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE:initMasterShard
+!
+!> @brief create a new shard file with empty master pattern arrays
+!
+!> @details The file has the same EMData/datagroupname layout as the regular master pattern
+!> file, so that the lastEnergy based restart option can be used for each shard.  The HDF 
+!> interface must be opened by the caller.
+!
+!> @param shardname name of the shard file
+!> @param datagroupname name of the master pattern data group (e.g., EBSDmaster)
+!> @param shard shard number (1..nshards)
+!> @param nshards total number of shards
+!> @param npx half size of Lambert grid
+!> @param numEbins number of energy bins
+!> @param numsites number of atom sites
+!--------------------------------------------------------------------------
+recursive subroutine initMasterShard(shardname, datagroupname, shard, nshards, npx, numEbins, numsites)
+!DEC$ ATTRIBUTES DLLEXPORT :: initMasterShard
+
+use HDF5
+use HDFsupport
+
+IMPLICIT NONE
+
+character(fnlen),INTENT(IN)             :: shardname
+character(fnlen),INTENT(IN)             :: datagroupname
+integer(kind=irg),INTENT(IN)            :: shard
+integer(kind=irg),INTENT(IN)            :: nshards
+integer(kind=irg),INTENT(IN)            :: npx
+integer(kind=irg),INTENT(IN)            :: numEbins
+integer(kind=irg),INTENT(IN)            :: numsites
+
+type(HDFobjectStackType)                :: HDF_head
+character(fnlen)                        :: groupname, dataset
+integer(kind=irg)                       :: hdferr, lastEnergy
+integer(HSIZE_T)                        :: dims4(4), cnt4(4), offset4(4)
+real(kind=sgl),allocatable              :: zeroes(:,:,:,:)
+
+nullify(HDF_head%next)
+hdferr = HDF_createFile(shardname, HDF_head)
+
+groupname = SC_EMData
+hdferr = HDF_createGroup(groupname, HDF_head)
+hdferr = HDF_createGroup(datagroupname, HDF_head)
+
+dataset = SC_shard
+hdferr = HDF_writeDatasetInteger(dataset, shard, HDF_head)
+
+dataset = SC_nshards
+hdferr = HDF_writeDatasetInteger(dataset, nshards, HDF_head)
+
+dataset = SC_npx
+hdferr = HDF_writeDatasetInteger(dataset, npx, HDF_head)
+
+dataset = SC_numEbins
+hdferr = HDF_writeDatasetInteger(dataset, numEbins, HDF_head)
+
+dataset = SC_numsites
+hdferr = HDF_writeDatasetInteger(dataset, numsites, HDF_head)
+
+lastEnergy = -1
+dataset = SC_lastEnergy
+hdferr = HDF_writeDatasetInteger(dataset, lastEnergy, HDF_head)
+
+! create the hyperslabs and write zeroes to them for now
+allocate(zeroes(2*npx+1,2*npx+1,1,numsites))
+zeroes = 0.0
+dims4 = (/  2*npx+1, 2*npx+1, numEbins, numsites /)
+cnt4 = (/ 2*npx+1, 2*npx+1, 1, numsites /)
+offset4 = (/ 0, 0, 0, 0 /)
+
+dataset = SC_mLPNH
+hdferr = HDF_writeHyperslabFloatArray4D(dataset, zeroes, dims4, offset4, cnt4, HDF_head)
+
+dataset = SC_mLPSH
+hdferr = HDF_writeHyperslabFloatArray4D(dataset, zeroes, dims4, offset4, cnt4, HDF_head)
+
+deallocate(zeroes)
+
+call HDF_pop(HDF_head,.TRUE.)
+
+end subroutine initMasterShard
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE:writeMasterShard
+!
+!> @brief store the master pattern arrays of this shard for one energy bin
+!
+!> @details The HDF interface must be opened by the caller.
+!
+!> @param shardname name of the shard file
+!> @param datagroupname name of the master pattern data group (e.g., EBSDmaster)
+!> @param iE energy bin
+!> @param npx half size of Lambert grid
+!> @param numEbins number of energy bins
+!> @param numsites number of atom sites
+!> @param mLPNH Northern hemisphere master pattern for this energy bin
+!> @param mLPSH Southern hemisphere master pattern for this energy bin
+!--------------------------------------------------------------------------
+recursive subroutine writeMasterShard(shardname, datagroupname, iE, npx, numEbins, numsites, mLPNH, mLPSH)
+!DEC$ ATTRIBUTES DLLEXPORT :: writeMasterShard
+
+use HDF5
+use HDFsupport
+
+IMPLICIT NONE
+
+character(fnlen),INTENT(IN)             :: shardname
+character(fnlen),INTENT(IN)             :: datagroupname
+integer(kind=irg),INTENT(IN)            :: iE
+integer(kind=irg),INTENT(IN)            :: npx
+integer(kind=irg),INTENT(IN)            :: numEbins
+integer(kind=irg),INTENT(IN)            :: numsites
+real(kind=sgl),INTENT(IN)               :: mLPNH(2*npx+1,2*npx+1,1,numsites)
+real(kind=sgl),INTENT(IN)               :: mLPSH(2*npx+1,2*npx+1,1,numsites)
+
+type(HDFobjectStackType)                :: HDF_head
+character(fnlen)                        :: groupname, dataset
+integer(kind=irg)                       :: hdferr
+integer(HSIZE_T)                        :: dims4(4), cnt4(4), offset4(4)
+logical                                 :: overwrite=.TRUE., insert=.TRUE.
+
+nullify(HDF_head%next)
+hdferr = HDF_openFile(shardname, HDF_head)
+
+groupname = SC_EMData
+hdferr = HDF_openGroup(groupname, HDF_head)
+hdferr = HDF_openGroup(datagroupname, HDF_head)
+
+dims4 = (/  2*npx+1, 2*npx+1, numEbins, numsites /)
+cnt4 = (/ 2*npx+1, 2*npx+1, 1, numsites /)
+offset4 = (/ 0, 0, iE-1, 0 /)
+
+dataset = SC_mLPNH
+hdferr = HDF_writeHyperslabFloatArray4D(dataset, mLPNH, dims4, offset4, cnt4, HDF_head, insert)
+
+dataset = SC_mLPSH
+hdferr = HDF_writeHyperslabFloatArray4D(dataset, mLPSH, dims4, offset4, cnt4, HDF_head, insert)
+
+! the energy counter is updated last, so that an interrupted write is redone after a restart
+dataset = SC_lastEnergy
+hdferr = HDF_writeDatasetInteger(dataset, iE, HDF_head, overwrite)
+
+call HDF_pop(HDF_head,.TRUE.)
+
+end subroutine writeMasterShard
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE:readMasterShards
+!
+!> @brief merge the master pattern arrays of all shards for one energy bin
+!
+!> @details All shard files must exist and must have completed the requested energy bin; the 
+!> HDF interface must be opened by the caller.
+!
+!> @param outname name of the master pattern output file
+!> @param datagroupname name of the master pattern data group (e.g., EBSDmaster)
+!> @param nshards total number of shards
+!> @param iE energy bin
+!> @param npx half size of Lambert grid
+!> @param numEbins number of energy bins
+!> @param numsites number of atom sites
+!> @param mLPNH Northern hemisphere master pattern for this energy bin
+!> @param mLPSH Southern hemisphere master pattern for this energy bin
+!--------------------------------------------------------------------------
+recursive subroutine readMasterShards(outname, datagroupname, nshards, iE, npx, numEbins, numsites, mLPNH, mLPSH)
+!DEC$ ATTRIBUTES DLLEXPORT :: readMasterShards
+
+use HDF5
+use HDFsupport
+use error
+
+IMPLICIT NONE
+
+character(fnlen),INTENT(IN)             :: outname
+character(fnlen),INTENT(IN)             :: datagroupname
+integer(kind=irg),INTENT(IN)            :: nshards
+integer(kind=irg),INTENT(IN)            :: iE
+integer(kind=irg),INTENT(IN)            :: npx
+integer(kind=irg),INTENT(IN)            :: numEbins
+integer(kind=irg),INTENT(IN)            :: numsites
+real(kind=sgl),INTENT(OUT)              :: mLPNH(2*npx+1,2*npx+1,1,numsites)
+real(kind=sgl),INTENT(OUT)              :: mLPSH(2*npx+1,2*npx+1,1,numsites)
+
+type(HDFobjectStackType)                :: HDF_head
+character(fnlen)                        :: groupname, dataset, shardname
+integer(kind=irg)                       :: hdferr, ishard, ival(4), lastEnergy
+integer(HSIZE_T)                        :: cnt4(4), offset4(4)
+real(kind=sgl),allocatable              :: rdata(:,:,:,:)
+logical                                 :: f_exists, readonly=.TRUE.
+
+mLPNH = 0.0
+mLPSH = 0.0
+cnt4 = (/ 2*npx+1, 2*npx+1, 1, numsites /)
+offset4 = (/ 0, 0, iE-1, 0 /)
+
+do ishard=1,nshards
+  shardname = getMasterShardName(outname, ishard, nshards)
+  inquire(file=trim(shardname), exist=f_exists)
+  if (.not.f_exists) then 
+    call FatalError('readMasterShards','shard file '//trim(shardname)//' does not exist')
+  end if
+
+  nullify(HDF_head%next)
+  hdferr = HDF_openFile(shardname, HDF_head, readonly)
+
+  groupname = SC_EMData
+  hdferr = HDF_openGroup(groupname, HDF_head)
+  hdferr = HDF_openGroup(datagroupname, HDF_head)
+
+! make sure that this shard belongs to the same computation 
+  dataset = SC_nshards
+  call HDF_readDatasetInteger(dataset, HDF_head, hdferr, ival(1))
+  dataset = SC_npx
+  call HDF_readDatasetInteger(dataset, HDF_head, hdferr, ival(2))
+  dataset = SC_numEbins
+  call HDF_readDatasetInteger(dataset, HDF_head, hdferr, ival(3))
+  dataset = SC_numsites
+  call HDF_readDatasetInteger(dataset, HDF_head, hdferr, ival(4))
+  if (any(ival.ne.(/ nshards, npx, numEbins, numsites /))) then 
+    call FatalError('readMasterShards','shard file '//trim(shardname)//' has incompatible dimensions')
+  end if
+
+! energies are computed in decreasing order, so this energy bin must be at or above lastEnergy
+  dataset = SC_lastEnergy
+  call HDF_readDatasetInteger(dataset, HDF_head, hdferr, lastEnergy)
+  if ((lastEnergy.eq.-1).or.(lastEnergy.gt.iE)) then 
+    call FatalError('readMasterShards','shard file '//trim(shardname)//' is incomplete')
+  end if
+
+  dataset = SC_mLPNH
+  rdata = HDF_readHyperslabFloatArray4D(dataset, offset4, cnt4, HDF_head)
+  mLPNH = mLPNH + rdata
+
+  dataset = SC_mLPSH
+  rdata = HDF_readHyperslabFloatArray4D(dataset, offset4, cnt4, HDF_head)
+  mLPSH = mLPSH + rdata
+
+  call HDF_pop(HDF_head,.TRUE.)
+end do
+
+end subroutine readMasterShards
+
+end module shardmod
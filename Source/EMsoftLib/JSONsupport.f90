@@ -539,7 +539,7 @@ integer(kind=irg),INTENT(INOUT)                       :: error_cnt
 
 type(json_value),pointer                              :: p, inp
 
-integer(kind=irg),parameter                           :: n_int = 5, n_real = 7
+integer(kind=irg),parameter                           :: n_int = 8, n_real = 7
 integer(kind=irg)                                     :: io_int(n_int)
 real(kind=dbl)                                        :: io_real(n_real)
 character(20)                                         :: intlist(n_int), reallist(n_real)
@@ -551,12 +551,16 @@ namelistname = 'MCdata'
 call JSON_initpointers(p, inp, jsonname, namelistname, error_cnt)
 
 ! write all the single integers
-io_int = (/ mcnl%stdout, mcnl%numsx, mcnl%primeseed, mcnl%num_el, mcnl%nthreads /)
+io_int = (/ mcnl%stdout, mcnl%numsx, mcnl%primeseed, mcnl%num_el, mcnl%nthreads, mcnl%blocksize, &
+           mcnl%firstbatch, mcnl%nbatches /)
 intlist(1) = 'stdout'
 intlist(2) = 'numsx'
 intlist(3) = 'primeseed'
 intlist(4) = 'num_el'
 intlist(5) = 'nthreads'
+intlist(6) = 'blocksize'
+intlist(7) = 'firstbatch'
+intlist(8) = 'nbatches'
 call JSON_writeNMLintegers(inp, io_int, intlist, n_int, error_cnt)
 
 ! write all the single doubles
@@ -574,6 +578,9 @@ call JSON_writeNMLdoubles(inp, io_real, reallist, n_real, error_cnt)
 dataset = SC_MCmode
 call json_add(inp, dataset, mcnl%MCmode); call JSON_failtest(error_cnt)
 
+dataset = SC_rngmode
+call json_add(inp, dataset, mcnl%rngmode); call JSON_failtest(error_cnt)
+
 dataset = SC_xtalname
 call json_add(inp, dataset, mcnl%xtalname); call JSON_failtest(error_cnt)
 
@@ -796,7 +803,7 @@ integer(kind=irg),INTENT(INOUT)                       :: error_cnt
 
 type(json_value),pointer                              :: p, inp
 
-integer(kind=irg),parameter                           :: n_int = 6, n_real = 1
+integer(kind=irg),parameter                           :: n_int = 10, n_real = 1
 integer(kind=irg)                                     :: io_int(n_int), restart, uniform
 real(kind=sgl)                                        :: io_real(n_real)
 character(20)                                         :: intlist(n_int), reallist(n_real)
@@ -819,13 +826,18 @@ if (emnl%uniform.eqv..TRUE.) then
 else
   uniform = 0
 end if
-io_int = (/ emnl%stdout, emnl%npx, emnl%Esel, emnl%nthreads, restart, uniform /)
+io_int = (/ emnl%stdout, emnl%npx, emnl%Esel, emnl%nthreads, restart, uniform, emnl%checkpoint, emnl%Econcurrent, &
+            emnl%nshards, emnl%shard /)
 intlist(1) = 'stdout'
 intlist(2) = 'npx'
 intlist(3) = 'Esel'
 intlist(4) = 'nthreads'
 intlist(5) = 'restart'
 intlist(6) = 'uniform'
+intlist(7) = 'checkpoint'
+intlist(8) = 'Econcurrent'
+intlist(9) = 'nshards'
+intlist(10) = 'shard'
 call JSON_writeNMLintegers(inp, io_int, intlist, n_int, error_cnt)
 
 ! write a single real
@@ -936,7 +948,7 @@ integer(kind=irg),INTENT(INOUT)                       :: error_cnt
 
 type(json_value),pointer                              :: p, inp
 
-integer(kind=irg),parameter                           :: n_int = 4, n_real = 1
+integer(kind=irg),parameter                           :: n_int = 6, n_real = 1
 integer(kind=irg)                                     :: io_int(n_int)
 real(kind=dbl)                                        :: io_real(n_real)
 character(20)                                         :: intlist(n_int), reallist(n_real)
@@ -948,11 +960,13 @@ namelistname = 'ECPmastervars'
 call JSON_initpointers(p, inp, jsonname, namelistname, error_cnt)
 
 ! write all the single integers
-io_int = (/ ecpnl%stdout, ecpnl%Esel, ecpnl%npx, ecpnl%nthreads /)
+io_int = (/ ecpnl%stdout, ecpnl%Esel, ecpnl%npx, ecpnl%nthreads, ecpnl%nshards, ecpnl%shard /)
 intlist(1) = 'stdout'
 intlist(2) = 'Esel'
 intlist(3) = 'npx'
 intlist(4) = 'nthreads'
+intlist(5) = 'nshards'
+intlist(6) = 'shard'
 call JSON_writeNMLintegers(inp, io_int, intlist, n_int, error_cnt)
 
 !dataset = 'distort'
@@ -3100,6 +3114,12 @@ else
   call JSONreadInteger(json, ep, mcnl%primeseed, defmcnl%primeseed)
   ep = 'MCdata.nthreads'
   call JSONreadInteger(json, ep, mcnl%nthreads, defmcnl%nthreads)
+  ep = 'MCdata.blocksize'
+  call JSONreadInteger(json, ep, mcnl%blocksize, defmcnl%blocksize)
+  ep = 'MCdata.firstbatch'
+  call JSONreadInteger(json, ep, mcnl%firstbatch, defmcnl%firstbatch)
+  ep = 'MCdata.nbatches'
+  call JSONreadInteger(json, ep, mcnl%nbatches, defmcnl%nbatches)
 
   ep = 'MCdata.sig'
   call JSONreadDouble(json, ep, mcnl%sig, defmcnl%sig)
@@ -3120,6 +3140,11 @@ else
   s = mcnl%MCmode
   s2 = defmcnl%MCmode
   call JSONreadString(json, ep, s, s2)
+  ep = 'MCdata.rngmode'
+  s = mcnl%rngmode
+  s2 = defmcnl%rngmode
+  call JSONreadString(json, ep, s, s2)
+  mcnl%rngmode = trim(s)
   ep = 'MCdata.xtalname'
   call JSONreadString(json, ep, mcnl%xtalname, defmcnl%xtalname)
   ep = 'MCdata.dataname'
@@ -3392,6 +3417,14 @@ else
   call JSONreadInteger(json, ep, emnl%Esel, defemnl%Esel)
   ep = 'EBSDmastervars.nthreads'
   call JSONreadInteger(json, ep, emnl%nthreads, defemnl%nthreads)
+  ep = 'EBSDmastervars.checkpoint'
+  call JSONreadInteger(json, ep, emnl%checkpoint, defemnl%checkpoint)
+  ep = 'EBSDmastervars.Econcurrent'
+  call JSONreadInteger(json, ep, emnl%Econcurrent, defemnl%Econcurrent)
+  ep = 'EBSDmastervars.nshards'
+  call JSONreadInteger(json, ep, emnl%nshards, defemnl%nshards)
+  ep = 'EBSDmastervars.shard'
+  call JSONreadInteger(json, ep, emnl%shard, defemnl%shard)
 
   ep = 'EBSDmastervars.dmin'
   call JSONreadReal(json, ep, emnl%dmin, defemnl%dmin)
@@ -3543,6 +3576,10 @@ else
   call JSONreadInteger(json, ep, ecpnl%Esel, defecpnl%Esel)
   ep = 'ECPmastervars.nthreads'
   call JSONreadInteger(json, ep, ecpnl%nthreads, defecpnl%nthreads)
+  ep = 'ECPmastervars.nshards'
+  call JSONreadInteger(json, ep, ecpnl%nshards, defecpnl%nshards)
+  ep = 'ECPmastervars.shard'
+  call JSONreadInteger(json, ep, ecpnl%shard, defecpnl%shard)
 
   !ep = 'ECPmastervars.startthick'
   !call JSONreadReal(json, ep, ecpnl%startthick, defecpnl%startthick)
@@ -0,0 +1,335 @@
+! ###################################################################
+! Copyright (c) 2013-2024, Marc De Graef Research Group/Carnegie Mellon University
+! All rights reserved.
+!
+! Redistribution and use in source and binary forms, with or without modification, are 
+! permitted provided that the following conditions are met:
+!
+!     - Redistributions of source code must retain the above copyright notice, this list 
+!        of conditions and the following disclaimer.
+!     - Redistributions in binary form must reproduce the above copyright notice, this 
+!        list of conditions and the following disclaimer in the documentation and/or 
+!        other materials provided with the distribution.
+!     - Neither the names of Marc De Graef, Carnegie Mellon University nor the names 
+!        of its contributors may be used to endorse or promote products derived from 
+!        this software without specific prior written permission.
+!
+! THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+! AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+! IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+! ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+! LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+! DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+! SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+! CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+! OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE 
+! USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+! ###################################################################
+
+!--------------------------------------------------------------------------
+! EMsoft:LUTcache.f90
+!--------------------------------------------------------------------------
+!
+! MODULE: LUTcache
+!
+!> @brief on-disk persistence of the Fourier coefficient (cell%LUT) and Sgh (cell%SghLUT) lookup tables
+!
+!> @details Setting up the lookup tables is often the dominant cost of a short master pattern run,
+!> and a parameter sweep recomputes exactly the same tables for every run.  When the EMSOFTLUTCACHE
+!> environment variable points to a folder, the tables are stored there after they have been computed,
+!> and subsequent runs load them with a single read per array.  The cache files are keyed by a 64-bit
+!> hash of the crystal structure (lattice parameters, space group and setting, and the full asymmetric 
+!> unit contents) and of all parameters that affect the table entries (table dimensions, accelerating 
+!> voltage, interpolation mode, number of Sgh sets), so that any change to the .xtal file or the 
+!> input parameters results in a different cache file.  The file ends with a copy of the key, so that 
+!> an incomplete file (e.g., from an interrupted run) is never accepted. Caching is disabled when 
+!> the environment variable is not defined.
+!--------------------------------------------------------------------------
+module LUTcache
+
+use local
+use typedefs
+
+IMPLICIT NONE
+
+! increment this when the contents of the cached tables change
+integer(kind=irg),parameter,private     :: LUTcacheversion = 1
+integer(kind=irg),parameter,private     :: LUTcachemagic = 1129599820
+
+contains
+
+!--------------------------------------------------------------------------
+!
+! FUNCTION: LUTcache_getpathname
+!
+!> @brief returns the cache folder (with terminating delimiter), or an empty string when caching is off
+!--------------------------------------------------------------------------
+recursive function LUTcache_getpathname() result(cachepath)
+!DEC$ ATTRIBUTES DLLEXPORT :: LUTcache_getpathname
+
+IMPLICIT NONE
+
+character(fnlen)                        :: cachepath
+
+character(fnlen)                        :: envReturn
+integer(kind=irg)                       :: l
+
+cachepath = ''
+call getenv('EMSOFTLUTCACHE',envReturn)
+if (trim(envReturn).ne.'') then 
+  cachepath = trim(envReturn)
+  l = len(trim(cachepath))
+  if ( (cachepath(l:l).ne.'/') .and. (cachepath(l:l).ne.'\') ) then  !'
+    cachepath = trim(cachepath)//'/'
+  end if
+  cachepath = trim(EMsoft_toNativePath(cachepath))
+end if
+
+end function LUTcache_getpathname
+
+!--------------------------------------------------------------------------
+!
+! FUNCTION: LUTcache_key
+!
+!> @brief compute the 64-bit cache key for a crystal structure and a set of table parameters
+!
+!> @details The key consists of two independent 32-bit FNV-1a hashes (with different offset bases) 
+!> of the bit patterns of all the input quantities, written as a 16 character hexadecimal string.
+!
+!> @param cell unit cell pointer
+!> @param tag table type identifier
+!> @param ipar integer parameters that affect the table
+!> @param rpar real parameters that affect the table
+!--------------------------------------------------------------------------
+recursive function LUTcache_key(cell, tag, ipar, rpar) result(key)
+!DEC$ ATTRIBUTES DLLEXPORT :: LUTcache_key
+
+IMPLICIT NONE
+
+type(unitcell),INTENT(IN)               :: cell
+character(*),INTENT(IN)                 :: tag
+integer(kind=irg),INTENT(IN)            :: ipar(:)
+real(kind=dbl),INTENT(IN)               :: rpar(:)
+character(16)                           :: key
+
+integer(kind=irg),allocatable           :: w(:)
+integer(kind=8),parameter               :: mask32 = 4294967295_8, fnvprime = 16777619_8
+integer(kind=8)                         :: h1, h2, uw, b
+integer(kind=irg)                       :: i, k, n, nw, p
+
+! word list: version, tag characters, lattice parameters (6 doubles), space group, setting, number 
+! of atom types, atom types, atom positions (5 reals per atom), ipar and rpar (doubles)
+n = cell%ATOM_ntype
+nw = 1 + len(tag) + 12 + 3 + n + 5*n + size(ipar) + 2*size(rpar)
+allocate(w(nw))
+
+w(1) = LUTcacheversion
+do i=1,len(tag)
+  w(1+i) = ichar(tag(i:i))
+end do
+p = 1 + len(tag)
+w(p+1:p+12) = transfer( (/ cell%a, cell%b, cell%c, cell%alpha, cell%beta, cell%gamma /), 0_irg, 12)
+p = p + 12
+w(p+1:p+3) = (/ cell%SYM_SGnum, cell%SYM_SGset, n /)
+p = p + 3
+w(p+1:p+n) = cell%ATOM_type(1:n)
+p = p + n
+w(p+1:p+5*n) = transfer(cell%ATOM_pos(1:n,1:5), 0_irg, 5*n)
+p = p + 5*n
+w(p+1:p+size(ipar)) = ipar
+p = p + size(ipar)
+w(p+1:nw) = transfer(rpar, 0_irg, 2*size(rpar))
+
+! all arithmetic is done in 64-bit integers to avoid relying on signed 32-bit overflow
+h1 = 2166136261_8
+h2 = 3735928559_8
+do i=1,nw
+  uw = iand(int(w(i),8), mask32)
+  do k=0,3
+    b = ibits(uw, 8*k, 8)
+    h1 = iand(ieor(h1, b) * fnvprime, mask32)
+    h2 = iand(ieor(h2, b) * fnvprime, mask32)
+  end do
+end do
+deallocate(w)
+
+write (key,"(Z8.8,Z8.8)") h1, h2
+
+end function LUTcache_key
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: LUTcache_readSghLUT
+!
+!> @brief try to load the cell%SghLUT array from the cache
+!
+!> @param cell unit cell pointer; cell%SghLUT must have been allocated
+!> @param key cache key
+!> @param found returns .TRUE. if a complete cache file was read
+!--------------------------------------------------------------------------
+recursive subroutine LUTcache_readSghLUT(cell, key, found)
+!DEC$ ATTRIBUTES DLLEXPORT :: LUTcache_readSghLUT
+
+IMPLICIT NONE
+
+type(unitcell),INTENT(INOUT)            :: cell
+character(16),INTENT(IN)                :: key
+logical,INTENT(OUT)                     :: found
+
+character(fnlen)                        :: fname
+character(16)                           :: fkey, tkey
+integer(kind=irg)                       :: ios, magic, lb(4), ub(4)
+
+found = .FALSE.
+fname = trim(LUTcache_getpathname())
+if (trim(fname).eq.'') return
+fname = trim(fname)//'SghLUT_'//key//'.bin'
+
+inquire(file=trim(fname), exist=found)
+if (.not.found) return
+found = .FALSE.
+
+open(unit=dataunit3, file=trim(fname), status='old', access='stream', form='unformatted', &
+     action='read', iostat=ios)
+if (ios.ne.0) return
+
+read(dataunit3, iostat=ios) magic, fkey, lb, ub
+if ((ios.eq.0).and.(magic.eq.LUTcachemagic).and.(fkey.eq.key).and.  &
+    (all(lb.eq.lbound(cell%SghLUT))).and.(all(ub.eq.ubound(cell%SghLUT)))) then
+  read(dataunit3, iostat=ios) cell%SghLUT
+  if (ios.eq.0) read(dataunit3, iostat=ios) tkey
+  found = (ios.eq.0).and.(tkey.eq.key)
+end if
+close(unit=dataunit3, status='keep')
+
+if (.not.found) cell%SghLUT = cmplx(0.D0,0.D0)
+
+end subroutine LUTcache_readSghLUT
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: LUTcache_writeSghLUT
+!
+!> @brief store the cell%SghLUT array in the cache
+!
+!> @param cell unit cell pointer
+!> @param key cache key
+!--------------------------------------------------------------------------
+recursive subroutine LUTcache_writeSghLUT(cell, key)
+!DEC$ ATTRIBUTES DLLEXPORT :: LUTcache_writeSghLUT
+
+IMPLICIT NONE
+
+type(unitcell),INTENT(IN)               :: cell
+character(16),INTENT(IN)                :: key
+
+character(fnlen)                        :: fname
+integer(kind=irg)                       :: ios
+
+fname = trim(LUTcache_getpathname())
+if (trim(fname).eq.'') return
+fname = trim(fname)//'SghLUT_'//key//'.bin'
+
+! a failure to write the cache file is not an error; the next run will simply recompute the table
+open(unit=dataunit3, file=trim(fname), status='replace', access='stream', form='unformatted', &
+     action='write', iostat=ios)
+if (ios.ne.0) return
+write(dataunit3, iostat=ios) LUTcachemagic, key, lbound(cell%SghLUT), ubound(cell%SghLUT)
+if (ios.eq.0) write(dataunit3, iostat=ios) cell%SghLUT
+if (ios.eq.0) write(dataunit3, iostat=ios) key
+close(unit=dataunit3, status='keep')
+
+end subroutine LUTcache_writeSghLUT
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: LUTcache_readLUT
+!
+!> @brief try to load the cell%LUT, cell%LUTqg and cell%dbdiff arrays from the cache
+!
+!> @param cell unit cell pointer; all three arrays must have been allocated
+!> @param key cache key
+!> @param found returns .TRUE. if a complete cache file was read
+!--------------------------------------------------------------------------
+recursive subroutine LUTcache_readLUT(cell, key, found)
+!DEC$ ATTRIBUTES DLLEXPORT :: LUTcache_readLUT
+
+IMPLICIT NONE
+
+type(unitcell),INTENT(INOUT)            :: cell
+character(16),INTENT(IN)                :: key
+logical,INTENT(OUT)                     :: found
+
+character(fnlen)                        :: fname
+character(16)                           :: fkey, tkey
+integer(kind=irg)                       :: ios, magic, lb(3), ub(3)
+
+found = .FALSE.
+fname = trim(LUTcache_getpathname())
+if (trim(fname).eq.'') return
+fname = trim(fname)//'UcgLUT_'//key//'.bin'
+
+inquire(file=trim(fname), exist=found)
+if (.not.found) return
+found = .FALSE.
+
+open(unit=dataunit3, file=trim(fname), status='old', access='stream', form='unformatted', &
+     action='read', iostat=ios)
+if (ios.ne.0) return
+
+read(dataunit3, iostat=ios) magic, fkey, lb, ub
+if ((ios.eq.0).and.(magic.eq.LUTcachemagic).and.(fkey.eq.key).and.  &
+    (all(lb.eq.lbound(cell%LUT))).and.(all(ub.eq.ubound(cell%LUT)))) then
+  read(dataunit3, iostat=ios) cell%LUT
+  if (ios.eq.0) read(dataunit3, iostat=ios) cell%LUTqg
+  if (ios.eq.0) read(dataunit3, iostat=ios) cell%dbdiff
+  if (ios.eq.0) read(dataunit3, iostat=ios) tkey
+  found = (ios.eq.0).and.(tkey.eq.key)
+end if
+close(unit=dataunit3, status='keep')
+
+if (.not.found) then
+  cell%LUT = cmplx(0.D0,0.D0)
+  cell%LUTqg = cmplx(0.D0,0.D0)
+  cell%dbdiff = .FALSE.
+end if
+
+end subroutine LUTcache_readLUT
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: LUTcache_writeLUT
+!
+!> @brief store the cell%LUT, cell%LUTqg and cell%dbdiff arrays in the cache
+!
+!> @param cell unit cell pointer
+!> @param key cache key
+!--------------------------------------------------------------------------
+recursive subroutine LUTcache_writeLUT(cell, key)
+!DEC$ ATTRIBUTES DLLEXPORT :: LUTcache_writeLUT
+
+IMPLICIT NONE
+
+type(unitcell),INTENT(IN)               :: cell
+character(16),INTENT(IN)                :: key
+
+character(fnlen)                        :: fname
+integer(kind=irg)                       :: ios
+
+fname = trim(LUTcache_getpathname())
+if (trim(fname).eq.'') return
+fname = trim(fname)//'UcgLUT_'//key//'.bin'
+
+open(unit=dataunit3, file=trim(fname), status='replace', access='stream', form='unformatted', &
+     action='write', iostat=ios)
+if (ios.ne.0) return
+write(dataunit3, iostat=ios) LUTcachemagic, key, lbound(cell%LUT), ubound(cell%LUT)
+if (ios.eq.0) write(dataunit3, iostat=ios) cell%LUT
+if (ios.eq.0) write(dataunit3, iostat=ios) cell%LUTqg
+if (ios.eq.0) write(dataunit3, iostat=ios) cell%dbdiff
+if (ios.eq.0) write(dataunit3, iostat=ios) key
+close(unit=dataunit3, status='keep')
+
+end subroutine LUTcache_writeLUT
+
+end module LUTcache
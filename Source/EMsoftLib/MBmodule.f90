@@ -489,6 +489,9 @@ end subroutine CalcKthick
 !> @param dmin smallest d-spacing to consider
 !> @param verbose produce output (or not)
 !
+!> @details when the EMSOFTLUTCACHE environment variable is set, the table is taken from (or 
+!> added to) the on-disk cache of the LUTcache module
+!
 !> @date 05/02/16 MDG 1.0 original
 !> @date 12/03/20 MDG 2.0 adds OpenMP to speed up the computation for large unit cells
 !--------------------------------------------------------------------------
@@ -504,6 +507,7 @@ use io
 use error
 use gvectors
 use diffraction
+use LUTcache
 use omp_lib
 
 IMPLICIT NONE
@@ -520,6 +524,8 @@ integer(kind=irg)                          :: istat, io_int(3), skip, TID
 integer(kind=irg)                          :: imh, imk, iml, gg(3), ix, iy, iz
 real(kind=sgl)                             :: dhkl, io_real(3), ddt
 complex(kind=dbl)                          :: Sghvec(numset)
+character(16)                              :: cachekey
+logical                                    :: cached
 
 
 ! compute the range of reflections for the lookup table and allocate the table
@@ -555,6 +561,18 @@ complex(kind=dbl)                          :: Sghvec(numset)
  if (istat.ne.0) call FatalError('InitializeCell:',' unable to allocate cell%SghLUT array')
  cell%SghLUT = cmplx(0.D0,0.D0)
 
+! has this table been computed before for the same structure and parameters ?
+ cachekey = LUTcache_key(cell, 'SghLUT', (/ numset, imh, imk, iml /), (/ real(kind=dbl) :: /) )
+ call LUTcache_readSghLUT(cell, cachekey, cached)
+ if (cached) then
+   if (present(verbose)) then
+    if (verbose) then
+     call Message('Sgh coefficient lookup table loaded from cache', frm = "(/A/)")
+    end if
+   end if
+   return
+ end if
+
  if (present(verbose)) then
   if (verbose) then
    call Message('Generating Sgh coefficient lookup table ... ', frm = "(/A)",advance="no")
@@ -602,6 +620,8 @@ complex(kind=dbl)                          :: Sghvec(numset)
     end do izl
  end if
 
+ call LUTcache_writeSghLUT(cell, cachekey)
+
   if (present(verbose)) then
    if (verbose) then
     call Message('Done', frm = "(A/)")
@@ -775,6 +795,46 @@ integer(kind=irg)                       :: ir, ic, kkk(3)
 
 end subroutine getSghfromLUT
 
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: getSghfromLUTTable
+!
+!> @brief compute the Sgh array from the Sgh lookup table, for a contiguous reflection table
+!
+!> @param cell unit cell pointer
+!> @param reftab reflection table, after a call to Apply_BethePotentialsTable
+!> @param nns number of strong reflections
+!> @param numset number of atom positions in asymmetric unit
+!> @param Sgh output array
+!--------------------------------------------------------------------------
+recursive subroutine getSghfromLUTTable(cell,reftab,nns,numset,Sgh)
+!DEC$ ATTRIBUTES DLLEXPORT :: getSghfromLUTTable
+
+use local
+use typedefs
+
+IMPLICIT NONE
+
+type(unitcell)                          :: cell
+type(ReflectionTableType),INTENT(IN)    :: reftab
+integer(kind=irg),INTENT(IN)            :: nns
+integer(kind=irg),INTENT(IN)            :: numset
+complex(kind=dbl),INTENT(INOUT)         :: Sgh(nns,nns,numset)
+!f2py intent(in,out) ::  Sgh
+
+integer(kind=irg)                       :: ir, ic, kkk(3), gr(3)
+
+! ic is the column index, ir the row index
+do ic=1,nns
+  gr = reftab%hkl(1:3,reftab%strong(ic))
+  do ir=1,nns
+    kkk = gr - reftab%hkl(1:3,reftab%strong(ir))
+    Sgh(ir,ic,1:numset) = cell%SghLUT(1:numset,kkk(1),kkk(2),kkk(3))
+  end do
+end do
+
+end subroutine getSghfromLUTTable
+
 !--------------------------------------------------------------------------
 !
 ! SUBROUTINE: getSghfromLUTEEC
@@ -1061,6 +1121,74 @@ type(reflisttype),pointer               :: rltmpa, rltmpb
   
 end subroutine CalcSgh
 
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: CalcSghTable
+!
+!> @brief compute structure factor-like Sgh array for EBSD, ECCI and ECP simulations, for
+!> a contiguous reflection table
+!
+!> @param cell unit cell pointer
+!> @param reftab reflection table, after a call to Apply_BethePotentialsTable
+!> @param nn dimension of array
+!> @param numset number of atom positions in asymmetric unit
+!> @param Sgh output array
+!
+!> @details identical to CalcSgh, but the Debye-Waller factor and the orbit phase factors 
+!> are computed once for each (g-h) difference vector, and reused for all atom sites
+!--------------------------------------------------------------------------
+recursive subroutine CalcSghTable(cell,reftab,nn,numset,Sgh)
+!DEC$ ATTRIBUTES DLLEXPORT :: CalcSghTable
+
+use local
+use typedefs
+use crystal
+use constants
+use symmetry
+
+IMPLICIT NONE
+
+type(unitcell)                          :: cell
+type(ReflectionTableType),INTENT(IN)    :: reftab
+integer(kind=irg),INTENT(IN)            :: nn
+integer(kind=irg),INTENT(IN)            :: numset
+complex(kind=dbl),INTENT(INOUT)         :: Sgh(nn,nn,numset)
+!f2py intent(in,out) ::  Sgh
+
+integer(kind=irg)                       :: ip, ir, ic, kkk(3), ikk, n(maxpasym)
+real(kind=sgl)                          :: Znsq(maxpasym), DBWF, kkl
+complex(kind=dbl)                       :: csum
+real(kind=dbl)                          :: ctmp(192,3), arg, tpi
+
+  tpi = 2.D0 * cPi
+  Sgh = cmplx(0.D0,0.D0)
+
+! orbit sizes and Z^2 times the site occupation parameter for all special positions
+  do ip=1,cell % ATOM_ntype
+    call CalcOrbit(cell,ip,n(ip),ctmp)
+    Znsq(ip) = float(cell%ATOM_type(ip))**2 * cell%ATOM_pos(ip,4)
+  end do
+
+! ic is the column index, ir the row index
+  do ic=1,nn
+    do ir=1,nn
+      kkk = reftab%hkl(1:3,reftab%strong(ic)) - reftab%hkl(1:3,reftab%strong(ir))
+! isotropic Debye-Waller factors; we need the square of the length of s=  kk^2/4
+      kkl = 0.25 * CalcLength(cell,float(kkk),'r')**2
+      do ip=1,cell % ATOM_ntype
+        DBWF = Znsq(ip) * exp(-cell%ATOM_pos(ip,5)*kkl)
+        csum = cmplx(0.D0,0.D0,dbl)
+        do ikk=1,n(ip)
+          arg = tpi*sum(dble(kkk(1:3))*cell%apos(ip,ikk,1:3))
+          csum = csum + cmplx(dcos(arg),dsin(arg),dbl)
+        end do
+        Sgh(ir,ic,ip) = csum * cmplx(DBWF,0.D0)
+      end do
+    end do
+  end do
+  
+end subroutine CalcSghTable
+
 !--------------------------------------------------------------------------
 !
 ! SUBROUTINE: CalcSghMaster
@@ -1147,6 +1275,100 @@ end do
 
 end subroutine CalcSghMaster
 
+! ###################################################################
+!
+! SUBROUTINE: InitLghWorkspace
+!
+!> @brief (re)allocate the persistent LAPACK work space used by CalcLgh
+!
+!> @details The work space sizes for ZGEEV (or ZHEEV) and ZGETRI are queried once for the full
+!> capacity and reused for all smaller matrices, so the per-beam direction work space queries
+!> and allocations disappear; the work space only grows when a larger matrix comes along.
+!
+!> @param LghWS work space
+!> @param nn number of strong beams to accommodate
+!> @param hermitian [optional] the dynamical matrices are Hermitian (no absorption), so ZHEEV can be used
+! ###################################################################
+recursive subroutine InitLghWorkspace(LghWS, nn, hermitian)
+!DEC$ ATTRIBUTES DLLEXPORT :: InitLghWorkspace
+
+use local
+use typedefs
+
+IMPLICIT NONE
+
+type(LghWorkspaceType),INTENT(INOUT)   :: LghWS
+integer(kind=irg),INTENT(IN)           :: nn
+logical,INTENT(IN),OPTIONAL            :: hermitian
+
+integer(kind=irg)                      :: nmax, INFO
+complex(kind=dbl)                      :: qwork(1)
+
+if (present(hermitian)) LghWS%hermitian = hermitian
+
+! nothing to do if the current capacity suffices
+if ((nn.le.LghWS%nnmax).and.allocated(LghWS%work)) return
+
+! grow with some head room so that a slowly increasing number of strong beams does not
+! trigger a new allocation for every beam direction
+nmax = max(nn, (5*LghWS%nnmax)/4, 1)
+call DeleteLghWorkspace(LghWS)
+LghWS%nnmax = nmax
+
+allocate(LghWS%jpiv(nmax), LghWS%rwork(max(2*nmax,3*nmax-2)), LghWS%wr(nmax), LghWS%W(nmax))
+allocate(LghWS%Minp(nmax,nmax), LghWS%CGG(nmax,nmax), LghWS%CGinv(nmax,nmax), LghWS%Ijk(nmax,nmax), LghWS%VL(1,1))
+
+! work space queries for the eigenvalue solvers; the larger of the two is kept so that
+! the hermitian flag can be changed later on without another query
+INFO = 0
+call zgeev('N','V',nmax,LghWS%Minp,nmax,LghWS%W,LghWS%VL,1,LghWS%CGG,nmax,qwork,-1,LghWS%rwork,INFO)
+LghWS%lwork = max(1,INT(real(qwork(1))))
+call zheev('V','U',nmax,LghWS%Minp,nmax,LghWS%wr,qwork,-1,LghWS%rwork,INFO)
+LghWS%lwork = max(LghWS%lwork,INT(real(qwork(1))))
+allocate(LghWS%work(LghWS%lwork))
+
+! and for the matrix inversion
+call zgetri(nmax,LghWS%CGinv,nmax,LghWS%jpiv,qwork,-1,INFO)
+LghWS%liwork = max(1,INT(real(qwork(1))))
+allocate(LghWS%iwork(LghWS%liwork))
+
+end subroutine InitLghWorkspace
+
+! ###################################################################
+!
+! SUBROUTINE: DeleteLghWorkspace
+!
+!> @brief release the LAPACK work space used by CalcLgh
+!
+!> @param LghWS work space
+! ###################################################################
+recursive subroutine DeleteLghWorkspace(LghWS)
+!DEC$ ATTRIBUTES DLLEXPORT :: DeleteLghWorkspace
+
+use local
+use typedefs
+
+IMPLICIT NONE
+
+type(LghWorkspaceType),INTENT(INOUT)   :: LghWS
+
+if (allocated(LghWS%jpiv)) deallocate(LghWS%jpiv)
+if (allocated(LghWS%rwork)) deallocate(LghWS%rwork)
+if (allocated(LghWS%wr)) deallocate(LghWS%wr)
+if (allocated(LghWS%work)) deallocate(LghWS%work)
+if (allocated(LghWS%iwork)) deallocate(LghWS%iwork)
+if (allocated(LghWS%W)) deallocate(LghWS%W)
+if (allocated(LghWS%Minp)) deallocate(LghWS%Minp)
+if (allocated(LghWS%CGG)) deallocate(LghWS%CGG)
+if (allocated(LghWS%CGinv)) deallocate(LghWS%CGinv)
+if (allocated(LghWS%Ijk)) deallocate(LghWS%Ijk)
+if (allocated(LghWS%VL)) deallocate(LghWS%VL)
+LghWS%nnmax = 0
+LghWS%lwork = 0
+LghWS%liwork = 0
+
+end subroutine DeleteLghWorkspace
+
 ! ###################################################################
 !
 ! SUBROUTINE: CalcLgh
@@ -1155,6 +1377,12 @@ end subroutine CalcSghMaster
 !
 !> @brief compute the Lgh matrix for EBSD, ECCI, ECP, etc simulations
 !
+!> @details When called from inside a beam direction loop, pass a per-thread LghWS work space 
+!> so that the LAPACK work arrays are reused from one beam direction to the next; without it, a 
+!> temporary work space is created for this call only.  If LghWS%hermitian is set, the dynamical
+!> matrix is assumed to be Hermitian (no absorption); ZHEEV is then used and the eigenvector matrix
+!> is inverted by taking its conjugate transpose, so that ZGETRF/ZGETRI are not needed.
+!
 !> @param DMat dynamical matrix
 !> @param Lgh output array
 !> @param thick integration thickness
@@ -1164,6 +1392,7 @@ end subroutine CalcSghMaster
 !> @param depthstep depth step size
 !> @param lambdaE energy weight factors
 !> @param izz number of energy weight factors
+!> @param LghWS [optional] persistent work space
 !
 !> @date 10/13/98  MDG 1.0 original
 !> @date 07/04/01  MDG 2.0 f90
@@ -1171,7 +1400,7 @@ end subroutine CalcSghMaster
 !> @date 06/23/14  MDG 4.0 moved to MBmodule
 !> @date 09/09/15  MDG 4.1 verification of matrix multiplications after Silicon pattern issues
 ! ###################################################################
-recursive subroutine CalcLgh(DMat,Lgh,thick,kn,nn,gzero,depthstep,lambdaE,izz)
+recursive subroutine CalcLgh(DMat,Lgh,thick,kn,nn,gzero,depthstep,lambdaE,izz,LghWS)
 !DEC$ ATTRIBUTES DLLEXPORT :: CalcLgh
 
 use local
@@ -1191,62 +1420,45 @@ integer(kind=irg),INTENT(IN)        :: gzero
 real(kind=dbl),INTENT(IN)           :: depthstep
 integer(kind=irg),INTENT(IN)        :: izz
 real(kind=sgl),INTENT(IN)           :: lambdaE(izz)
+type(LghWorkspaceType),INTENT(INOUT),OPTIONAL,TARGET :: LghWS
 
-integer                             :: i,j,k, iz
-complex(kind=dbl)                   :: CGinv(nn,nn), Minp(nn,nn), tmp3(nn,nn)
-
+type(LghWorkspaceType),TARGET       :: localWS
+type(LghWorkspaceType),pointer      :: ws
+integer                             :: j,k, iz
 real(kind=dbl)                      :: tpi, dzt
-complex(kind=dbl)                   :: Ijk(nn,nn), q, getMIWORK(1), qold
-
-integer(kind=irg)                   :: INFO, LDA, LDVR, LDVL,  JPIV(nn), MILWORK
-complex(kind=dbl)                   :: CGG(nn,nn), W(nn)
-complex(kind=dbl),allocatable       :: MIWORK(:)
-
-integer(kind=irg),parameter         :: LWMAX = 5000 
-complex(kind=dbl)                   :: VL(nn,nn),  WORK(LWMAX)
-real(kind=dbl)                      :: RWORK(2*nn)
-character                           :: JOBVL, JOBVR
-integer(kind=sgl)                   :: LWORK
-
-! compute the eigenvalues and eigenvectors
-! using the LAPACK CGEEV, CGETRF, and CGETRI routines
-! 
- Minp = DMat
-
-! set some initial LAPACK variables 
- LDA = nn
- LDVL = nn
- LDVR = nn
- INFO = 0
-
- ! first initialize the parameters for the LAPACK ZGEEV, CGETRF, and CGETRI routines
- JOBVL = 'N'   ! do not compute the left eigenvectors
- JOBVR = 'V'   ! do compute the right eigenvectors
- LWORK = -1 ! so that we can ask the routine for the actually needed value
-
-! call the routine to determine the optimal workspace size
- LDA = nn
-  call zgeev(JOBVL,JOBVR,nn,Minp,LDA,W,VL,LDVL,CGG,LDVR,WORK,LWORK,RWORK,INFO)
-  LWORK = MIN( LWMAX, INT( WORK( 1 ) ) )
-
-! then call the eigenvalue solver
-  LDA = nn
-  call zgeev(JOBVL,JOBVR,nn,Minp,LDA,W,VL,LDVL,CGG,LDVR,WORK,LWORK,RWORK,INFO)
+complex(kind=dbl)                   :: q, qold, eq, pq
+integer(kind=irg)                   :: INFO, LDA
+
+! use the caller's work space if there is one, otherwise a temporary one
+if (present(LghWS)) then
+  ws => LghWS
+else
+  ws => localWS
+end if
+call InitLghWorkspace(ws, nn)
+
+! all work arrays have leading dimension ws%nnmax; only the leading nn x nn blocks are used
+LDA = ws%nnmax
+INFO = 0
+ws%Minp(1:nn,1:nn) = DMat
+
+if (ws%hermitian.eqv..TRUE.) then 
+! compute the eigenvalues and eigenvectors using the LAPACK ZHEEV routine; 
+! the eigenvector matrix is unitary, so its inverse is the conjugate transpose
+  call zheev('V','U',nn,ws%Minp,LDA,ws%wr,ws%work,ws%lwork,ws%rwork,INFO)
+  if (INFO.ne.0) call FatalError('Error in CalcLgh: ','ZHEEV return not zero')
+  ws%W(1:nn) = cmplx(ws%wr(1:nn),0.D0,dbl)
+  ws%CGG(1:nn,1:nn) = ws%Minp(1:nn,1:nn)
+  ws%CGinv(1:nn,1:nn) = conjg(transpose(ws%CGG(1:nn,1:nn)))
+else
+! compute the eigenvalues and eigenvectors using the LAPACK ZGEEV, ZGETRF, and ZGETRI routines
+  call zgeev('N','V',nn,ws%Minp,LDA,ws%W,ws%VL,1,ws%CGG,LDA,ws%work,ws%lwork,ws%rwork,INFO)
   if (INFO.ne.0) call FatalError('Error in CalcLgh3: ','ZGEEV return not zero')
 
- CGinv = CGG
- 
- LDA=nn
- call zgetrf(nn,nn,CGinv,LDA,JPIV,INFO)
- MILWORK = -1
- LDA=nn
- call zgetri(nn,CGinv,LDA,JPIV,getMIWORK,MILWORK,INFO)
- MILWORK =  INT(real(getMIWORK(1)))
- if (.not.allocated(MIWORK)) allocate(MIWORK(MILWORK))
- MIWORK = cmplx(0.D0,0.D0)
- LDA=nn
- call zgetri(nn,CGinv,LDA,JPIV,MIWORK,MILWORK,INFO)
- deallocate(MIWORK)
+  ws%CGinv(1:nn,1:nn) = ws%CGG(1:nn,1:nn)
+  call zgetrf(nn,nn,ws%CGinv,LDA,ws%jpiv,INFO)
+  call zgetri(nn,ws%CGinv,LDA,ws%jpiv,ws%iwork,ws%liwork,INFO)
+end if
 
 ! in all the time that we've used these routines, we haven't
 ! had a single problem with the matrix inversion, so we don't
@@ -1256,7 +1468,7 @@ integer(kind=sgl)                   :: LWORK
 
 
 ! then compute the integrated intensity matrix
- W = W/cmplx(2.0*kn,0.0)
+ ws%W(1:nn) = ws%W(1:nn)/cmplx(2.0*kn,0.0)
 
 ! recall that alpha(1:nn) = CGinv(1:nn,gzero)
 
@@ -1266,25 +1478,33 @@ integer(kind=sgl)                   :: LWORK
 ! the depth profile lambdaE must be added to the absorption 
 ! components of the Bloch wave eigenvalues.
 
+! q(k,j) is the complex conjugate of q(j,k), so only the lower triangle is computed; the sum
+! over the depth steps uses the recursion exp(-qold*iz) = exp(-qold*(iz-1)) * exp(-qold), which
+! is stable because real(qold) is never negative, and needs a single exponential per (j,k) pair
 tpi = 2.D0*cPi*depthstep
 dzt = depthstep/thick
- do j=1,nn
-  do k=1,nn
-     q =  cmplx(0.D0,0.D0)
-     qold = cmplx(tpi*(aimag(W(j))+aimag(W(k))),tpi*(real(W(j))-real(W(k))))
+ do k=1,nn
+  do j=k,nn
+     q =  cmplx(0.D0,0.D0,dbl)
+     qold = cmplx(tpi*(aimag(ws%W(j))+aimag(ws%W(k))),tpi*(real(ws%W(j))-real(ws%W(k))),dbl)
      if(real(qold) .lt. 0.0) qold = -qold
-     !if(real(qold) .lt. 0.D0) qold = -qold
+     eq = exp( - qold )
+     pq = eq
      do iz = 1,izz
-       q = q + dble(lambdaE(iz)) * exp( - qold * dble(iz) ) !MNS changed cexp to cdexp to be compatible with gfortran
+       q = q + dble(lambdaE(iz)) * pq
+       pq = pq * eq
      end do
-     Ijk(j,k) = conjg(CGinv(j,gzero)) * q * CGinv(k,gzero)
+     ws%Ijk(j,k) = conjg(ws%CGinv(j,gzero)) * q * ws%CGinv(k,gzero)
+     if (j.ne.k) ws%Ijk(k,j) = conjg(ws%CGinv(k,gzero)) * conjg(q) * ws%CGinv(j,gzero)
   end do
  end do
-Ijk = Ijk * dzt
+ws%Ijk(1:nn,1:nn) = ws%Ijk(1:nn,1:nn) * dzt
 
-! then the matrix multiplications to obtain Lgh 
-tmp3 = matmul(conjg(CGG),Ijk) 
-Lgh = matmul(tmp3,transpose(CGG))
+! then the matrix multiplications to obtain Lgh; Minp is free at this point and holds the intermediate product
+ws%Minp(1:nn,1:nn) = matmul(conjg(ws%CGG(1:nn,1:nn)),ws%Ijk(1:nn,1:nn))
+Lgh = matmul(ws%Minp(1:nn,1:nn),transpose(ws%CGG(1:nn,1:nn)))
+
+if (.not.present(LghWS)) call DeleteLghWorkspace(localWS)
 
 end subroutine CalcLgh
 
@@ -1738,6 +1958,99 @@ end if
 
 end subroutine GetDynMat
 
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: GetDynMatTable
+!
+!> @brief compute the Bloch wave dynamical matrix, including Bethe potentials, for a 
+!> contiguous reflection table
+!
+!> @param cell unit cell pointer
+!> @param reftab reflection table, after a call to Apply_BethePotentialsTable
+!> @param rlp Fourier coefficient structure
+!> @param DynMat dynamical matrix
+!> @param nns number of strong reflections
+!> @param nnw number of weak reflections
+!> @param noNormAbs (optional) set to .TRUE. to exclude the normal absorption
+!
+!> @details This is the 'D' mode of GetDynMat.  The Bethe perturbation of the off-diagonal 
+!> elements, sum_h U_{g-h} U_{h-g'}/s_h, is a matrix product of an nns x nnw array with 
+!> an nnw x nns array, so the weak beam contributions are gathered from the LUT once and
+!> combined with a single matmul instead of a triple loop over the linked lists.
+!--------------------------------------------------------------------------
+recursive subroutine GetDynMatTable(cell, reftab, rlp, DynMat, nns, nnw, noNormAbs)
+!DEC$ ATTRIBUTES DLLEXPORT :: GetDynMatTable
+
+use local
+use typedefs
+use diffraction
+use constants
+
+IMPLICIT NONE
+
+type(unitcell)                   :: cell
+type(ReflectionTableType),INTENT(IN) :: reftab
+type(gnode),INTENT(INOUT)        :: rlp
+!f2py intent(in,out) ::  rlp
+integer(kind=irg),INTENT(IN)     :: nns
+complex(kind=dbl),INTENT(INOUT)  :: DynMat(nns,nns)
+!f2py intent(in,out) ::  DynMat
+integer(kind=irg),INTENT(IN)     :: nnw
+logical,INTENT(IN),OPTIONAL      :: noNormAbs
+
+complex(kind=dbl),allocatable    :: Usw(:,:), Uws(:,:)
+real(kind=dbl),allocatable       :: weaksgsum(:)
+real(kind=sgl)                   :: Upz
+integer(kind=irg)                :: ir, ic, iw, ll(3), gr(3), gw(3)
+real(kind=dbl)                   :: rsg
+
+call CalcUcg(cell, rlp, (/0,0,0/) )
+Upz = rlp%Upmod
+if (present(noNormAbs)) then 
+  if (noNormAbs.eqv..TRUE.) then 
+    Upz = 0.0
+  end if
+end if
+
+! off-diagonal Fourier coefficients
+do ic=1,nns
+  gr = reftab%hkl(1:3,reftab%strong(ic))
+  do ir=1,nns
+    ll = reftab%hkl(1:3,reftab%strong(ir)) - gr
+    DynMat(ir,ic) = cell%LUT(ll(1),ll(2),ll(3))
+  end do
+end do
+
+allocate(weaksgsum(nns))
+weaksgsum = 0.D0
+
+! Bethe potential corrections 
+if (nnw.ne.0) then
+  allocate(Usw(nns,nnw), Uws(nnw,nns))
+  do iw=1,nnw
+    gw = reftab%hkl(1:3,reftab%weak(iw))
+    rsg = 1.D0/reftab%sg(reftab%weak(iw))
+    do ir=1,nns
+      ll = reftab%hkl(1:3,reftab%strong(ir)) - gw
+      Usw(ir,iw) = cell%LUT(ll(1),ll(2),ll(3))
+      Uws(iw,ir) = cell%LUT(-ll(1),-ll(2),-ll(3)) * rsg
+      weaksgsum(ir) = weaksgsum(ir) + abs(Usw(ir,iw))**2 * rsg
+    end do
+  end do
+  DynMat = DynMat - cmplx(0.5D0*cell%mLambda,0.0D0,dbl) * matmul(Usw, Uws)
+  weaksgsum = weaksgsum * cell%mLambda/2.D0
+  deallocate(Usw, Uws)
+end if
+
+! diagonal entries contain the excitation error and the normal absorption
+do ir=1,nns
+  DynMat(ir,ir) = cmplx(2.D0*reftab%sg(reftab%strong(ir))/cell%mLambda-weaksgsum(ir),Upz,dbl)
+end do
+
+deallocate(weaksgsum)
+
+end subroutine GetDynMatTable
+
 
 !--------------------------------------------------------------------------
 !
@@ -1656,6 +1656,9 @@ integer(kind=irg)       :: numsx
 integer(kind=irg)       :: num_el
 integer(kind=irg)       :: primeseed
 integer(kind=irg)       :: nthreads
+integer(kind=irg)       :: blocksize
+integer(kind=irg)       :: firstbatch
+integer(kind=irg)       :: nbatches
 real(kind=dbl)          :: sig
 real(kind=dbl)          :: omega
 real(kind=dbl)          :: EkeV
@@ -1664,12 +1667,14 @@ real(kind=dbl)          :: Ebinsize
 real(kind=dbl)          :: depthmax
 real(kind=dbl)          :: depthstep
 character(4)            :: MCmode
+character(8)            :: rngmode
 character(fnlen)        :: xtalname
 character(fnlen)        :: dataname
 
 ! define the IO namelist to facilitate passing variables to the program.
 namelist  / MCdata / stdout, xtalname, sig, numsx, num_el, primeseed, EkeV, &
-                dataname, nthreads, Ehistmin, Ebinsize, depthmax, depthstep, omega, MCmode
+                dataname, nthreads, Ehistmin, Ebinsize, depthmax, depthstep, omega, MCmode, blocksize, &
+                rngmode, firstbatch, nbatches
 
 ! set the input parameters to default values (except for xtalname, which must be present)
 stdout = 6
@@ -1677,6 +1682,7 @@ numsx = 1501
 primeseed = 932117
 num_el = 12500000
 nthreads = 1
+blocksize = 0           ! 0 = one electron at a time; > 0 = number of electrons advanced in lockstep
 sig = 70.D0
 omega = 0.D0
 EkeV = 30.D0
@@ -1685,6 +1691,9 @@ Ebinsize = 0.5D0
 depthmax = 100.D0
 depthstep = 1.0D0
 MCmode = 'CSDA'
+rngmode = 'thread'      ! 'thread' = one random number stream per thread; 'electron' = one per electron
+firstbatch = 1          ! first batch of num_el electrons in the 'electron' rngmode
+nbatches = 1            ! number of batches of num_el electrons in the 'electron' rngmode
 xtalname = 'undefined'
 dataname = 'MCoutput.data'
 
@@ -1702,6 +1711,9 @@ if (.not.skipread) then
  if (trim(xtalname).eq.'undefined') then
   call FatalError('EMMC:',' structure file name is undefined in '//nmlfile)
  end if
+ if ((trim(rngmode).ne.'thread').and.(trim(rngmode).ne.'electron')) then
+  call FatalError('EMMC:',' rngmode must be thread or electron in '//nmlfile)
+ end if
 end if
 
 ! if we get here, then all appears to be ok, and we need to fill in the mcnl fields
@@ -1710,6 +1722,9 @@ mcnl%numsx = numsx
 mcnl%primeseed = primeseed
 mcnl%num_el = num_el
 mcnl%nthreads = nthreads
+mcnl%blocksize = blocksize
+mcnl%firstbatch = firstbatch
+mcnl%nbatches = nbatches
 mcnl%sig = sig
 mcnl%omega = omega
 mcnl%EkeV = EkeV
@@ -1718,6 +1733,7 @@ mcnl%Ebinsize = Ebinsize
 mcnl%depthmax = depthmax
 mcnl%depthstep = depthstep
 mcnl%MCmode = MCmode
+mcnl%rngmode = rngmode
 mcnl%xtalname = xtalname
 mcnl%dataname = dataname
 mcnl%stdout = stdout
@@ -2627,15 +2643,19 @@ logical                                 :: skipread = .FALSE.
 
 real(kind=sgl)          :: kamcutoff
 integer(kind=irg)       :: orav
+integer(kind=irg)       :: nbtype
+integer(kind=irg)       :: radius
 character(fnlen)        :: dotproductfile
 character(fnlen)        :: kamtiff
 
 ! define the IO namelist to facilitate passing variables to the program.
-namelist /KAM/ kamcutoff, orav, dotproductfile, kamtiff
+namelist /KAM/ kamcutoff, orav, dotproductfile, kamtiff, nbtype, radius
 
 ! set the input parameters to default values (except for xtalname, which must be present)
 kamcutoff = 5.0                 ! number of near-matches to use
 orav = 0                        ! perform orientation average first ?
+nbtype = 4                      ! neighborhood type (4 or 8)
+radius = 1                      ! neighborhood radius (in pixels)
 dotproductfile = 'undefined'    ! default filename for input dotproduct file (HDF5)
 kamtiff = 'undefined'    ! default filename for input dotproduct file (HDF5)
 
@@ -2657,11 +2677,21 @@ if (.not.skipread) then
  if (trim(kamtiff).eq.'undefined') then
   call FatalError(' EMKAM',' kam.tiff output file name is undefined in '//nmlfile)
  end if
+
+ if ((nbtype.ne.4).and.(nbtype.ne.8)) then
+  call FatalError(' EMKAM',' nbtype must be 4 or 8 in '//nmlfile)
+ end if
+
+ if (radius.lt.1) then
+  call FatalError(' EMKAM',' radius must be at least 1 in '//nmlfile)
+ end if
 end if
 
 ! if we get here, then all appears to be ok, and we need to fill in the emnl fields
 emnl%kamcutoff = kamcutoff
 emnl%orav = orav
+emnl%nbtype = nbtype
+emnl%radius = radius
 emnl%dotproductfile = dotproductfile
 emnl%kamtiff = kamtiff
 
@@ -2787,6 +2817,10 @@ integer(kind=irg)       :: stdout
 integer(kind=irg)       :: npx
 integer(kind=irg)       :: Esel
 integer(kind=irg)       :: nthreads
+integer(kind=irg)       :: checkpoint
+integer(kind=irg)       :: Econcurrent
+integer(kind=irg)       :: nshards
+integer(kind=irg)       :: shard
 real(kind=sgl)          :: dmin
 character(3)            :: Notify
 character(fnlen)        :: copyfromenergyfile
@@ -2801,12 +2835,17 @@ logical                 :: doLegendre
 
 ! define the IO namelist to facilitate passing variables to the program.
 namelist /EBSDmastervars/ dmin,npx,nthreads,copyfromenergyfile,energyfile,Esel,restart,uniform,Notify, &
-                          combinesites, h5copypath, BetheParametersFile, stdout, useEnergyWeighting, doLegendre
+                          combinesites, h5copypath, BetheParametersFile, stdout, useEnergyWeighting, doLegendre, &
+                          checkpoint, Econcurrent, nshards, shard
 
 ! set the input parameters to default values (except for xtalname, which must be present)
 stdout = 6
 npx = 500                       ! Nx pixels (total = 2Nx+1)
 nthreads = 1
+checkpoint = 0                  ! number of beam directions between checkpoints (0 = no checkpoints)
+Econcurrent = 0                 ! maximum number of energies computed concurrently (0 = automatic)
+nshards = 1                     ! number of independent processes that share the beam directions
+shard = 1                       ! shard to compute (1..nshards), or 0 to merge all shard files
 Esel = -1                       ! selected energy value for single energy run
 dmin = 0.025                    ! smallest d-spacing to include in dynamical matrix [nm]
 Notify = 'Off'
@@ -2842,6 +2881,10 @@ emnl%stdout = stdout
 emnl%npx = npx
 emnl%Esel = Esel
 emnl%nthreads = nthreads
+emnl%checkpoint = checkpoint
+emnl%Econcurrent = Econcurrent
+emnl%nshards = nshards
+emnl%shard = shard
 emnl%dmin = dmin
 emnl%copyfromenergyfile = copyfromenergyfile
 emnl%h5copypath = h5copypath
@@ -3324,6 +3367,8 @@ integer(kind=irg)       :: stdout
 integer(kind=irg)       :: npx
 integer(kind=irg)       :: Esel
 integer(kind=irg)       :: nthreads
+integer(kind=irg)       :: nshards
+integer(kind=irg)       :: shard
 real(kind=sgl)          :: dmin
 character(fnlen)        :: energyfile
 logical                 :: combinesites
@@ -3331,12 +3376,14 @@ logical                 :: restart
 logical                 :: uniform
 
 ! define the IO namelist to facilitate passing variables to the program.
-namelist /TKDmastervars/ dmin,npx,nthreads,energyfile,Esel,restart,uniform,combinesites
+namelist /TKDmastervars/ dmin,npx,nthreads,energyfile,Esel,restart,uniform,combinesites,nshards,shard
 
 ! set the input parameters to default values (except for xtalname, which must be present)
 stdout = 6
 npx = 500                       ! Nx pixels (total = 2Nx+1)
 nthreads = 1
+nshards = 1                     ! number of independent processes that share the beam directions
+shard = 1                       ! shard to compute (1..nshards), or 0 to merge all shard files
 Esel = -1                       ! selected energy value for single energy run
 dmin = 0.025                    ! smallest d-spacing to include in dynamical matrix [nm]
 energyfile = 'undefined'        ! default filename for z_0(E_e) data from EMMC Monte Carlo simulations
@@ -3365,6 +3412,8 @@ emnl%stdout = stdout
 emnl%npx = npx
 emnl%Esel = Esel
 emnl%nthreads = nthreads
+emnl%nshards = nshards
+emnl%shard = shard
 emnl%dmin = dmin
 emnl%energyfile = energyfile
 emnl%outname = energyfile       ! as off release 3.1, outname must be the same as energyfile
@@ -3763,6 +3812,8 @@ integer(kind=irg)       :: stdout
 integer(kind=irg)       :: npx
 integer(kind=irg)       :: Esel
 integer(kind=irg)       :: nthreads
+integer(kind=irg)       :: nshards
+integer(kind=irg)       :: shard
 real(kind=sgl)          :: dmin
 character(3)            :: Notify
 character(fnlen)        :: compmode
@@ -3773,12 +3824,14 @@ logical                 :: combinesites
 
 ! define the IO namelist to facilitate passing variables to the program.
 namelist /ECPmastervars/ stdout, dmin, compmode, Notify, h5copypath, &
-    energyfile, Esel, npx, nthreads, copyfromenergyfile, combinesites
+    energyfile, Esel, npx, nthreads, copyfromenergyfile, combinesites, nshards, shard
 
 ! set the input parameters to default values (except for xtalname, which must be present)
 stdout = 6
 Esel = -1                       ! selected energy value for single energy run
 nthreads = 1
+nshards = 1                     ! number of independent processes that share the beam directions
+shard = 1                       ! shard to compute (1..nshards), or 0 to merge all shard files
 dmin = 0.04                    ! smallest d-spacing to include in dynamical matrix [nm]
 npx = 256
 Notify = 'Off'
@@ -3809,6 +3862,8 @@ ecpnl%stdout = stdout
 ecpnl%Esel = Esel
 ecpnl%npx = npx
 ecpnl%nthreads = nthreads
+ecpnl%nshards = nshards
+ecpnl%shard = shard
 ecpnl%dmin = dmin
 ecpnl%Notify = Notify
 ecpnl%compmode = compmode
@@ -4056,7 +4111,7 @@ binning         = 1             ! binning mode  (1, 2, 4, or 8)
 L               = 20000.0       ! [microns]
 nthreads        = 1             ! number of OpenMP threads
 nregions        = 10            ! number of regions in adaptive histogram equalization
-energyaverage   = 0             ! apply energy averaging (1) or not (0); useful for dictionary computations
+energyaverage   = 0             ! number of energy clusters for an approximate energy sum (0 = use all energy bins)
 thetac          = 0.0           ! [degrees]
 delta           = 25.0          ! [microns]
 xpc             = 0.0           ! [pixels]
@@ -4903,6 +4958,7 @@ integer(kind=irg)        :: refresh
 integer(kind=irg)        :: iwrite
 integer(kind=irg)        :: method(3)
 integer(kind=irg)        :: GrainID
+integer(kind=irg)        :: stall
 real(kind=sgl)           :: VTR 
 real(kind=sgl)           :: CR_XC
 real(kind=sgl)           :: F_XC
@@ -4973,7 +5029,7 @@ namelist  / EBSDDEdata / NP, itermax, strategy, refresh, iwrite, method, VTR, CR
                          energymax, gammavalue, alphaBD, scalingmode, axisangle, nthreads, outputformat, maskpattern, &
                          energyaverage, spatialaverage, applyDeformation, Ftensor, includebackground, anglefiletype, &
                          makedictionary, hipassw, nregions, maskradius, poisson, patx, paty, inputtype, HDFstrings, ipf_wd, &
-                         ipf_ht, datafile, w, w_damp, c1, c2, single_opt, Fframe, single_grain, GrainID
+                         ipf_ht, datafile, w, w_damp, c1, c2, single_opt, Fframe, single_grain, GrainID, stall
 
 ! set the input parameters to default values (except for xtalname, which must be present)
                         
@@ -4993,6 +5049,7 @@ w=1.0
 w_damp=0.99
 c1=2
 c2=2
+stall=0                         ! retire dominated particles after this many iterations without improvement (0 = never)
 hybrid='n'
 globalopt='DE'
 single_opt='n'
@@ -5095,6 +5152,7 @@ de%w=w
 de%w_damp=w_damp
 de%c1=c1
 de%c2=c2
+de%stall=stall
 de%hybrid=hybrid
 de%globalopt=globalopt
 de%objective=objective
@@ -7013,6 +7071,8 @@ integer(kind=irg)                                 :: usenumd
 integer(kind=irg)                                 :: platid
 integer(kind=irg)                                 :: nregions
 integer(kind=irg)                                 :: nlines
+integer(kind=irg)                                 :: PCAdim
+integer(kind=irg)                                 :: PCAsamples
 real(kind=sgl)                                    :: L
 real(kind=sgl)                                    :: thetac
 real(kind=sgl)                                    :: delta
@@ -7069,7 +7129,8 @@ beamcurrent, dwelltime, binning, gammavalue, energymin, spatialaverage, nregions
 scalingmode, maskpattern, energyaverage, L, omega, nthreads, energymax, datafile, angfile, ctffile, &
 ncubochoric, numexptsingle, numdictsingle, ipf_ht, ipf_wd, nnk, nnav, exptfile, maskradius, inputtype, usetmpfile, &
 dictfile, indexingmode, hipassw, stepX, stepY, tmpfile, avctffile, nosm, eulerfile, Notify, maskfile, &
-section, HDFstrings, ROI, keeptmpfile, multidevid, usenumd, nism, isangle, refinementNMLfile, similaritymetric
+section, HDFstrings, ROI, keeptmpfile, multidevid, usenumd, nism, isangle, refinementNMLfile, similaritymetric, &
+PCAdim, PCAsamples
 
 ! set the input parameters to default values (except for xtalname, which must be present)
 ncubochoric     = 50
@@ -7081,6 +7142,8 @@ usenumd         = 1
 multidevid      = (/ 0, 0, 0, 0, 0, 0, 0, 0 /)
 nregions        = 10
 nlines          = 3
+PCAdim          = 0             ! number of eigen-patterns for low-rank matching (0 = full-length dot products)
+PCAsamples      = 2000          ! number of dictionary patterns used to build the eigen-pattern basis
 nnk             = 50
 nnav            = 20
 nosm            = 20
@@ -7174,6 +7237,10 @@ if (.not.skipread) then
         call FatalError('EMEBSDIndexing:',' pattern size numsy is zero in '//nmlfile)
     end if
 
+    if ((PCAdim.gt.0).and.(PCAsamples.lt.PCAdim)) then
+        call FatalError('EMEBSDIndexing:',' PCAsamples must be at least as large as PCAdim in '//nmlfile)
+    end if
+
     if (energyaverage.ne.-1) then
         call Message('EMEBSDIndexing Warning: energyaverage parameter is no longer used;')
         call Message('   ------> parameter value will be ignored during program run ')
@@ -7190,6 +7257,8 @@ enl%usenumd       = usenumd
 enl%platid        = platid
 enl%nregions      = nregions
 enl%nlines        = nlines
+enl%PCAdim        = PCAdim
+enl%PCAsamples    = PCAsamples
 enl%maskpattern   = maskpattern
 enl%keeptmpfile   = keeptmpfile
 enl%usetmpfile    = usetmpfile
@@ -7479,6 +7548,8 @@ integer(kind=irg)       :: numsx
 integer(kind=irg)       :: numsy
 integer(kind=irg)       :: nthreads
 integer(kind=irg)       :: nregions
+integer(kind=irg)       :: nbtype
+integer(kind=irg)       :: radius
 integer(kind=irg)       :: ROI(4)
 real(kind=dbl)          :: hipassw
 character(1)            :: maskpattern
@@ -7494,7 +7565,8 @@ character(fnlen)        :: HDFstrings(10)
 
 ! define the IO namelist to facilitate passing variables to the program.
 namelist  / getADP / numsx, numsy, nregions, maskpattern, nthreads, ipf_ht, ipf_wd, exptfile, maskradius, inputtype, &
-                     tmpfile, maskfile, HDFstrings, hipassw, tiffname, filterpattern, keeptmpfile, usetmpfile, ROI
+                     tmpfile, maskfile, HDFstrings, hipassw, tiffname, filterpattern, keeptmpfile, usetmpfile, ROI, &
+                     nbtype, radius
 
 ! set the input parameters to default values
  ipf_ht = 100
@@ -7507,6 +7579,8 @@ namelist  / getADP / numsx, numsy, nregions, maskpattern, nthreads, ipf_ht, ipf_
  maskradius = 240
  hipassw = 0.05
  nregions = 10
+ nbtype = 4             ! neighborhood type (4 or 8)
+ radius = 1             ! neighborhood radius (in pixels)
  numsx = 0
  numsy = 0
  ROI = (/ 0, 0, 0, 0 /)
@@ -7543,6 +7617,14 @@ if (.not.skipread) then
     if (numsy.eq.0) then
         call FatalError('GetADPNameList:',' patterns size numsy is zero in '//nmlfile)
     end if
+
+    if ((nbtype.ne.4).and.(nbtype.ne.8)) then
+        call FatalError('GetADPNameList:',' nbtype must be 4 or 8 in '//nmlfile)
+    end if
+
+    if (radius.lt.1) then
+        call FatalError('GetADPNameList:',' radius must be at least 1 in '//nmlfile)
+    end if
  end if
 
 ! if we get here, then all appears to be ok, and we need to fill in the enl fields
@@ -7553,6 +7635,8 @@ adpnl%numsx = numsx
 adpnl%numsy = numsy
 adpnl%nthreads = nthreads
 adpnl%nregions = nregions
+adpnl%nbtype = nbtype
+adpnl%radius = radius
 adpnl%ROI = ROI
 adpnl%hipassw = hipassw
 adpnl%maskpattern = maskpattern
@@ -7596,17 +7680,23 @@ logical,OPTIONAL,INTENT(IN)                       :: initonly
 logical                                           :: skipread = .FALSE.
 
 integer(kind=irg)       :: nmatch(5)
+integer(kind=irg)       :: nbtype
+integer(kind=irg)       :: radius
 character(fnlen)        :: dotproductfile
 character(fnlen)        :: tiffname
+character(1)            :: distweight
 
 
 ! define the IO namelist to facilitate passing variables to the program.
-namelist  / getOSM / nmatch, dotproductfile, tiffname
+namelist  / getOSM / nmatch, dotproductfile, tiffname, distweight, nbtype, radius
 
 ! set the input parameters to default values
 nmatch = (/ 20, 0, 0, 0, 0 /)
+nbtype = 4              ! neighborhood type (4 or 8)
+radius = 1              ! neighborhood radius (in pixels)
 dotproductfile = 'undefined'
 tiffname = 'undefined'
+distweight = 'n'        ! also produce inverse-distance weighted maps ?
 
 if (present(initonly)) then
   if (initonly) skipread = .TRUE.
@@ -7626,12 +7716,23 @@ if (.not.skipread) then
     if (trim(tiffname).eq.'undefined') then
         call FatalError('GetOSMNameList:',' output tiff file name is undefined in '//nmlfile)
     end if
+
+    if ((nbtype.ne.4).and.(nbtype.ne.8)) then
+        call FatalError('GetOSMNameList:',' nbtype must be 4 or 8 in '//nmlfile)
+    end if
+
+    if (radius.lt.1) then
+        call FatalError('GetOSMNameList:',' radius must be at least 1 in '//nmlfile)
+    end if
  end if
 
 ! if we get here, then all appears to be ok, and we need to fill in the enl fields
 osmnl%nmatch = nmatch
+osmnl%nbtype = nbtype
+osmnl%radius = radius
 osmnl%dotproductfile = dotproductfile
 osmnl%tiffname = tiffname
+osmnl%distweight = distweight
 
 end subroutine GetOSMNameList
 
@@ -9010,12 +9111,19 @@ real(kind=sgl)                                    :: step
 integer(kind=irg)                                 :: initialx
 integer(kind=irg)                                 :: initialy
 character(fnlen)                                  :: PCcorrection
+real(kind=sgl)                                    :: PCquantum
+integer(kind=irg)                                 :: PCcachesize
+character(fnlen)                                  :: PCmodel
+integer(kind=irg)                                 :: PCmodeliter
+integer(kind=irg)                                 :: PCmodelsamples
 real(kind=sgl)                                    :: truedelta
+integer(kind=irg)                                 :: energyaverage
 
 
 namelist / RefineOrientations / nthreads, dotproductfile, ctffile, modality, nmis, niter, step, inRAM, method, &
                                 matchdepth, PSvariantfile, tmpfile, initialx, initialy, PCcorrection, truedelta, &
-                                usetmpfile, angfile
+                                usetmpfile, angfile, energyaverage, PCquantum, PCcachesize, &
+                                PCmodel, PCmodeliter, PCmodelsamples
 
 nthreads = 1
 matchdepth = 1
@@ -9034,7 +9142,13 @@ modality = 'EBSD'
 initialx = 0
 initialy = 0
 PCcorrection = 'off'
+PCquantum = 0.0                 ! pattern center quantum [pixels] for the detector cache (0 = exact detectors, no cache)
+PCcachesize = 8                 ! number of cached detectors per thread
+PCmodel = 'none'                ! scan-wide pattern center model ('none', 'plane', 'quadratic')
+PCmodeliter = 5                 ! number of alternating orientation/pattern center updates
+PCmodelsamples = 400            ! number of patterns used for the pattern center model update
 truedelta = 50.0
+energyaverage = 0               ! number of energy clusters for an approximate energy sum (0 = use all energy bins)
 
 
 if (present(initonly)) then
@@ -9074,7 +9188,13 @@ enl%modality = modality
 enl%initialx = initialx 
 enl%initialy = initialy
 enl%PCcorrection = PCcorrection
+enl%PCquantum = PCquantum
+enl%PCcachesize = PCcachesize
+enl%PCmodel = PCmodel
+enl%PCmodeliter = PCmodeliter
+enl%PCmodelsamples = PCmodelsamples
 enl%truedelta = truedelta 
+enl%energyaverage = energyaverage
 
 end subroutine GetRefineOrientationNameList
 
@@ -216,6 +216,9 @@ type MCNameListType
         integer(kind=irg)       :: num_el
         integer(kind=irg)       :: totnum_el
         integer(kind=irg)       :: nthreads
+        integer(kind=irg)       :: blocksize
+        integer(kind=irg)       :: firstbatch
+        integer(kind=irg)       :: nbatches
         real(kind=dbl)          :: sig
         real(kind=dbl)          :: omega
         real(kind=dbl)          :: EkeV
@@ -224,6 +227,7 @@ type MCNameListType
         real(kind=dbl)          :: depthmax
         real(kind=dbl)          :: depthstep
         character(4)            :: MCmode
+        character(8)            :: rngmode
         character(fnlen)        :: mode
         character(fnlen)        :: xtalname
         character(fnlen)        :: dataname
@@ -486,6 +490,10 @@ type EBSDMasterNameListType
         integer(kind=irg)       :: npx
         integer(kind=irg)       :: Esel
         integer(kind=irg)       :: nthreads
+        integer(kind=irg)       :: checkpoint
+        integer(kind=irg)       :: Econcurrent
+        integer(kind=irg)       :: nshards
+        integer(kind=irg)       :: shard
         real(kind=sgl)          :: dmin
         character(3)            :: Notify
         character(fnlen)        :: copyfromenergyfile
@@ -561,6 +569,8 @@ type TKDMasterNameListType
         integer(kind=irg)       :: npx
         integer(kind=irg)       :: Esel
         integer(kind=irg)       :: nthreads
+        integer(kind=irg)       :: nshards
+        integer(kind=irg)       :: shard
         real(kind=sgl)          :: dmin
         character(fnlen)        :: energyfile
         character(fnlen)        :: outname
@@ -690,6 +700,7 @@ integer(kind=irg)        :: refresh
 integer(kind=irg)        :: iwrite
 integer(kind=irg)        :: method(3)
 integer(kind=irg)        :: GrainID
+integer(kind=irg)        :: stall
 real(kind=sgl)           :: VTR 
 real(kind=sgl)           :: CR_XC
 real(kind=sgl)           :: F_XC
@@ -1150,6 +1161,8 @@ type ECPMasterNameListType
     integer(kind=irg)       :: npx
     integer(kind=irg)       :: Esel
     integer(kind=irg)       :: nthreads
+    integer(kind=irg)       :: nshards
+    integer(kind=irg)       :: shard
     real(kind=sgl)          :: dmin
     character(3)            :: Notify
     character(fnlen)        :: compmode
@@ -1415,6 +1428,8 @@ end type OrientationSimilarityNameListType
 type KAMNameListType
         real(kind=sgl)          :: kamcutoff
         integer(kind=irg)       :: orav
+        integer(kind=irg)       :: nbtype
+        integer(kind=irg)       :: radius
         character(fnlen)        :: dotproductfile
         character(fnlen)        :: kamtiff
 end type KAMNameListType
@@ -1476,6 +1491,8 @@ type EBSDIndexingNameListType
         integer(kind=irg)       :: platid
         integer(kind=irg)       :: nregions
         integer(kind=irg)       :: nlines
+        integer(kind=irg)       :: PCAdim
+        integer(kind=irg)       :: PCAsamples
         real(kind=sgl)          :: L
         real(kind=sgl)          :: thetac
         real(kind=sgl)          :: delta
@@ -1608,6 +1625,8 @@ type ADPNameListType
         integer(kind=irg)       :: numsy
         integer(kind=irg)       :: nthreads
         integer(kind=irg)       :: nregions
+        integer(kind=irg)       :: nbtype
+        integer(kind=irg)       :: radius
         integer(kind=irg)       :: ROI(4)
         real(kind=dbl)          :: hipassw
         character(1)            :: maskpattern
@@ -1624,8 +1643,11 @@ end type ADPNameListType
 
 type OSMNameListType
         integer(kind=irg)       :: nmatch(5)
+        integer(kind=irg)       :: nbtype
+        integer(kind=irg)       :: radius
         character(fnlen)        :: dotproductfile
         character(fnlen)        :: tiffname
+        character(1)            :: distweight
 end type OSMNameListType
 
 type dpmergeNameListType
@@ -2110,7 +2132,13 @@ type RefineOrientationtype
         integer(kind=irg)       :: initialx
         integer(kind=irg)       :: initialy
         character(fnlen)        :: PCcorrection
+        real(kind=sgl)          :: PCquantum
+        integer(kind=irg)       :: PCcachesize
+        character(fnlen)        :: PCmodel
+        integer(kind=irg)       :: PCmodeliter
+        integer(kind=irg)       :: PCmodelsamples
         real(kind=sgl)          :: truedelta
+        integer(kind=irg)       :: energyaverage
 end type RefineOrientationtype
 
 type FitOrientationPStype
@@ -90,63 +90,17 @@ type(EBSDDetectorType),INTENT(INOUT)    :: EBSDdetector
 !f2py intent(in,out) ::  EBSDdetector
 logical,INTENT(IN),OPTIONAL             :: verbose
 
-real(kind=sgl),allocatable              :: scin_x(:), scin_y(:), testarray(:,:)  ! scintillator coordinate arrays [microns]
-real(kind=sgl),parameter                :: dtor = 0.0174533  ! convert from degrees to radians
-real(kind=sgl)                          :: alp, ca, sa, cw, sw
-real(kind=sgl)                          :: L2, Ls, Lc, calpha     ! distances
-real(kind=sgl),allocatable              :: z(:,:)           
-integer(kind=irg)                       :: nix, niy, binx, biny , i, j, Emin, Emax, istat, k, ipx, ipy, nsx, nsy, elp  
+real(kind=sgl)                          :: calpha
+integer(kind=irg)                       :: nix, niy, i, j, Emin, Emax, istat, k, ipx, ipy, nsx, nsy
 real(kind=sgl)                          :: dc(3), scl, alpha, theta, g, pcvec(3), s, dp           ! direction cosine array
-real(kind=sgl)                          :: sx, dx, dxm, dy, dym, rhos, x, bindx         ! various parameters
+real(kind=sgl)                          :: dx, dxm, dy, dym, x         ! various parameters
 real(kind=sgl)                          :: ixy(2)
 
 !====================================
 ! ------ generate the detector arrays
 !====================================
 ! This needs to be done only once for a given detector geometry
-allocate(scin_x(enl%numsx),scin_y(enl%numsy),stat=istat)
-! if (istat.ne.0) then ...
-! change to the detector point of view necessitates negating the x pattern center coordinate
-scin_x = - ( -enl%xpc - ( 1.0 - enl%numsx ) * 0.5 - (/ (i-1, i=1,enl%numsx) /) ) * enl%delta
-scin_y = ( enl%ypc - ( 1.0 - enl%numsy ) * 0.5 - (/ (i-1, i=1,enl%numsy) /) ) * enl%delta
-
-! auxiliary angle to rotate between reference frames
-alp = 0.5 * cPi - (mcnl%sig - enl%thetac) * dtor
-ca = cos(alp)
-sa = sin(alp)
-
-cw = cos(mcnl%omega * dtor)
-sw = sin(mcnl%omega * dtor)
-
-! we will need to incorporate a series of possible distortions 
-! here as well, as described in Gert Nolze's paper; for now we 
-! just leave this place holder comment instead
-
-! compute auxilliary interpolation arrays
-! if (istat.ne.0) then ...
-
-elp = enl%numsy + 1
-L2 = enl%L * enl%L
-do j=1,enl%numsx
-  sx = L2 + scin_x(j) * scin_x(j)
-  Ls = -sw * scin_x(j) + enl%L*cw
-  Lc = cw * scin_x(j) + enl%L*sw
-  do i=1,enl%numsy
-   rhos = 1.0/sqrt(sx + scin_y(i)**2)
-   EBSDdetector%rgx(j,elp-i) = (scin_y(i) * ca + sa * Ls) * rhos!Ls * rhos
-   EBSDdetector%rgy(j,elp-i) = Lc * rhos!(scin_x(i) * cw + Lc * sw) * rhos
-   EBSDdetector%rgz(j,elp-i) = (-sa * scin_y(i) + ca * Ls) * rhos!(-sw * scin_x(i) + Lc * cw) * rhos
-  end do
-end do
-deallocate(scin_x, scin_y)
-
-! normalize the direction cosines.
-allocate(z(enl%numsx,enl%numsy))
-  z = 1.0/sqrt(EBSDdetector%rgx*EBSDdetector%rgx+EBSDdetector%rgy*EBSDdetector%rgy+EBSDdetector%rgz*EBSDdetector%rgz)
-  EBSDdetector%rgx = EBSDdetector%rgx*z
-  EBSDdetector%rgy = EBSDdetector%rgy*z
-  EBSDdetector%rgz = EBSDdetector%rgz*z
-deallocate(z)
+call EBSDDetectorDirectionCosines(enl, mcnl, EBSDdetector%rgx, EBSDdetector%rgy, EBSDdetector%rgz)
 !====================================
 
 !====================================
@@ -232,6 +186,246 @@ end if
 !====================================
 end subroutine GenerateEBSDDetector
 
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE:EBSDDetectorDirectionCosines
+!
+!> @brief compute the direction cosine arrays of all detector pixels for a given pattern center
+!
+!> @details This is the geometric part of GenerateEBSDDetector; it is cheap compared to the 
+!> energy weights, so it can be evaluated exactly for every pattern center.
+!
+!> @param enl EBSD name list structure
+!> @param mcnl Monte Carlo name list structure
+!> @param rgx, rgy, rgz direction cosine arrays
+!--------------------------------------------------------------------------
+recursive subroutine EBSDDetectorDirectionCosines(enl, mcnl, rgx, rgy, rgz)
+!DEC$ ATTRIBUTES DLLEXPORT :: EBSDDetectorDirectionCosines
+
+use local
+use typedefs
+use NameListTypedefs
+use constants
+
+IMPLICIT NONE
+
+type(EBSDNameListType),INTENT(IN)       :: enl
+type(MCCLNameListType),INTENT(IN)       :: mcnl
+real(kind=sgl),INTENT(INOUT)            :: rgx(:,:)
+real(kind=sgl),INTENT(INOUT)            :: rgy(:,:)
+real(kind=sgl),INTENT(INOUT)            :: rgz(:,:)
+
+real(kind=sgl),allocatable              :: scin_x(:), scin_y(:)  ! scintillator coordinate arrays [microns]
+real(kind=sgl),parameter                :: dtor = 0.0174533  ! convert from degrees to radians
+real(kind=sgl)                          :: alp, ca, sa, cw, sw
+real(kind=sgl)                          :: L2, Ls, Lc     ! distances
+real(kind=sgl),allocatable              :: z(:,:)           
+integer(kind=irg)                       :: i, j, istat, elp  
+real(kind=sgl)                          :: sx, rhos
+
+allocate(scin_x(enl%numsx),scin_y(enl%numsy),stat=istat)
+! if (istat.ne.0) then ...
+! change to the detector point of view necessitates negating the x pattern center coordinate
+scin_x = - ( -enl%xpc - ( 1.0 - enl%numsx ) * 0.5 - (/ (i-1, i=1,enl%numsx) /) ) * enl%delta
+scin_y = ( enl%ypc - ( 1.0 - enl%numsy ) * 0.5 - (/ (i-1, i=1,enl%numsy) /) ) * enl%delta
+
+! auxiliary angle to rotate between reference frames
+alp = 0.5 * cPi - (mcnl%sig - enl%thetac) * dtor
+ca = cos(alp)
+sa = sin(alp)
+
+cw = cos(mcnl%omega * dtor)
+sw = sin(mcnl%omega * dtor)
+
+! we will need to incorporate a series of possible distortions 
+! here as well, as described in Gert Nolze's paper; for now we 
+! just leave this place holder comment instead
+
+! compute auxilliary interpolation arrays
+! if (istat.ne.0) then ...
+
+elp = enl%numsy + 1
+L2 = enl%L * enl%L
+do j=1,enl%numsx
+  sx = L2 + scin_x(j) * scin_x(j)
+  Ls = -sw * scin_x(j) + enl%L*cw
+  Lc = cw * scin_x(j) + enl%L*sw
+  do i=1,enl%numsy
+   rhos = 1.0/sqrt(sx + scin_y(i)**2)
+   rgx(j,elp-i) = (scin_y(i) * ca + sa * Ls) * rhos!Ls * rhos
+   rgy(j,elp-i) = Lc * rhos!(scin_x(i) * cw + Lc * sw) * rhos
+   rgz(j,elp-i) = (-sa * scin_y(i) + ca * Ls) * rhos!(-sw * scin_x(i) + Lc * cw) * rhos
+  end do
+end do
+deallocate(scin_x, scin_y)
+
+! normalize the direction cosines.
+allocate(z(size(rgx,1),size(rgx,2)))
+  z = 1.0/sqrt(rgx*rgx+rgy*rgy+rgz*rgz)
+  rgx = rgx*z
+  rgy = rgy*z
+  rgz = rgz*z
+deallocate(z)
+
+end subroutine EBSDDetectorDirectionCosines
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE:InitEBSDDetectorCache
+!
+!> @brief allocate a detector cache for refinements with a pattern center that varies across the scan
+!
+!> @param cache detector cache structure
+!> @param nslots number of detectors to keep
+!> @param qpc pattern center quantum [pixels]; L is quantized in steps of qpc * delta; 0 disables the cache
+!> @param numE number of energy bins
+!> @param nsx number of detector pixels along x
+!> @param nsy number of detector pixels along y
+!--------------------------------------------------------------------------
+recursive subroutine InitEBSDDetectorCache(cache, nslots, qpc, numE, nsx, nsy)
+!DEC$ ATTRIBUTES DLLEXPORT :: InitEBSDDetectorCache
+
+use local
+use typedefs
+
+IMPLICIT NONE
+
+type(EBSDDetectorCacheType),INTENT(INOUT)  :: cache
+integer(kind=irg),INTENT(IN)            :: nslots
+real(kind=sgl),INTENT(IN)               :: qpc
+integer(kind=irg),INTENT(IN)            :: numE
+integer(kind=irg),INTENT(IN)            :: nsx
+integer(kind=irg),INTENT(IN)            :: nsy
+
+! without quantization the cache is never used, so no slots are allocated
+cache%nslots = nslots
+if (qpc.le.0.0) cache%nslots = 0
+cache%nused = 0
+cache%tick = 0
+cache%qpc = qpc
+allocate(cache%key(3,cache%nslots), cache%age(cache%nslots), cache%accum(numE,nsx,nsy,cache%nslots))
+cache%key = 0
+cache%age = 0
+
+end subroutine InitEBSDDetectorCache
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE:DeleteEBSDDetectorCache
+!
+!> @brief release the memory of a detector cache
+!
+!> @param cache detector cache structure
+!--------------------------------------------------------------------------
+recursive subroutine DeleteEBSDDetectorCache(cache)
+!DEC$ ATTRIBUTES DLLEXPORT :: DeleteEBSDDetectorCache
+
+use local
+use typedefs
+
+IMPLICIT NONE
+
+type(EBSDDetectorCacheType),INTENT(INOUT)  :: cache
+
+if (allocated(cache%key)) deallocate(cache%key)
+if (allocated(cache%age)) deallocate(cache%age)
+if (allocated(cache%accum)) deallocate(cache%accum)
+cache%nslots = 0
+cache%nused = 0
+
+end subroutine DeleteEBSDDetectorCache
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE:GetCachedEBSDDetector
+!
+!> @brief generate the detector arrays for a given pattern center, reusing cached energy weights
+!
+!> @details The energy weights (accum_e_detector) vary slowly with the pattern center, and 
+!> are by far the most expensive part of the detector generation, so they are computed for the
+!> pattern center rounded to a multiple of cache%qpc and kept in a small least-recently-used
+!> cache.  The direction cosines are always computed exactly for the requested pattern center.
+!> The detector arrays must be allocated by the caller; each thread should use its own cache.
+!
+!> @param enl EBSD name list structure (with the pattern center for this pattern)
+!> @param mcnl Monte Carlo name list structure
+!> @param EBSDMCdata MC data
+!> @param cache detector cache structure
+!> @param EBSDdetector detector arrays
+!> @param hit (optional) returns .TRUE. if the energy weights were taken from the cache
+!--------------------------------------------------------------------------
+recursive subroutine GetCachedEBSDDetector(enl, mcnl, EBSDMCdata, cache, EBSDdetector, hit)
+!DEC$ ATTRIBUTES DLLEXPORT :: GetCachedEBSDDetector
+
+use local
+use typedefs
+use NameListTypedefs
+
+IMPLICIT NONE
+
+type(EBSDNameListType),INTENT(IN)       :: enl
+type(MCCLNameListType),INTENT(INOUT)    :: mcnl
+!f2py intent(in,out) ::  mcnl
+type(EBSDMCdataType),INTENT(INOUT)      :: EBSDMCdata
+!f2py intent(in,out) ::  EBSDMCdata
+type(EBSDDetectorCacheType),INTENT(INOUT)  :: cache
+!f2py intent(in,out) ::  cache
+type(EBSDDetectorType),INTENT(INOUT)    :: EBSDdetector
+!f2py intent(in,out) ::  EBSDdetector
+logical,INTENT(OUT),OPTIONAL            :: hit
+
+type(EBSDNameListType)                  :: qenl
+integer(kind=irg)                       :: key(3), i, islot
+logical                                 :: found
+
+qenl = enl
+
+! no quantization requested, so simply generate the full detector
+if ((cache%qpc.le.0.0).or.(cache%nslots.eq.0)) then
+  call GenerateEBSDDetector(qenl, mcnl, EBSDMCdata, EBSDdetector, verbose=.FALSE.)
+  if (present(hit)) hit = .FALSE.
+  return
+end if
+
+key = (/ nint(enl%xpc/cache%qpc), nint(enl%ypc/cache%qpc), nint(enl%L/(cache%qpc*enl%delta)) /)
+cache%tick = cache%tick + 1
+
+found = .FALSE.
+do i=1,cache%nused
+  if (all(cache%key(1:3,i).eq.key)) then
+    found = .TRUE.
+    islot = i
+    EXIT
+  end if
+end do
+
+if (found.eqv..TRUE.) then
+  EBSDdetector%accum_e_detector = cache%accum(:,:,:,islot)
+else
+! generate the detector at the quantized pattern center and store its energy weights
+! in an empty slot or in place of the least recently used one
+  qenl%xpc = key(1) * cache%qpc
+  qenl%ypc = key(2) * cache%qpc
+  qenl%L = key(3) * cache%qpc * enl%delta
+  call GenerateEBSDDetector(qenl, mcnl, EBSDMCdata, EBSDdetector, verbose=.FALSE.)
+  if (cache%nused.lt.cache%nslots) then
+    cache%nused = cache%nused + 1
+    islot = cache%nused
+  else
+    islot = minloc(cache%age, 1)
+  end if
+  cache%key(1:3,islot) = key
+  cache%accum(:,:,:,islot) = EBSDdetector%accum_e_detector
+end if
+cache%age(islot) = cache%tick
+
+! the direction cosines for the actual pattern center
+call EBSDDetectorDirectionCosines(enl, mcnl, EBSDdetector%rgx, EBSDdetector%rgy, EBSDdetector%rgz)
+
+if (present(hit)) hit = found
+
+end subroutine GetCachedEBSDDetector
+
 
 !--------------------------------------------------------------------------
 !
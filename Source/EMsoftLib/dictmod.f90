@@ -112,15 +112,23 @@ use math
 IMPLICIT NONE
 
 public  :: DI_Init, DI_EMforDD, DD_Density, DI_Similarity_Classifier, DI_SampleDD, getDisorientationAngle, &
-           ReduceOrientationtoRFZ
+           ReduceOrientationtoRFZ, getDisorientationAngles
 private :: DD_Estep, DD_Mstep, DD_getQandL, CardIntersection, randDDMarginal, randUniformSphere, &
-           getDDDensityLBM,  VMFMeanDirDensity, WatsonMeanDirDensity, DI_RotateToMu, logCp 
+           getDDDensityLBM,  VMFMeanDirDensity, WatsonMeanDirDensity, DI_RotateToMu, logCp, getDisorientationBlock
+
+! number of orientation pairs handled per block in the batched disorientation routines
+integer(kind=irg),parameter,private :: DisBlockSize = 256
 
 interface getDisorientationAngle
         module procedure getDisorientationAngleSingle
         module procedure getDisorientationAngleDouble
 end interface
 
+interface getDisorientationAngles
+        module procedure getDisorientationAnglesSingle
+        module procedure getDisorientationAnglesDouble
+end interface
+
 interface getAverageDisorientationMap
         module procedure getAverageDisorientationMapSingle
         module procedure getAverageDisorientationMapDouble
@@ -1572,6 +1580,12 @@ if (a.ne.0.D0) then
   if (Mu(1).lt.0.D0) Mu=-Mu
   qu = eu2qu(eu2)
   if (qu(1).lt.0.D0) qu=-qu
+! if the axis is not needed, a single loop over the symmetry operators suffices
+  if (.not.present(ax)) then
+    call getDisorientationBlock(1, Mu, qu, dict%Pm(1:4,1:Pmdims), Pmdims, p(1:1))
+    disang = p(1)
+    return
+  end if
   ac = 1000.D0
   do j=1,Pmdims ! loop over the symmetric equivalents of Mu
     Mus =  quat_mult(dict%Pm(1:4,j),Mu)
@@ -1636,6 +1650,7 @@ real(kind=sgl),INTENT(OUT)              :: disang
 real(kind=dbl),OPTIONAL,INTENT(OUT)     :: ax(3)
 
 real(kind=sgl)                          :: Mu(4), qu(4), Mus(4), qus(4), p(4), ac, a
+real(kind=dbl)                          :: dd(1)
 integer(kind=irg)                       :: j, k, Pmdims
 
 disang = 0.0
@@ -1647,6 +1662,12 @@ if (a.ne.0.0) then
   if (Mu(1).lt.0.0) Mu=-Mu
   qu = eu2qu(eu2)
   if (qu(1).lt.0.0) qu=-qu
+! if the axis is not needed, a single loop over the symmetry operators suffices
+  if (.not.present(ax)) then
+    call getDisorientationBlock(1, dble(Mu), dble(qu), dict%Pm(1:4,1:Pmdims), Pmdims, dd)
+    disang = sngl(dd(1))
+    return
+  end if
   ac = 1000.0
   do j=1,Pmdims ! loop over the symmetric equivalents of Mu
     Mus =  quat_mult(sngl(dict%Pm(1:4,j)),Mu)
@@ -1814,6 +1835,163 @@ end if
 
 end subroutine getDisorientationAngleAxisTwoPhases
 
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: getDisorientationBlock
+!
+!> @brief disorientation angles (in radians) for a block of orientation pairs given as quaternions
+!
+!> @details The disorientation is the smallest rotation angle of S_j q1 (S_k q2)^* over all pairs 
+!> of symmetry operators (S_j, S_k).  Since the rotation angle does not change under conjugation 
+!> and the rotational part of the Laue group in dict%Pm is closed under multiplication, this is 
+!> identical to the smallest rotation angle of S_l m over a single loop of operators S_l, with
+!> m = q1 q2^* the misorientation quaternion.  Only the scalar part of S_l m is needed, so each 
+!> operator costs four multiplications per pair, and the acos is evaluated once per pair.
+!
+!> @param nb number of pairs in the block
+!> @param q1 first orientation of each pair
+!> @param q2 second orientation of each pair
+!> @param Pm symmetry operators
+!> @param Pmdims number of symmetry operators
+!> @param disang output disorientation angles
+!--------------------------------------------------------------------------
+recursive subroutine getDisorientationBlock(nb, q1, q2, Pm, Pmdims, disang)
+!DEC$ ATTRIBUTES DLLEXPORT :: getDisorientationBlock
+
+use local
+use constants
+
+IMPLICIT NONE
+
+integer(kind=irg),INTENT(IN)            :: nb
+real(kind=dbl),INTENT(IN)               :: q1(4,nb)
+real(kind=dbl),INTENT(IN)               :: q2(4,nb)
+integer(kind=irg),INTENT(IN)            :: Pmdims
+real(kind=dbl),INTENT(IN)               :: Pm(4,Pmdims)
+real(kind=dbl),INTENT(OUT)              :: disang(nb)
+
+real(kind=dbl)                          :: m0(nb), m1(nb), m2(nb), m3(nb), cmax(nb), mnorm
+integer(kind=irg)                       :: i, k
+
+! misorientation quaternion m = q1 * conjg(q2), written out to allow vectorization
+!$OMP SIMD
+do i=1,nb
+  m0(i) = q1(1,i)*q2(1,i) + q1(2,i)*q2(2,i) + q1(3,i)*q2(3,i) + q1(4,i)*q2(4,i)
+  m1(i) = q1(2,i)*q2(1,i) - q1(1,i)*q2(2,i) + epsijkd * ( q1(4,i)*q2(3,i) - q1(3,i)*q2(4,i) )
+  m2(i) = q1(3,i)*q2(1,i) - q1(1,i)*q2(3,i) + epsijkd * ( q1(2,i)*q2(4,i) - q1(4,i)*q2(2,i) )
+  m3(i) = q1(4,i)*q2(1,i) - q1(1,i)*q2(4,i) + epsijkd * ( q1(3,i)*q2(2,i) - q1(2,i)*q2(3,i) )
+  cmax(i) = 0.D0
+end do
+
+! largest |scalar part| of S_l * m over all symmetry operators
+do k=1,Pmdims
+!$OMP SIMD
+  do i=1,nb
+    cmax(i) = max( cmax(i), abs( Pm(1,k)*m0(i) - Pm(2,k)*m1(i) - Pm(3,k)*m2(i) - Pm(4,k)*m3(i) ) )
+  end do
+end do
+
+! dividing by the norm of m removes the effect of rounding errors in the input quaternions, 
+! so that identical orientations result in a zero angle
+!$OMP SIMD PRIVATE(mnorm)
+do i=1,nb
+  mnorm = sqrt( m0(i)**2 + m1(i)**2 + m2(i)**2 + m3(i)**2 )
+  disang(i) = 2.D0 * acos( min(cmax(i)/mnorm, 1.D0) )
+end do
+
+end subroutine getDisorientationBlock
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: getDisorientationAnglesDouble
+!
+!> @brief Determine the disorientation angles for an array of orientation pairs (in radians)
+!
+!> @details The pairs are processed in blocks of DisBlockSize; the blocks are distributed over
+!> the available OpenMP threads when the array is large enough.
+!
+!> @param n number of orientation pairs
+!> @param qu1 first orientation of each pair (quaternions)
+!> @param qu2 second orientation of each pair (quaternions)
+!> @param dict dict structure
+!> @param disang output disorientation angles
+!--------------------------------------------------------------------------
+recursive subroutine getDisorientationAnglesDouble(n, qu1, qu2, dict, disang)
+!DEC$ ATTRIBUTES DLLEXPORT :: getDisorientationAnglesDouble
+
+use local
+use typedefs
+
+IMPLICIT NONE
+
+integer(kind=irg),INTENT(IN)            :: n
+real(kind=dbl),INTENT(IN)               :: qu1(4,n)
+real(kind=dbl),INTENT(IN)               :: qu2(4,n)
+type(dicttype),INTENT(IN)               :: dict
+real(kind=dbl),INTENT(OUT)              :: disang(n)
+
+integer(kind=irg)                       :: ib, i1, i2, Pmdims
+
+Pmdims = dict%Nqsym
+
+!$OMP PARALLEL DO DEFAULT(SHARED) PRIVATE(ib,i1,i2) SCHEDULE(STATIC) IF(n.gt.4*DisBlockSize)
+do ib=1,n,DisBlockSize
+  i1 = ib
+  i2 = min(ib+DisBlockSize-1, n)
+  call getDisorientationBlock(i2-i1+1, qu1(1:4,i1:i2), qu2(1:4,i1:i2), dict%Pm(1:4,1:Pmdims), &
+                              Pmdims, disang(i1:i2))
+end do
+!$OMP END PARALLEL DO
+
+end subroutine getDisorientationAnglesDouble
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: getDisorientationAnglesSingle
+!
+!> @brief Determine the disorientation angles for an array of orientation pairs (in radians, single precision)
+!
+!> @details The computation itself is carried out in double precision, one block at a time.
+!
+!> @param n number of orientation pairs
+!> @param qu1 first orientation of each pair (quaternions)
+!> @param qu2 second orientation of each pair (quaternions)
+!> @param dict dict structure
+!> @param disang output disorientation angles
+!--------------------------------------------------------------------------
+recursive subroutine getDisorientationAnglesSingle(n, qu1, qu2, dict, disang)
+!DEC$ ATTRIBUTES DLLEXPORT :: getDisorientationAnglesSingle
+
+use local
+use typedefs
+
+IMPLICIT NONE
+
+integer(kind=irg),INTENT(IN)            :: n
+real(kind=sgl),INTENT(IN)               :: qu1(4,n)
+real(kind=sgl),INTENT(IN)               :: qu2(4,n)
+type(dicttype),INTENT(IN)               :: dict
+real(kind=sgl),INTENT(OUT)              :: disang(n)
+
+real(kind=dbl)                          :: q1(4,DisBlockSize), q2(4,DisBlockSize), d(DisBlockSize)
+integer(kind=irg)                       :: ib, i1, i2, nb, Pmdims
+
+Pmdims = dict%Nqsym
+
+!$OMP PARALLEL DO DEFAULT(SHARED) PRIVATE(ib,i1,i2,nb,q1,q2,d) SCHEDULE(STATIC) IF(n.gt.4*DisBlockSize)
+do ib=1,n,DisBlockSize
+  i1 = ib
+  i2 = min(ib+DisBlockSize-1, n)
+  nb = i2-i1+1
+  q1(1:4,1:nb) = dble(qu1(1:4,i1:i2))
+  q2(1:4,1:nb) = dble(qu2(1:4,i1:i2))
+  call getDisorientationBlock(nb, q1(1:4,1:nb), q2(1:4,1:nb), dict%Pm(1:4,1:Pmdims), Pmdims, d(1:nb))
+  disang(i1:i2) = sngl(d(1:nb))
+end do
+!$OMP END PARALLEL DO
+
+end subroutine getDisorientationAnglesSingle
+
 !--------------------------------------------------------------------------
 !
 ! SUBROUTINE: getAverageDisorientationMapSingle
@@ -1847,12 +2025,13 @@ type(dicttype),INTENT(INOUT)            :: dict
 !f2py intent(in,out) ::  dict
 real(kind=sgl),INTENT(OUT)              :: ADMap(wd,ht)
 
-integer(kind=irg)                       :: i, j, ic, icr, ict
-real(kind=sgl)                          :: misor(4,wd,ht), denom(wd, ht), disang
+integer(kind=irg)                       :: i, j, ic, n
+real(kind=sgl)                          :: denom(wd, ht)
+real(kind=sgl),allocatable              :: qu(:,:), dh(:), dv(:)
 
+n = wd*ht
 ADMap = 0.0
 denom = 4.0
-misor = 0.0   ! contains four misorientation angles in the order r, t, l, b 
 
 !edges
 denom(2:wd-1,1) = 3.0
@@ -1865,31 +2044,40 @@ denom(1,ht) = 2.0
 denom(wd,1) = 2.0
 denom(wd,ht) = 2.0
 
-! we'll do this line by line (horizontally)
+! convert the orientations to quaternions once; the disorientations with the right and top 
+! neighbors of all pixels are then obtained from two calls to the batched routine
+allocate(qu(4,n), dh(n), dv(n))
+!$OMP PARALLEL DO DEFAULT(SHARED) PRIVATE(ic)
+do ic=1,n
+  qu(1:4,ic) = eu2qu(eulers(1:3,ic))
+end do
+!$OMP END PARALLEL DO
+dh = 0.0
+dv = 0.0
+if (n.gt.1) call getDisorientationAnglesSingle(n-1, qu(1:4,1:n-1), qu(1:4,2:n), dict, dh(1:n-1))
+if (ht.gt.1) call getDisorientationAnglesSingle(n-wd, qu(1:4,1:n-wd), qu(1:4,wd+1:n), dict, dv(1:n-wd))
+
 do j=1,ht
   do i=1,wd
     ic = wd*(j-1)+i
-    icr = wd*(j-1)+i+1
-    ict = wd*j + i
 
 ! right neighbor (also includes left one)
     if (i.lt.wd) then 
-      call getDisorientationAngleSingle(eulers(1:3,ic), eulers(1:3,icr), dict, disang)
-      misor(1,i,j) = disang
-      misor(3,i+1,j) = disang
+      ADMap(i,j) = ADMap(i,j) + dh(ic)
+      ADMap(i+1,j) = ADMap(i+1,j) + dh(ic)
     end if
 
 ! top neighbor
     if (j.lt.ht) then
-      call getDisorientationAngleSingle(eulers(1:3,ic), eulers(1:3,ict), dict, disang)
-      misor(2,i,j) = disang
-      misor(4,i,j+1) = disang
+      ADMap(i,j) = ADMap(i,j) + dv(ic)
+      ADMap(i,j+1) = ADMap(i,j+1) + dv(ic)
     end if
   end do 
 end do 
+deallocate(qu, dh, dv)
 
 ! then take the average
-ADMap = sum(misor,1)/denom
+ADMap = ADMap/denom
 
 ! and convert to degrees
 ADMap = ADMap * 180.0/sngl(cPi)
@@ -1929,12 +2117,13 @@ type(dicttype),INTENT(INOUT)            :: dict
 !f2py intent(in,out) ::  dict
 real(kind=dbl),INTENT(OUT)              :: ADMap(wd,ht)
 
-integer(kind=irg)                       :: i, j, ic, icr, ict
-real(kind=dbl)                          :: misor(4,wd,ht), denom(wd, ht), disang
+integer(kind=irg)                       :: i, j, ic, n
+real(kind=dbl)                          :: denom(wd, ht)
+real(kind=dbl),allocatable              :: qu(:,:), dh(:), dv(:)
 
+n = wd*ht
 ADMap = 0.D0
 denom = 4.D0
-misor = 0.D0   ! contains four misorientation angles in the order r, t, l, b 
 
 !edges
 denom(2:wd-1,1) = 3.D0
@@ -1947,31 +2136,40 @@ denom(1,ht) = 2.D0
 denom(wd,1) = 2.D0
 denom(wd,ht) = 2.D0
 
-! we'll do this line by line (horizontally)
+! convert the orientations to quaternions once; the disorientations with the right and top 
+! neighbors of all pixels are then obtained from two calls to the batched routine
+allocate(qu(4,n), dh(n), dv(n))
+!$OMP PARALLEL DO DEFAULT(SHARED) PRIVATE(ic)
+do ic=1,n
+  qu(1:4,ic) = eu2qu(eulers(1:3,ic))
+end do
+!$OMP END PARALLEL DO
+dh = 0.D0
+dv = 0.D0
+if (n.gt.1) call getDisorientationAnglesDouble(n-1, qu(1:4,1:n-1), qu(1:4,2:n), dict, dh(1:n-1))
+if (ht.gt.1) call getDisorientationAnglesDouble(n-wd, qu(1:4,1:n-wd), qu(1:4,wd+1:n), dict, dv(1:n-wd))
+
 do j=1,ht
   do i=1,wd
     ic = wd*(j-1)+i
-    icr = wd*(j-1)+i+1
-    ict = wd*j + i
 
 ! right neighbor (also includes left one)
     if (i.lt.wd) then 
-      call getDisorientationAngleDouble(eulers(1:3,ic), eulers(1:3,icr), dict, disang)
-      misor(1,i,j) = disang
-      misor(3,i+1,j) = disang
+      ADMap(i,j) = ADMap(i,j) + dh(ic)
+      ADMap(i+1,j) = ADMap(i+1,j) + dh(ic)
     end if
 
 ! top neighbor
     if (j.lt.ht) then
-      call getDisorientationAngleDouble(eulers(1:3,ic), eulers(1:3,ict), dict, disang)
-      misor(2,i,j) = disang
-      misor(4,i,j+1) = disang
+      ADMap(i,j) = ADMap(i,j) + dv(ic)
+      ADMap(i,j+1) = ADMap(i,j+1) + dv(ic)
     end if
   end do 
 end do 
+deallocate(qu, dh, dv)
 
 ! then take the average
-ADMap = sum(misor,1)/denom
+ADMap = ADMap/denom
 
 ! and convert to degrees
 ADMap = ADMap * 180.D0/cPi
@@ -262,6 +262,7 @@ integer(kind=irg)                       :: hkl(3), io_int(1)
 
 ! which scattering factors should be used ?
   if (present(skip)) then
+   rlp%absorption = .FALSE.
    select case (skip) 
     case(1); rlp%method='DT'; 
     case(2); rlp%method='WK'; 
@@ -602,79 +602,80 @@ end function adhisteq
 !
 !> @brief  compute Average Dot Product map, reading patterns from file unit iunit (expected to be open already)
 !
+!> @details The patterns are read row by row into a buffer of radius+1 rows, so that each pattern 
+!> is read only once; the dot products for each row are computed in parallel, and the map is 
+!> assembled by the neighborhood module.
+!
 !> @param iunit input file unit
 !> @param nexpt number of experimental patterns
 !> @param L number of pixels per pattern
 !> @param wd ROI-width
 !> @param ht ROI-ht
 !> @param dpmap output ADP map
+!> @param nbtype (optional) neighborhood type (4 or 8, default 4)
+!> @param radius (optional) neighborhood radius (default 1)
 !
 !> @date 01/09/18 MDG 1.0 original
 !--------------------------------------------------------------------------
-recursive subroutine getADPmap(iunit, nexpt, L, wd, ht, dpmap)
+recursive subroutine getADPmap(iunit, nexpt, L, wd, ht, dpmap, nbtype, radius)
 !DEC$ ATTRIBUTES DLLEXPORT :: getADPmap
 
+use neighborhood
+
 integer(kind=irg),INTENT(IN)        :: iunit
 integer(kind=irg),INTENT(IN)        :: nexpt
 integer(kind=irg),INTENT(IN)        :: L
 integer(kind=irg),INTENT(IN)        :: wd
 integer(kind=irg),INTENT(IN)        :: ht
 real(kind=sgl),INTENT(OUT)          :: dpmap(nexpt)
-
-integer(kind=irg)                   :: ii, iii, jj
-real(kind=sgl)                      :: lstore(L,wd), pstore(L,wd), lp(L), cp(L), imageexpt(L), dp
-
-dpmap= 0.0
-pstore = 0.0
-lstore = 0.0
-lp = 0.0
-cp = 0.0
-
-do iii = 1,nexpt
-    read(iunit,rec=iii) imageexpt
-    ii = mod(iii,wd)
-    if (ii.eq.0) ii = wd
-    jj = iii/wd+1
-! do we need to copy pstore into lstore ?
-    if ((ii.eq.1).and.(jj.gt.1)) lstore = pstore
-! determine to which dpmap entries we need to add the dot product
-    if (ii.eq.1) then
-      cp(1:L) = imageexpt(1:L)
-      pstore(1:L,ii) = cp(1:L)
-    else
-      lp = cp
-      cp(1:L) = imageexpt(1:L)
-      pstore(1:L,ii) = cp(1:L)
-      dp = sum(lp(1:L)*cp(1:L))
-      dpmap(iii-1) = dpmap(iii-1) + dp
-      dpmap(iii) = dpmap(iii) + dp
-    end if
-    if (jj.gt.1) then
-      dp = sum(lstore(1:L,ii)*cp(1:L))
-      dpmap(iii-wd+1) = dpmap(iii-wd+1) + dp
-      dpmap(iii) = dpmap(iii) + dp
-    end if
+integer(kind=irg),INTENT(IN),OPTIONAL :: nbtype
+integer(kind=irg),INTENT(IN),OPTIONAL :: radius
+
+type(NeighborhoodType)              :: nb
+real(kind=sgl),allocatable          :: rows(:,:,:), pv(:,:)
+integer(kind=irg)                   :: i, j, jr, k, p, q, nr, ntype, rad
+
+ntype = 4
+if (present(nbtype)) ntype = nbtype
+rad = 1
+if (present(radius)) rad = radius
+call NB_Init(nb, wd, ht, ntype, rad)
+
+! row jr of the map is kept in slot mod(jr-1,nr)+1 of the row buffer
+nr = rad+1
+allocate(rows(L,wd,nr), pv(wd*ht,nb%noff))
+pv = 0.0
+dpmap = 0.0
+
+do jr=1,min(nr,ht)
+  do i=1,wd
+    read(iunit,rec=wd*(jr-1)+i) rows(1:L,i,mod(jr-1,nr)+1)
+  end do
 end do
 
-! correct the dot product map values depending on inside, edge, or corner pixels
-! divide by 4
-dpmap = dpmap*0.25
-
-! correct the straight segments
-dpmap(2:wd-1) = dpmap(2:wd-1) * 4.0/3.0
-dpmap(nexpt-wd+2:nexpt-1) = dpmap(nexpt-wd+2:nexpt-1) * 4.0/3.0
-do jj=1,ht-2
-  dpmap(wd*jj+1) = dpmap(wd*jj+1) * 4.0/3.0
-end do
-do jj=2,ht-1
-  dpmap(wd*jj) = dpmap(wd*jj) * 4.0/3.0
+do j=1,ht
+! all partners of the pixels in row j lie in rows j..j+radius, which are in the buffer
+!$OMP PARALLEL DO DEFAULT(SHARED) PRIVATE(i,k,p,q)
+  do i=1,wd
+    p = wd*(j-1)+i
+    do k=1,nb%noff
+      q = NB_Partner(nb, k, i, j)
+      if (q.ne.0) pv(p,k) = sum( rows(1:L,i,mod(j-1,nr)+1) * rows(1:L,i+nb%dx(k),mod(j+nb%dy(k)-1,nr)+1) )
+    end do
+  end do
+!$OMP END PARALLEL DO
+! row j is no longer needed, so its slot receives row j+nr
+  jr = j+nr
+  if (jr.le.ht) then
+    do i=1,wd
+      read(iunit,rec=wd*(jr-1)+i) rows(1:L,i,mod(jr-1,nr)+1)
+    end do
+  end if
 end do
 
-! and the corners
-dpmap(1) = dpmap(1) * 4.0
-dpmap(wd) = dpmap(wd) * 2.0
-dpmap(nexpt) = dpmap(nexpt) * 2.0
-dpmap(nexpt-wd+1) = dpmap(nexpt-wd+1) * 4.0/3.0
+call NB_Gather(nb, pv, dpmap)
+
+deallocate(rows, pv)
 
 end subroutine getADPmap
 
@@ -684,7 +685,7 @@ end subroutine getADPmap
 !
 !> @author Marc De Graef, Carnegie Mellon University
 !
-!> @brief  compute Average Dot Product map, reading patterns from file unit iunit
+!> @brief  compute Average Dot Product map for patterns that are held in memory
 !
 !> @param epatterns experimental patterns after preprocessing (held in RAM!)
 !> @param nexpt number of experimental patterns
@@ -692,12 +693,16 @@ end subroutine getADPmap
 !> @param wd ROI-width
 !> @param ht ROI-ht
 !> @param dpmap output ADP map
+!> @param nbtype (optional) neighborhood type (4 or 8, default 4)
+!> @param radius (optional) neighborhood radius (default 1)
 !
 !> @date 01/09/18 MDG 1.0 original
 !--------------------------------------------------------------------------
-recursive subroutine getADPmapRAM(epatterns, nexpt, cs, L, wd, ht, dpmap)
+recursive subroutine getADPmapRAM(epatterns, nexpt, cs, L, wd, ht, dpmap, nbtype, radius)
 !DEC$ ATTRIBUTES DLLEXPORT :: getADPmapRAM
 
+use neighborhood
+
 integer(kind=irg),INTENT(IN)        :: nexpt
 integer(kind=irg),INTENT(IN)        :: cs
 real(kind=sgl),INTENT(IN)           :: epatterns(cs,nexpt)
@@ -705,61 +710,39 @@ integer(kind=irg),INTENT(IN)        :: L
 integer(kind=irg),INTENT(IN)        :: wd
 integer(kind=irg),INTENT(IN)        :: ht
 real(kind=sgl),INTENT(OUT)          :: dpmap(nexpt)
-
-integer(kind=irg)                   :: ii, iii, jj
-real(kind=sgl)                      :: lstore(L,wd), pstore(L,wd), lp(L), cp(L), imageexpt(L), dp
-
-dpmap= 0.0
-pstore = 0.0
-lstore = 0.0
-lp = 0.0
-cp = 0.0
-
-do iii = 1,nexpt
-    imageexpt = epatterns(1:L,iii)
-    ii = mod(iii,wd)
-    if (ii.eq.0) ii = wd
-    jj = iii/wd+1
-! do we need to copy pstore into lstore ?
-    if ((ii.eq.1).and.(jj.gt.1)) lstore = pstore
-! determine to which dpmap entries we need to add the dot product
-    if (ii.eq.1) then
-      cp(1:L) = imageexpt(1:L)
-      pstore(1:L,ii) = cp(1:L)
-    else
-      lp = cp
-      cp(1:L) = imageexpt(1:L)
-      pstore(1:L,ii) = cp(1:L)
-      dp = sum(lp(1:L)*cp(1:L))
-      dpmap(iii-1) = dpmap(iii-1) + dp
-      dpmap(iii) = dpmap(iii) + dp
-    end if
-    if (jj.gt.1) then
-      dp = sum(lstore(1:L,ii)*cp(1:L))
-      dpmap(iii-wd+1) = dpmap(iii-wd+1) + dp
-      dpmap(iii) = dpmap(iii) + dp
-    end if
+integer(kind=irg),INTENT(IN),OPTIONAL :: nbtype
+integer(kind=irg),INTENT(IN),OPTIONAL :: radius
+
+type(NeighborhoodType)              :: nb
+real(kind=sgl),allocatable          :: pv(:,:)
+integer(kind=irg)                   :: i, j, k, p, q, ntype, rad
+
+ntype = 4
+if (present(nbtype)) ntype = nbtype
+rad = 1
+if (present(radius)) rad = radius
+call NB_Init(nb, wd, ht, ntype, rad)
+
+allocate(pv(wd*ht,nb%noff))
+pv = 0.0
+dpmap = 0.0
+
+! all patterns are available, so the rows can be processed in parallel
+!$OMP PARALLEL DO DEFAULT(SHARED) PRIVATE(i,j,k,p,q) SCHEDULE(DYNAMIC)
+do j=1,ht
+  do i=1,wd
+    p = wd*(j-1)+i
+    do k=1,nb%noff
+      q = NB_Partner(nb, k, i, j)
+      if (q.ne.0) pv(p,k) = sum( epatterns(1:L,p) * epatterns(1:L,q) )
+    end do
+  end do
 end do
+!$OMP END PARALLEL DO
 
-! correct the dot product map values depending on inside, edge, or corner pixels
-! divide by 4
-dpmap = dpmap*0.25
-
-! correct the straight segments
-dpmap(2:wd-1) = dpmap(2:wd-1) * 4.0/3.0
-dpmap(nexpt-wd+2:nexpt-1) = dpmap(nexpt-wd+2:nexpt-1) * 4.0/3.0
-do jj=1,ht-2
-  dpmap(wd*jj+1) = dpmap(wd*jj+1) * 4.0/3.0
-end do
-do jj=2,ht-1
-  dpmap(wd*jj) = dpmap(wd*jj) * 4.0/3.0
-end do
+call NB_Gather(nb, pv, dpmap)
 
-! and the corners
-dpmap(1) = dpmap(1) * 4.0
-dpmap(wd) = dpmap(wd) * 2.0
-dpmap(nexpt) = dpmap(nexpt) * 2.0
-dpmap(nexpt-wd+1) = dpmap(nexpt-wd+1) * 4.0/3.0
+deallocate(pv)
 
 end subroutine getADPmapRAM
 
@@ -1424,14 +1407,11 @@ complex(C_DOUBLE_COMPLEX),pointer,INTENT(INOUT) :: inp(:,:), outp(:,:)
 type(C_PTR),INTENT(IN)                  :: planf, planb
 real(kind=dbl)                          :: fdata(dims(1),dims(2))
 integer(kind=irg)                       :: j, k
-complex(kind=dbl)                       :: hpmask_complex(dims(1),dims(2)), lpmask_complex(dims(1),dims(2))
 
 ! apply the hi-pass mask to rdata
 do j=1,dims(1)
  do k=1,dims(2)
   inp(j,k) = cmplx(rdata(j,k),0.D0)    
-  hpmask_complex(j,k) = cmplx(hpmask(j,k),0.D0)    
-  lpmask_complex(j,k) = cmplx(lpmask(j,k),0.D0) 
  end do
 end do
 
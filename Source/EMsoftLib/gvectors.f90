@@ -762,6 +762,116 @@ deallocate(glist, rh)
 
 end subroutine Apply_BethePotentials
 
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: Apply_BethePotentialsTable
+!
+!> @brief tag weak and strong reflections in a contiguous reflection table
+!
+!> @param cell unit cell pointer
+!> @param reftab reflection table, after a call to Update_ReflectionTable
+!> @param BetheParameter Bethe Potential parameter structure
+!> @param nns number of strong reflections
+!> @param nnw number of weak reflections
+!
+!> @details Same classification as Apply_BethePotentials, but the strong and weak reflections
+!> are returned as the index lists reftab%strong and reftab%weak, in list order. The minimum 
+!> over h of |sg|/|U_{g-h}| is obtained as |sg| divided by the maximum of |U_{g-h}|, so that
+!> the inner loop is a simple gather/max over the retained reflections.
+!--------------------------------------------------------------------------
+recursive subroutine Apply_BethePotentialsTable(cell, reftab, BetheParameter, nns, nnw)
+!DEC$ ATTRIBUTES DLLEXPORT :: Apply_BethePotentialsTable
+
+IMPLICIT NONE
+
+type(unitcell)                                 :: cell
+type(ReflectionTableType),INTENT(INOUT)        :: reftab
+type(BetheParameterType),INTENT(IN)            :: BetheParameter
+integer(kind=irg),INTENT(OUT)                  :: nns
+integer(kind=irg),INTENT(OUT)                  :: nnw
+
+integer(kind=irg)                              :: ir, ih, ig, gmh(3)
+real(kind=dbl)                                 :: la, m, Umax
+logical                                        :: dbd
+
+la = 1.D0/cell%mLambda
+
+! the first reflection is always strong
+nns = 1
+nnw = 0
+reftab%strong(1) = reftab%ref(1)
+
+irloop: do ir = 2,reftab%nref
+  ig = reftab%ref(ir)
+  Umax = 0.D0
+  dbd = .FALSE.
+  do ih = 1,reftab%nref
+    gmh(1:3) = reftab%hkl(1:3,ig) - reftab%hkl(1:3,reftab%ref(ih))
+    if (cell%dbdiff(gmh(1),gmh(2),gmh(3))) then  ! double diffraction reflection with |U|=0
+      dbd = .TRUE.
+    else
+      Umax = max(Umax, abs( cell%LUT(gmh(1), gmh(2), gmh(3)) ))
+    end if
+  end do
+
+! double diffraction differences contribute a fixed value of 10000 to the minimum
+  if (Umax.gt.0.D0) then
+    m = la * abs(reftab%sg(ig)) / Umax
+    if (dbd) m = min(m, 10000.D0)
+  else
+    m = 10000.D0
+  end if
+
+! m > c2 => ignore this reflection
+  if (m.gt.BetheParameter%c2) CYCLE irloop
+
+! c1 < m < c2 => weak reflection
+  if (BetheParameter%c1.lt.m) then
+    nnw = nnw + 1
+    reftab%weak(nnw) = ig
+  else
+! m < c1 => strong
+    nns = nns + 1
+    reftab%strong(nns) = ig
+  end if
+end do irloop
+
+reftab%nns = nns
+reftab%nnw = nnw
+
+end subroutine Apply_BethePotentialsTable
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: Delete_ReflectionTable
+!
+!> @brief release all arrays of a contiguous reflection table
+!
+!> @param reftab reflection table
+!--------------------------------------------------------------------------
+recursive subroutine Delete_ReflectionTable(reftab)
+!DEC$ ATTRIBUTES DLLEXPORT :: Delete_ReflectionTable
+
+IMPLICIT NONE
+
+type(ReflectionTableType),INTENT(INOUT)        :: reftab
+
+if (allocated(reftab%hkl)) deallocate(reftab%hkl)
+if (allocated(reftab%gx)) deallocate(reftab%gx, reftab%gy, reftab%gz, reftab%gg)
+if (allocated(reftab%rUg)) deallocate(reftab%rUg)
+if (allocated(reftab%sg)) deallocate(reftab%sg)
+if (allocated(reftab%dbdiff)) deallocate(reftab%dbdiff)
+if (allocated(reftab%ref)) deallocate(reftab%ref)
+if (allocated(reftab%strong)) deallocate(reftab%strong)
+if (allocated(reftab%weak)) deallocate(reftab%weak)
+reftab%ncand = 0
+reftab%nref = 0
+reftab%nns = 0
+reftab%nnw = 0
+
+end subroutine Delete_ReflectionTable
+
+
 
 !--------------------------------------------------------------------------
 !
@@ -166,6 +166,182 @@ izl:   do iz=-iml,iml
 
 end subroutine Initialize_ReflectionList
 
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: Initialize_ReflectionTable
+!
+!> @brief determine the candidate reflections for the contiguous reflection table
+!
+!> @details The candidate set consists of all reflections in the LUT range that are allowed
+!> by the lattice centering and have a d-spacing larger than dmin, in the same order as the 
+!> linked list generated by Initialize_ReflectionList, with 000 as the first entry.  None 
+!> of these quantities depend on the beam direction, so this routine is called only once per 
+!> thread, before the beam direction loop (but after the LUT has been computed for the 
+!> current energy).  The per-direction selection is then done by Update_ReflectionTable.
+!
+!> @param cell unit cell pointer
+!> @param reftab reflection table
+!> @param dmin smallest lattice d-spacing to consider
+!> @param verbose (optional) used for debugging purposes mostly
+!--------------------------------------------------------------------------
+recursive subroutine Initialize_ReflectionTable(cell, reftab, dmin, verbose)
+!DEC$ ATTRIBUTES DLLEXPORT :: Initialize_ReflectionTable
+
+use local
+use typedefs
+use io
+use crystal
+use gvectors
+use symmetry
+
+IMPLICIT NONE
+
+type(unitcell)                                  :: cell
+type(ReflectionTableType),INTENT(INOUT)         :: reftab
+real(kind=sgl),INTENT(IN)                       :: dmin
+logical,INTENT(IN),OPTIONAL                     :: verbose
+
+integer(kind=irg)                               :: imh, imk, iml, gg(3), ix, iy, iz, gp(3), ipass, nc, io_int(1)
+real(kind=dbl)                                  :: gr(3), Ugm
+
+  call Delete_ReflectionTable(reftab)
+
+! get the size of the lookup table
+  gp = shape(cell%LUT)
+  imh = (gp(1)-1)/4
+  imk = (gp(2)-1)/4
+  iml = (gp(3)-1)/4
+
+! first pass counts the candidates, second pass fills the arrays
+  do ipass = 1,2
+    nc = 1
+    if (ipass.eq.2) then
+      reftab%hkl(1:3,1) = (/ 0, 0, 0 /)
+      reftab%dbdiff(1) = .FALSE.
+    end if
+    do ix=-imh,imh
+     do iy=-imk,imk
+      do iz=-iml,iml
+        if ((abs(ix)+abs(iy)+abs(iz)).ne.0) then 
+         gg = (/ ix, iy, iz /)
+         if ((IsGAllowed(cell,gg)).and.(1.0/CalcLength(cell, float(gg), 'r').gt.dmin)) then
+           nc = nc + 1
+           if (ipass.eq.2) then
+             reftab%hkl(1:3,nc) = gg
+             reftab%dbdiff(nc) = cell%dbdiff(ix, iy, iz)
+           end if
+         end if
+        end if
+      end do
+     end do
+    end do
+    if (ipass.eq.1) then
+      reftab%ncand = nc
+      allocate(reftab%hkl(3,nc), reftab%gx(nc), reftab%gy(nc), reftab%gz(nc), reftab%gg(nc), reftab%rUg(nc), &
+               reftab%sg(nc), reftab%dbdiff(nc), reftab%ref(nc), reftab%strong(nc), reftab%weak(nc))
+    end if
+  end do
+
+! the energy-dependent part: rmt.g for the excitation errors and 1/|Ug| for the Bethe cutoff
+  do nc = 1,reftab%ncand
+    gr = dble(reftab%hkl(1:3,nc))
+    reftab%gx(nc) = sum(cell%rmt(1,1:3)*gr)
+    reftab%gy(nc) = sum(cell%rmt(2,1:3)*gr)
+    reftab%gz(nc) = sum(cell%rmt(3,1:3)*gr)
+    reftab%gg(nc) = reftab%gx(nc)*gr(1) + reftab%gy(nc)*gr(2) + reftab%gz(nc)*gr(3)
+    Ugm = abs(cell%LUT(reftab%hkl(1,nc), reftab%hkl(2,nc), reftab%hkl(3,nc)))
+    if (Ugm.gt.0.D0) then 
+      reftab%rUg(nc) = 1.D0/Ugm
+    else
+      reftab%rUg(nc) = huge(1.D0)
+    end if
+  end do
+  reftab%nref = 0
+  reftab%nns = 0
+  reftab%nnw = 0
+
+  if (present(verbose)) then 
+    if (verbose) then 
+      io_int(1) = reftab%ncand
+      call WriteValue(' Number of candidate reflections in table : ', io_int, 1, "(I8)")
+    end if
+  end if
+
+end subroutine Initialize_ReflectionTable
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: Update_ReflectionTable
+!
+!> @brief select the reflections of the table for a given wave vector
+!
+!> @details table equivalent of Initialize_ReflectionList; the excitation errors of all 
+!> candidates are computed in a single array pass (Ewald sphere equation with the precomputed 
+!> rmt.g components), after which the same Bethe cutoff criteria are applied.  Moving from one
+!> beam direction to the next therefore only costs a few dot products per candidate.
+!
+!> @param cell unit cell pointer
+!> @param reftab reflection table, initialized by Initialize_ReflectionTable
+!> @param BetheParameter Bethe potential structure
+!> @param FN  foil normal
+!> @param k wave vector in reciprocal frame
+!> @param nref number of retained reflections
+!--------------------------------------------------------------------------
+recursive subroutine Update_ReflectionTable(cell, reftab, BetheParameter, FN, k, nref)
+!DEC$ ATTRIBUTES DLLEXPORT :: Update_ReflectionTable
+
+use local
+use typedefs
+
+IMPLICIT NONE
+
+type(unitcell)                                  :: cell
+type(ReflectionTableType),INTENT(INOUT)         :: reftab
+type(BetheParameterType),INTENT(IN)             :: BetheParameter
+real(kind=sgl),INTENT(IN)                       :: FN(3)
+real(kind=sgl),INTENT(IN)                       :: k(3)
+integer(kind=irg),INTENT(OUT)                   :: nref
+
+integer(kind=irg)                               :: ic, nc
+real(kind=dbl)                                  :: kk(3), fn3(3), Gk(3), Gfn(3), kfn, rfnl, rBethe_i, rBethe_d, la
+
+  nc = reftab%ncand
+  rBethe_i = BetheParameter%c3
+  rBethe_d = BetheParameter%sgdbdiff
+  la = 1.D0/cell%mLambda
+
+! sg = - g.(2k+g) / ( 2 (k+g).FN/|FN| ) 
+  kk = dble(k)
+  fn3 = dble(FN)
+  Gk = matmul(cell%rmt, kk)
+  Gfn = matmul(cell%rmt, fn3)
+  kfn = sum(kk*Gfn)
+  rfnl = 0.5D0*sqrt(sum(fn3*Gfn))
+  reftab%sg(1:nc) = -rfnl*(2.D0*(reftab%gx(1:nc)*kk(1) + reftab%gy(1:nc)*kk(2) + reftab%gz(1:nc)*kk(3)) + reftab%gg(1:nc)) &
+                    / (kfn + reftab%gx(1:nc)*fn3(1) + reftab%gy(1:nc)*fn3(2) + reftab%gz(1:nc)*fn3(3))
+
+! transmitted beam has excitation error zero and is always included
+  reftab%sg(1) = 0.D0
+  reftab%ref(1) = 1
+  nref = 1
+  do ic = 2,nc
+    if (reftab%dbdiff(ic)) then 
+      if (abs(reftab%sg(ic)).le.rBethe_d) then 
+        nref = nref + 1
+        reftab%ref(nref) = ic
+      end if
+    else
+      if (la*abs(reftab%sg(ic))*reftab%rUg(ic).le.rBethe_i) then
+        nref = nref + 1
+        reftab%ref(nref) = ic
+      end if
+    end if
+  end do
+  reftab%nref = nref
+
+end subroutine Update_ReflectionTable
+
+
 
 !--------------------------------------------------------------------------
 !
@@ -3379,6 +3379,103 @@ end do
 
 end function vectormatch
 
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: sortmatchlist
+!
+!> @brief sort a list of unique positive integers (e.g., top match indices) in ascending order, keeping track of the original rank
+!
+!> @details The lists are short (typically up to 100 entries) and sorted once per pattern, so 
+!> a straight insertion sort is used.
+!
+!> @param n number of entries in list
+!> @param va input list (in rank order)
+!> @param sa sorted list
+!> @param ra rank (position in va) of each entry of sa
+!--------------------------------------------------------------------------
+recursive subroutine sortmatchlist(n, va, sa, ra)
+!DEC$ ATTRIBUTES DLLEXPORT :: sortmatchlist
+
+IMPLICIT NONE
+
+integer(kind=irg),INTENT(IN)     :: n
+integer(kind=irg),INTENT(IN)     :: va(n)
+integer(kind=irg),INTENT(OUT)    :: sa(n)
+integer(kind=irg),INTENT(OUT)    :: ra(n)
+
+integer(kind=irg)                :: i, j, v, r
+
+do i=1,n
+  v = va(i)
+  r = i
+  j = i-1
+  do while (j.ge.1)
+    if (sa(j).le.v) EXIT
+    sa(j+1) = sa(j)
+    ra(j+1) = ra(j)
+    j = j-1
+  end do
+  sa(j+1) = v
+  ra(j+1) = r
+end do
+
+end subroutine sortmatchlist
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: vectormatchranked
+!
+!> @brief number of common entries among the top nms(l) entries of two ranked lists, for several levels l at once
+!
+!> @details The lists must have been sorted with sortmatchlist; an entry that is common to both
+!> lists counts for level l when its rank is at most nms(l) in both lists, so a single merge 
+!> pass over the full lists gives the vectormatch result for every level.
+!
+!> @param n number of entries in vectors
+!> @param sa first sorted list
+!> @param ra ranks for first list
+!> @param sb second sorted list
+!> @param rb ranks for second list
+!> @param nlev number of levels
+!> @param nms number of top entries to consider for each level
+!> @param nce number of common entries for each level
+!--------------------------------------------------------------------------
+recursive subroutine vectormatchranked(n, sa, ra, sb, rb, nlev, nms, nce)
+!DEC$ ATTRIBUTES DLLEXPORT :: vectormatchranked
+
+IMPLICIT NONE
+
+integer(kind=irg),INTENT(IN)     :: n
+integer(kind=irg),INTENT(IN)     :: sa(n)
+integer(kind=irg),INTENT(IN)     :: ra(n)
+integer(kind=irg),INTENT(IN)     :: sb(n)
+integer(kind=irg),INTENT(IN)     :: rb(n)
+integer(kind=irg),INTENT(IN)     :: nlev
+integer(kind=irg),INTENT(IN)     :: nms(nlev)
+integer(kind=irg),INTENT(OUT)    :: nce(nlev)
+
+integer(kind=irg)                :: i, j, l, r
+
+nce = 0
+i = 1
+j = 1
+do while ((i.le.n).and.(j.le.n))
+  if (sa(i).lt.sb(j)) then
+    i = i+1
+  else if (sa(i).gt.sb(j)) then
+    j = j+1
+  else
+    r = max(ra(i), rb(j))
+    do l=1,nlev
+      if (r.le.nms(l)) nce(l) = nce(l)+1
+    end do
+    i = i+1
+    j = j+1
+  end if
+end do
+
+end subroutine vectormatchranked
+
 
 
 !--------------------------------------------------------------------------
@@ -0,0 +1,245 @@
+! ###################################################################
+! Copyright (c) 2013-2024, Marc De Graef Research Group/Carnegie Mellon University
+! All rights reserved.
+!
+! Redistribution and use in source and binary forms, with or without modification, are 
+! permitted provided that the following conditions are met:
+!
+!     - Redistributions of source code must retain the above copyright notice, this list 
+!        of conditions and the following disclaimer.
+!     - Redistributions in binary form must reproduce the above copyright notice, this 
+!        list of conditions and the following disclaimer in the documentation and/or 
+!        other materials provided with the distribution.
+!     - Neither the names of Marc De Graef, Carnegie Mellon University nor the names 
+!        of its contributors may be used to endorse or promote products derived from 
+!        this software without specific prior written permission.
+!
+! THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+! AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+! IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+! ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+! LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL 
+! DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+! SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+! CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+! OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE 
+! USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+! ###################################################################
+
+!--------------------------------------------------------------------------
+! EMsoft:neighborhood.f90
+!--------------------------------------------------------------------------
+!
+! MODULE: neighborhood
+!
+!> @brief generic nearest-neighbor map engine for ADP, OSM, KAM and similar maps
+!
+!> @details All of these maps assign to each pixel of a scan the (weighted) average of a pair 
+!> quantity (dot product, number of common matches, disorientation, ...) between the pixel and 
+!> its neighbors.  The neighborhood is described by a list of "forward" offsets (dx,dy) with 
+!> dy>0, or dy=0 and dx>0, so that each neighbor pair is evaluated only once.  The calling routine
+!> evaluates the pair quantity for each pixel p and each forward offset k and stores it in the 
+!> pair value array pv(p,k); since only pixels in rows j..j+radius are needed for the pairs of 
+!> row j, this can be done for independent row bands in parallel, or row by row with a buffer of
+!> radius+1 rows when the data is read from a file.  NB_Gather then combines the pair values 
+!> into the map, averaging over the neighbors that lie inside the scan area.
+!> Two neighborhood types are available: nbtype=4 (all offsets with |dx|+|dy| <= radius) and 
+!> nbtype=8 (all offsets with max(|dx|,|dy|) <= radius); nbtype=4 with radius=1 is the classical
+!> four nearest neighbor map.
+!--------------------------------------------------------------------------
+module neighborhood
+
+use local
+
+IMPLICIT NONE
+
+type NeighborhoodType
+  integer(kind=irg)             :: wd, ht, nbtype, radius, noff
+  integer(kind=irg),allocatable :: dx(:), dy(:), shift(:)
+  real(kind=sgl),allocatable    :: w(:), dist(:)
+end type NeighborhoodType
+
+contains
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: NB_Init
+!
+!> @brief set up the list of forward offsets for a given neighborhood
+!
+!> @param nb neighborhood structure
+!> @param wd width of the map
+!> @param ht height of the map
+!> @param nbtype 4 or 8
+!> @param radius neighborhood radius (in pixels)
+!> @param distweight (optional) weigh each neighbor by the inverse of its distance
+!--------------------------------------------------------------------------
+recursive subroutine NB_Init(nb, wd, ht, nbtype, radius, distweight)
+!DEC$ ATTRIBUTES DLLEXPORT :: NB_Init
+
+use error
+
+IMPLICIT NONE
+
+type(NeighborhoodType),INTENT(INOUT)    :: nb
+integer(kind=irg),INTENT(IN)            :: wd
+integer(kind=irg),INTENT(IN)            :: ht
+integer(kind=irg),INTENT(IN)            :: nbtype
+integer(kind=irg),INTENT(IN)            :: radius
+logical,INTENT(IN),OPTIONAL             :: distweight
+
+integer(kind=irg)                       :: dx, dy, k, pass
+logical                                 :: inside, dw
+
+if ((nbtype.ne.4).and.(nbtype.ne.8)) call FatalError('NB_Init','neighborhood type must be 4 or 8')
+if (radius.lt.1) call FatalError('NB_Init','neighborhood radius must be at least 1')
+
+dw = .FALSE.
+if (present(distweight)) dw = distweight
+
+nb%wd = wd
+nb%ht = ht
+nb%nbtype = nbtype
+nb%radius = radius
+
+if (allocated(nb%dx)) deallocate(nb%dx, nb%dy, nb%shift, nb%w, nb%dist)
+
+! first pass counts the offsets, second pass stores them
+do pass=1,2
+  k = 0
+  do dy=0,radius
+    do dx=-radius,radius
+      if ((dy.eq.0).and.(dx.le.0)) CYCLE
+      if (nbtype.eq.4) then
+        inside = (abs(dx)+dy).le.radius
+      else
+        inside = .TRUE.
+      end if
+      if (inside) then
+        k = k+1
+        if (pass.eq.2) then
+          nb%dx(k) = dx
+          nb%dy(k) = dy
+          nb%shift(k) = dy*wd+dx
+          nb%dist(k) = sqrt(float(dx*dx+dy*dy))
+          if (dw) then
+            nb%w(k) = 1.0/nb%dist(k)
+          else
+            nb%w(k) = 1.0
+          end if
+        end if
+      end if
+    end do
+  end do
+  if (pass.eq.1) then
+    nb%noff = k
+    allocate(nb%dx(k), nb%dy(k), nb%shift(k), nb%w(k), nb%dist(k))
+  end if
+end do
+
+end subroutine NB_Init
+
+!--------------------------------------------------------------------------
+!
+! FUNCTION: NB_Partner
+!
+!> @brief return the 1D index of the forward neighbor k of pixel (i,j), or 0 if it lies outside the map
+!
+!> @param nb neighborhood structure
+!> @param k offset number
+!> @param i column of pixel
+!> @param j row of pixel
+!--------------------------------------------------------------------------
+recursive function NB_Partner(nb, k, i, j) result(q)
+!DEC$ ATTRIBUTES DLLEXPORT :: NB_Partner
+
+IMPLICIT NONE
+
+type(NeighborhoodType),INTENT(IN)       :: nb
+integer(kind=irg),INTENT(IN)            :: k
+integer(kind=irg),INTENT(IN)            :: i
+integer(kind=irg),INTENT(IN)            :: j
+integer(kind=irg)                       :: q
+
+integer(kind=irg)                       :: ii, jj
+
+ii = i + nb%dx(k)
+jj = j + nb%dy(k)
+if ((ii.lt.1).or.(ii.gt.nb%wd).or.(jj.gt.nb%ht)) then
+  q = 0
+else
+  q = nb%wd*(jj-1) + ii
+end if
+
+end function NB_Partner
+
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE: NB_Gather
+!
+!> @brief combine the pair values of all forward offsets into the neighborhood average map
+!
+!> @details Each pair value pv(p,k) contributes to pixel p and to its forward neighbor k; 
+!> pair values for neighbors outside the map are ignored, so the result is the weighted 
+!> average over the neighbors that are actually present.  The rows are handled in parallel.
+!> Several maps with different weights (e.g., uniform and inverse distance) can be obtained
+!> from the same pair values by passing the weights explicitly.
+!
+!> @param nb neighborhood structure
+!> @param pv pair values
+!> @param nbmap output map
+!> @param w (optional) weight for each offset, replaces nb%w
+!--------------------------------------------------------------------------
+recursive subroutine NB_Gather(nb, pv, nbmap, w)
+!DEC$ ATTRIBUTES DLLEXPORT :: NB_Gather
+
+IMPLICIT NONE
+
+type(NeighborhoodType),INTENT(IN)       :: nb
+real(kind=sgl),INTENT(IN)               :: pv(nb%wd*nb%ht, nb%noff)
+real(kind=sgl),INTENT(OUT)              :: nbmap(nb%wd*nb%ht)
+real(kind=sgl),INTENT(IN),OPTIONAL      :: w(nb%noff)
+
+integer(kind=irg)                       :: i, j, k, p, ii, jj
+real(kind=sgl)                          :: s, sw, wk(nb%noff)
+
+if (present(w)) then
+  wk = w
+else
+  wk = nb%w
+end if
+
+!$OMP PARALLEL DO DEFAULT(SHARED) PRIVATE(i,j,k,p,ii,jj,s,sw) SCHEDULE(STATIC)
+do j=1,nb%ht
+  do i=1,nb%wd
+    p = nb%wd*(j-1)+i
+    s = 0.0
+    sw = 0.0
+    do k=1,nb%noff
+! forward neighbor (i+dx, j+dy)
+      ii = i + nb%dx(k)
+      jj = j + nb%dy(k)
+      if ((ii.ge.1).and.(ii.le.nb%wd).and.(jj.le.nb%ht)) then
+        s = s + wk(k)*pv(p,k)
+        sw = sw + wk(k)
+      end if
+! backward neighbor (i-dx, j-dy), for which this pixel is forward neighbor k
+      ii = i - nb%dx(k)
+      jj = j - nb%dy(k)
+      if ((ii.ge.1).and.(ii.le.nb%wd).and.(jj.ge.1)) then
+        s = s + wk(k)*pv(p-nb%shift(k),k)
+        sw = sw + wk(k)
+      end if
+    end do
+    if (sw.gt.0.0) then
+      nbmap(p) = s/sw
+    else
+      nbmap(p) = 0.0
+    end if
+  end do
+end do
+!$OMP END PARALLEL DO
+
+end subroutine NB_Gather
+
+end module neighborhood
@@ -28,12 +28,15 @@
 module rng 
 implicit none 
 private 
-public :: rng_t, rng_seed, rng_uniform
+public :: rng_t, rng_seed, rng_uniform, rng_block_t, rng_block_seed, rng_block_uniform, rng_philox4x32, rng_philox
 
 ! Dimension of the state 
 integer, parameter :: ns = 4 
 !DEC$ ATTRIBUTES DLLEXPORT :: ns
 
+! 32-bit mask for the 64-bit integer arithmetic of the block generator
+integer(kind=8), parameter :: mask32 = 4294967295_8
+
 ! Default seed vector 
 integer, parameter, dimension(ns) :: default_seed = (/ 521288629, 362436069, 16163801, 1131199299 /) 
 !DEC$ ATTRIBUTES DLLEXPORT :: default_seed
@@ -43,6 +46,15 @@ type :: rng_t
   integer, dimension(ns) :: state = default_seed 
 end type rng_t 
 
+! The states of a block of independent generators (lanes), stored as a structure of
+! arrays so that all lanes can be advanced together in a vectorized loop; the 32-bit 
+! linear congruential part is kept as a 64-bit integer so that it never overflows
+type :: rng_block_t 
+  integer :: nlanes = 0
+  integer, allocatable :: s1(:), s2(:), s3(:)
+  integer(kind=8), allocatable :: s4(:)
+end type rng_block_t 
+
 contains 
 
 
@@ -81,4 +93,140 @@ end function rng_uniform
 
 
 
+! Seeds a block of nlanes generators; every lane state is derived from a hash of the
+! seed and the lane number, so that neighbouring seeds and lanes are not correlated. 
+recursive subroutine rng_block_seed(self, seed, nlanes) 
+!DEC$ ATTRIBUTES DLLEXPORT :: rng_block_seed
+type(rng_block_t), intent(inout) :: self 
+integer, intent(in) :: seed, nlanes
+integer :: i, j
+integer(kind=8) :: h
+real(kind(1.d0)) :: u(nlanes)
+
+if (allocated(self%s1)) deallocate(self%s1, self%s2, self%s3, self%s4)
+allocate(self%s1(nlanes), self%s2(nlanes), self%s3(nlanes), self%s4(nlanes))
+self%nlanes = nlanes
+
+do i=1,nlanes
+  h = mix32(iand(int(seed,8), mask32) + 2654435761_8 * i)
+  self%s1(i) = int(1 + modulo(h, 2147483578_8))
+  h = mix32(h + default_seed(2))
+  self%s2(i) = int(1 + modulo(h, 2147483578_8))
+  h = mix32(h + default_seed(3))
+  self%s3(i) = int(1 + modulo(h, 2147483578_8))
+  self%s4(i) = mix32(h + default_seed(4))
+end do
+
+! discard the first few numbers of each lane
+do j=1,8
+  call rng_block_uniform(self, u)
+end do
+
+contains
+
+  ! 32-bit integer hash (xor-shift-multiply rounds with odd multipliers below 2^31, so
+  ! that all products fit in a 64-bit integer)
+  pure function mix32(k) result(m)
+  integer(kind=8), intent(in) :: k
+  integer(kind=8) :: m
+  m = iand(k, mask32)
+  m = ieor(m, ishft(m, -16))
+  m = iand(m * 2146121005_8, mask32)
+  m = ieor(m, ishft(m, -15))
+  m = iand(m * 1540483477_8, mask32)
+  m = ieor(m, ishft(m, -16))
+  end function mix32
+
+end subroutine rng_block_seed 
+
+
+
+
+! Draws one uniform number on [0,1] for each lane of the block; this is the same 
+! generator as rng_uniform, applied to all lanes at once, but written without any
+! reliance on integer overflow so that the loop can safely be vectorized.
+recursive subroutine rng_block_uniform(self, u) 
+!DEC$ ATTRIBUTES DLLEXPORT :: rng_block_uniform
+type(rng_block_t), intent(inout) :: self 
+real(kind(1.d0)), intent(out) :: u(self%nlanes)
+integer :: i, imz 
+integer(kind=8) :: w
+
+!$OMP SIMD PRIVATE(imz,w)
+do i=1,self%nlanes
+  imz = self%s1(i) - self%s3(i)
+  if (imz < 0) imz = imz + 2147483579 
+  self%s1(i) = self%s2(i)
+  self%s2(i) = self%s3(i)
+  self%s3(i) = imz
+  self%s4(i) = iand(69069_8 * self%s4(i) + 1013904243_8, mask32)
+! 32-bit two's complement sum of imz and the congruential state
+  w = iand(imz + self%s4(i), mask32)
+  if (w >= 2147483648_8) w = w - 4294967296_8
+  u(i) = 0.5d0 + 0.23283064d-9 * w
+end do
+end subroutine rng_block_uniform 
+
+
+
+
+! Philox4x32-10 counter-based generator (Salmon et al., SC'11): maps a 128-bit counter and a
+! 64-bit key onto four 32-bit random integers; all words are held in 64-bit integers in [0,2^32).
+recursive pure function rng_philox4x32(ctr, key) result(x)
+!DEC$ ATTRIBUTES DLLEXPORT :: rng_philox4x32
+integer(kind=8), intent(in) :: ctr(4), key(2)
+integer(kind=8) :: x(4)
+integer(kind=8) :: k(2), hi0, lo0, hi1, lo1
+integer :: r
+
+x = ctr
+k = key
+do r=1,10
+  call mulhilo(3528531795_8, x(1), hi0, lo0)
+  call mulhilo(3449720151_8, x(3), hi1, lo1)
+  x = (/ ieor(ieor(hi1, x(2)), k(1)), lo1, ieor(ieor(hi0, x(4)), k(2)), lo0 /)
+  k(1) = iand(k(1) + 2654435769_8, mask32)
+  k(2) = iand(k(2) + 3144134277_8, mask32)
+end do
+
+contains
+
+  ! high and low 32-bit words of the 64-bit product a*b, computed with 16-bit partial products
+  pure subroutine mulhilo(a, b, hi, lo)
+  integer(kind=8), intent(in) :: a, b
+  integer(kind=8), intent(out) :: hi, lo
+  integer(kind=8) :: p1, p2, t
+  p1 = a * iand(b, 65535_8)
+  p2 = a * ishft(b, -16)
+  t = p1 + ishft(iand(p2, 65535_8), 16)
+  lo = iand(t, mask32)
+  hi = ishft(p2, -16) + ishft(t, -32)
+  end subroutine mulhilo
+
+end function rng_philox4x32 
+
+
+
+
+! Four uniform numbers on (0,1) for draw number step of stream id; the result depends on 
+! nothing but (seed, id, step), so each stream can be generated anywhere, in any order.
+elemental subroutine rng_philox(seed, id, step, u1, u2, u3, u4) 
+!DEC$ ATTRIBUTES DLLEXPORT :: rng_philox
+integer, intent(in) :: seed, step
+integer(kind=8), intent(in) :: id
+real(kind(1.d0)), intent(out) :: u1, u2, u3, u4
+integer(kind=8) :: x(4)
+real(kind(1.d0)), parameter :: s32 = 2.3283064365386963d-10
+
+x = rng_philox4x32( (/ iand(id, mask32), iand(ishft(id, -32), mask32), iand(int(step,8), mask32), 0_8 /), &
+                    (/ iand(int(seed,8), mask32), 0_8 /) )
+u1 = (dble(x(1)) + 0.5d0) * s32
+u2 = (dble(x(2)) + 0.5d0) * s32
+u3 = (dble(x(3)) + 0.5d0) * s32
+u4 = (dble(x(4)) + 0.5d0) * s32
+end subroutine rng_philox 
+
+
+
+
 end module rng
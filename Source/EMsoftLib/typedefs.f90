@@ -920,6 +920,27 @@ type reflisttype
   type(reflisttype),pointer     :: nextw                ! connection to next weak entry in linked list
 end type reflisttype
 
+! contiguous (structure-of-arrays) version of the reflection list, used in the beam direction loops of
+! the master pattern programs; the candidate reflections inside the dmin sphere do not depend on the
+! beam direction, so they are determined once per thread, and for each new beam direction only the
+! excitation errors and the strong/weak selections are recomputed.  Instead of nexts/nextw pointers,
+! the strong and weak reflections are stored as index lists into the candidate arrays.
+type ReflectionTableType
+  integer(kind=irg)             :: ncand = 0, &         ! number of candidate reflections (000 is always the first one)
+                                   nref = 0, &          ! number of reflections retained for the current beam direction
+                                   nns = 0, &           ! number of strong reflections
+                                   nnw = 0              ! number of weak reflections
+  integer(kind=irg),allocatable :: hkl(:,:)             ! Miller indices of the candidates, hkl(3,ncand)
+  real(kind=dbl),allocatable    :: gx(:), gy(:), gz(:),&  ! components of rmt.g, for the excitation error dot products
+                                   gg(:), &             ! g.g (squared length of reciprocal lattice vector)
+                                   rUg(:), &            ! 1/|Ug|, used for the Bethe cutoff
+                                   sg(:)                ! excitation errors for the current beam direction
+  logical,allocatable           :: dbdiff(:)            ! double diffraction reflection ?
+  integer(kind=irg),allocatable :: ref(:), &            ! candidate indices of the retained reflections
+                                   strong(:), &         ! candidate indices of the strong reflections
+                                   weak(:)              ! candidate indices of the weak reflections
+end type ReflectionTableType
+
 ! linked list of quasi-crystal reflections [03/15/17, MDG]
 type QCreflisttype  
   integer(kind=irg)             :: num, &               ! sequential number
@@ -1273,6 +1294,31 @@ type DynType
 !                                             phiz(:),Az(:,:)   ! used for Taylor expansion of scattering matrix
 end type DynType
 
+!--------------------------------------------------------------------------
+!--------------------------------------------------------------------------
+!--------------------------------------------------------------------------
+
+! persistent LAPACK work space for the Bloch wave eigenvalue problem in CalcLgh; each OpenMP thread 
+! keeps its own copy for the whole beam direction loop, so that the arrays are allocated and the 
+! LAPACK work space sizes are queried only when the number of strong beams exceeds the current capacity
+type LghWorkspaceType
+  integer(kind=irg)                         :: nnmax = 0              ! current capacity (number of strong beams)
+  logical                                   :: hermitian = .FALSE.    ! use ZHEEV (only valid in the absence of absorption)
+  integer(kind=irg)                         :: lwork = 0              ! size of work, set by the ZGEEV/ZHEEV work space queries
+  integer(kind=irg)                         :: liwork = 0             ! size of iwork, set by the ZGETRI work space query
+  integer(kind=irg),allocatable             :: jpiv(:)                ! pivots for ZGETRF/ZGETRI
+  real(kind=dbl),allocatable                :: rwork(:), &            ! real work space for ZGEEV/ZHEEV
+                                               wr(:)                  ! real eigenvalues for ZHEEV
+  complex(kind=dbl),allocatable             :: work(:), &             ! complex work space for ZGEEV/ZHEEV
+                                               iwork(:), &            ! complex work space for ZGETRI
+                                               W(:), &                ! Bloch wave eigenvalues
+                                               Minp(:,:), &           ! copy of the dynamical matrix (destroyed by the solver)
+                                               CGG(:,:), &            ! Bloch wave eigenvectors
+                                               CGinv(:,:), &          ! inverse of the eigenvector matrix
+                                               Ijk(:,:), &            ! depth integrated Bloch wave products
+                                               VL(:,:)                ! left eigenvectors (not computed)
+end type LghWorkspaceType
+
 
 
 !--------------------------------------------------------------------------
@@ -1911,6 +1957,14 @@ type EBSDDetectorType
         type(EBSDPixel),allocatable     :: detector(:,:) 
 end type EBSDDetectorType
 
+! small least-recently-used cache of detector energy weights, keyed by the quantized pattern center
+type EBSDDetectorCacheType
+        integer(kind=irg)               :: nslots, nused, tick
+        real(kind=sgl)                  :: qpc          ! pattern center quantum [pixels]
+        integer(kind=irg),allocatable   :: key(:,:), age(:)
+        real(kind=sgl),allocatable      :: accum(:,:,:,:)
+end type EBSDDetectorCacheType
+
 
 
 !=======================================
@@ -272,6 +272,7 @@ namespace EMsoftWorkbenchConstants
     const QString BeamCurrent = "Beam Current";
     const QString DwellTime = "Dwell Time";
     const QString BarrelDistortion = "Barrel Distortion";
+    const QString EnergyClusters = "Energy Clusters";
     const QString Energy = "Energy";
     const QString Minimum = "Min";
     const QString Maximum = "Max";
@@ -36,8 +36,7 @@
 #include "PatternTools.h"
 
 #include <QtCore/QFile>
-#include <QtCore/QTextStream>
-#include <QtCore/QFile>
+#include <QtCore/QMutexLocker>
 #include <QtCore/QTextStream>
 
 #include <QtGui/QImage>
@@ -49,6 +48,9 @@
 
 #include "EbsdLib/Core/OrientationTransformation.hpp"
 
+QMutex PatternTools::s_DetectorMutex;
+const void* PatternTools::s_DetectorOwner = nullptr;
+
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
@@ -66,13 +68,30 @@ std::vector<float> PatternTools::GeneratePattern(PatternTools::IParValues iParVa
                                                           std::vector<float> &lpnhData, std::vector<float> &lpshData,
                                                           std::vector<int32_t> &monteCarloSquareData, const std::vector<float> &eulerAngles,
                                                           int angleIndex, bool &cancel)
+{
+  std::vector<int32_t> genericIParPtr = CreateIPar(iParValues);
+  std::vector<float> genericFParPtr = CreateFPar(fParValues);
+
+  std::vector<float> genericEBSDPatternsPtr;
+  genericEBSDPatternsPtr.resize(iParValues.numberOfOrientations * genericIParPtr[22] * genericIParPtr[23]);
+
+  // this call always rebuilds the detector tables inside EMsoftCgetEBSDPatterns, so nobody owns them afterwards
+  QMutexLocker locker(&s_DetectorMutex);
+  s_DetectorOwner = nullptr;
+
+  PatternTools::GeneratePattern_Helper(static_cast<size_t>(angleIndex), eulerAngles, lpnhData, lpshData, monteCarloSquareData, genericEBSDPatternsPtr, genericIParPtr, genericFParPtr, cancel);
+
+  return genericEBSDPatternsPtr;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+std::vector<int32_t> PatternTools::CreateIPar(const PatternTools::IParValues& iParValues)
 {
   std::vector<int32_t> genericIParPtr(EMsoftWorkbenchConstants::Constants::IParSize);
   std::fill(genericIParPtr.begin(), genericIParPtr.end(), 0);
 
-  std::vector<float> genericFParPtr(EMsoftWorkbenchConstants::Constants::FParSize);
-  std::fill(genericFParPtr.begin(), genericFParPtr.end(), 0.0f);
-
   genericIParPtr[0] = (iParValues.numsx - 1) / 2;
   genericIParPtr[8] = iParValues.numset;
   genericIParPtr[11] = static_cast<int>((iParValues.incidentBeamVoltage - iParValues.minEnergy) / iParValues.energyBinSize) + 1;
@@ -99,6 +118,18 @@ std::vector<float> PatternTools::GeneratePattern(PatternTools::IParValues iParVa
   genericIParPtr[21] = binningIndex;
   genericIParPtr[22] = static_cast<int32_t>(iParValues.numOfPixelsX / iParValues.detectorBinningValue);
   genericIParPtr[23] = static_cast<int32_t>(iParValues.numOfPixelsY / iParValues.detectorBinningValue);
+  genericIParPtr[26] = static_cast<int32_t>(iParValues.energyClusters);
+
+  return genericIParPtr;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+std::vector<float> PatternTools::CreateFPar(const PatternTools::FParValues& fParValues)
+{
+  std::vector<float> genericFParPtr(EMsoftWorkbenchConstants::Constants::FParSize);
+  std::fill(genericFParPtr.begin(), genericFParPtr.end(), 0.0f);
 
   // and set all the float input parameters for the EMsoftCgetEBSDPatterns routine
   // some of these have been set in previous filters
@@ -114,12 +145,36 @@ std::vector<float> PatternTools::GeneratePattern(PatternTools::IParValues iParVa
   genericFParPtr[20] = static_cast<float>(fParValues.dwellTime);             // beam dwell time per pattern [micro-seconds]
   genericFParPtr[21] = static_cast<float>(fParValues.gammaValue);            // intensity scaling gamma value
 
-  std::vector<float> genericEBSDPatternsPtr;
-  genericEBSDPatternsPtr.resize(iParValues.numberOfOrientations * genericIParPtr[22] * genericIParPtr[23]);
+  return genericFParPtr;
+}
 
-  PatternTools::GeneratePattern_Helper(static_cast<size_t>(angleIndex), eulerAngles, lpnhData, lpshData, monteCarloSquareData, genericEBSDPatternsPtr, genericIParPtr, genericFParPtr, cancel);
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+std::vector<float> PatternTools::GeneratePatterns(const void* owner, std::vector<int32_t>& iPar, std::vector<float>& fPar, std::vector<float>& lpnhData, std::vector<float>& lpshData,
+                                                  std::vector<int32_t>& monteCarloSquareData, std::vector<float>& quats, bool reuseDetector, bool& cancel)
+{
+  size_t numOfPatterns = quats.size() / 4;
+  iPar[20] = static_cast<int32_t>(numOfPatterns);
+  iPar[24] = 0; // quaternion input
 
-  return genericEBSDPatternsPtr;
+  std::vector<float> patterns(numOfPatterns * iPar[22] * iPar[23]);
+  if(numOfPatterns == 0)
+  {
+    return patterns;
+  }
+
+  // the detector tables are SAVEd inside the Fortran routine and shared by every caller in the process
+  QMutexLocker locker(&s_DetectorMutex);
+  bool initialized = reuseDetector && owner != nullptr && s_DetectorOwner == owner;
+  iPar[25] = initialized ? 1 : 0;
+
+  EMsoftCgetEBSDPatterns(iPar.data(), fPar.data(), patterns.data(), quats.data(), monteCarloSquareData.data(), lpnhData.data(), lpshData.data(), nullptr, 0, &cancel);
+
+  s_DetectorOwner = owner;
+  iPar[25] = 0;
+
+  return patterns;
 }
 
 // -----------------------------------------------------------------------------
@@ -35,6 +35,8 @@
 
 #pragma once
 
+#include <QtCore/QMutex>
+
 #include <QtGui/QColor>
 #include <QtGui/QImage>
 
@@ -55,6 +57,7 @@ class PatternTools
         double numOfPixelsY;
         int detectorBinningValue;
         size_t numberOfOrientations;
+        int energyClusters = 0; // number of effective energy clusters; 0 sums over all energy bins
     };
 
     struct FParValues
@@ -88,6 +91,38 @@ class PatternTools
                                   std::vector<int32_t> &monteCarloSquareData, const std::vector<float> &eulerAngles,
                                   int angleIndex, bool &cancel);
 
+    /**
+     * @brief CreateIPar Fills the integer parameter array used by EMsoftCgetEBSDPatterns
+     * @param iParValues
+     * @return
+     */
+    static std::vector<int32_t> CreateIPar(const PatternTools::IParValues& iParValues);
+
+    /**
+     * @brief CreateFPar Fills the float parameter array used by EMsoftCgetEBSDPatterns
+     * @param fParValues
+     * @return
+     */
+    static std::vector<float> CreateFPar(const PatternTools::FParValues& fParValues);
+
+    /**
+     * @brief GeneratePatterns Computes one pattern per quaternion using prebuilt ipar/fpar arrays.  The detector
+     * direction cosines and energy weights are kept inside EMsoftCgetEBSDPatterns between calls; when reuseDetector
+     * is true and the last detector initialization was done for the same owner, only the orientation loop is run.
+     * @param owner Opaque identifier of the caller that owns the cached detector tables
+     * @param iPar
+     * @param fPar
+     * @param lpnhData
+     * @param lpshData
+     * @param monteCarloSquareData
+     * @param quats Quaternions (scalar first), 4 values per pattern
+     * @param reuseDetector
+     * @param cancel
+     * @return
+     */
+    static std::vector<float> GeneratePatterns(const void* owner, std::vector<int32_t>& iPar, std::vector<float>& fPar, std::vector<float>& lpnhData, std::vector<float>& lpshData,
+                                               std::vector<int32_t>& monteCarloSquareData, std::vector<float>& quats, bool reuseDetector, bool& cancel);
+
     /**
      * @brief ApplyCircularMask
      * @param pattern
@@ -155,6 +190,8 @@ class PatternTools
     PatternTools();
 
   private:
+    static QMutex s_DetectorMutex;
+    static const void* s_DetectorOwner;
 
     /**
      * @brief GeneratePattern_Helper
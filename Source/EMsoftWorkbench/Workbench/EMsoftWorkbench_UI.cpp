@@ -57,6 +57,7 @@
 #include "QtSupport/QtSSettings.h"
 
 #include "EMsoftApplication.h"
+#include "JobQueueWidget.h"
 #include "StatusBarWidget.h"
 
 // -----------------------------------------------------------------------------
@@ -97,6 +98,8 @@ void EMsoftWorkbench_UI::setupGui()
 
   setupIssuesTable();
 
+  setupJobsDock();
+
   setupStatusBar();
 
   setupMainToolbarAndStackedWidget();
@@ -104,6 +107,20 @@ void EMsoftWorkbench_UI::setupGui()
   createWidgetConnections();
 }
 
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void EMsoftWorkbench_UI::setupJobsDock()
+{
+  m_JobsDockWidget = new QDockWidget(tr("Jobs"), this);
+  m_JobsDockWidget->setObjectName("jobsDockWidget");
+  m_JobsDockWidget->setMinimumSize(300, 199);
+  m_JobsDockWidget->setWidget(new JobQueueWidget(m_JobsDockWidget));
+  addDockWidget(Qt::RightDockWidgetArea, m_JobsDockWidget);
+  tabifyDockWidget(stdOutDockWidget, m_JobsDockWidget);
+  stdOutDockWidget->raise();
+}
+
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
@@ -114,6 +131,7 @@ void EMsoftWorkbench_UI::setupStatusBar()
 
   m_StatusBar->setButtonAction(issuesDockWidget, StatusBarWidget::Button::Issues);
   m_StatusBar->setButtonAction(stdOutDockWidget, StatusBarWidget::Button::StandardOutput);
+  m_StatusBar->setButtonAction(m_JobsDockWidget, StatusBarWidget::Button::Jobs);
   m_StatusBar->setButtonAction(mainToolbar, StatusBarWidget::Button::ModuleNavigator);
 }
 
@@ -659,6 +677,10 @@ void EMsoftWorkbench_UI::readSettings()
   readDockWidgetSettings(prefs.data(), stdOutDockWidget);
   prefs->endGroup();
 
+  prefs->beginGroup("Jobs Dock Widget");
+  readDockWidgetSettings(prefs.data(), m_JobsDockWidget);
+  prefs->endGroup();
+
   prefs->endGroup();
 
   QtSRecentFileList::instance()->readList(prefs.data());
@@ -728,6 +750,10 @@ void EMsoftWorkbench_UI::writeSettings()
   writeDockWidgetSettings(prefs.data(), stdOutDockWidget);
   prefs->endGroup();
 
+  prefs->beginGroup("Jobs Dock Widget");
+  writeDockWidgetSettings(prefs.data(), m_JobsDockWidget);
+  prefs->endGroup();
+
   prefs->endGroup();
 
   QtSRecentFileList::instance()->writeList(prefs.data());
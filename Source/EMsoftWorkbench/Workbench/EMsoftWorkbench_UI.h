@@ -145,6 +145,7 @@ private:
   QActionGroup* m_ToolbarButtonGroup = nullptr;
   QStringList m_ModuleNamesOrder;
   StatusBarWidget* m_StatusBar;
+  QDockWidget* m_JobsDockWidget = nullptr;
 
   QMenuBar* m_MenuBar = nullptr;
 
@@ -169,6 +170,11 @@ private:
    */
   void createWorkbenchMenuSystem();
 
+  /**
+   * @brief Creates the dock widget that lists the jobs of the JobScheduler
+   */
+  void setupJobsDock();
+
   /**
    * @brief setupStatusBar
    */
@@ -0,0 +1,216 @@
+/* ============================================================================
+ * Copyright (c) 2009-2017 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-07-D-5800
+ *    United States Air Force Prime Contract FA8650-10-D-5210
+ *    United States Prime Contract Navy N00173-07-C-2068
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#include "JobQueueWidget.h"
+
+#include <QtCore/QTimer>
+
+#include <QtWidgets/QHBoxLayout>
+#include <QtWidgets/QHeaderView>
+#include <QtWidgets/QPushButton>
+#include <QtWidgets/QTreeWidget>
+#include <QtWidgets/QVBoxLayout>
+
+#include "Modules/JobScheduler.h"
+
+namespace
+{
+const int k_JobIdRole = Qt::UserRole + 1;
+
+// -----------------------------------------------------------------------------
+QString FormatElapsed(qint64 msecs)
+{
+  qint64 secs = msecs / 1000;
+  return QString("%1:%2:%3").arg(secs / 3600, 2, 10, QChar('0')).arg((secs / 60) % 60, 2, 10, QChar('0')).arg(secs % 60, 2, 10, QChar('0'));
+}
+} // namespace
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+JobQueueWidget::JobQueueWidget(QWidget* parent)
+: QWidget(parent)
+{
+  setupGui();
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+JobQueueWidget::~JobQueueWidget() = default;
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void JobQueueWidget::setupGui()
+{
+  m_JobsTree = new QTreeWidget(this);
+  m_JobsTree->setRootIsDecorated(false);
+  m_JobsTree->setSelectionMode(QAbstractItemView::SingleSelection);
+  m_JobsTree->setHeaderLabels({tr("Job"), tr("State"), tr("Threads"), tr("Queued"), tr("Started"), tr("Elapsed")});
+  m_JobsTree->header()->setSectionResizeMode(static_cast<int>(Column::Name), QHeaderView::Stretch);
+  m_JobsTree->header()->setStretchLastSection(false);
+
+  m_CancelBtn = new QPushButton(tr("Cancel Job"), this);
+  m_ClearBtn = new QPushButton(tr("Clear Finished"), this);
+
+  QHBoxLayout* buttonLayout = new QHBoxLayout();
+  buttonLayout->addStretch();
+  buttonLayout->addWidget(m_ClearBtn);
+  buttonLayout->addWidget(m_CancelBtn);
+
+  QVBoxLayout* layout = new QVBoxLayout(this);
+  layout->setContentsMargins(0, 0, 0, 8);
+  layout->addWidget(m_JobsTree);
+  layout->addLayout(buttonLayout);
+
+  // Elapsed times of running jobs are refreshed once a second
+  m_ElapsedTimer = new QTimer(this);
+  m_ElapsedTimer->setInterval(1000);
+  connect(m_ElapsedTimer, &QTimer::timeout, this, &JobQueueWidget::updateElapsedTimes);
+  m_ElapsedTimer->start();
+
+  JobScheduler* scheduler = JobScheduler::Instance();
+  connect(scheduler, &JobScheduler::jobsChanged, this, &JobQueueWidget::updateJobs);
+  connect(m_JobsTree, &QTreeWidget::itemSelectionChanged, this, &JobQueueWidget::updateButtonStates);
+
+  connect(m_CancelBtn, &QPushButton::clicked, [=] {
+    QList<QTreeWidgetItem*> items = m_JobsTree->selectedItems();
+    for(QTreeWidgetItem* item : items)
+    {
+      JobScheduler::Instance()->cancelJob(item->data(static_cast<int>(Column::Name), k_JobIdRole).toInt());
+    }
+  });
+  connect(m_ClearBtn, &QPushButton::clicked, [=] { JobScheduler::Instance()->clearFinishedJobs(); });
+
+  updateJobs();
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void JobQueueWidget::updateJobs()
+{
+  int selectedId = -1;
+  QList<QTreeWidgetItem*> selectedItems = m_JobsTree->selectedItems();
+  if(!selectedItems.isEmpty())
+  {
+    selectedId = selectedItems.front()->data(static_cast<int>(Column::Name), k_JobIdRole).toInt();
+  }
+
+  m_JobsTree->blockSignals(true);
+  m_JobsTree->clear();
+  QVector<JobScheduler::JobInfo> jobs = JobScheduler::Instance()->getJobs();
+  for(const JobScheduler::JobInfo& job : jobs)
+  {
+    QTreeWidgetItem* item = new QTreeWidgetItem(m_JobsTree);
+    updateItem(item, job.id);
+    if(job.id == selectedId)
+    {
+      item->setSelected(true);
+    }
+  }
+  m_JobsTree->blockSignals(false);
+
+  updateButtonStates();
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void JobQueueWidget::updateElapsedTimes()
+{
+  for(int i = 0; i < m_JobsTree->topLevelItemCount(); i++)
+  {
+    QTreeWidgetItem* item = m_JobsTree->topLevelItem(i);
+    int id = item->data(static_cast<int>(Column::Name), k_JobIdRole).toInt();
+    if(JobScheduler::Instance()->getJob(id).state == JobScheduler::JobState::Running)
+    {
+      updateItem(item, id);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void JobQueueWidget::updateButtonStates()
+{
+  bool cancelable = false;
+  QList<QTreeWidgetItem*> items = m_JobsTree->selectedItems();
+  for(QTreeWidgetItem* item : items)
+  {
+    int id = item->data(static_cast<int>(Column::Name), k_JobIdRole).toInt();
+    cancelable = cancelable || !JobScheduler::IsTerminal(JobScheduler::Instance()->getJob(id).state);
+  }
+
+  m_CancelBtn->setEnabled(cancelable);
+  m_ClearBtn->setEnabled(JobScheduler::Instance()->getActiveJobCount() < m_JobsTree->topLevelItemCount());
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void JobQueueWidget::updateItem(QTreeWidgetItem* item, int id) const
+{
+  JobScheduler::JobInfo job = JobScheduler::Instance()->getJob(id);
+  QString timeFormat("hh:mm:ss");
+
+  QString state = JobScheduler::StateToString(job.state);
+  if(!job.statusMessage.isEmpty())
+  {
+    state = tr("%1 (%2)").arg(state, job.statusMessage);
+  }
+
+  // Running jobs show the time so far, done jobs the time they took; queued jobs show none
+  QString elapsed;
+  if(job.state == JobScheduler::JobState::Running)
+  {
+    elapsed = FormatElapsed(job.startTime.msecsTo(QDateTime::currentDateTime()));
+  }
+  else if(job.startTime.isValid() && job.finishTime.isValid())
+  {
+    elapsed = FormatElapsed(job.startTime.msecsTo(job.finishTime));
+  }
+
+  item->setData(static_cast<int>(Column::Name), k_JobIdRole, job.id);
+  item->setText(static_cast<int>(Column::Name), job.name);
+  item->setText(static_cast<int>(Column::State), state);
+  item->setText(static_cast<int>(Column::Threads), QString::number(job.threadCost));
+  item->setText(static_cast<int>(Column::Queued), job.queuedTime.toString(timeFormat));
+  item->setText(static_cast<int>(Column::Started), job.startTime.isValid() ? job.startTime.toString(timeFormat) : QString());
+  item->setText(static_cast<int>(Column::Elapsed), elapsed);
+  item->setToolTip(static_cast<int>(Column::Name), job.inputFiles.isEmpty() ? QString() : tr("Reads: %1").arg(job.inputFiles.join(", ")));
+}
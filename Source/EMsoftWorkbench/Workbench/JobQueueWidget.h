@@ -0,0 +1,109 @@
+/* ============================================================================
+ * Copyright (c) 2009-2017 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-07-D-5800
+ *    United States Air Force Prime Contract FA8650-10-D-5210
+ *    United States Prime Contract Navy N00173-07-C-2068
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#pragma once
+
+#include <QtWidgets/QWidget>
+
+class QPushButton;
+class QTimer;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+/**
+ * @brief The JobQueueWidget class lists the jobs of the JobScheduler with their state, thread cost and timing,
+ * and lets the user cancel a job or clear out the jobs that are done.
+ */
+class JobQueueWidget : public QWidget
+{
+  Q_OBJECT
+
+public:
+  JobQueueWidget(QWidget* parent = nullptr);
+  ~JobQueueWidget() override;
+
+  using EnumType = unsigned int;
+
+  enum class Column : EnumType
+  {
+    Name = 0,
+    State,
+    Threads,
+    Queued,
+    Started,
+    Elapsed
+  };
+
+protected:
+  /**
+   * @brief setupGui
+   */
+  void setupGui();
+
+protected slots:
+  /**
+   * @brief Rebuilds the job list from the scheduler
+   */
+  void updateJobs();
+
+  /**
+   * @brief Updates the elapsed time of the running jobs
+   */
+  void updateElapsedTimes();
+
+  /**
+   * @brief updateButtonStates
+   */
+  void updateButtonStates();
+
+private:
+  QTreeWidget* m_JobsTree = nullptr;
+  QPushButton* m_CancelBtn = nullptr;
+  QPushButton* m_ClearBtn = nullptr;
+  QTimer* m_ElapsedTimer = nullptr;
+
+  /**
+   * @brief updateItem
+   * @param item
+   * @param id
+   */
+  void updateItem(QTreeWidgetItem* item, int id) const;
+
+public:
+  JobQueueWidget(const JobQueueWidget&) = delete;            // Copy Constructor Not Implemented
+  JobQueueWidget(JobQueueWidget&&) = delete;                 // Move Constructor Not Implemented
+  JobQueueWidget& operator=(const JobQueueWidget&) = delete; // Copy Assignment Not Implemented
+  JobQueueWidget& operator=(JobQueueWidget&&) = delete;      // Move Assignment Not Implemented
+};
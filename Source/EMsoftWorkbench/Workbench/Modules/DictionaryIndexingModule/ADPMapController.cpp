@@ -35,11 +35,14 @@
 
 #include "ADPMapController.h"
 
+#include <algorithm>
+
 #include <QtCore/QTextStream>
 
 #include <QtGui/QImage>
 
 #include "EMsoftLib/EMsoftStringConstants.h"
+#include "EMsoftWrapperLib/DictionaryIndexing/EMsoftDIwrappers.h"
 
 #include "Workbench/Common/FileIOTools.h"
 
@@ -47,6 +50,7 @@ using InputType = EMsoftWorkbenchConstants::InputType;
 
 const QString k_ExeName = QString("EMgetADP");
 const QString k_NMLName = QString("EMgetADP.nml");
+const QString k_TmpFileName = QString("EMEBSDDict_tmp.data");
 
 // -----------------------------------------------------------------------------
 //
@@ -69,61 +73,94 @@ void ADPMapController::setData(const InputDataType& data)
   m_InputData = data;
 }
 
+// -----------------------------------------------------------------------------
+bool ADPMapController::hasInProcessDriver() const
+{
+  return true;
+}
+
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
-void ADPMapController::executeWrapper()
+void ADPMapController::executeInProcess()
+{
+  initializeData();
+
+  std::vector<int32_t> iParVector = getIParVector();
+  std::vector<float> fParVector = getFParVector();
+  std::vector<char> sParVector = getSParVector();
+
+  // The mask is sized to the pattern; the IQ and ADP maps are always sized to the full scan, even
+  // when a region of interest is selected.  The wrapper multiplies every pattern by the mask and only
+  // zeroes the pixels outside the mask circle, so the mask must start out as all ones.
+  size_t patternSize = static_cast<size_t>(m_InputData.patternWidth) * m_InputData.patternHeight;
+  size_t mapSize = static_cast<size_t>(m_InputData.ipfWidth) * m_InputData.ipfHeight;
+  m_OutputMaskVector.resize(patternSize, 1.0f);
+  m_OutputIQMapVector.resize(mapSize, 0.0f);
+  m_OutputADPMapVector.resize(mapSize, 0.0f);
+
+  // m_Cancel is passed on to the EMsoft routine so that the Cancel button works; the m_InstanceKey
+  // routes the progress call backs to this particular controller
+  EMsoftCpreprocessEBSDPatterns(iParVector.data(), fParVector.data(), sParVector.data(), m_OutputMaskVector.data(), m_OutputIQMapVector.data(), m_OutputADPMapVector.data(),
+                                &IProcessController::ProcessProgress, m_InstanceKey, &m_Cancel);
+
+  // The preprocessed patterns are only kept around for the ADP computation
+  QFile::remove(m_TempDir.filePath(k_TmpFileName));
+
+  if(m_Cancel)
+  {
+    return;
+  }
+
+  // The preprocessed patterns are non-negative and normalized, so an all-zero map means that
+  // every pattern was zeroed during the preprocessing
+  if(std::all_of(m_OutputADPMapVector.begin(), m_OutputADPMapVector.end(), [](float value) { return value == 0.0f; }))
+  {
+    emit errorMessageGenerated(tr("The ADP map is empty; please check the pattern data file and the mask parameters."));
+    return;
+  }
+
+  QImage imageResult = createADPMapImage();
+  if(!imageResult.isNull())
+  {
+    emit adpMapCreated(imageResult);
+  }
+}
+
+// -----------------------------------------------------------------------------
+QImage ADPMapController::createADPMapImage() const
 {
-  //  initializeData();
-  //  std::vector<int32_t> iParVector = data.getIParVector();
-  //  std::vector<float> fParVector = data.getFParVector();
-  //  std::vector<char> sParVector = data.getSParVector();
-
-  //  // Create a new Mask Array
-  //  m_OutputMaskVector.resize(data.patternHeight * data.patternWidth);
-  //  std::fill(m_OutputMaskVector.begin(), m_OutputMaskVector.end(), 0.0f);
-
-  //  // Create a new IQ Map Array
-  //  m_OutputIQMapVector.resize(data.patternHeight * data.patternWidth);
-  //  std::fill(m_OutputIQMapVector.begin(), m_OutputIQMapVector.end(), 0.0f);
-
-  //  // Create a new ADP Map Array
-  //  m_OutputADPMapVector.resize(data.patternHeight * data.patternWidth);
-  //  std::fill(m_OutputADPMapVector.begin(), m_OutputADPMapVector.end(), 0.0f);
-
-  //  // Set the start time for this run (m_StartTime)
-  //  m_StartTime = QDateTime::currentDateTime().time().toString();
-
-  //  // the EMsoft call will return two arrays: mLPNH and mLPSH
-  //  // call the EMsoft EMsoftCgetEBSDmaster routine to compute the patterns;
-  //  // m_Executing enables the Cancel button to properly work by passing
-  //  // on a m_Cancel flag to the EMsoft routine; the m_InstanceKey provides
-  //  // a unique label to this particular instantiation of this filter, so that
-  //  // multiple simultaneous instantiations of this filter become possible without
-  //  // incorrect interactions between the callback routines.
-  //  m_Executing = true;
-  //  s_ControllerInstances[m_InstanceKey] = this;
-  //  //  EMsoftCpreprocessEBSDPatterns(iParVector.data(), fParVector.data(), sParVector.data(), m_OutputMaskVector.data(), m_OutputIQMapVector.data(), m_OutputADPMapVector.data(),
-  //  //  &ADPMapControllerProgress, m_InstanceKey, &m_Cancel);
-
-  //  QSharedPointer<QProcess> avgDotProductMapProcess = QSharedPointer<QProcess>(new QProcess());
-  //  connect(avgDotProductMapProcess.data(), &QProcess::readyReadStandardOutput, [=] { emit
-  //  stdOutputMessageGenerated(QString::fromStdString(avgDotProductMapProcess->readAllStandardOutput().toStdString())); }); connect(avgDotProductMapProcess.data(), &QProcess::readyReadStandardError,
-  //          [=] { emit stdOutputMessageGenerated(QString::fromStdString(avgDotProductMapProcess->readAllStandardError().toStdString())); });
-  //  connect(avgDotProductMapProcess.data(), QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), [=](int exitCode, QProcess::ExitStatus exitStatus) { listenADPMapFinished(exitCode,
-  //  exitStatus); }); QString adpExecutablePath = getADPMapExecutablePath(); if (!adpExecutablePath.isEmpty())
-  //  {
-  //    QString nmlFilePath = m_TempDir.path() + QDir::separator() + "EMgetADP.nml";
-  //    generateNMLFile(nmlFilePath, data);
-  //    QStringList parameters = {nmlFilePath};
-  //    avgDotProductMapProcess->start(adpExecutablePath, parameters);
-
-  //    // Wait until the QProcess is finished to exit this thread.
-  //    // ADPMapController::createADPMap is currently on a separate thread, so the GUI will continue to operate normally
-  //    avgDotProductMapProcess->waitForFinished(-1);
-  //  }
-
-  //  emit finished();
+  int width = m_InputData.ipfWidth;
+  int height = m_InputData.ipfHeight;
+  if(m_InputData.useROI)
+  {
+    width = m_InputData.roi_3;
+    height = m_InputData.roi_4;
+  }
+
+  size_t count = static_cast<size_t>(width) * height;
+  if(width <= 0 || height <= 0 || count > m_OutputADPMapVector.size())
+  {
+    return {};
+  }
+
+  // Same byte scaling that EMgetADP uses for its tiff output
+  auto minMax = std::minmax_element(m_OutputADPMapVector.begin(), m_OutputADPMapVector.begin() + count);
+  float min = *minMax.first;
+  float range = *minMax.second - min;
+
+  QImage image(width, height, QImage::Format_Grayscale8);
+  for(int y = 0; y < height; y++)
+  {
+    uchar* scanLine = image.scanLine(y);
+    for(int x = 0; x < width; x++)
+    {
+      float value = m_OutputADPMapVector[static_cast<size_t>(y) * width + x];
+      scanLine[x] = (range > 0.0f) ? static_cast<uchar>(255.0f * (value - min) / range) : 0;
+    }
+  }
+
+  return image;
 }
 
 // -----------------------------------------------------------------------------
@@ -162,6 +199,9 @@ void ADPMapController::generateNMLFile(const QString& filePath)
   nml.emplace_back(FileIOTools::CreateNMLEntry(EMsoft::Constants::hipassw, m_InputData.hipassFilter));
   nml.emplace_back(std::string("! number of regions for adaptive histogram equalization"));
   nml.emplace_back(FileIOTools::CreateNMLEntry(EMsoft::Constants::nregions, m_InputData.numOfRegions));
+  nml.emplace_back(std::string("! neighborhood type (4 or 8) and radius (in pixels) for the average dot product"));
+  nml.emplace_back(FileIOTools::CreateNMLEntry(EMsoft::Constants::nbtype, m_InputData.nbType));
+  nml.emplace_back(FileIOTools::CreateNMLEntry(EMsoft::Constants::radius, m_InputData.nbRadius));
   nml.emplace_back(std::string("! number of pattern pixels along x and y"));
   nml.emplace_back(FileIOTools::CreateNMLEntry(EMsoft::Constants::numsx, m_InputData.patternWidth));
   nml.emplace_back(FileIOTools::CreateNMLEntry(EMsoft::Constants::numsy, m_InputData.patternHeight));
@@ -279,80 +319,80 @@ void ADPMapController::initializeData()
   m_OutputADPMapVector.clear();
 }
 
-//// -----------------------------------------------------------------------------
-////
-//// -----------------------------------------------------------------------------
-// std::vector<int32_t> ADPMapController::ADPMapData::getIParVector() const
-//{
-//  std::vector<int32_t> iParVector(SizeConstants::IParSize, 0);
-
-//  iParVector[17] = numOfThreads;
-//  iParVector[18] = patternWidth;
-//  iParVector[19] = patternHeight;
-////  iParVector[21] = binningFactor;
-//  iParVector[22] = patternWidth;
-//  iParVector[23] = patternHeight;
-//  iParVector[25] = ipfWidth;
-//  iParVector[26] = ipfHeight;
-//  iParVector[27] = numOfRegions;
-////  iParVector[28] = maskPattern;
-
-//  if (useROI)
-//  {
-//    iParVector[29] = 1;
-//  }
-//  else
-//  {
-//    iParVector[29] = 0;
-//  }
-
-//  iParVector[30] = roi_1;
-//  iParVector[31] = roi_2;
-//  iParVector[32] = roi_3;
-//  iParVector[33] = roi_4;
-//  iParVector[34] = static_cast<int>(inputType);
-
-//  return iParVector;
-//}
-
-//// -----------------------------------------------------------------------------
-////
-//// -----------------------------------------------------------------------------
-// std::vector<float> ADPMapController::ADPMapData::getFParVector() const
-//{
-//  std::vector<float> fParVector(SizeConstants::FParSize, 0.0f);
-
-//  fParVector[22] = maskRadius;
-//  fParVector[23] = hipassFilter;
-
-//  return fParVector;
-//}
-
-//// -----------------------------------------------------------------------------
-////
-//// -----------------------------------------------------------------------------
-// std::vector<char> ADPMapController::ADPMapData::getSParVector() const
-//{
-//  // Move each string from the string array into the char array.  Each string has SParStringSize as its max size.
-//  std::vector<char> sParVector(SizeConstants::SParSize * SizeConstants::SParStringSize, 0);
-//  char* sPar = sParVector.data();
-
-////  // Move Output File Path into the vector
-////  const char* charArray = outputFilePath.toStdString().c_str();
-////  std::memcpy(sPar + (30 * SizeConstants::SParStringSize), charArray, outputFilePath.size());
-
-//  // Move Pattern Data File into the vector
-//  const char* charArray = patternDataFile.toStdString().c_str();
-//  std::memcpy(sPar + (31 * SizeConstants::SParStringSize), charArray, patternDataFile.size());
-
-//  // Move HDF Strings into the vector
-//  int count = 40;
-//  for (const QString &hdfString : hdfStrings)
-//  {
-//    charArray = hdfString.toStdString().c_str();
-//    std::memcpy(sPar + (count * SizeConstants::SParStringSize), charArray, hdfString.size());
-//    count++;
-//  }
-
-//  return sParVector;
-//}
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+std::vector<int32_t> ADPMapController::getIParVector() const
+{
+  std::vector<int32_t> iParVector(EMsoftWorkbenchConstants::Constants::IParSize, 0);
+
+  iParVector[17] = m_InputData.numOfThreads;
+  iParVector[18] = m_InputData.patternWidth;
+  iParVector[19] = m_InputData.patternHeight;
+  iParVector[21] = 1; // binning factor; the wrapper divides by it
+  iParVector[22] = m_InputData.patternWidth;
+  iParVector[23] = m_InputData.patternHeight;
+  iParVector[25] = m_InputData.ipfWidth;
+  iParVector[26] = m_InputData.ipfHeight;
+  iParVector[27] = m_InputData.numOfRegions;
+  iParVector[28] = 0; // maskpattern
+
+  if(m_InputData.useROI)
+  {
+    iParVector[29] = 1;
+  }
+  else
+  {
+    iParVector[29] = 0;
+  }
+
+  iParVector[30] = m_InputData.roi_1;
+  iParVector[31] = m_InputData.roi_2;
+  iParVector[32] = m_InputData.roi_3;
+  iParVector[33] = m_InputData.roi_4;
+
+  // The wrapper routine numbers the input types from 1
+  iParVector[34] = static_cast<int32_t>(m_InputData.inputType) + 1;
+
+  // ADP neighborhood
+  iParVector[51] = m_InputData.nbType;
+  iParVector[52] = m_InputData.nbRadius;
+
+  return iParVector;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+std::vector<float> ADPMapController::getFParVector() const
+{
+  std::vector<float> fParVector(EMsoftWorkbenchConstants::Constants::FParSize, 0.0f);
+
+  fParVector[22] = m_InputData.maskRadius;
+  fParVector[23] = m_InputData.hipassFilter;
+
+  return fParVector;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+std::vector<char> ADPMapController::getSParVector() const
+{
+  // Each string has SParStringSize as its max size.
+  std::vector<char> sParVector(EMsoftWorkbenchConstants::Constants::SParSize * EMsoftWorkbenchConstants::Constants::SParStringSize, 0);
+
+  // Temporary file for the preprocessed patterns; the EMtmppathname slot is left empty, so this is an absolute path
+  SetSParString(sParVector, 30, m_TempDir.filePath(k_TmpFileName));
+
+  // Pattern Data File
+  SetSParString(sParVector, 31, FileIOTools::GetAbsolutePath(m_InputData.patternDataFile));
+
+  // HDF Strings
+  for(int i = 0; i < m_InputData.hdfStrings.size() && i < 10; i++)
+  {
+    SetSParString(sParVector, 40 + i, m_InputData.hdfStrings.at(i));
+  }
+
+  return sParVector;
+}
@@ -37,6 +37,8 @@
 
 #include <QtCore/QTemporaryDir>
 
+#include <QtGui/QImage>
+
 #include "Modules/IProcessController.h"
 
 #include "Common/Constants.h"
@@ -70,6 +72,8 @@ public:
     float hipassFilter;
     int numOfRegions;
     int numOfThreads;
+    int nbType;
+    int nbRadius;
     QStringList hdfStrings;
   };
 
@@ -105,15 +109,27 @@ private:
   void processFinished() override;
 
   /**
-   * @brief executeWrapper
+   * @brief hasInProcessDriver
+   * @return
+   */
+  bool hasInProcessDriver() const override;
+
+  /**
+   * @brief Computes the ADP map through EMsoftCpreprocessEBSDPatterns and emits it straight from the returned buffer
+   */
+  void executeInProcess() override;
+
+  /**
+   * @brief Converts the ADP map buffer (or its region of interest) into an 8-bit image
+   * @return
    */
-  void executeWrapper();
+  QImage createADPMapImage() const;
 
-  //  std::vector<int32_t> getIParVector() const;
+  std::vector<int32_t> getIParVector() const;
 
-  //  std::vector<float> getFParVector() const;
+  std::vector<float> getFParVector() const;
 
-  //  std::vector<char> getSParVector() const;
+  std::vector<char> getSParVector() const;
 
 public:
   ADPMapController(const ADPMapController&) = delete; // Copy Constructor Not Implemented
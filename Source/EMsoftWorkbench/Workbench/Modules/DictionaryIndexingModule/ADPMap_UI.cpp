@@ -106,6 +106,7 @@ void ADPMap_UI::createValidators()
 //  m_Ui->maskPatternLE->setValidator(new QIntValidator(m_Ui->maskPatternLE));
   m_Ui->numOfRegionsLE->setValidator(new QIntValidator(1, std::numeric_limits<int>::max(), m_Ui->numOfRegionsLE));
   m_Ui->numOfThreadsLE->setValidator(new QIntValidator(1, QThreadPool::globalInstance()->maxThreadCount(), m_Ui->numOfThreadsLE));
+  m_Ui->nbRadiusLE->setValidator(new QIntValidator(1, std::numeric_limits<int>::max(), m_Ui->nbRadiusLE));
 
   //  m_Ui->adpMapZoomSB->setMaximum(std::numeric_limits<int>::max());
 }
@@ -132,6 +133,10 @@ void ADPMap_UI::createModificationConnections()
   connect(m_Ui->numOfThreadsLE, &QLineEdit::textChanged, [=] { emit parametersChanged(); });
   connect(m_Ui->maskRadiusLE, &QLineEdit::textChanged, [=] { emit parametersChanged(); });
   connect(m_Ui->hipassLE, &QLineEdit::textChanged, [=] { emit parametersChanged(); });
+  connect(m_Ui->nbRadiusLE, &QLineEdit::textChanged, [=] { emit parametersChanged(); });
+
+  // Combo Boxes
+  connect(m_Ui->nbTypeCB, QOverload<int>::of(&QComboBox::currentIndexChanged), [=] { emit parametersChanged(); });
 
   // Checkboxes
   connect(m_Ui->roiCB, &QCheckBox::stateChanged, this, &ADPMap_UI::listenROICheckboxStateChanged);
@@ -358,6 +363,8 @@ ADPMapController::InputDataType ADPMap_UI::getADPMapData()
   data.hipassFilter = m_Ui->hipassLE->text().toDouble();
   data.numOfRegions = m_Ui->numOfRegionsLE->text().toInt();
   data.numOfThreads = m_Ui->numOfThreadsLE->text().toInt();
+  data.nbType = m_Ui->nbTypeCB->currentText().toInt();
+  data.nbRadius = m_Ui->nbRadiusLE->text().toInt();
   data.patternWidth = m_Ui->patternWidthLE->text().toInt();
 //  data.binningFactor = m_Ui->binningFactorLE->text().toInt();
   data.patternHeight = m_Ui->patternHeightLE->text().toInt();
@@ -389,6 +396,8 @@ void ADPMap_UI::readSession(const QJsonObject &obj)
     m_Ui->hipassLE->setText(QString::number(adpMapParamsObj[ioConstants::HipassFilter].toDouble()));
     m_Ui->numOfRegionsLE->setText(QString::number(adpMapParamsObj[ioConstants::NumberOfRegions].toInt()));
     m_Ui->numOfThreadsLE->setText(QString::number(adpMapParamsObj[ioConstants::NumberOfThreads].toInt()));
+    m_Ui->nbTypeCB->setCurrentText(QString::number(adpMapParamsObj[ioConstants::NeighborhoodType].toInt(4)));
+    m_Ui->nbRadiusLE->setText(QString::number(adpMapParamsObj[ioConstants::NeighborhoodRadius].toInt(1)));
 
     m_Ui->adpViewer->readSession(adpMapParamsObj);
 
@@ -419,6 +428,8 @@ void ADPMap_UI::writeSession(QJsonObject& obj) const
   adpMapParamsObj[ioConstants::HipassFilter] = m_Ui->hipassLE->text().toDouble();
   adpMapParamsObj[ioConstants::NumberOfRegions] = m_Ui->numOfRegionsLE->text().toInt();
   adpMapParamsObj[ioConstants::NumberOfThreads] = m_Ui->numOfThreadsLE->text().toInt();
+  adpMapParamsObj[ioConstants::NeighborhoodType] = m_Ui->nbTypeCB->currentText().toInt();
+  adpMapParamsObj[ioConstants::NeighborhoodRadius] = m_Ui->nbRadiusLE->text().toInt();
   m_Ui->adpViewer->writeSession(adpMapParamsObj);
 
   obj[ioConstants::ADPMapParams] = adpMapParamsObj;
@@ -77,6 +77,8 @@ namespace DictionaryIndexingModuleConstants
     const QString HipassFilter = "Hipass Filter";
     const QString NumberOfRegions = "Number Of Regions";
     const QString NumberOfThreads = "Number Of Threads";
+    const QString NeighborhoodType = "Neighborhood Type";
+    const QString NeighborhoodRadius = "Neighborhood Radius";
     const QString SelectedADPCoordX = "Selected ADP Coord X";
     const QString SelectedADPCoordY = "Selected ADP Coord Y";
 
@@ -58,15 +58,12 @@
 const QString k_ExeName = QString("EMEBSDDI");
 const QString k_NMLName = QString("EMEBSDDI.nml");
 
-static size_t k_InstanceKey = 0;
-static QMap<size_t, DictionaryIndexingController*> instances;
-
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
 void DIProcessTiming(size_t instance, int loopCompleted, int totalLoops, float timeRemaining)
 {
-  DictionaryIndexingController* obj = instances[instance];
+  auto* obj = dynamic_cast<DictionaryIndexingController*>(IProcessController::GetInstance(instance));
   if(nullptr != obj)
   {
     obj->setUpdateProgress(loopCompleted, totalLoops, timeRemaining);
@@ -78,7 +75,7 @@ void DIProcessTiming(size_t instance, int loopCompleted, int totalLoops, float t
 // -----------------------------------------------------------------------------
 void DIProcessOutput(size_t instance, int nDict, float** eulerArray, float** dpArray, int32_t** indexArray)
 {
-  DictionaryIndexingController* obj = instances[instance];
+  auto* obj = dynamic_cast<DictionaryIndexingController*>(IProcessController::GetInstance(instance));
   if(nullptr != obj)
   {
     obj->updateOutput(nDict, *eulerArray, *dpArray, *indexArray);
@@ -90,7 +87,7 @@ void DIProcessOutput(size_t instance, int nDict, float** eulerArray, float** dpA
 // -----------------------------------------------------------------------------
 void DIProcessError(size_t instance, int errorCode)
 {
-  DictionaryIndexingController* obj = instances[instance];
+  auto* obj = dynamic_cast<DictionaryIndexingController*>(IProcessController::GetInstance(instance));
   if(nullptr != obj)
   {
     obj->reportError(errorCode);
@@ -103,7 +100,6 @@ void DIProcessError(size_t instance, int errorCode)
 DictionaryIndexingController::DictionaryIndexingController(QObject* parent)
 : IProcessController(k_ExeName, k_NMLName, parent)
 {
-  m_InstanceKey = ++k_InstanceKey;
 }
 
 // -----------------------------------------------------------------------------
@@ -111,7 +107,6 @@ DictionaryIndexingController::DictionaryIndexingController(QObject* parent)
 // -----------------------------------------------------------------------------
 DictionaryIndexingController::~DictionaryIndexingController()
 {
-  k_InstanceKey--;
 }
 
 // -----------------------------------------------------------------------------
@@ -133,7 +128,15 @@ void DictionaryIndexingController::setData(const InputDataType& data)
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
-void DictionaryIndexingController::executeWrapper()
+bool DictionaryIndexingController::hasInProcessDriver() const
+{
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void DictionaryIndexingController::executeInProcess()
 {
   initializeData();
 
@@ -157,14 +160,9 @@ void DictionaryIndexingController::executeWrapper()
   // a unique label to this particular instantiation of this filter, so that
   // multiple simultaneous instantiations of this filter become possible without
   // incorrect interactions between the callback routines.
-  m_Executing = true;
-  instances[m_InstanceKey] = this;
-
-  char* nmlFilePathArray = nmlFilePath.toLatin1().data();
-  char* appNameArray = QCoreApplication::applicationName().toLatin1().data();
-  EBSDDIdriver(nmlFilePathArray, appNameArray, &DIProcessOutput, &DIProcessTiming, &DIProcessError, m_InstanceKey, &m_Cancel);
-
-  emit finished();
+  QByteArray nmlFilePathArray = nmlFilePath.toLatin1();
+  QByteArray appNameArray = QCoreApplication::applicationName().toLatin1();
+  EBSDDIdriver(nmlFilePathArray.data(), appNameArray.data(), &DIProcessOutput, &DIProcessTiming, &DIProcessError, m_InstanceKey, &m_Cancel);
 }
 
 // -----------------------------------------------------------------------------
@@ -163,18 +163,11 @@ public:
    */
   void updateOutput(int nDict, float* eulerArray, float* dpArray, int32_t* indexArray);
 
-public slots:
-  /**
-   * @brief executeWrapper
-   */
-  void executeWrapper();
-
 signals:
   void diCreated(const QImage& dIndex) const;
 
 private:
   InputDataType m_InputData;
-  size_t m_InstanceKey = 0;
 
   int m_SpaceGroupNumber = 0;
 
@@ -201,6 +194,17 @@ private:
    */
   void processFinished() override;
 
+  /**
+   * @brief hasInProcessDriver
+   * @return
+   */
+  bool hasInProcessDriver() const override;
+
+  /**
+   * @brief Runs EBSDDIdriver on the calling thread; the indexing results come back through the DI call backs
+   */
+  void executeInProcess() override;
+
   /**
    * @brief getRegionOfInterest
    * @return
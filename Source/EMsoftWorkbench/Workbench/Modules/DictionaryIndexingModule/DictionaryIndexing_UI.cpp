@@ -37,9 +37,14 @@
 
 #include <QtConcurrent>
 
+#include <QtCore/QFileInfo>
+
 #include <QtWidgets/QFileDialog>
 
+#include "Common/FileIOTools.h"
+
 #include "Modules/DictionaryIndexingModule/Constants.h"
+#include "Modules/JobScheduler.h"
 #include "Modules/ModuleTools.hpp"
 
 namespace ioConstants = DictionaryIndexingModuleConstants::IOStrings;
@@ -82,6 +87,15 @@ void DictionaryIndexing_UI::setupGui()
   // Create all signal/slot connections that will update the simulated pattern when parameters are changed
   createModificationConnections();
 
+  // Indexing runs as a job in the global queue; restore the GUI once it is done, whatever the outcome
+  connect(JobScheduler::Instance(), &JobScheduler::jobStateChanged, this, [=](int id) {
+    if(id == m_JobId && JobScheduler::IsTerminal(JobScheduler::Instance()->getJob(id).state))
+    {
+      m_JobId = -1;
+      processFinished();
+    }
+  });
+
   validateData();
 
   listenIndexingModeChanged(0);
@@ -527,8 +541,7 @@ void DictionaryIndexing_UI::listenDIGenerationStarted()
 {
   if(m_Ui->generateDIBtn->text() == "Cancel")
   {
-    m_DIController->cancel();
-    emit diGenerationFinished();
+    JobScheduler::Instance()->cancelJob(m_JobId);
     return;
   }
 
@@ -547,24 +560,19 @@ void DictionaryIndexing_UI::listenDIGenerationStarted()
     m_DIController = nullptr;
   }
 
-  // Create a new QThread to run the Controller class.
-  m_WorkerThread = QSharedPointer<QThread>(new QThread());
   m_DIController = new DictionaryIndexingController;
-  m_DIController->moveToThread(m_WorkerThread.data());
   m_DIController->setData(data); // Set the input data
 
-  // Conncet Signals & Slots to get the thread started and quit
-  connect(m_WorkerThread.data(), SIGNAL(started()), m_DIController, SLOT(executeWrapper()));
-  connect(m_DIController, SIGNAL(finished()), m_WorkerThread.data(), SLOT(quit()));
-  connect(m_WorkerThread.data(), SIGNAL(finished()), this, SLOT(processFinished()));
-
   // Pass errors, warnings, and std output messages up to the user interface
   connect(m_DIController, &DictionaryIndexingController::errorMessageGenerated, this, &DictionaryIndexing_UI::errorMessageGenerated);
   connect(m_DIController, &DictionaryIndexingController::warningMessageGenerated, this, &DictionaryIndexing_UI::warningMessageGenerated);
   connect(m_DIController, SIGNAL(stdOutputMessageGenerated(QString)), this, SIGNAL(stdOutputMessageGenerated(QString)));
   connect(m_DIController, &DictionaryIndexingController::diCreated, m_Ui->diViewer, &GLImageViewer::loadImage);
 
-  m_WorkerThread->start();
+  // Queue the indexing run; it waits for any queued or running master pattern job that writes the master file
+  QStringList inputFiles = {FileIOTools::GetAbsolutePath(data.masterFile), data.patternDataFile};
+  QString jobName = tr("Dictionary Indexing: %1").arg(QFileInfo(data.patternDataFile).fileName());
+  m_JobId = JobScheduler::Instance()->submit(m_DIController, jobName, data.numOfThreads, inputFiles, QStringList());
   emit diGenerationStarted();
 }
 
@@ -187,7 +187,7 @@ private:
   QSharedPointer<Ui::DictionaryIndexing_UI> m_Ui;
 
   DictionaryIndexingController* m_DIController = nullptr;
-  QSharedPointer<QThread> m_WorkerThread;
+  int m_JobId = -1;
 
   InputType m_InputType = InputType::Binary;
   QString m_PatternDataFile;
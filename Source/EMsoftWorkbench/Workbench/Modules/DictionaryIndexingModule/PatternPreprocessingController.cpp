@@ -35,11 +35,14 @@
 
 #include "PatternPreprocessingController.h"
 
+#include <algorithm>
+
 #include <QtCore/QTextStream>
 
 #include <QtGui/QImage>
 
 #include "EMsoftLib/EMsoftStringConstants.h"
+#include "EMsoftWrapperLib/DictionaryIndexing/EMsoftDIwrappers.h"
 
 #include "Workbench/Common/FileIOTools.h"
 
@@ -69,61 +72,61 @@ void PatternPreprocessingController::setData(const InputDataType& data)
   m_InputData = data;
 }
 
+// -----------------------------------------------------------------------------
+bool PatternPreprocessingController::hasInProcessDriver() const
+{
+  return true;
+}
+
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
-void PatternPreprocessingController::executeWrapper()
+void PatternPreprocessingController::executeInProcess()
 {
-  //  // WIP: This code currently calls out to a QProcess, but eventually it will use a C++ callback method instead
-
-  ////  initializeData();
-
-  ////  std::vector<int32_t> iParVector = data.getIParVector();
-  ////  std::vector<float> fParVector = data.getFParVector();
-  ////  std::vector<char> sParVector = data.getSParVector();
-
-  ////  // Create a new Mask Array
-  ////  m_OutputMaskVector.resize(data.patternHeight * data.patternWidth);
-  ////  std::fill(m_OutputMaskVector.begin(), m_OutputMaskVector.end(), 0.0f);
-
-  ////  // Create a new IQ Map Array
-  ////  m_OutputIQMapVector.resize(data.patternHeight * data.patternWidth);
-  ////  std::fill(m_OutputIQMapVector.begin(), m_OutputIQMapVector.end(), 0.0f);
-
-  ////  // Create a new ADP Map Array
-  ////  m_OutputADPMapVector.resize(data.patternHeight * data.patternWidth);
-  ////  std::fill(m_OutputADPMapVector.begin(), m_OutputADPMapVector.end(), 0.0f);
-
-  //  // Set the start time for this run (m_StartTime)
-  //  m_StartTime = QDateTime::currentDateTime().time().toString();
-
-  //  // the EMsoft call will return two arrays: mLPNH and mLPSH
-  //  // call the EMsoft EMsoftCgetEBSDmaster routine to compute the patterns;
-  //  // m_Executing enables the Cancel button to properly work by passing
-  //  // on a m_Cancel flag to the EMsoft routine; the m_InstanceKey provides
-  //  // a unique label to this particular instantiation of this filter, so that
-  //  // multiple simultaneous instantiations of this filter become possible without
-  //  // incorrect interactions between the callback routines.
-  //  m_Executing = true;
-  //  instances[m_InstanceKey] = this;
-  ////  EMsoftCpreprocessEBSDPatterns(iParVector.data(), fParVector.data(), sParVector.data(), m_OutputMaskVector.data(), m_OutputIQMapVector.data(), m_OutputADPMapVector.data(),
-  ///&PatternPreprocessingControllerProgress, m_InstanceKey, &m_Cancel);
-
-  //  QSharedPointer<QProcess> ppMatrixProcess = QSharedPointer<QProcess>(new QProcess());
-  //  connect(ppMatrixProcess.data(), &QProcess::readyReadStandardOutput, [=] { emit stdOutputMessageGenerated(QString::fromStdString(ppMatrixProcess->readAllStandardOutput().toStdString())); });
-  //  connect(ppMatrixProcess.data(), &QProcess::readyReadStandardError, [=] { emit stdOutputMessageGenerated(QString::fromStdString(ppMatrixProcess->readAllStandardError().toStdString())); });
-  //  connect(ppMatrixProcess.data(), QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), [=](int exitCode, QProcess::ExitStatus exitStatus) {
-  //  listenPreprocessedPatternsMatrixFinished(exitCode, exitStatus); }); QString ppMatrixExecutablePath = getPreprocessedPatternsMatrixExecutablePath(); if (!ppMatrixExecutablePath.isEmpty())
-  //  {
-  //    QString nmlFilePath = m_TempDir.path() + QDir::separator() + "EMEBSDDIpreview.nml";
-  //    writePreprocessedPatternsMatrixToFile(nmlFilePath, data);
-  //    QStringList parameters = {nmlFilePath};
-  //    ppMatrixProcess->start(ppMatrixExecutablePath, parameters);
-
-  //    // Wait until the QProcess is finished to exit this thread.
-  //    // PatternPreprocessingController::createPreprocessedPatternsMatrix is currently on a separate thread, so the GUI will continue to operate normally
-  //    ppMatrixProcess->waitForFinished(-1);
-  //  }
+  initializeData();
+
+  std::vector<int32_t> iParVector = getIParVector();
+  std::vector<float> fParVector = getFParVector();
+  std::vector<char> sParVector = getSParVector();
+
+  size_t patternSize = static_cast<size_t>(m_InputData.patternWidth) * m_InputData.patternHeight;
+  m_AveragedPatternVector.resize(patternSize, 0.0f);
+  m_PatternMatrixVector.resize(patternSize * m_InputData.numw * m_InputData.numr, 0.0f);
+
+  EMsoftCEBSDDIpreview(iParVector.data(), fParVector.data(), sParVector.data(), m_AveragedPatternVector.data(), m_PatternMatrixVector.data());
+  ProcessProgress(m_InstanceKey, 1, 1);
+
+  QImage imageResult = createPatternMatrixImage();
+  if(!imageResult.isNull())
+  {
+    emit preprocessedPatternsMatrixCreated(imageResult);
+  }
+}
+
+// -----------------------------------------------------------------------------
+QImage PatternPreprocessingController::createPatternMatrixImage() const
+{
+  // The matrix holds numw patterns horizontally (hipass values) by numr patterns vertically (region counts),
+  // already scaled to [0, 255] by the wrapper routine
+  int width = m_InputData.numw * m_InputData.patternWidth;
+  int height = m_InputData.numr * m_InputData.patternHeight;
+  if(width <= 0 || height <= 0 || static_cast<size_t>(width) * height > m_PatternMatrixVector.size())
+  {
+    return {};
+  }
+
+  QImage image(width, height, QImage::Format_Grayscale8);
+  for(int y = 0; y < height; y++)
+  {
+    uchar* scanLine = image.scanLine(y);
+    for(int x = 0; x < width; x++)
+    {
+      float value = m_PatternMatrixVector[static_cast<size_t>(y) * width + x];
+      scanLine[x] = static_cast<uchar>(std::max(0.0f, std::min(255.0f, value)));
+    }
+  }
+
+  return image;
 }
 
 // -----------------------------------------------------------------------------
@@ -250,74 +253,66 @@ void PatternPreprocessingController::processFinished()
 // -----------------------------------------------------------------------------
 void PatternPreprocessingController::initializeData()
 {
-  m_OutputMaskVector.clear();
-  m_OutputIQMapVector.clear();
-  m_OutputADPMapVector.clear();
+  m_AveragedPatternVector.clear();
+  m_PatternMatrixVector.clear();
 }
 
-//// -----------------------------------------------------------------------------
-////
-//// -----------------------------------------------------------------------------
-// std::vector<int32_t> PatternPreprocessingController::PPMatrixData::getIParVector() const
-//{
-//  std::vector<int32_t> iParVector(SizeConstants::IParSize, 0);
-
-//  iParVector[18] = patternWidth;
-//  iParVector[19] = patternHeight;
-//  iParVector[25] = ipfWidth;
-//  iParVector[26] = ipfHeight;
-//  iParVector[34] = static_cast<int>(inputType);
-//  iParVector[44] = minNumOfRegions;
-//  iParVector[45] = numOfRegionsStepSize;
-//  iParVector[47] = patternCoordinateX;
-//  iParVector[48] = patternCoordinateY;
-
-//  // Used in wrapper routine, but not NML file...
-//  iParVector[46] = numav;
-//  iParVector[49] = numw;
-//  iParVector[50] = numr;
-
-//  return iParVector;
-//}
-
-//// -----------------------------------------------------------------------------
-////
-//// -----------------------------------------------------------------------------
-// std::vector<float> PatternPreprocessingController::PPMatrixData::getFParVector() const
-//{
-//  std::vector<float> fParVector(SizeConstants::FParSize, 0.0f);
-
-//  fParVector[23] = hipassFilter;
-//  fParVector[25] = hipassValue;
-
-//  return fParVector;
-//}
-
-//// -----------------------------------------------------------------------------
-////
-//// -----------------------------------------------------------------------------
-// std::vector<char> PatternPreprocessingController::PPMatrixData::getSParVector() const
-//{
-//  // Move each string from the string array into the char array.  Each string has SParStringSize as its max size.
-//  std::vector<char> sParVector(SizeConstants::SParSize * SizeConstants::SParStringSize, 0);
-//  char* sPar = sParVector.data();
-
-////  // Move Output File Path into the vector
-////  const char* charArray = outputFilePath.toStdString().c_str();
-////  std::memcpy(sPar + (30 * SizeConstants::SParStringSize), charArray, outputFilePath.size());
-
-//  // Move Pattern Data File into the vector
-//  const char* charArray = patternDataFile.toStdString().c_str();
-//  std::memcpy(sPar + (31 * SizeConstants::SParStringSize), charArray, patternDataFile.size());
-
-//  // Move HDF Strings into the vector
-//  int count = 40;
-//  for (const QString &hdfString : hdfStrings)
-//  {
-//    charArray = hdfString.toStdString().c_str();
-//    std::memcpy(sPar + (count * SizeConstants::SParStringSize), charArray, hdfString.size());
-//    count++;
-//  }
-
-//  return sParVector;
-//}
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+std::vector<int32_t> PatternPreprocessingController::getIParVector() const
+{
+  std::vector<int32_t> iParVector(EMsoftWorkbenchConstants::Constants::IParSize, 0);
+
+  iParVector[18] = m_InputData.patternWidth;
+  iParVector[19] = m_InputData.patternHeight;
+  iParVector[25] = m_InputData.ipfWidth;
+  iParVector[26] = m_InputData.ipfHeight;
+
+  // The wrapper routine numbers the input types from 1
+  iParVector[34] = static_cast<int32_t>(m_InputData.inputType) + 1;
+  iParVector[44] = m_InputData.minNumOfRegions;
+  iParVector[45] = m_InputData.numOfRegionsStepSize;
+  iParVector[47] = m_InputData.patternCoordinateX;
+  iParVector[48] = m_InputData.patternCoordinateY;
+
+  // Used in wrapper routine, but not NML file...
+  iParVector[46] = m_InputData.numav;
+  iParVector[49] = m_InputData.numw;
+  iParVector[50] = m_InputData.numr;
+
+  return iParVector;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+std::vector<float> PatternPreprocessingController::getFParVector() const
+{
+  std::vector<float> fParVector(EMsoftWorkbenchConstants::Constants::FParSize, 0.0f);
+
+  fParVector[23] = m_InputData.hipassFilter;
+  fParVector[25] = m_InputData.hipassValue;
+
+  return fParVector;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+std::vector<char> PatternPreprocessingController::getSParVector() const
+{
+  // Each string has SParStringSize as its max size.
+  std::vector<char> sParVector(EMsoftWorkbenchConstants::Constants::SParSize * EMsoftWorkbenchConstants::Constants::SParStringSize, 0);
+
+  // Pattern Data File
+  SetSParString(sParVector, 31, FileIOTools::GetAbsolutePath(m_InputData.patternDataFile));
+
+  // HDF Strings
+  for(int i = 0; i < m_InputData.hdfStrings.size() && i < 10; i++)
+  {
+    SetSParString(sParVector, 40 + i, m_InputData.hdfStrings.at(i));
+  }
+
+  return sParVector;
+}
@@ -37,6 +37,8 @@
 
 #include <QtCore/QTemporaryDir>
 
+#include <QtGui/QImage>
+
 #include "Common/Constants.h"
 
 #include "Modules/IProcessController.h"
@@ -87,9 +89,8 @@ signals:
 private:
   InputDataType m_InputData;
 
-  std::vector<float> m_OutputMaskVector;
-  std::vector<float> m_OutputIQMapVector;
-  std::vector<float> m_OutputADPMapVector;
+  std::vector<float> m_AveragedPatternVector;
+  std::vector<float> m_PatternMatrixVector;
 
   QTemporaryDir m_TempDir;
 
@@ -110,15 +111,27 @@ private:
   void processFinished() override;
 
   /**
-   * @brief executeWrapper
+   * @brief hasInProcessDriver
+   * @return
+   */
+  bool hasInProcessDriver() const override;
+
+  /**
+   * @brief Computes the matrix of preprocessed patterns through EMsoftCEBSDDIpreview and emits it straight from the returned buffer
+   */
+  void executeInProcess() override;
+
+  /**
+   * @brief Converts the preprocessed pattern matrix buffer into an 8-bit image
+   * @return
    */
-  void executeWrapper();
+  QImage createPatternMatrixImage() const;
 
-  //  std::vector<int32_t> getIParVector() const;
+  std::vector<int32_t> getIParVector() const;
 
-  //  std::vector<float> getFParVector() const;
+  std::vector<float> getFParVector() const;
 
-  //  std::vector<char> getSParVector() const;
+  std::vector<char> getSParVector() const;
 
 public:
   PatternPreprocessingController(const PatternPreprocessingController&) = delete; // Copy Constructor Not Implemented
@@ -378,6 +378,12 @@ PatternPreprocessingController::InputDataType PatternPreprocessing_UI::getPPMatr
   data.patternCoordinateX = m_SelectedADPPatternPixel.x();
   data.patternCoordinateY = m_SelectedADPPatternPixel.y();
 
+  // Matrix layout for the wrapper routine; these mirror what EMEBSDDIpreview derives from its name list
+  data.numav = 0;
+  data.numw = data.hipassNumSteps;
+  data.numr = (data.numOfRegionsStepSize > 0) ? (data.maxNumOfRegions - data.minNumOfRegions) / data.numOfRegionsStepSize + 1 : 1;
+  data.hipassFilter = data.hipassValue;
+
   return data;
 }
 
@@ -35,12 +35,29 @@
 
 #include "IProcessController.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include <QtCore/QDateTime>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
 #include <QtCore/QTemporaryDir>
 #include <QtCore/QTextStream>
 
+#include "Common/Constants.h"
+
 #include "Workbench/Common/FileIOTools.h"
 
+namespace
+{
+// Registry of live controllers, keyed by the value that is passed through the EMsoft wrapper routines
+// and handed back to the call back functions
+QMutex s_InstancesMutex;
+QMap<size_t, IProcessController*> s_Instances;
+size_t s_LastInstanceKey = 0;
+} // namespace
+
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
@@ -49,12 +66,73 @@ IProcessController::IProcessController(const QString& exeName, const QString& nm
 , m_ExeName(exeName)
 , m_NMLName(nmlName)
 {
+  QMutexLocker locker(&s_InstancesMutex);
+  m_InstanceKey = ++s_LastInstanceKey;
+  s_Instances.insert(m_InstanceKey, this);
 }
 
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
 IProcessController::~IProcessController()
+{
+  QMutexLocker locker(&s_InstancesMutex);
+  s_Instances.remove(m_InstanceKey);
+}
+
+// -----------------------------------------------------------------------------
+IProcessController* IProcessController::GetInstance(size_t instanceKey)
+{
+  QMutexLocker locker(&s_InstancesMutex);
+  return s_Instances.value(instanceKey, nullptr);
+}
+
+// -----------------------------------------------------------------------------
+void IProcessController::ProcessProgress(size_t instanceKey, int loopCompleted, int totalLoops)
+{
+  IProcessController* obj = GetInstance(instanceKey);
+  if(nullptr != obj)
+  {
+    emit obj->progressUpdated(loopCompleted, totalLoops);
+    if(totalLoops > 0)
+    {
+      float percent = (static_cast<float>(loopCompleted) / totalLoops) * 100;
+      emit obj->stdOutputMessageGenerated(QObject::tr("%1: %2% complete").arg(obj->m_ExeName).arg(percent, 0, 'f', 1));
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+bool IProcessController::succeeded() const
+{
+  return m_Succeeded;
+}
+
+// -----------------------------------------------------------------------------
+void IProcessController::SetSParString(std::vector<char>& sPar, size_t index, const QString& value)
+{
+  const size_t stringSize = EMsoftWorkbenchConstants::Constants::SParStringSize;
+  if(sPar.size() < (index + 1) * stringSize)
+  {
+    return;
+  }
+
+  // Leave room for the terminating null character that the wrapper routines look for
+  QByteArray bytes = value.toLocal8Bit();
+  size_t count = std::min(static_cast<size_t>(bytes.size()), stringSize - 1);
+  char* dest = sPar.data() + index * stringSize;
+  std::memset(dest, 0, stringSize);
+  std::memcpy(dest, bytes.constData(), count);
+}
+
+// -----------------------------------------------------------------------------
+bool IProcessController::hasInProcessDriver() const
+{
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+void IProcessController::executeInProcess()
 {
 }
 
@@ -80,6 +158,46 @@ void IProcessController::execute()
   // Set the start time for this run (m_StartTime)
   QString str;
   QTextStream out(&str);
+  m_Succeeded = false;
+
+  // Controllers that can call straight into the EMsoft library do so on this thread; the results come back
+  // through memory buffers and the progress call back, so there is no process to launch or output files to read back
+  if(hasInProcessDriver())
+  {
+    out << m_ExeName << ": Start Time: " << QDateTime::currentDateTime().toString(dtFormat) << "\n";
+    out << m_ExeName << ": Running in-process through the EMsoft library...\n";
+    out << "===========================================================\n";
+    emit stdOutputMessageGenerated(str);
+
+    // the in-process drivers report their failures through errorMessageGenerated
+    bool errorReported = false;
+    QMetaObject::Connection errorConnection = connect(this, &IProcessController::errorMessageGenerated, this, [&errorReported] { errorReported = true; }, Qt::DirectConnection);
+
+    m_Cancel = false;
+    m_Executing = true;
+    executeInProcess();
+    m_Executing = false;
+
+    disconnect(errorConnection);
+    m_Succeeded = !m_Cancel && !errorReported;
+
+    str = "";
+    out << "===========================================================\n";
+    if(m_Cancel)
+    {
+      out << m_ExeName << " was canceled.\n";
+      m_Cancel = false;
+    }
+    else
+    {
+      out << m_ExeName << " Completed\n";
+    }
+    out << m_ExeName << ": Finished: " << QDateTime::currentDateTime().toString(dtFormat) << "\n";
+    emit stdOutputMessageGenerated(str);
+
+    emit finished();
+    return;
+  }
 
   m_CurrentProcess = QSharedPointer<QProcess>(new QProcess());
   connect(m_CurrentProcess.data(), &QProcess::readyReadStandardOutput, [=] { emit stdOutputMessageGenerated(QString::fromStdString(m_CurrentProcess->readAllStandardOutput().toStdString())); });
@@ -129,6 +247,7 @@ void IProcessController::processFinished(int exitCode, QProcess::ExitStatus exit
   processFinished();
 
   m_Executing = false;
+  m_Succeeded = !m_Cancel && exitStatus == QProcess::ExitStatus::NormalExit && exitCode == 0;
 
   // do we need to write this accumulator data into an EMsoft .h5 file?
   // This is so that the results can be read by other EMsoft programs outside of DREAM.3D...
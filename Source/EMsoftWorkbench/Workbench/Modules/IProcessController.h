@@ -35,6 +35,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include <QtCore/QObject>
 #include <QtCore/QProcess>
 #include <QtCore/QSharedPointer>
@@ -46,6 +48,30 @@ class IProcessController : public QObject
 public:
   ~IProcessController() override;
 
+  /**
+   * @brief Returns the live controller registered under the given wrapper key, or nullptr
+   * if that controller has since been destroyed.
+   * @param instanceKey
+   * @return
+   */
+  static IProcessController* GetInstance(size_t instanceKey);
+
+  /**
+   * @brief Progress call back for the EMsoft C wrapper routines (ProgCallBackTypeDI2 signature).
+   * Forwards the number of completed and total work units to the controller's progressUpdated signal.
+   * @param instanceKey
+   * @param loopCompleted
+   * @param totalLoops
+   */
+  static void ProcessProgress(size_t instanceKey, int loopCompleted, int totalLoops);
+
+  /**
+   * @brief Returns true if the last execute() ran to completion: the executable exited normally with exit code 0,
+   * or the in-process driver finished without being canceled or reporting an error.
+   * @return
+   */
+  bool succeeded() const;
+
 public slots:
   /**
    * @brief execute
@@ -63,6 +89,33 @@ protected:
   bool m_Cancel = false;
   bool m_Executing = false;
 
+  /**
+   * @brief Unique key handed to the EMsoft C wrapper routines so that their call back
+   * functions can find this controller again, even with several controllers running at once.
+   */
+  size_t m_InstanceKey = 0;
+
+  /**
+   * @brief Returns true if this controller can run its computation directly through the EMsoft C wrapper
+   * routines.  Otherwise execute() writes the name list file and launches the EMsoft executable.
+   * @return
+   */
+  virtual bool hasInProcessDriver() const;
+
+  /**
+   * @brief Runs the computation through the EMsoft C wrapper routines, with the results handed back in
+   * memory.  Only called when hasInProcessDriver() returns true.
+   */
+  virtual void executeInProcess();
+
+  /**
+   * @brief Copies a string into slot 'index' of an spar string array (SParSize strings of SParStringSize characters each)
+   * @param sPar
+   * @param index
+   * @param value
+   */
+  static void SetSParString(std::vector<char>& sPar, size_t index, const QString& value);
+
 protected slots:
   void processFinished(int exitCode, QProcess::ExitStatus exitStatus);
 
@@ -70,6 +123,7 @@ signals:
   void warningMessageGenerated(const QString& msg) const;
   void errorMessageGenerated(const QString& msg) const;
   void stdOutputMessageGenerated(const QString& msg) const;
+  void progressUpdated(int loopCompleted, int totalLoops) const;
   void finished();
 
 private:
@@ -77,6 +131,7 @@ private:
   QString m_NMLName;
 
   QString m_StartTime = "";
+  bool m_Succeeded = false;
   QSharedPointer<QProcess> m_CurrentProcess = nullptr;
 
   /**
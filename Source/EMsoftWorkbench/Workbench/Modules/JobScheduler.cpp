@@ -0,0 +1,452 @@
+/* ============================================================================
+ * Copyright (c) 2009-2017 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-07-D-5800
+ *    United States Air Force Prime Contract FA8650-10-D-5210
+ *    United States Prime Contract Navy N00173-07-C-2068
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#include "JobScheduler.h"
+
+#include <algorithm>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFileInfo>
+
+#include "Modules/IProcessController.h"
+
+JobScheduler* JobScheduler::self = nullptr;
+
+namespace
+{
+// -----------------------------------------------------------------------------
+QString NormalizedPath(const QString& filePath)
+{
+  return QFileInfo(filePath).absoluteFilePath();
+}
+} // namespace
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+JobScheduler::JobScheduler(QObject* parent)
+: QObject(parent)
+, m_ThreadBudget(std::max(1, QThread::idealThreadCount()))
+{
+  Q_ASSERT_X(!self, "JobScheduler", "There should be only one JobScheduler object");
+  JobScheduler::self = this;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+JobScheduler::~JobScheduler()
+{
+  // Running jobs have to be stopped before their threads go away
+  cancelAll();
+  for(Job& job : m_Jobs)
+  {
+    if(job.thread != nullptr)
+    {
+      job.thread->wait();
+    }
+  }
+
+  self = nullptr;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+JobScheduler* JobScheduler::Instance()
+{
+  if(self == nullptr)
+  {
+    self = new JobScheduler(QCoreApplication::instance());
+  }
+  return self;
+}
+
+// -----------------------------------------------------------------------------
+JobScheduler::JobId JobScheduler::submit(IProcessController* controller, const QString& name, int threadCost, const QStringList& inputFiles, const QStringList& outputFiles,
+                                         const QVector<JobId>& dependencies)
+{
+  Job job;
+  job.controller = controller;
+  job.info.id = m_NextJobId++;
+  job.info.name = name;
+  job.info.threadCost = std::max(1, threadCost);
+  job.info.queuedTime = QDateTime::currentDateTime();
+
+  for(const QString& filePath : inputFiles)
+  {
+    job.info.inputFiles.push_back(NormalizedPath(filePath));
+  }
+  for(const QString& filePath : outputFiles)
+  {
+    job.info.outputFiles.push_back(NormalizedPath(filePath));
+  }
+
+  for(JobId dependency : dependencies)
+  {
+    if(m_Jobs.contains(dependency) && !job.info.dependencies.contains(dependency))
+    {
+      job.info.dependencies.push_back(dependency);
+    }
+  }
+
+  // The most recent unfinished writer of each input file becomes a dependency
+  for(const QString& filePath : job.info.inputFiles)
+  {
+    for(auto iter = m_Jobs.end(); iter != m_Jobs.begin();)
+    {
+      --iter;
+      const JobInfo& other = iter->info;
+      if(!IsTerminal(other.state) && other.outputFiles.contains(filePath))
+      {
+        if(!job.info.dependencies.contains(other.id))
+        {
+          job.info.dependencies.push_back(other.id);
+        }
+        break;
+      }
+    }
+  }
+
+  if(controller == nullptr)
+  {
+    job.info.state = JobState::Failed;
+    job.info.statusMessage = tr("No controller to run");
+    job.info.finishTime = job.info.queuedTime;
+  }
+
+  JobId id = job.info.id;
+  m_Jobs.insert(id, job);
+  emit jobAdded(id);
+  emit jobsChanged();
+
+  schedule();
+  return id;
+}
+
+// -----------------------------------------------------------------------------
+void JobScheduler::cancelJob(JobId id)
+{
+  if(!m_Jobs.contains(id))
+  {
+    return;
+  }
+
+  Job& job = m_Jobs[id];
+  if(job.info.state == JobState::Queued)
+  {
+    setJobState(job, JobState::Canceled, tr("Canceled before it started"));
+    schedule();
+  }
+  else if(job.info.state == JobState::Running && !job.cancelRequested)
+  {
+    // The job is marked as canceled once its thread has wound down
+    job.cancelRequested = true;
+    if(job.controller != nullptr)
+    {
+      job.controller->cancel();
+    }
+    job.info.statusMessage = tr("Canceling...");
+    emit jobStateChanged(id);
+    emit jobsChanged();
+  }
+}
+
+// -----------------------------------------------------------------------------
+void JobScheduler::cancelAll()
+{
+  // Cancel the queued jobs first so that none of them is started when a running job winds down
+  QList<JobId> ids = m_Jobs.keys();
+  for(JobId id : ids)
+  {
+    if(m_Jobs[id].info.state == JobState::Queued)
+    {
+      cancelJob(id);
+    }
+  }
+  for(JobId id : ids)
+  {
+    cancelJob(id);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void JobScheduler::clearFinishedJobs()
+{
+  for(auto iter = m_Jobs.begin(); iter != m_Jobs.end();)
+  {
+    if(IsTerminal(iter->info.state))
+    {
+      iter = m_Jobs.erase(iter);
+    }
+    else
+    {
+      ++iter;
+    }
+  }
+
+  emit jobsChanged();
+}
+
+// -----------------------------------------------------------------------------
+JobScheduler::JobInfo JobScheduler::getJob(JobId id) const
+{
+  return m_Jobs.value(id).info;
+}
+
+// -----------------------------------------------------------------------------
+QVector<JobScheduler::JobInfo> JobScheduler::getJobs() const
+{
+  QVector<JobInfo> jobs;
+  jobs.reserve(m_Jobs.size());
+  for(const Job& job : m_Jobs)
+  {
+    jobs.push_back(job.info);
+  }
+  return jobs;
+}
+
+// -----------------------------------------------------------------------------
+int JobScheduler::getActiveJobCount() const
+{
+  return static_cast<int>(std::count_if(m_Jobs.begin(), m_Jobs.end(), [](const Job& job) { return !IsTerminal(job.info.state); }));
+}
+
+// -----------------------------------------------------------------------------
+bool JobScheduler::isPendingOutput(const QString& filePath) const
+{
+  QString path = NormalizedPath(filePath);
+  return std::any_of(m_Jobs.begin(), m_Jobs.end(), [&path](const Job& job) { return !IsTerminal(job.info.state) && job.info.outputFiles.contains(path); });
+}
+
+// -----------------------------------------------------------------------------
+int JobScheduler::getThreadBudget() const
+{
+  return m_ThreadBudget;
+}
+
+// -----------------------------------------------------------------------------
+void JobScheduler::setThreadBudget(int threads)
+{
+  m_ThreadBudget = std::max(1, threads);
+  schedule();
+}
+
+// -----------------------------------------------------------------------------
+int JobScheduler::getThreadsInUse() const
+{
+  return m_ThreadsInUse;
+}
+
+// -----------------------------------------------------------------------------
+QString JobScheduler::StateToString(JobState state)
+{
+  switch(state)
+  {
+  case JobState::Queued:
+    return tr("Queued");
+  case JobState::Running:
+    return tr("Running");
+  case JobState::Finished:
+    return tr("Finished");
+  case JobState::Failed:
+    return tr("Failed");
+  case JobState::Canceled:
+    return tr("Canceled");
+  }
+
+  return QString();
+}
+
+// -----------------------------------------------------------------------------
+bool JobScheduler::IsTerminal(JobState state)
+{
+  return state == JobState::Finished || state == JobState::Failed || state == JobState::Canceled;
+}
+
+// -----------------------------------------------------------------------------
+void JobScheduler::schedule()
+{
+  // Dependencies always have smaller ids than their dependents, so a single pass in submission order
+  // also cancels whole chains behind a failed job
+  bool budgetExhausted = false;
+  for(Job& job : m_Jobs)
+  {
+    if(job.info.state != JobState::Queued)
+    {
+      continue;
+    }
+
+    bool ready = true;
+    for(JobId dependency : job.info.dependencies)
+    {
+      if(!m_Jobs.contains(dependency))
+      {
+        // Cleared from the list, which only happens to jobs that are done
+        continue;
+      }
+
+      const JobInfo& other = m_Jobs[dependency].info;
+      if(other.state == JobState::Failed || other.state == JobState::Canceled)
+      {
+        setJobState(job, JobState::Canceled, tr("'%1' did not finish").arg(other.name));
+        ready = false;
+        break;
+      }
+      if(other.state != JobState::Finished)
+      {
+        ready = false;
+      }
+    }
+
+    if(!ready || budgetExhausted)
+    {
+      continue;
+    }
+
+    // Jobs start in submission order; once the oldest ready job does not fit, later ones wait behind it
+    int threadCost = std::min(job.info.threadCost, m_ThreadBudget);
+    if(m_ThreadsInUse + threadCost > m_ThreadBudget)
+    {
+      budgetExhausted = true;
+      continue;
+    }
+
+    startJob(job);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void JobScheduler::startJob(Job& job)
+{
+  JobId id = job.info.id;
+  IProcessController* controller = job.controller;
+  if(controller == nullptr)
+  {
+    setJobState(job, JobState::Failed, tr("The controller was deleted before the job started"));
+    return;
+  }
+
+  m_ThreadsInUse += std::min(job.info.threadCost, m_ThreadBudget);
+  job.info.startTime = QDateTime::currentDateTime();
+  setJobState(job, JobState::Running);
+
+  job.thread = QSharedPointer<QThread>(new QThread);
+  QThread* mainThread = thread();
+  controller->moveToThread(job.thread.data());
+
+  // Hand the controller back to the GUI thread from within its own thread before that thread quits, so that
+  // the module that owns it can keep using it afterwards
+  connect(
+      controller, &IProcessController::finished, controller, [controller, mainThread] { controller->moveToThread(mainThread); }, Qt::DirectConnection);
+  connect(job.thread.data(), &QThread::started, controller, &IProcessController::execute);
+  connect(controller, &IProcessController::finished, job.thread.data(), &QThread::quit);
+  connect(job.thread.data(), &QThread::finished, this, [this, id] { jobThreadFinished(id); });
+
+  job.thread->start();
+}
+
+// -----------------------------------------------------------------------------
+void JobScheduler::jobThreadFinished(JobId id)
+{
+  if(!m_Jobs.contains(id))
+  {
+    return;
+  }
+
+  Job& job = m_Jobs[id];
+  m_ThreadsInUse -= std::min(job.info.threadCost, m_ThreadBudget);
+  m_ThreadsInUse = std::max(0, m_ThreadsInUse);
+
+  if(job.controller != nullptr)
+  {
+    // Only drop the scheduler's own connections; the module may still be listening to the controller
+    disconnect(job.controller, &IProcessController::finished, job.controller, nullptr);
+    disconnect(job.controller, &IProcessController::finished, job.thread.data(), nullptr);
+  }
+
+  if(job.cancelRequested)
+  {
+    setJobState(job, JobState::Canceled, tr("Canceled while running"));
+  }
+  else if(job.controller == nullptr)
+  {
+    setJobState(job, JobState::Failed, tr("The controller was deleted while the job was running"));
+  }
+  else if(!job.controller->succeeded())
+  {
+    setJobState(job, JobState::Failed, tr("The job did not complete successfully"));
+  }
+  else
+  {
+    // An output file left over from an earlier run does not count; file systems may only store whole seconds,
+    // so the start time is rounded down before the comparison
+    QDateTime startTime = job.info.startTime.addMSecs(-job.info.startTime.time().msec());
+    QStringList missingFiles;
+    for(const QString& filePath : job.info.outputFiles)
+    {
+      QFileInfo fi(filePath);
+      if(!fi.exists() || fi.lastModified() < startTime)
+      {
+        missingFiles.push_back(fi.fileName());
+      }
+    }
+
+    if(missingFiles.isEmpty())
+    {
+      setJobState(job, JobState::Finished);
+    }
+    else
+    {
+      setJobState(job, JobState::Failed, tr("Missing output: %1").arg(missingFiles.join(", ")));
+    }
+  }
+
+  schedule();
+}
+
+// -----------------------------------------------------------------------------
+void JobScheduler::setJobState(Job& job, JobState state, const QString& message)
+{
+  job.info.state = state;
+  job.info.statusMessage = message;
+  if(IsTerminal(state))
+  {
+    job.info.finishTime = QDateTime::currentDateTime();
+  }
+
+  emit jobStateChanged(job.info.id);
+  emit jobsChanged();
+}
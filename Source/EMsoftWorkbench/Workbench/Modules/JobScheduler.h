@@ -0,0 +1,243 @@
+/* ============================================================================
+ * Copyright (c) 2009-2017 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-07-D-5800
+ *    United States Air Force Prime Contract FA8650-10-D-5210
+ *    United States Prime Contract Navy N00173-07-C-2068
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#pragma once
+
+#include <QtCore/QDateTime>
+#include <QtCore/QMap>
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QStringList>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+
+class IProcessController;
+
+/**
+ * @brief The JobScheduler class queues IProcessController runs from all modules and starts each one on its own
+ * thread once its dependencies have finished and the thread budget has room for it.  A job that reads a file that a
+ * queued or running job writes automatically waits for that job, so a Monte Carlo run, the master pattern run that
+ * reads its output and the indexing runs that read the master pattern can all be queued at once.
+ *
+ * The scheduler lives on the GUI thread and all of its methods must be called from there.  It does not take
+ * ownership of the controllers; a controller has to outlive its job.  This class uses the Singleton design pattern.
+ */
+class JobScheduler : public QObject
+{
+  Q_OBJECT
+
+public:
+  ~JobScheduler() override;
+
+  using JobId = int;
+  using EnumType = unsigned int;
+
+  enum class JobState : EnumType
+  {
+    Queued = 0,
+    Running,
+    Finished,
+    Failed,
+    Canceled
+  };
+
+  struct JobInfo
+  {
+    JobId id = -1;
+    QString name;
+    JobState state = JobState::Queued;
+    int threadCost = 1;
+    QVector<JobId> dependencies;
+    QStringList inputFiles;
+    QStringList outputFiles;
+    QDateTime queuedTime;
+    QDateTime startTime;
+    QDateTime finishTime;
+    QString statusMessage;
+  };
+
+  /**
+   * @brief Static instance to retrieve the global instance of this class
+   * @return
+   */
+  static JobScheduler* Instance();
+
+  /**
+   * @brief Queues a run of the controller's execute() slot.  Dependencies on queued or running jobs that write
+   * any of the input files are added automatically.
+   * @param controller
+   * @param name Name shown in the job view
+   * @param threadCost Number of threads the job keeps busy; clamped to the thread budget
+   * @param inputFiles Files the job reads
+   * @param outputFiles Files the job writes; a job that reports a failure or does not (re)write all of them during its run
+   * is marked as failed
+   * @param dependencies Additional jobs that must finish first
+   * @return The id of the new job
+   */
+  JobId submit(IProcessController* controller, const QString& name, int threadCost, const QStringList& inputFiles, const QStringList& outputFiles,
+               const QVector<JobId>& dependencies = QVector<JobId>());
+
+  /**
+   * @brief Cancels a queued or running job.  Jobs that depend on it are canceled as well.
+   * @param id
+   */
+  void cancelJob(JobId id);
+
+  /**
+   * @brief cancelAll
+   */
+  void cancelAll();
+
+  /**
+   * @brief Removes finished, failed and canceled jobs from the job list
+   */
+  void clearFinishedJobs();
+
+  /**
+   * @brief getJob
+   * @param id
+   * @return
+   */
+  JobInfo getJob(JobId id) const;
+
+  /**
+   * @brief Returns all jobs in submission order
+   * @return
+   */
+  QVector<JobInfo> getJobs() const;
+
+  /**
+   * @brief Returns the number of queued and running jobs
+   * @return
+   */
+  int getActiveJobCount() const;
+
+  /**
+   * @brief Returns true if a queued or running job will write the given file.  Modules use this to accept
+   * input files that do not exist yet.
+   * @param filePath
+   * @return
+   */
+  bool isPendingOutput(const QString& filePath) const;
+
+  /**
+   * @brief Returns the total number of threads that running jobs may keep busy
+   * @return
+   */
+  int getThreadBudget() const;
+
+  /**
+   * @brief setThreadBudget
+   * @param threads
+   */
+  void setThreadBudget(int threads);
+
+  /**
+   * @brief getThreadsInUse
+   * @return
+   */
+  int getThreadsInUse() const;
+
+  /**
+   * @brief StateToString
+   * @param state
+   * @return
+   */
+  static QString StateToString(JobState state);
+
+  /**
+   * @brief Returns true for the states that a job never leaves
+   * @param state
+   * @return
+   */
+  static bool IsTerminal(JobState state);
+
+signals:
+  void jobAdded(int id);
+  void jobStateChanged(int id);
+  void jobsChanged();
+
+protected:
+  JobScheduler(QObject* parent = nullptr);
+
+private:
+  struct Job
+  {
+    JobInfo info;
+    QPointer<IProcessController> controller;
+    QSharedPointer<QThread> thread;
+    bool cancelRequested = false;
+  };
+
+  static JobScheduler* self;
+
+  QMap<JobId, Job> m_Jobs;
+  JobId m_NextJobId = 1;
+  int m_ThreadBudget = 1;
+  int m_ThreadsInUse = 0;
+
+  /**
+   * @brief Starts every queued job whose dependencies have finished, in submission order, until the thread
+   * budget is used up.  Queued jobs with a failed or canceled dependency are canceled.
+   */
+  void schedule();
+
+  /**
+   * @brief startJob
+   * @param job
+   */
+  void startJob(Job& job);
+
+  /**
+   * @brief jobThreadFinished
+   * @param id
+   */
+  void jobThreadFinished(JobId id);
+
+  /**
+   * @brief setJobState
+   * @param job
+   * @param state
+   * @param message
+   */
+  void setJobState(Job& job, JobState state, const QString& message = QString());
+
+public:
+  JobScheduler(const JobScheduler&) = delete;            // Copy Constructor Not Implemented
+  JobScheduler(JobScheduler&&) = delete;                 // Move Constructor Not Implemented
+  JobScheduler& operator=(const JobScheduler&) = delete; // Copy Assignment Not Implemented
+  JobScheduler& operator=(JobScheduler&&) = delete;      // Move Assignment Not Implemented
+};
@@ -42,6 +42,7 @@
 #include "EMsoftLib/EMsoftStringConstants.h"
 
 #include "Workbench/Common/FileIOTools.h"
+#include "Workbench/Modules/JobScheduler.h"
 
 const QString k_ExeName = QString("EMEBSDmaster");
 const QString k_NMLName = QString("EMEBSDmaster.nml");
@@ -168,7 +169,8 @@ bool MasterPatternSimulationController::validateInput() const
     emit errorMessageGenerated(ss);
     return false;
   }
-  if(!inFi.exists())
+  // A Monte Carlo job that is still queued or running will create the energy file before this job starts
+  if(!inFi.exists() && !JobScheduler::Instance()->isPendingOutput(FileIOTools::GetAbsolutePath(energyFilePath)))
   {
     QString ss = QObject::tr("The energy file with path '%1' does not exist.").arg(energyFilePath);
     emit errorMessageGenerated(ss);
@@ -53,6 +53,7 @@
 #include "Workbench/Common/Constants.h"
 #include "Workbench/Common/FileIOTools.h"
 #include "Workbench/Common/PatternTools.h"
+#include "Workbench/Modules/JobScheduler.h"
 #include "Workbench/Modules/MasterPatternSimulationModule/MasterPatternSimulationController.h"
 
 #include "QtSupport/QtSSettings.h"
@@ -91,6 +92,15 @@ void MasterPatternSimulation_UI::setupGui()
   // Create all signal/slot connections that will update the simulated pattern when parameters are changed
   createModificationConnections();
 
+  // The simulation runs as a job in the global queue; restore the GUI once it is done, whatever the outcome
+  connect(JobScheduler::Instance(), &JobScheduler::jobStateChanged, this, [=](int id) {
+    if(id == m_JobId && JobScheduler::IsTerminal(JobScheduler::Instance()->getJob(id).state))
+    {
+      m_JobId = -1;
+      processFinished();
+    }
+  });
+
   validateData();
 
   int numOfCores = QThread::idealThreadCount();
@@ -164,9 +174,8 @@ void MasterPatternSimulation_UI::slot_simulateBtn_clicked()
 {
   if(simulateBtn->text() == "Cancel" && m_Controller != nullptr)
   {
-    m_Controller->cancel();
+    JobScheduler::Instance()->cancelJob(m_JobId);
     emit processCompleted();
-    setRunning(false);
     return;
   }
 
@@ -196,24 +205,22 @@ void MasterPatternSimulation_UI::slot_simulateBtn_clicked()
     m_Controller = nullptr;
   }
 
-  // Create a new QThread to run the Controller class.
-  m_WorkerThread = QSharedPointer<QThread>(new QThread);
   m_Controller = new MasterPatternSimulationController;
-  m_Controller->moveToThread(m_WorkerThread.data());
   m_Controller->setData(data); // Set the input data
 
-  // Conncet Signals & Slots to get the thread started and quit
-  connect(m_WorkerThread.data(), SIGNAL(started()), m_Controller, SLOT(execute()));
-  connect(m_Controller, SIGNAL(finished()), m_WorkerThread.data(), SLOT(quit()));
-  connect(m_WorkerThread.data(), SIGNAL(finished()), this, SLOT(processFinished()));
-
   // Pass errors, warnings, and std output messages up to the user interface
   connect(m_Controller, &MasterPatternSimulationController::errorMessageGenerated, this, &MasterPatternSimulation_UI::notifyErrorMessage);
   connect(m_Controller, &MasterPatternSimulationController::warningMessageGenerated, this, &MasterPatternSimulation_UI::notifyWarningMessage);
   connect(m_Controller, SIGNAL(stdOutputMessageGenerated(QString)), this, SLOT(appendToStdOut(QString)));
 
-  m_WorkerThread->start();
+  // Queue the simulation behind any job that is still writing the energy file.  EMEBSDmaster adds the master
+  // pattern to the energy file, so that file is both its input and its output.
   setRunning(true);
+  QString jobName = tr("Master Pattern: %1").arg(QFileInfo(data.energyFilePath).fileName());
+  m_JobId = JobScheduler::Instance()->submit(m_Controller, jobName, data.numOfOpenMPThreads, {data.energyFilePath}, {data.energyFilePath});
+
+  // Modules that read the master pattern can now queue their own jobs behind this one
+  emit validationOfOtherModulesNeeded(this);
 }
 
 // -----------------------------------------------------------------------------
@@ -99,7 +99,7 @@ private slots:
 
 private:
   MasterPatternSimulationController* m_Controller;
-  QSharedPointer<QThread> m_WorkerThread;
+  int m_JobId = -1;
 
   QString m_LastFilePath = "";
 
@@ -59,6 +59,7 @@
 #include "Common/FileIOTools.h"
 #include "Common/PatternTools.h"
 
+#include "Modules/JobScheduler.h"
 #include "Modules/ModuleTools.hpp"
 
 #include "QtSupport/QtSSettings.h"
@@ -97,6 +98,15 @@ void MonteCarloSimulation_UI::setupGui()
   // Create all signal/slot connections between this widget and its sub-widgets.
   createWidgetConnections();
 
+  // The simulation runs as a job in the global queue; restore the GUI once it is done, whatever the outcome
+  connect(JobScheduler::Instance(), &JobScheduler::jobStateChanged, this, [=](int id) {
+    if(id == m_JobId && JobScheduler::IsTerminal(JobScheduler::Instance()->getJob(id).state))
+    {
+      m_JobId = -1;
+      processFinished();
+    }
+  });
+
   // Create all signal/slot connections that will update the simulated pattern when parameters are changed
   createModificationConnections();
 
@@ -251,9 +261,8 @@ void MonteCarloSimulation_UI::slot_createMonteCarloBtn_clicked()
 {
   if(createMonteCarloBtn->text() == "Cancel" && m_Controller != nullptr)
   {
-    m_Controller->cancel();
+    JobScheduler::Instance()->cancelJob(m_JobId);
     emit processCompleted();
-    setRunning(false);
     return;
   }
 
@@ -273,18 +282,16 @@ void MonteCarloSimulation_UI::slot_createMonteCarloBtn_clicked()
   gpuGrpBox->setDisabled(true);
   outputGrpBox->setDisabled(true);
 
-  // Create a new QThread to run the Controller class.
-  m_WorkerThread = QSharedPointer<QThread>(new QThread);
-  m_Controller->moveToThread(m_WorkerThread.data());
   m_Controller->setData(data); // Set the input data
 
-  // Conncet Signals & Slots to get the thread started and quit
-  connect(m_WorkerThread.data(), SIGNAL(started()), m_Controller, SLOT(execute()));
-  connect(m_Controller, SIGNAL(finished()), m_WorkerThread.data(), SLOT(quit()));
-  connect(m_WorkerThread.data(), SIGNAL(finished()), this, SLOT(processFinished()));
-
-  m_WorkerThread->start();
+  // Queue the simulation; the scheduler starts it on a worker thread.  The simulation itself runs on the GPU,
+  // so it only takes up a single thread of the budget.
   setRunning(true);
+  QString jobName = tr("Monte Carlo: %1").arg(QFileInfo(data.outputFilePath).fileName());
+  m_JobId = JobScheduler::Instance()->submit(m_Controller, jobName, 1, {data.inputFilePath}, {data.outputFilePath});
+
+  // Modules that read the Monte Carlo file can now queue their own jobs behind this one
+  emit validationOfOtherModulesNeeded(this);
 }
 
 // -----------------------------------------------------------------------------
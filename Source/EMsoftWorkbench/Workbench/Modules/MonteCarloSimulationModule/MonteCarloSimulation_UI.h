@@ -102,7 +102,7 @@ private slots:
 
 private:
   MonteCarloSimulationController* m_Controller = nullptr;
-  QSharedPointer<QThread> m_WorkerThread;
+  int m_JobId = -1;
 
   QString m_LastFilePath = "";
 
@@ -0,0 +1,512 @@
+/* ============================================================================
+ * Copyright (c) 2009-2016 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-07-D-5800
+ *    United States Air Force Prime Contract FA8650-10-D-5210
+ *    United States Prime Contract Navy N00173-07-C-2068
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#include "CubochoricSampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <QtConcurrent>
+
+#include <QtCore/QThreadPool>
+
+#include "Common/Constants.h"
+
+#include "EbsdLib/Core/EbsdLibConstants.h"
+#include "EbsdLib/Core/OrientationTransformation.hpp"
+
+namespace
+{
+/**
+ * @brief ParallelChunks Splits [0, count) into contiguous chunks, one per pool thread, and runs
+ * fn(chunkIndex, start, end) for each of them.  Returns once all chunks are done.
+ */
+template <typename Fn>
+size_t ParallelChunks(size_t count, Fn fn)
+{
+  size_t numChunks = static_cast<size_t>(std::max(1, QThreadPool::globalInstance()->maxThreadCount()));
+  numChunks = std::max(static_cast<size_t>(1), std::min(numChunks, count));
+  size_t chunkSize = (count + numChunks - 1) / numChunks;
+
+  std::vector<QFuture<void>> futures;
+  futures.reserve(numChunks);
+  for(size_t c = 0; c < numChunks; c++)
+  {
+    size_t start = std::min(count, c * chunkSize);
+    size_t end = std::min(count, start + chunkSize);
+    futures.push_back(QtConcurrent::run([=] { fn(c, start, end); }));
+  }
+  for(QFuture<void>& future : futures)
+  {
+    future.waitForFinished();
+  }
+  return numChunks;
+}
+
+/**
+ * @brief StoreEuler Converts a 4-component Rodrigues vector to Euler angles and stores them as floats
+ */
+inline void StoreEuler(const OrientationD& rod, float* dst)
+{
+  OrientationD eu = OrientationTransformation::ro2eu<OrientationD, OrientationD>(rod);
+  dst[0] = static_cast<float>(eu[0]);
+  dst[1] = static_cast<float>(eu[1]);
+  dst[2] = static_cast<float>(eu[2]);
+}
+} // namespace
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+CubochoricSampler::CubochoricSampler() = default;
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+CubochoricSampler::~CubochoricSampler() = default;
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+std::vector<float> CubochoricSampler::SampleRFZ(double numOfSamplingPts, int ptGrpNum, bool offsetGrid)
+{
+  int Np = static_cast<int>(numOfSamplingPts);
+  if(Np < 1 || ptGrpNum < 1 || ptGrpNum > 32)
+  {
+    return {};
+  }
+
+  // step size for sampling of grid; maximum total number of samples = pow(2*Np+1,3)
+  double delta = (0.50 * EbsdLib::LPs::ap) / numOfSamplingPts;
+
+  // do we need to shift this array away from the origin?
+  double gridShift = offsetGrid ? 0.5 : 0.0;
+
+  // determine which function we should call for this point group symmetry
+  int32_t FZtype = EMsoftWorkbenchConstants::Constants::FZtarray[ptGrpNum - 1];
+  int32_t FZorder = EMsoftWorkbenchConstants::Constants::FZoarray[ptGrpNum - 1];
+
+  // eliminate points for which any of the coordinates lies outside the cube with semi-edge length "edge",
+  // or outside the smaller cube that encloses the fundamental zone; neither test needs a conversion
+  double edge = 0.5 * EbsdLib::LPs::ap;
+  double bound = std::min(edge, MaxCubochoricSemiEdge(FZtype, FZorder));
+
+  // the grid is the same along all three axes; note that we do not want to include
+  // the opposite edges/facets of the cube, to avoid double counting rotations
+  // with a rotation angle of 180 degrees.  This only affects the cyclic groups.
+  std::vector<double> coords;
+  coords.reserve(2 * Np);
+  for(int i = -Np + 1; i < Np + 1; i++)
+  {
+    double c = (static_cast<double>(i) + gridShift) * delta;
+    if(fabs(c) <= edge && fabs(c) <= bound)
+    {
+      coords.push_back(c);
+    }
+  }
+  size_t nc = coords.size();
+  if(nc == 0)
+  {
+    return {};
+  }
+
+  // every worker owns a buffer that is large enough for all the candidate points of its slab
+  size_t maxChunks = static_cast<size_t>(std::max(1, QThreadPool::globalInstance()->maxThreadCount()));
+  std::vector<std::vector<float>> buffers(std::min(maxChunks, nc));
+  size_t numChunks = ParallelChunks(nc, [&](size_t chunk, size_t start, size_t end) {
+    std::vector<float>& buffer = buffers[chunk];
+    buffer.resize((end - start) * nc * nc * 3);
+    size_t n = 0;
+    for(size_t i = start; i < end; i++)
+    {
+      for(size_t j = 0; j < nc; j++)
+      {
+        for(size_t k = 0; k < nc; k++)
+        {
+          OrientationD rod = OrientationTransformation::cu2ro<OrientationD, OrientationD>(OrientationD(coords[i], coords[j], coords[k]));
+          if(IsinsideFZ(rod.data(), FZtype, FZorder))
+          {
+            StoreEuler(rod, buffer.data() + n);
+            n += 3;
+          }
+        }
+      }
+    }
+    buffer.resize(n);
+  });
+
+  // concatenate the per-thread buffers in grid order
+  size_t total = 0;
+  for(size_t c = 0; c < numChunks; c++)
+  {
+    total += buffers[c].size();
+  }
+  std::vector<float> eulerAngles;
+  eulerAngles.reserve(total);
+  for(size_t c = 0; c < numChunks; c++)
+  {
+    eulerAngles.insert(eulerAngles.end(), buffers[c].begin(), buffers[c].end());
+    std::vector<float>().swap(buffers[c]);
+  }
+
+  return eulerAngles;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+std::vector<float> CubochoricSampler::SampleMisorientation(double numOfSamplingPts, const std::array<double, 3>& refOrientation, double misorientationAngle, bool shellOnly)
+{
+  int Np = static_cast<int>(numOfSamplingPts);
+  if(Np < 1)
+  {
+    return {};
+  }
+
+  // step size for sampling of grid; the edge length of the cube is (pi ( w - sin(w) ))^1/3 with w the misorientation angle
+  double omega = misorientationAngle * EbsdLib::Constants::k_PiF / 180.0F;
+  double semi = pow(EbsdLib::Constants::k_PiF * (omega - sin(omega)), 1.0F / 3.0F) * 0.5F;
+  double delta = semi / numOfSamplingPts;
+
+  // convert the reference orientation to a 3-component Rodrigues vector sigma
+  OrientationD sigma(4), referenceOrientation(3);
+  referenceOrientation[0] = static_cast<double>(refOrientation[0] * EbsdLib::Constants::k_PiF / 180.0F);
+  referenceOrientation[1] = static_cast<double>(refOrientation[1] * EbsdLib::Constants::k_PiF / 180.0F);
+  referenceOrientation[2] = static_cast<double>(refOrientation[2] * EbsdLib::Constants::k_PiF / 180.0F);
+  OrientationD sigm = OrientationTransformation::eu2ro<OrientationD, OrientationD>(referenceOrientation);
+
+  sigma[0] = sigm[0] * sigm[3];
+  sigma[1] = sigm[1] * sigm[3];
+  sigma[2] = sigm[2] * sigm[3];
+
+  // every grid point produces exactly one orientation here, so the output can be sized up front
+  // and each worker writes straight into its own slice of it
+  std::vector<float> eulerAngles;
+  auto convert = [&](double x, double y, double z, size_t p) {
+    OrientationD rod = OrientationTransformation::cu2ro<OrientationD, OrientationD>(OrientationD(x, y, z));
+    RodriguesComposition(sigma, rod);
+    StoreEuler(rod, eulerAngles.data() + 3 * p);
+  };
+
+  if(shellOnly)
+  {
+    // enumerate the sub-cube surface: x-y bottom and top planes, y-z planes and finally the x-z planes
+    std::vector<std::array<double, 3>> points;
+    points.reserve(24 * Np * Np + 2);
+    for(int i = -Np; i <= Np; i++)
+    {
+      double x = static_cast<double>(i) * delta;
+      for(int j = -Np; j <= Np; j++)
+      {
+        double y = static_cast<double>(j) * delta;
+        points.push_back({-x, -y, -semi});
+        points.push_back({-x, -y, semi});
+      }
+    }
+    for(int j = -Np; j <= Np; j++)
+    {
+      double y = static_cast<double>(j) * delta;
+      for(int k = -Np + 1; k <= Np - 1; k++)
+      {
+        double z = static_cast<double>(k) * delta;
+        points.push_back({-semi, -y, -z});
+        points.push_back({semi, -y, -z});
+      }
+    }
+    for(int i = -Np + 1; i <= Np - 1; i++)
+    {
+      double x = static_cast<double>(i) * delta;
+      for(int k = -Np + 1; k <= Np - 1; k++)
+      {
+        double z = static_cast<double>(k) * delta;
+        points.push_back({-x, -semi, -z});
+        points.push_back({-x, semi, -z});
+      }
+    }
+
+    eulerAngles.resize(points.size() * 3);
+    ParallelChunks(points.size(), [&](size_t chunk, size_t start, size_t end) {
+      Q_UNUSED(chunk)
+      for(size_t p = start; p < end; p++)
+      {
+        convert(points[p][0], points[p][1], points[p][2], p);
+      }
+    });
+  }
+  else
+  {
+    // the full sub-cube; see misorientation sampling paper for this expression
+    size_t n = static_cast<size_t>(2 * Np + 1);
+    size_t totp = n * n * n;
+    eulerAngles.resize(totp * 3);
+    ParallelChunks(totp, [&](size_t chunk, size_t start, size_t end) {
+      Q_UNUSED(chunk)
+      for(size_t p = start; p < end; p++)
+      {
+        double x = static_cast<double>(static_cast<int>(p / (n * n)) - Np) * delta;
+        double y = static_cast<double>(static_cast<int>((p / n) % n) - Np) * delta;
+        double z = static_cast<double>(static_cast<int>(p % n) - Np) * delta;
+        convert(-x, -y, -z, p);
+      }
+    });
+  }
+
+  return eulerAngles;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+double CubochoricSampler::MaxCubochoricSemiEdge(int FZtype, int FZorder)
+{
+  // largest Rodrigues vector length inside the fundamental zone
+  double rmax = 0.0;
+  switch(FZtype)
+  {
+  case EMsoftWorkbenchConstants::Constants::DihedralType: {
+    // prism of height 2 tan(pi/2n) over a regular 2n-gon with unit inradius
+    double halfAngle = EbsdLib::Constants::k_PiD / (2.0 * FZorder);
+    rmax = sqrt(1.0 / (cos(halfAngle) * cos(halfAngle)) + tan(halfAngle) * tan(halfAngle));
+    break;
+  }
+  case EMsoftWorkbenchConstants::Constants::TetrahedralType:
+    // octahedron |r1|+|r2|+|r3| <= 1
+    rmax = 1.0;
+    break;
+  case EMsoftWorkbenchConstants::Constants::OctahedralType: {
+    // truncated cube; the corner lies at (t, t, 1-2t) with t = tan(pi/8)
+    double t = EbsdLib::LPs::BP[3];
+    rmax = sqrt(2.0 * t * t + (1.0 - 2.0 * t) * (1.0 - 2.0 * t));
+    break;
+  }
+  default:
+    // anorthic and cyclic zones contain 180 degree rotations
+    return std::numeric_limits<double>::infinity();
+  }
+
+  // rotation angle -> homochoric radius -> cubochoric semi-edge (equal volume cube and ball); a small
+  // relative margin keeps points on the zone boundary inside
+  double omega = 2.0 * atan(rmax);
+  double ho = pow(0.75 * (omega - sin(omega)), 1.0 / 3.0);
+  return ho * pow(EbsdLib::Constants::k_PiD / 6.0, 1.0 / 3.0) * (1.0 + 1.0e-6);
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void CubochoricSampler::RodriguesComposition(const OrientationD& sigma, OrientationD& rod)
+{
+  OrientationD rho(3), rhomis(3);
+  rho[0] = -rod[0] * rod[3];
+  rho[1] = -rod[1] * rod[3];
+  rho[2] = -rod[2] * rod[3];
+
+  // perform the Rodrigues rotation composition with sigma to get rhomis
+  double denom = 1.0f + (sigma[0] * rho[0] + sigma[1] * rho[1] + sigma[2] * rho[2]);
+  if(denom == 0.0f)
+  {
+    double len;
+    len = sqrt(sigma[0] * sigma[0] + sigma[1] * sigma[1] + sigma[2] * sigma[2]);
+    rod[0] = sigma[0] / len;
+    rod[1] = sigma[1] / len;
+    rod[2] = sigma[2] / len;
+    rod[3] = std::numeric_limits<double>::infinity(); // set this to infinity
+  }
+  else
+  {
+    rhomis[0] = (rho[0] - sigma[0] + (rho[1] * sigma[2] - rho[2] * sigma[1])) / denom;
+    rhomis[1] = (rho[1] - sigma[1] + (rho[2] * sigma[0] - rho[0] * sigma[2])) / denom;
+    rhomis[2] = (rho[2] - sigma[2] + (rho[0] * sigma[1] - rho[1] * sigma[0])) / denom;
+    // revert rhomis to a four-component Rodrigues vector
+    double len;
+    len = sqrt(rhomis[0] * rhomis[0] + rhomis[1] * rhomis[1] + rhomis[2] * rhomis[2]);
+    if(len != 0.0f)
+    {
+      rod[0] = -rhomis[0] / len;
+      rod[1] = -rhomis[1] / len;
+      rod[2] = -rhomis[2] / len;
+      rod[3] = len;
+    }
+    else
+    {
+      rod[0] = 0.0;
+      rod[1] = 0.0;
+      rod[2] = 0.0;
+      rod[3] = 0.0;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+bool CubochoricSampler::IsinsideFZ(const double* rod, int FZtype, int FZorder)
+{
+  bool insideFZ = false;
+  // dealing with 180 rotations is needed only for
+  // FZtypes 0 and 1; the other FZs are always finite.
+  switch(FZtype)
+  {
+  case EMsoftWorkbenchConstants::Constants::AnorthicType:
+    insideFZ = true; // all points are inside the FZ
+    break;
+  case EMsoftWorkbenchConstants::Constants::CyclicType:
+    insideFZ = insideCyclicFZ(rod, FZorder); // infinity is checked inside this function
+    break;
+  case EMsoftWorkbenchConstants::Constants::DihedralType:
+    if(rod[3] != std::numeric_limits<double>::infinity())
+    {
+      insideFZ = insideDihedralFZ(rod, FZorder);
+    }
+    break;
+  case EMsoftWorkbenchConstants::Constants::TetrahedralType:
+    if(rod[3] != std::numeric_limits<double>::infinity())
+    {
+      insideFZ = insideCubicFZ(rod, EMsoftWorkbenchConstants::Constants::TetrahedralType);
+    }
+    break;
+  case EMsoftWorkbenchConstants::Constants::OctahedralType:
+    if(rod[3] != std::numeric_limits<double>::infinity())
+    {
+      insideFZ = insideCubicFZ(rod, EMsoftWorkbenchConstants::Constants::OctahedralType);
+    }
+    break;
+  default:
+    insideFZ = false;
+    break;
+  }
+  return insideFZ;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+bool CubochoricSampler::insideCyclicFZ(const double* rod, int order)
+{
+
+  bool insideFZ = false;
+
+  if(rod[3] != std::numeric_limits<double>::infinity())
+  {
+    // check the z-component vs. tan(pi/2n)
+    insideFZ = fabs(rod[2] * rod[3]) <= EbsdLib::LPs::BP[order - 1];
+  }
+  else if(rod[2] == 0.0)
+  {
+    insideFZ = true;
+  }
+  return insideFZ;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+bool CubochoricSampler::insideDihedralFZ(const double* rod, int order)
+{
+
+  bool res = false, c1 = false, c2 = false;
+  double r[3] = {rod[0] * rod[3], rod[1] * rod[3], rod[2] * rod[3]};
+  const double r1 = 1.0;
+
+  // first, check the z-component vs. tan(pi/2n)  (same as insideCyclicFZ)
+  c1 = fabs(r[2]) <= EbsdLib::LPs::BP[order - 1];
+  res = false;
+
+  // check the square boundary planes if c1=true
+  if(c1)
+  {
+    switch(order)
+    {
+    case EMsoftWorkbenchConstants::Constants::TwoFoldAxisOrder:
+      c2 = (fabs(r[0]) <= r1) && (fabs(r[1]) <= r1);
+      break;
+    case EMsoftWorkbenchConstants::Constants::ThreeFoldAxisOrder:
+      c2 = fabs(EbsdLib::LPs::srt * r[0] + 0.50 * r[1]) <= r1;
+      c2 = c2 && (fabs(EbsdLib::LPs::srt * r[0] - 0.50 * r[1]) <= r1);
+      c2 = c2 && (fabs(r[1]) <= r1);
+      break;
+    case EMsoftWorkbenchConstants::Constants::FourFoldAxisOrder:
+      c2 = (fabs(r[0]) <= r1) && (fabs(r[1]) <= r1);
+      c2 = c2 && ((EbsdLib::LPs::r22 * fabs(r[0] + r[1]) <= r1) && (EbsdLib::LPs::r22 * fabs(r[0] - r[1]) <= r1));
+      break;
+    case EMsoftWorkbenchConstants::Constants::SixFoldAxisOrder:
+      c2 = fabs(0.50 * r[0] + EbsdLib::LPs::srt * r[1]) <= r1;
+      c2 = c2 && (fabs(EbsdLib::LPs::srt * r[0] + 0.50 * r[1]) <= r1);
+      c2 = c2 && (fabs(EbsdLib::LPs::srt * r[0] - 0.50 * r[1]) <= r1);
+      c2 = c2 && (fabs(0.50 * r[0] - EbsdLib::LPs::srt * r[1]) <= r1);
+      c2 = c2 && (fabs(r[1]) <= r1);
+      c2 = c2 && (fabs(r[0]) <= r1);
+      break;
+    default:
+      res = false;
+      break;
+    }
+    res = c2;
+  }
+  return res;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+bool CubochoricSampler::insideCubicFZ(const double* rod, int ot)
+{
+  bool res = false, c1 = false, c2 = false;
+  double r[3] = {rod[0] * rod[3], rod[1] * rod[3], rod[2] * rod[3]};
+  const double r1 = 1.0;
+
+  // primary cube planes (only needed for octahedral case)
+  if(ot == EMsoftWorkbenchConstants::Constants::OctahedralType)
+  {
+    double maxValue = std::max(fabs(r[0]), std::max(fabs(r[1]), fabs(r[2])));
+    c1 = maxValue <= EbsdLib::LPs::BP[3];
+  }
+  else
+  {
+    c1 = true;
+  }
+
+  // octahedral truncation planes, both for tetrahedral and octahedral point groups
+  c2 = ((fabs(r[0]) + fabs(r[1]) + fabs(r[2])) <= r1);
+
+  // if both c1 and c2, then the point is inside
+  if(c1 && c2)
+  {
+    res = true;
+  }
+
+  return res;
+}
@@ -0,0 +1,115 @@
+/* ============================================================================
+ * Copyright (c) 2009-2016 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-07-D-5800
+ *    United States Air Force Prime Contract FA8650-10-D-5210
+ *    United States Prime Contract Navy N00173-07-C-2068
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "EbsdLib/Core/Orientation.hpp"
+
+/**
+ * @brief The CubochoricSampler class generates uniform orientation samples on a cubochoric grid,
+ * either inside a Rodrigues fundamental zone or on/inside a misorientation cube around a reference
+ * orientation.  The grid is partitioned across the global thread pool; each worker writes its Euler
+ * angle triplets into its own preallocated buffer and the buffers are concatenated in grid order, so
+ * the output is identical to a serial i-j-k walk of the grid.
+ */
+class CubochoricSampler
+{
+public:
+  virtual ~CubochoricSampler();
+
+  /**
+   * @brief SampleRFZ Samples the Rodrigues fundamental zone of the given point group
+   * @param numOfSamplingPts Number of sampling points along the cube semi-edge
+   * @param ptGrpNum Point group number (1..32)
+   * @param offsetGrid Shift the sampling grid by half a step away from the origin
+   * @return Euler angle triplets (radians)
+   */
+  static std::vector<float> SampleRFZ(double numOfSamplingPts, int ptGrpNum, bool offsetGrid);
+
+  /**
+   * @brief SampleMisorientation Samples a cube (or only its surface) of the given misorientation
+   * around a reference orientation
+   * @param numOfSamplingPts Number of sampling points along the cube semi-edge
+   * @param refOrientation Reference orientation as Euler angles (degrees)
+   * @param misorientationAngle Misorientation angle (degrees)
+   * @param shellOnly Only sample the surface of the misorientation cube
+   * @return Euler angle triplets (radians)
+   */
+  static std::vector<float> SampleMisorientation(double numOfSamplingPts, const std::array<double, 3>& refOrientation, double misorientationAngle, bool shellOnly);
+
+  /**
+   * @brief IsinsideFZ Tests whether a 4-component Rodrigues vector lies inside the fundamental zone
+   * @param rod
+   * @param FZtype
+   * @param FZorder
+   * @return
+   */
+  static bool IsinsideFZ(const double* rod, int FZtype, int FZorder);
+
+  /**
+   * @brief MaxCubochoricSemiEdge Returns the semi-edge of the smallest cubochoric cube that encloses
+   * the fundamental zone.  The cube-to-ball mapping sends concentric cubes onto concentric spheres and
+   * the homochoric radius is monotonic in the rotation angle, so any grid point outside this cube can be
+   * rejected before the cu2ro conversion.
+   * @param FZtype
+   * @param FZorder
+   * @return
+   */
+  static double MaxCubochoricSemiEdge(int FZtype, int FZorder);
+
+  /**
+   * @brief RodriguesComposition Composes a 4-component Rodrigues vector with the 3-component vector sigma
+   * @param sigma
+   * @param rod
+   */
+  static void RodriguesComposition(const OrientationD& sigma, OrientationD& rod);
+
+protected:
+  CubochoricSampler();
+
+private:
+  static bool insideCyclicFZ(const double* rod, int order);
+  static bool insideDihedralFZ(const double* rod, int order);
+  static bool insideCubicFZ(const double* rod, int ot);
+
+public:
+  CubochoricSampler(const CubochoricSampler&) = delete;            // Copy Constructor Not Implemented
+  CubochoricSampler(CubochoricSampler&&) = delete;                 // Move Constructor Not Implemented
+  CubochoricSampler& operator=(const CubochoricSampler&) = delete; // Copy Assignment Not Implemented
+  CubochoricSampler& operator=(CubochoricSampler&&) = delete;      // Move Assignment Not Implemented
+};
@@ -39,13 +39,9 @@
 
 #include "Common/Constants.h"
 
+#include "Modules/PatternDisplayModule/AngleWidgets/CubochoricSampler.h"
 #include "Modules/PatternDisplayModule/PatternDisplay_UI.h"
 
-#include "EbsdLib/Core/EbsdLibConstants.h"
-#include "EbsdLib/Core/OrientationTransformation.hpp"
-
-using OrientationListArrayType = std::list<OrientationD>;
-
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
@@ -240,460 +236,22 @@ void SampleCubochoricSpaceWidget::on_samplingModeCB_currentIndexChanged(int inde
   valuesChanged();
 }
 
-// -----------------------------------------------------------------------------
-//
-// -----------------------------------------------------------------------------
-void SampleCubochoricSpaceWidget::RodriguesComposition(const OrientationD& sigma, OrientationD& rod) const
-{
-  OrientationD rho(3), rhomis(3);
-  rho[0] = -rod[0] * rod[3];
-  rho[1] = -rod[1] * rod[3];
-  rho[2] = -rod[2] * rod[3];
-
-  // perform the Rodrigues rotation composition with sigma to get rhomis
-  double denom = 1.0f + (sigma[0] * rho[0] + sigma[1] * rho[1] + sigma[2] * rho[2]);
-  if(denom == 0.0f)
-  {
-    double len;
-    len = sqrt(sigma[0] * sigma[0] + sigma[1] * sigma[1] + sigma[2] * sigma[2]);
-    rod[0] = sigma[0] / len;
-    rod[1] = sigma[1] / len;
-    rod[2] = sigma[2] / len;
-    rod[3] = std::numeric_limits<double>::infinity(); // set this to infinity
-  }
-  else
-  {
-    rhomis[0] = (rho[0] - sigma[0] + (rho[1] * sigma[2] - rho[2] * sigma[1])) / denom;
-    rhomis[1] = (rho[1] - sigma[1] + (rho[2] * sigma[0] - rho[0] * sigma[2])) / denom;
-    rhomis[2] = (rho[2] - sigma[2] + (rho[0] * sigma[1] - rho[1] * sigma[0])) / denom;
-    // revert rhomis to a four-component Rodrigues vector
-    double len;
-    len = sqrt(rhomis[0] * rhomis[0] + rhomis[1] * rhomis[1] + rhomis[2] * rhomis[2]);
-    if(len != 0.0f)
-    {
-      rod[0] = -rhomis[0] / len;
-      rod[1] = -rhomis[1] / len;
-      rod[2] = -rhomis[2] / len;
-      rod[3] = len;
-    }
-    else
-    {
-      rod[0] = 0.0;
-      rod[1] = 0.0;
-      rod[2] = 0.0;
-      rod[3] = 0.0;
-    }
-  }
-}
-
-// -----------------------------------------------------------------------------
-//
-// -----------------------------------------------------------------------------
-bool SampleCubochoricSpaceWidget::IsinsideFZ(double* rod, int FZtype, int FZorder) const
-{
-  bool insideFZ = false;
-  // dealing with 180 rotations is needed only for
-  // FZtypes 0 and 1; the other FZs are always finite.
-  switch(FZtype)
-  {
-  case EMsoftWorkbenchConstants::Constants::AnorthicType:
-    insideFZ = true; // all points are inside the FZ
-    break;
-  case EMsoftWorkbenchConstants::Constants::CyclicType:
-    insideFZ = insideCyclicFZ(rod, FZorder); // infinity is checked inside this function
-    break;
-  case EMsoftWorkbenchConstants::Constants::DihedralType:
-    if(rod[3] != std::numeric_limits<double>::infinity())
-    {
-      insideFZ = insideDihedralFZ(rod, FZorder);
-    }
-    break;
-  case EMsoftWorkbenchConstants::Constants::TetrahedralType:
-    if(rod[3] != std::numeric_limits<double>::infinity())
-    {
-      insideFZ = insideCubicFZ(rod, EMsoftWorkbenchConstants::Constants::TetrahedralType);
-    }
-    break;
-  case EMsoftWorkbenchConstants::Constants::OctahedralType:
-    if(rod[3] != std::numeric_limits<double>::infinity())
-    {
-      insideFZ = insideCubicFZ(rod, EMsoftWorkbenchConstants::Constants::OctahedralType);
-    }
-    break;
-  default:
-    insideFZ = false;
-    break;
-  }
-  return insideFZ;
-}
-
-// -----------------------------------------------------------------------------
-//
-// -----------------------------------------------------------------------------
-bool SampleCubochoricSpaceWidget::insideCyclicFZ(const double* rod, int order) const
-{
-
-  bool insideFZ = false;
-
-  if(rod[3] != std::numeric_limits<double>::infinity())
-  {
-    // check the z-component vs. tan(pi/2n)
-    insideFZ = fabs(rod[2] * rod[3]) <= EbsdLib::LPs::BP[order - 1];
-  }
-  else if(rod[2] == 0.0)
-  {
-    insideFZ = true;
-  }
-  return insideFZ;
-}
-
-// -----------------------------------------------------------------------------
-//
-// -----------------------------------------------------------------------------
-bool SampleCubochoricSpaceWidget::insideDihedralFZ(const double* rod, int order) const
-{
-
-  bool res = false, c1 = false, c2 = false;
-  double r[3] = {rod[0] * rod[3], rod[1] * rod[3], rod[2] * rod[3]};
-  const double r1 = 1.0;
-
-  // first, check the z-component vs. tan(pi/2n)  (same as insideCyclicFZ)
-  c1 = fabs(r[2]) <= EbsdLib::LPs::BP[order - 1];
-  res = false;
-
-  // check the square boundary planes if c1=true
-  if(c1)
-  {
-    switch(order)
-    {
-    case EMsoftWorkbenchConstants::Constants::TwoFoldAxisOrder:
-      c2 = (fabs(r[0]) <= r1) && (fabs(r[1]) <= r1);
-      break;
-    case EMsoftWorkbenchConstants::Constants::ThreeFoldAxisOrder:
-      c2 = fabs(EbsdLib::LPs::srt * r[0] + 0.50 * r[1]) <= r1;
-      c2 = c2 && (fabs(EbsdLib::LPs::srt * r[0] - 0.50 * r[1]) <= r1);
-      c2 = c2 && (fabs(r[1]) <= r1);
-      break;
-    case EMsoftWorkbenchConstants::Constants::FourFoldAxisOrder:
-      c2 = (fabs(r[0]) <= r1) && (fabs(r[1]) <= r1);
-      c2 = c2 && ((EbsdLib::LPs::r22 * fabs(r[0] + r[1]) <= r1) && (EbsdLib::LPs::r22 * fabs(r[0] - r[1]) <= r1));
-      break;
-    case EMsoftWorkbenchConstants::Constants::SixFoldAxisOrder:
-      c2 = fabs(0.50 * r[0] + EbsdLib::LPs::srt * r[1]) <= r1;
-      c2 = c2 && (fabs(EbsdLib::LPs::srt * r[0] + 0.50 * r[1]) <= r1);
-      c2 = c2 && (fabs(EbsdLib::LPs::srt * r[0] - 0.50 * r[1]) <= r1);
-      c2 = c2 && (fabs(0.50 * r[0] - EbsdLib::LPs::srt * r[1]) <= r1);
-      c2 = c2 && (fabs(r[1]) <= r1);
-      c2 = c2 && (fabs(r[0]) <= r1);
-      break;
-    default:
-      res = false;
-      break;
-    }
-    res = c2;
-  }
-  return res;
-}
-
-// -----------------------------------------------------------------------------
-//
-// -----------------------------------------------------------------------------
-bool SampleCubochoricSpaceWidget::insideCubicFZ(const double* rod, int ot) const
-{
-  bool res = false, c1 = false, c2 = false;
-  std::vector<double> r(3);
-  r[0] = rod[0] * rod[3];
-  r[1] = rod[1] * rod[3];
-  r[2] = rod[2] * rod[3];
-  const double r1 = 1.0;
-
-  // primary cube planes (only needed for octahedral case)
-  if(ot == EMsoftWorkbenchConstants::Constants::OctahedralType)
-  {
-    using VectorDoubleType = std::vector<double>;
-    using OMHelperType = ArrayHelpers<VectorDoubleType, double>;
-
-    VectorDoubleType out = OMHelperType::absValue(r);
-    double maxValue = OMHelperType::maxval(out);
-
-    c1 = maxValue <= EbsdLib::LPs::BP[3];
-  }
-  else
-  {
-    c1 = true;
-  }
-
-  // octahedral truncation planes, both for tetrahedral and octahedral point groups
-  c2 = ((fabs(r[0]) + fabs(r[1]) + fabs(r[2])) <= r1);
-
-  // if both c1 and c2, then the point is inside
-  if(c1 && c2)
-  {
-    res = true;
-  }
-
-  return res;
-}
-
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
 std::vector<float> SampleCubochoricSpaceWidget::getEulerAngles() const
 {
-  OrientationListArrayType FZlist;
-
   double numOfSamplingPts = numOfSamplingPtsLE->text().toDouble();
   if(samplingModeCB->currentIndex() == 0)
   {
     int ptGrpNum = ptGrpNumLE->text().toInt();
-
-    // here we perform the actual calculation; once we have the FZlist,
-    // we can allocate the data array and copy all entries
-    double x, y, z, delta;
-    int32_t FZtype, FZorder;
-
-    // step size for sampling of grid; maximum total number of samples = pow(2*getNumsp()+1,3)
-    delta = (0.50 * EbsdLib::LPs::ap) / static_cast<double>(numOfSamplingPts);
-
-    // do we need to shift this array away from the origin?
-    double gridShift = 0.0f;
-    if(offsetSamplingGridChkBox->isChecked())
-    {
-      gridShift = 0.5f;
-    }
-
-    // determine which function we should call for this point group symmetry
-    FZtype = EMsoftWorkbenchConstants::Constants::FZtarray[ptGrpNum - 1];
-    FZorder = EMsoftWorkbenchConstants::Constants::FZoarray[ptGrpNum - 1];
-
-    // loop over the cube of volume pi^2; note that we do not want to include
-    // the opposite edges/facets of the cube, to avoid double counting rotations
-    // with a rotation angle of 180 degrees.  This only affects the cyclic groups.
-    int Np = numOfSamplingPts;
-    int Totp = pow(2 * Np + 1, 3);
-    int Dn = Totp / 10;
-    int Dc = Dn;
-    int Di = 0;
-    int Dg = 0;
-
-    // eliminate points for which any of the coordinates lies outside the cube with semi-edge length "edge"
-    double edge = 0.5 * EbsdLib::LPs::ap;
-
-    for(int i = -Np + 1; i < Np + 1; i++)
-    {
-      x = (static_cast<double>(i) + gridShift) * delta;
-
-      if(fabs(x) <= edge)
-      {
-
-        for(int j = -Np + 1; j < Np + 1; j++)
-        {
-          y = (static_cast<double>(j) + gridShift) * delta;
-
-          if(fabs(y) <= edge)
-          {
-
-            for(int k = -Np + 1; k < Np + 1; k++)
-            {
-              z = (static_cast<double>(k) + gridShift) * delta;
-
-              if(fabs(z) <= edge)
-              {
-
-                // convert to Rodrigues representation
-                OrientationD rod = OrientationTransformation::cu2ro<OrientationD, OrientationD>(OrientationD(x, y, z));
-
-                // If insideFZ=true, then add this point to FZlist
-                bool b = IsinsideFZ(rod.data(), FZtype, FZorder);
-                if(b)
-                {
-                  FZlist.push_back(rod);
-                  Dg += 1;
-                }
-                Di += 1;
-              }
-            }
-          }
-        }
-      }
-
-      // report on status of computation
-      if(Di > Dc)
-      {
-        // Error: "Euler angle triplets tested: %1 of %2; triplets inside Rodrigues fundamental zone: %3 ").arg(QString::number(Di),QString::number(Totp),QString::number(Dg));
-
-        Dc += Dn;
-      }
-    }
+    return CubochoricSampler::SampleRFZ(numOfSamplingPts, ptGrpNum, offsetSamplingGridChkBox->isChecked());
   }
 
   // here are the misorientation sampling cases:
-  else
-  {
-    // here we perform the actual calculation; once we have the FZlist,
-    // we can allocate the data array and copy all entries
-    double x, y, z, delta, omega, semi;
-
-    double refOrientationX = refOrientationX_LE->text().toDouble();
-    double refOrientationY = refOrientationY_LE->text().toDouble();
-    double refOrientationZ = refOrientationZ_LE->text().toDouble();
-    double misorientationAngle = misorientationAngLE->text().toDouble();
-
-    // step size for sampling of grid; the edge length of the cube is (pi ( w - sin(w) ))^1/3 with w the misorientation angle
-    omega = misorientationAngle * EbsdLib::Constants::k_PiF / 180.0F;
-    semi = pow(EbsdLib::Constants::k_PiF * (omega - sin(omega)), 1.0F / 3.0F) * 0.5F;
-    delta = semi / static_cast<double>(numOfSamplingPts);
-
-    // convert the reference orientation to a 3-component Rodrigues vector sigma
-    OrientationD sigma(4), referenceOrientation(3);
-    referenceOrientation[0] = static_cast<double>(refOrientationX * EbsdLib::Constants::k_PiF / 180.0F);
-    referenceOrientation[1] = static_cast<double>(refOrientationY * EbsdLib::Constants::k_PiF / 180.0F);
-    referenceOrientation[2] = static_cast<double>(refOrientationZ * EbsdLib::Constants::k_PiF / 180.0F);
-    OrientationD sigm = OrientationTransformation::eu2ro<OrientationD, OrientationD>(referenceOrientation);
-
-    sigma[0] = sigm[0] * sigm[3];
-    sigma[1] = sigm[1] * sigm[3];
-    sigma[2] = sigm[2] * sigm[3];
-
-    if(samplingModeCB->currentIndex() == 1)
-    {
-      // set counter parameters for the loop over the sub-cube surface
-      int Np = numOfSamplingPts;
-      int Totp = 24 * Np * Np + 2;
-      int Dn = Totp / 20;
-      int Dc = Dn;
-      int Dg = 0;
-
-      // x-y bottom and top planes
-      for(int i = -Np; i <= Np; i++)
-      {
-        x = static_cast<double>(i) * delta;
-        for(int j = -Np; j <= Np; j++)
-        {
-          y = static_cast<double>(j) * delta;
-          // convert to Rodrigues representation and apply Rodrigues composition formula
-          {
-            OrientationD rod = OrientationTransformation::cu2ro<OrientationD, OrientationD>(OrientationD(-x, -y, -semi));
-            RodriguesComposition(sigma, rod);
-            FZlist.push_back(rod);
-            Dg += 1;
-          }
-          {
-            OrientationD rod = OrientationTransformation::cu2ro<OrientationD, OrientationD>(OrientationD(-x, -y, semi));
-            RodriguesComposition(sigma, rod);
-            FZlist.push_back(rod);
-            Dg += 1;
-          }
-        }
-      }
-      // y-z  planes
-      for(int j = -Np; j <= Np; j++)
-      {
-        y = static_cast<double>(j) * delta;
-        for(int k = -Np + 1; k <= Np - 1; k++)
-        {
-          z = static_cast<double>(k) * delta;
-          // convert to Rodrigues representation and apply Rodrigues composition formula
-          {
-            OrientationD rod = OrientationTransformation::cu2ro<OrientationD, OrientationD>(OrientationD(-semi, -y, -z));
-            RodriguesComposition(sigma, rod);
-            FZlist.push_back(rod);
-            Dg += 1;
-          }
-          {
-            OrientationD rod = OrientationTransformation::cu2ro<OrientationD, OrientationD>(OrientationD(semi, -y, -z));
-            RodriguesComposition(sigma, rod);
-            FZlist.push_back(rod);
-            Dg += 1;
-          }
-        }
-      }
-      // finally the x-z  planes
-      for(int i = -Np + 1; i <= Np - 1; i++)
-      {
-        x = static_cast<double>(i) * delta;
-        for(int k = -Np + 1; k <= Np - 1; k++)
-        {
-          z = static_cast<double>(k) * delta;
-          // convert to Rodrigues representation and apply Rodrigues composition formula
-          {
-            OrientationD rod = OrientationTransformation::cu2ro<OrientationD, OrientationD>(OrientationD(-x, -semi, -z));
-            RodriguesComposition(sigma, rod);
-            FZlist.push_back(rod);
-            Dg += 1;
-          }
-          {
-            OrientationD rod = OrientationTransformation::cu2ro<OrientationD, OrientationD>(OrientationD(-x, semi, -z));
-            RodriguesComposition(sigma, rod);
-            FZlist.push_back(rod);
-            Dg += 1;
-          }
-        }
-      }
-
-      // report on status of computation
-      if(Dg > Dc)
-      {
-        // Error: "Euler angle triplets generated: %1 out of %2").arg(QString::number(Dg),QString::number(Totp));
-
-        Dc += Dn;
-      }
-    }
-    else
-    {
-      // set counter parameters for the loop over the sub-cube surface
-      int Np = numOfSamplingPts;
-      int Totp = pow((2 * Np + 1), 3); // see misorientation sampling paper for this expression
-      int Dn = Totp / 20;
-      int Dc = Dn;
-      int Dg = 0;
-
-      for(int i = -Np; i <= Np; i++)
-      {
-        x = static_cast<double>(i) * delta;
-        for(int j = -Np; j <= Np; j++)
-        {
-          y = static_cast<double>(j) * delta;
-          for(int k = -Np; k <= Np; k++)
-          {
-            z = static_cast<double>(k) * delta;
-            // convert to Rodrigues representation and apply Rodrigues composition formula
-            {
-              OrientationD rod = OrientationTransformation::cu2ro<OrientationD, OrientationD>(OrientationD(-x, -y, -z));
-              RodriguesComposition(sigma, rod);
-              FZlist.push_back(rod);
-              Dg += 1;
-            }
-          }
-        }
-        // report on status of computation
-        if(Dg > Dc)
-        {
-          // Error: "Euler angle triplets generated: %1 out of %2").arg(QString::number(Dg),QString::number(Totp));
-
-          Dc += Dn;
-        }
-      }
-    }
-  }
-
-  // resize the EulerAngles array to the number of items in FZlist; don't forget to redefine the hard pointer
-  std::vector<float> eulerAngles(FZlist.size() * 3);
-
-  // copy the Rodrigues vectors as Euler angles into the eulerAngles array; convert doubles to floats along the way
-  int j = 0;
-  for(const OrientationD& rod : FZlist)
-  {
-    OrientationD eu = OrientationTransformation::ro2eu<OrientationD, OrientationD>(rod);
-
-    eulerAngles.at(j + 0) = static_cast<float>(eu[0]);
-    eulerAngles.at(j + 1) = static_cast<float>(eu[1]);
-    eulerAngles.at(j + 2) = static_cast<float>(eu[2]);
-
-    j += 3;
-  }
-
-  return eulerAngles;
+  std::array<double, 3> refOrientation = {refOrientationX_LE->text().toDouble(), refOrientationY_LE->text().toDouble(), refOrientationZ_LE->text().toDouble()};
+  double misorientationAngle = misorientationAngLE->text().toDouble();
+  return CubochoricSampler::SampleMisorientation(numOfSamplingPts, refOrientation, misorientationAngle, samplingModeCB->currentIndex() == 1);
 }
 
 // -----------------------------------------------------------------------------
@@ -105,17 +105,8 @@ protected slots:
   void lineEditChanged(const QString& text) const;
 
 private:
-
-
   void valuesChanged() const;
 
-  void RodriguesComposition(const OrientationD& sigma, OrientationD& rod) const;
-
-  bool IsinsideFZ(double* rod, int FZtype, int FZorder) const;
-  bool insideCyclicFZ(const double* rod, int order) const;
-  bool insideDihedralFZ(const double* rod, int order) const;
-  bool insideCubicFZ(const double* rod, int ot) const;
-
 public:
   SampleCubochoricSpaceWidget(const SampleCubochoricSpaceWidget&) = delete;            // Copy Constructor Not Implemented
   SampleCubochoricSpaceWidget(SampleCubochoricSpaceWidget&&) = delete;                 // Move Constructor Not Implemented
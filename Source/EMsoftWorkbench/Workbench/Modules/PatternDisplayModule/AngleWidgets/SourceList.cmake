@@ -56,6 +56,7 @@ set(EMsoftWorkbench_${MODULE_NAME}_${AngleWidgets_NAME}_SRCS
     ${Angle_Widgets_SRCS}
     ${${AngleWidgets_NAME}_DIR}/AbstractAngleWidget.cpp
     ${${AngleWidgets_NAME}_DIR}/AngleReaderWidget.cpp
+    ${${AngleWidgets_NAME}_DIR}/CubochoricSampler.cpp
     ${${AngleWidgets_NAME}_DIR}/SampleCubochoricSpaceWidget.cpp
     ${${AngleWidgets_NAME}_DIR}/SamplingRateWidget.cpp
     ${${AngleWidgets_NAME}_DIR}/SingleAngleWidget.cpp
@@ -80,6 +81,7 @@ set(EMsoftWorkbench_${MODULE_NAME}_${AngleWidgets_NAME}_HDRS ${Angle_Widgets_HDR
 
 set(EMsoftWorkbench_${MODULE_NAME}_${AngleWidgets_NAME}_HDRS ${Angle_Widgets_HDRS}
       ${${PLUGIN_NAME}_Widgets_MOC_HDRS}
+      ${${AngleWidgets_NAME}_DIR}/CubochoricSampler.h
   )
 
 # Organize the Source files for things like Visual Studio and Xcode
@@ -279,6 +279,7 @@ void PatternDisplayController::generatePatternImagesUsingThread(const SimulatedP
       iParValues.numOfPixelsY = detectorData.numOfPixelsY;
       iParValues.detectorBinningValue = static_cast<int32_t>(patternData.detectorBinningValue);
       iParValues.numberOfOrientations = 1;
+      iParValues.energyClusters = detectorData.energyClusters;
 
       // Build up the fParValues object
       PatternTools::FParValues fParValues;
@@ -106,6 +106,7 @@ public:
     double energyMin;
     double energyMax;
     QString masterFilePath;
+    int energyClusters = 0;
   };
 
   /**
@@ -35,6 +35,8 @@
 
 #include "PatternDisplay_UI.h"
 
+#include <limits>
+
 #include <QtCore/QDebug>
 
 #include <QtGui/QScreen>
@@ -136,6 +138,9 @@ void PatternDisplay_UI::createValidators() const
 
   dblValidator = new QDoubleValidator(barrelDistortion);
   barrelDistortion->setValidator(dblValidator);
+
+  intValidator = new QIntValidator(0, std::numeric_limits<int>::max(), energyClusters);
+  energyClusters->setValidator(intValidator);
 }
 
 // -----------------------------------------------------------------------------
@@ -217,6 +222,7 @@ void PatternDisplay_UI::createModificationConnections()
   connect(beamCurrent, &QLineEdit::textEdited, [=] { parametersChanged(); });
   connect(dwellTime, &QLineEdit::textEdited, [=] { parametersChanged(); });
   connect(barrelDistortion, &QLineEdit::textEdited, [=] { parametersChanged(); });
+  connect(energyClusters, &QLineEdit::textEdited, [=] { parametersChanged(); });
 
   // Tab Widget
   connect(patternDisplayTabWidget, &QTabWidget::currentChanged, [=] { parametersChanged(); });
@@ -309,6 +315,7 @@ PatternDisplayController::DetectorData PatternDisplay_UI::getDetectorData() cons
   detectorData.scintillatorDist = scintillatorDist->text().toDouble();
   detectorData.scintillatorPixelSize = scintillatorPixSize->text().toDouble();
   detectorData.masterFilePath = mpLabel->text();
+  detectorData.energyClusters = energyClusters->text().toInt();
   return detectorData;
 }
 
@@ -544,6 +551,7 @@ void PatternDisplay_UI::readDetectorAndMicroscopeParameters(QJsonObject& obj)
   beamCurrent->setText(QString::number(obj[EMsoftWorkbenchConstants::IOStrings::BeamCurrent].toDouble()));
   dwellTime->setText(QString::number(obj[EMsoftWorkbenchConstants::IOStrings::DwellTime].toDouble()));
   barrelDistortion->setText(QString::number(obj[EMsoftWorkbenchConstants::IOStrings::BarrelDistortion].toDouble()));
+  energyClusters->setText(QString::number(obj[EMsoftWorkbenchConstants::IOStrings::EnergyClusters].toInt(0)));
 
   QJsonObject energyObj = obj[EMsoftWorkbenchConstants::IOStrings::Energy].toObject();
   energyMinCB->setCurrentText(QString::number(energyObj[EMsoftWorkbenchConstants::IOStrings::Minimum].toInt()));
@@ -612,6 +620,7 @@ void PatternDisplay_UI::writeDetectorAndMicroscopeParameters(QJsonObject& obj) c
   obj[EMsoftWorkbenchConstants::IOStrings::BeamCurrent] = beamCurrent->text().toDouble();
   obj[EMsoftWorkbenchConstants::IOStrings::DwellTime] = dwellTime->text().toDouble();
   obj[EMsoftWorkbenchConstants::IOStrings::BarrelDistortion] = barrelDistortion->text().toDouble();
+  obj[EMsoftWorkbenchConstants::IOStrings::EnergyClusters] = energyClusters->text().toInt();
 
   QJsonObject energyObj;
   energyObj[EMsoftWorkbenchConstants::IOStrings::Minimum] = energyMinCB->currentText().toInt();
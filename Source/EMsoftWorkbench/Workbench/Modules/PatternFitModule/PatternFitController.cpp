@@ -56,18 +56,37 @@ PatternFitController::PatternFitController(QObject* parent)
 : QObject(parent)
 , m_Observer(nullptr)
 {
+  m_FitEngine = new PatternFitEngine(this);
+  m_FitEngine->setMasterPatternData(&m_MPFileData);
+
+  connect(m_FitEngine, &PatternFitEngine::fitProgress, this, &PatternFitController::fitProgress);
+  connect(m_FitEngine, &PatternFitEngine::fitFinished, this, &PatternFitController::fitFinished);
 }
 
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
-PatternFitController::~PatternFitController() = default;
+PatternFitController::~PatternFitController()
+{
+  m_FitEngine->cancelFit();
+  for(const QSharedPointer<QFutureWatcher<void>>& watcher : m_Watchers)
+  {
+    watcher->waitForFinished();
+  }
+}
 
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
 void PatternFitController::setMasterFilePath(const QString& masterFilePath)
 {
+  // the fit engine reads m_MPFileData on its worker thread
+  if(m_FitEngine->isFitting())
+  {
+    emit errorMessageGenerated(tr("The master pattern file cannot be changed while a fit is running."));
+    return;
+  }
+
   m_MasterFilePath = masterFilePath;
 
   QFileInfo fi(masterFilePath);
@@ -78,6 +97,7 @@ void PatternFitController::setMasterFilePath(const QString& masterFilePath)
 
   MasterPatternFileReader reader(masterFilePath, m_Observer);
   m_MPFileData = reader.readMasterPatternData();
+  m_FitEngine->setMasterPatternData(&m_MPFileData);
 
   if(m_MPFileData.ekevs.empty())
   {
@@ -91,35 +111,113 @@ void PatternFitController::setMasterFilePath(const QString& masterFilePath)
 // -----------------------------------------------------------------------------
 std::vector<float> PatternFitController::generatePattern(PatternFitController::SimulationData detectorData)
 {
-  // Build up the iParValues object
-  PatternTools::IParValues iParValues;
-  iParValues.numsx = m_MPFileData.numsx;
-  iParValues.numset = m_MPFileData.numset;
-  iParValues.incidentBeamVoltage = static_cast<float>(m_MPFileData.incidentBeamVoltage);
-  iParValues.minEnergy = static_cast<float>(m_MPFileData.minEnergy);
-  iParValues.energyBinSize = static_cast<float>(m_MPFileData.energyBinSize);
-  iParValues.npx = m_MPFileData.npx;
-  iParValues.numOfPixelsX = detectorData.numOfPixelsX;
-  iParValues.numOfPixelsY = detectorData.numOfPixelsY;
-  iParValues.detectorBinningValue = 1;
-  iParValues.numberOfOrientations = 1;
+  // the fit engine keeps the detector tables between calls, so stepping an orientation
+  // or the gamma value does not rebuild the detector geometry and energy weights
+  return m_FitEngine->generatePattern(GetDetectorSetup(detectorData), GetParameters(detectorData));
+}
 
-  // Build up the fParValues object
-  PatternTools::FParValues fParValues;
-  fParValues.omega = static_cast<float>(m_MPFileData.omega);
-  fParValues.sigma = static_cast<float>(m_MPFileData.sigma);
-  fParValues.pcPixelsX = detectorData.patternCenterX;
-  fParValues.pcPixelsY = detectorData.patternCenterY;
-  fParValues.scintillatorPixelSize = detectorData.scintillatorPixelSize;
-  fParValues.scintillatorDist = detectorData.scintillatorDist;
-  fParValues.detectorTiltAngle = detectorData.detectorTiltAngle;
-  fParValues.beamCurrent = detectorData.beamCurrent;
-  fParValues.dwellTime = detectorData.dwellTime;
-  fParValues.gammaValue = detectorData.gammaValue;
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+PatternFitEngine::DetectorSetup PatternFitController::GetDetectorSetup(const PatternFitController::SimulationData& data)
+{
+  PatternFitEngine::DetectorSetup setup;
+  setup.scintillatorPixelSize = data.scintillatorPixelSize;
+  setup.numOfPixelsX = data.numOfPixelsX;
+  setup.numOfPixelsY = data.numOfPixelsY;
+  setup.beamCurrent = data.beamCurrent;
+  setup.dwellTime = data.dwellTime;
+  return setup;
+}
 
-  std::vector<float> pattern =
-      PatternTools::GeneratePattern(iParValues, fParValues, m_MPFileData.masterLPNHData, m_MPFileData.masterLPSHData, m_MPFileData.monteCarloSquareData, detectorData.angles, 0, m_Cancel);
-  return pattern;
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+PatternFitEngine::ParameterArray PatternFitController::GetParameters(const PatternFitController::SimulationData& data)
+{
+  using Parameter = PatternFitEngine::Parameter;
+  PatternFitEngine::ParameterArray parameters;
+  parameters[static_cast<size_t>(Parameter::ScintillatorDist)] = data.scintillatorDist;
+  parameters[static_cast<size_t>(Parameter::SampleOmegaAngle)] = data.sampleOmegaAngle;
+  parameters[static_cast<size_t>(Parameter::PatternCenterX)] = data.patternCenterX;
+  parameters[static_cast<size_t>(Parameter::PatternCenterY)] = data.patternCenterY;
+  parameters[static_cast<size_t>(Parameter::DetectorTiltAngle)] = data.detectorTiltAngle;
+  parameters[static_cast<size_t>(Parameter::IntensityGamma)] = data.gammaValue;
+  parameters[static_cast<size_t>(Parameter::Phi1)] = data.angles[0] / EbsdLib::Constants::k_PiOver180D;
+  parameters[static_cast<size_t>(Parameter::Phi)] = data.angles[1] / EbsdLib::Constants::k_PiOver180D;
+  parameters[static_cast<size_t>(Parameter::Phi2)] = data.angles[2] / EbsdLib::Constants::k_PiOver180D;
+  return parameters;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void PatternFitController::ApplyFitParameters(const QVector<double>& parameters, PatternFitController::SimulationData& data)
+{
+  using Parameter = PatternFitEngine::Parameter;
+  if(parameters.size() != static_cast<int>(PatternFitEngine::k_NumParameters))
+  {
+    return;
+  }
+  data.scintillatorDist = parameters[static_cast<int>(Parameter::ScintillatorDist)];
+  data.sampleOmegaAngle = parameters[static_cast<int>(Parameter::SampleOmegaAngle)];
+  data.patternCenterX = parameters[static_cast<int>(Parameter::PatternCenterX)];
+  data.patternCenterY = parameters[static_cast<int>(Parameter::PatternCenterY)];
+  data.detectorTiltAngle = parameters[static_cast<int>(Parameter::DetectorTiltAngle)];
+  data.gammaValue = parameters[static_cast<int>(Parameter::IntensityGamma)];
+  data.angles.resize(3);
+  data.angles[0] = static_cast<float>(parameters[static_cast<int>(Parameter::Phi1)] * EbsdLib::Constants::k_PiOver180D);
+  data.angles[1] = static_cast<float>(parameters[static_cast<int>(Parameter::Phi)] * EbsdLib::Constants::k_PiOver180D);
+  data.angles[2] = static_cast<float>(parameters[static_cast<int>(Parameter::Phi2)] * EbsdLib::Constants::k_PiOver180D);
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void PatternFitController::setExperimentalPattern(const QImage& image)
+{
+  m_FitEngine->setExperimentalPattern(image);
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void PatternFitController::startFit(PatternFitController::SimulationData data, const PatternFitEngine::ParameterArray& stepSizes, const PatternFitEngine::RefineArray& refine)
+{
+  if(!m_FitEngine->reserveFit())
+  {
+    return;
+  }
+
+  PatternFitEngine::FitSettings settings;
+  settings.start = GetParameters(data);
+  settings.stepSize = stepSizes;
+  settings.refine = refine;
+  settings.useCircularMask = data.useCircularMask;
+  PatternFitEngine::DetectorSetup setup = GetDetectorSetup(data);
+
+  QSharedPointer<QFutureWatcher<void>> watcher = QSharedPointer<QFutureWatcher<void>>(new QFutureWatcher<void>());
+  connect(watcher.data(), &QFutureWatcher<void>::finished, this, [=] { m_Watchers.removeAll(watcher); });
+
+  QFuture<void> future = QtConcurrent::run(m_FitEngine, &PatternFitEngine::fit, setup, settings);
+  watcher->setFuture(future);
+  m_Watchers.push_back(watcher);
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void PatternFitController::cancelFit()
+{
+  m_FitEngine->cancelFit();
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+bool PatternFitController::isFitting() const
+{
+  return m_FitEngine->isFitting();
 }
 
 // -----------------------------------------------------------------------------
@@ -222,7 +320,13 @@ IObserver* PatternFitController::getObserver() const
 // -----------------------------------------------------------------------------
 void PatternFitController::setMPFileData(const MasterPatternFileReader::MasterPatternData& value)
 {
+  if(m_FitEngine->isFitting())
+  {
+    emit errorMessageGenerated(tr("The master pattern data cannot be changed while a fit is running."));
+    return;
+  }
   m_MPFileData = value;
+  m_FitEngine->setMasterPatternData(&m_MPFileData);
 }
 
 // -----------------------------------------------------------------------------
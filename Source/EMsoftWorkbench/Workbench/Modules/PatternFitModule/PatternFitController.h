@@ -49,6 +49,7 @@
 
 #include "EbsdLib/Math/EbsdLibMath.h"
 
+#include "Modules/PatternFitModule/PatternFitEngine.h"
 #include "Modules/PatternFitModule/PatternFitViewer.h"
 
 class PatternFitController : public QObject
@@ -87,8 +88,8 @@ public:
     double scintillatorPixelSize;
     int numOfPixelsX;
     int numOfPixelsY;
-    int patternCenterX;
-    int patternCenterY;
+    double patternCenterX;
+    double patternCenterY;
     double beamCurrent;
     double dwellTime;
     double sampleOmegaAngle;
@@ -140,6 +141,38 @@ public:
    */
   void setMasterFilePath(const QString &masterFilePath);
 
+  /**
+   * @brief setExperimentalPattern Sets the reference pattern that the automated fit compares against
+   * @param image
+   */
+  void setExperimentalPattern(const QImage& image);
+
+  /**
+   * @brief startFit Starts an automated Nelder-Mead fit on a worker thread
+   * @param data Current parameter values; these are the starting point of the fit
+   * @param stepSizes Initial simplex step for each PatternFitEngine::Parameter
+   * @param refine Which PatternFitEngine::Parameter entries are free
+   */
+  void startFit(PatternFitController::SimulationData data, const PatternFitEngine::ParameterArray& stepSizes, const PatternFitEngine::RefineArray& refine);
+
+  /**
+   * @brief cancelFit
+   */
+  void cancelFit();
+
+  /**
+   * @brief isFitting
+   * @return
+   */
+  bool isFitting() const;
+
+  /**
+   * @brief ApplyFitParameters Copies fitted parameter values back into a SimulationData object
+   * @param parameters
+   * @param data
+   */
+  static void ApplyFitParameters(const QVector<double>& parameters, PatternFitController::SimulationData& data);
+
   using VariantPair = QPair<QVariant, QVariant>;
   using FloatPair = QPair<float, float>;
   using IntPair = QPair<int, int>;
@@ -156,6 +189,8 @@ signals:
   void newProgressBarValue(int value) const;
   void rowDataChanged(const QModelIndex&, const QModelIndex&) const;
   void generationFinished() const;
+  void fitProgress(int evaluations, double dotProduct, QVector<double> parameters) const;
+  void fitFinished(int evaluations, double dotProduct, QVector<double> parameters) const;
 
   void errorMessageGenerated(const QString& msg) const;
   void warningMessageGenerated(const QString& msg) const;
@@ -170,6 +205,22 @@ private:
 
   QVector<QSharedPointer<QFutureWatcher<void>>> m_Watchers;
 
+  PatternFitEngine* m_FitEngine = nullptr;
+
+  /**
+   * @brief getDetectorSetup
+   * @param data
+   * @return
+   */
+  static PatternFitEngine::DetectorSetup GetDetectorSetup(const PatternFitController::SimulationData& data);
+
+  /**
+   * @brief GetParameters
+   * @param data
+   * @return
+   */
+  static PatternFitEngine::ParameterArray GetParameters(const PatternFitController::SimulationData& data);
+
 public:
   PatternFitController(const PatternFitController&) = delete; // Copy Constructor Not Implemented
   PatternFitController(PatternFitController&&) = delete;      // Move Constructor Not Implemented
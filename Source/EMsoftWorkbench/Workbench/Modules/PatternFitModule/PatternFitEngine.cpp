@@ -0,0 +1,417 @@
+/* ============================================================================
+ * Copyright (c) 2009-2017 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-07-D-5800
+ *    United States Air Force Prime Contract FA8650-10-D-5210
+ *    United States Prime Contract Navy N00173-07-C-2068
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#include "PatternFitEngine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include <QtCore/QMutexLocker>
+
+#include "EbsdLib/Core/EbsdLibConstants.h"
+#include "EbsdLib/Core/OrientationTransformation.hpp"
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+PatternFitEngine::PatternFitEngine(QObject* parent)
+: QObject(parent)
+, m_CancelFit(false)
+, m_Fitting(false)
+{
+  qRegisterMetaType<QVector<double>>("QVector<double>");
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+PatternFitEngine::~PatternFitEngine() = default;
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void PatternFitEngine::setMasterPatternData(MasterPatternFileReader::MasterPatternData* data)
+{
+  QMutexLocker locker(&m_Mutex);
+  m_MPData = data;
+  m_DetectorValid = false;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void PatternFitEngine::setExperimentalPattern(const QImage& image)
+{
+  QMutexLocker locker(&m_Mutex);
+
+  QImage pattern = image;
+  if(pattern.format() != QImage::Format_Grayscale8)
+  {
+    pattern = pattern.convertToFormat(QImage::Format_Grayscale8);
+  }
+
+  m_ExpPatternDims[0] = pattern.width();
+  m_ExpPatternDims[1] = pattern.height();
+  m_ExpPattern.resize(static_cast<size_t>(pattern.width()) * pattern.height());
+  for(int y = 0; y < pattern.height(); y++)
+  {
+    const uchar* line = pattern.constScanLine(y);
+    for(int x = 0; x < pattern.width(); x++)
+    {
+      m_ExpPattern[static_cast<size_t>(y) * pattern.width() + x] = static_cast<float>(line[x]);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void PatternFitEngine::updateParameterArrays(const DetectorSetup& setup, const ParameterArray& parameters)
+{
+  PatternTools::IParValues iParValues;
+  iParValues.numsx = m_MPData->numsx;
+  iParValues.numset = m_MPData->numset;
+  iParValues.incidentBeamVoltage = static_cast<float>(m_MPData->incidentBeamVoltage);
+  iParValues.minEnergy = static_cast<float>(m_MPData->minEnergy);
+  iParValues.energyBinSize = static_cast<float>(m_MPData->energyBinSize);
+  iParValues.npx = m_MPData->npx;
+  iParValues.numOfPixelsX = setup.numOfPixelsX;
+  iParValues.numOfPixelsY = setup.numOfPixelsY;
+  iParValues.detectorBinningValue = 1;
+  iParValues.numberOfOrientations = 1;
+
+  PatternTools::FParValues fParValues;
+  fParValues.omega = static_cast<float>(parameters[static_cast<size_t>(Parameter::SampleOmegaAngle)]);
+  fParValues.sigma = static_cast<float>(m_MPData->sigma);
+  fParValues.pcPixelsX = parameters[static_cast<size_t>(Parameter::PatternCenterX)];
+  fParValues.pcPixelsY = parameters[static_cast<size_t>(Parameter::PatternCenterY)];
+  fParValues.scintillatorPixelSize = setup.scintillatorPixelSize;
+  fParValues.scintillatorDist = parameters[static_cast<size_t>(Parameter::ScintillatorDist)];
+  fParValues.detectorTiltAngle = parameters[static_cast<size_t>(Parameter::DetectorTiltAngle)];
+  fParValues.beamCurrent = setup.beamCurrent;
+  fParValues.dwellTime = setup.dwellTime;
+  fParValues.gammaValue = parameters[static_cast<size_t>(Parameter::IntensityGamma)];
+
+  std::vector<int32_t> iPar = PatternTools::CreateIPar(iParValues);
+  std::vector<float> fPar = PatternTools::CreateFPar(fParValues);
+
+  // the gamma value (fpar(22)) is applied per pattern; every other entry feeds the detector tables
+  if(m_DetectorValid && iPar.size() == m_IPar.size() && fPar.size() == m_FPar.size())
+  {
+    bool same = std::equal(iPar.begin(), iPar.end(), m_IPar.begin());
+    for(size_t i = 0; i < fPar.size() && same; i++)
+    {
+      same = (i == 21) || (fPar[i] == m_FPar[i]);
+    }
+    m_DetectorValid = same;
+  }
+
+  m_IPar = iPar;
+  m_FPar = fPar;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+std::vector<float> PatternFitEngine::generatePattern(const DetectorSetup& setup, const ParameterArray& parameters)
+{
+  QMutexLocker locker(&m_Mutex);
+  if(m_MPData == nullptr || m_MPData->masterLPNHData.empty())
+  {
+    return std::vector<float>();
+  }
+
+  updateParameterArrays(setup, parameters);
+
+  using EulerType = std::vector<float>;
+  using QuatType = std::vector<float>;
+  EulerType eulerAngle(3);
+  eulerAngle[0] = static_cast<float>(parameters[static_cast<size_t>(Parameter::Phi1)] * EbsdLib::Constants::k_PiOver180D);
+  eulerAngle[1] = static_cast<float>(parameters[static_cast<size_t>(Parameter::Phi)] * EbsdLib::Constants::k_PiOver180D);
+  eulerAngle[2] = static_cast<float>(parameters[static_cast<size_t>(Parameter::Phi2)] * EbsdLib::Constants::k_PiOver180D);
+  QuatType quat = OrientationTransformation::eu2qu<EulerType, QuatType>(eulerAngle, Quaternion<float>::Order::ScalarVector);
+
+  m_Cancel = false;
+  std::vector<float> pattern = PatternTools::GeneratePatterns(this, m_IPar, m_FPar, m_MPData->masterLPNHData, m_MPData->masterLPSHData, m_MPData->monteCarloSquareData, quat,
+                                                              m_DetectorValid, m_Cancel);
+  m_DetectorValid = true;
+
+  return pattern;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+double PatternFitEngine::dotProduct(const std::vector<float>& pattern, bool useCircularMask) const
+{
+  if(pattern.empty() || pattern.size() != m_ExpPattern.size())
+  {
+    return 0.0;
+  }
+
+  int32_t xDim = m_ExpPatternDims[0];
+  int32_t yDim = m_ExpPatternDims[1];
+  int32_t centerX = xDim / 2;
+  int32_t centerY = yDim / 2;
+  int32_t radius = std::min(xDim, yDim) / 2;
+  int32_t radius_sq = radius * radius;
+
+  // zero-mean, unit-length dot product over the (optionally masked) pixels; the simulated pattern is
+  // stored upside down with respect to the experimental image, so its rows are flipped just like the
+  // pattern display does (mirroredVertical)
+  double sumS = 0.0, sumE = 0.0;
+  size_t count = 0;
+  for(int32_t y = 0; y < yDim; y++)
+  {
+    for(int32_t x = 0; x < xDim; x++)
+    {
+      if(useCircularMask && (x - centerX) * (x - centerX) + (y - centerY) * (y - centerY) > radius_sq)
+      {
+        continue;
+      }
+      size_t idx = static_cast<size_t>(y) * xDim + x;
+      size_t simIdx = static_cast<size_t>(yDim - 1 - y) * xDim + x;
+      sumS += pattern[simIdx];
+      sumE += m_ExpPattern[idx];
+      count++;
+    }
+  }
+  if(count == 0)
+  {
+    return 0.0;
+  }
+  double meanS = sumS / count;
+  double meanE = sumE / count;
+
+  double dot = 0.0, normS = 0.0, normE = 0.0;
+  for(int32_t y = 0; y < yDim; y++)
+  {
+    for(int32_t x = 0; x < xDim; x++)
+    {
+      if(useCircularMask && (x - centerX) * (x - centerX) + (y - centerY) * (y - centerY) > radius_sq)
+      {
+        continue;
+      }
+      size_t idx = static_cast<size_t>(y) * xDim + x;
+      size_t simIdx = static_cast<size_t>(yDim - 1 - y) * xDim + x;
+      double s = pattern[simIdx] - meanS;
+      double e = m_ExpPattern[idx] - meanE;
+      dot += s * e;
+      normS += s * s;
+      normE += e * e;
+    }
+  }
+  if(normS <= 0.0 || normE <= 0.0)
+  {
+    return 0.0;
+  }
+  return dot / std::sqrt(normS * normE);
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+bool PatternFitEngine::reserveFit()
+{
+  bool expected = false;
+  return m_Fitting.compare_exchange_strong(expected, true);
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void PatternFitEngine::fit(const DetectorSetup& setup, const FitSettings& settings)
+{
+  m_Fitting = true;
+  m_CancelFit = false;
+
+  // the free parameters are scaled by their fit step, so the initial simplex has unit edges
+  std::vector<size_t> freeParams;
+  for(size_t i = 0; i < k_NumParameters; i++)
+  {
+    if(settings.refine[i] && settings.stepSize[i] != 0.0)
+    {
+      freeParams.push_back(i);
+    }
+  }
+  size_t n = freeParams.size();
+
+  auto toParameters = [&](const std::vector<double>& x) {
+    ParameterArray p = settings.start;
+    for(size_t i = 0; i < n; i++)
+    {
+      p[freeParams[i]] += x[i] * settings.stepSize[freeParams[i]];
+    }
+    return p;
+  };
+
+  int evaluations = 0;
+  auto objective = [&](const std::vector<double>& x) {
+    evaluations++;
+    std::vector<float> pattern = generatePattern(setup, toParameters(x));
+    return -dotProduct(pattern, settings.useCircularMask);
+  };
+
+  auto toVector = [](const ParameterArray& p) { return QVector<double>(p.begin(), p.end()); };
+
+  std::vector<std::vector<double>> simplex(n + 1, std::vector<double>(n, 0.0));
+  std::vector<double> values(n + 1, 0.0);
+  for(size_t v = 0; v <= n; v++)
+  {
+    if(v > 0)
+    {
+      simplex[v][v - 1] = 1.0;
+    }
+    values[v] = objective(simplex[v]);
+  }
+
+  // standard Nelder-Mead coefficients
+  const double alpha = 1.0, gamma = 2.0, rho = 0.5, sigma = 0.5;
+  std::vector<size_t> order(n + 1);
+  double lastReported = 1.0;
+
+  while(n > 0 && evaluations < settings.maxEvaluations && !m_CancelFit)
+  {
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return values[a] < values[b]; });
+    size_t best = order.front();
+    size_t worst = order.back();
+    size_t secondWorst = order[n - 1];
+
+    if(values[best] < lastReported)
+    {
+      lastReported = values[best];
+      emit fitProgress(evaluations, -values[best], toVector(toParameters(simplex[best])));
+    }
+
+    if(values[worst] - values[best] <= settings.tolerance)
+    {
+      break;
+    }
+
+    std::vector<double> centroid(n, 0.0);
+    for(size_t v = 0; v <= n; v++)
+    {
+      if(v == worst)
+      {
+        continue;
+      }
+      for(size_t i = 0; i < n; i++)
+      {
+        centroid[i] += simplex[v][i] / static_cast<double>(n);
+      }
+    }
+
+    auto along = [&](double coeff, const std::vector<double>& from) {
+      std::vector<double> x(n);
+      for(size_t i = 0; i < n; i++)
+      {
+        x[i] = centroid[i] + coeff * (from[i] - centroid[i]);
+      }
+      return x;
+    };
+
+    std::vector<double> xr = along(-alpha, simplex[worst]);
+    double fr = objective(xr);
+    if(fr < values[best])
+    {
+      std::vector<double> xe = along(-gamma, simplex[worst]);
+      double fe = objective(xe);
+      if(fe < fr)
+      {
+        simplex[worst] = xe;
+        values[worst] = fe;
+      }
+      else
+      {
+        simplex[worst] = xr;
+        values[worst] = fr;
+      }
+    }
+    else if(fr < values[secondWorst])
+    {
+      simplex[worst] = xr;
+      values[worst] = fr;
+    }
+    else
+    {
+      // outside contraction if the reflected point improved on the worst one, inside otherwise
+      bool outside = fr < values[worst];
+      std::vector<double> xc = outside ? along(rho, xr) : along(rho, simplex[worst]);
+      double fc = objective(xc);
+      if(fc < std::min(fr, values[worst]))
+      {
+        simplex[worst] = xc;
+        values[worst] = fc;
+      }
+      else
+      {
+        for(size_t v = 0; v <= n; v++)
+        {
+          if(v == best)
+          {
+            continue;
+          }
+          for(size_t i = 0; i < n; i++)
+          {
+            simplex[v][i] = simplex[best][i] + sigma * (simplex[v][i] - simplex[best][i]);
+          }
+          values[v] = objective(simplex[v]);
+        }
+      }
+    }
+  }
+
+  size_t best = static_cast<size_t>(std::distance(values.begin(), std::min_element(values.begin(), values.end())));
+  m_Fitting = false;
+  emit fitFinished(evaluations, -values[best], toVector(toParameters(simplex[best])));
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void PatternFitEngine::cancelFit()
+{
+  m_CancelFit = true;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+bool PatternFitEngine::isFitting() const
+{
+  return m_Fitting;
+}
@@ -0,0 +1,190 @@
+/* ============================================================================
+ * Copyright (c) 2009-2017 BlueQuartz Software, LLC
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright notice, this
+ * list of conditions and the following disclaimer in the documentation and/or
+ * other materials provided with the distribution.
+ *
+ * Neither the name of BlueQuartz Software, the US Air Force, nor the names of its
+ * contributors may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The code contained herein was partially funded by the followig contracts:
+ *    United States Air Force Prime Contract FA8650-07-D-5800
+ *    United States Air Force Prime Contract FA8650-10-D-5210
+ *    United States Prime Contract Navy N00173-07-C-2068
+ *
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <vector>
+
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QVector>
+#include <QtGui/QImage>
+
+#include "Common/MasterPatternFileReader.h"
+#include "Common/PatternTools.h"
+
+/**
+ * @brief The PatternFitEngine class evaluates simulated patterns for the Pattern Fit module while keeping the
+ * detector tables of EMsoftCgetEBSDPatterns alive between calls.  Only the work that a parameter change invalidates
+ * is redone: orientation and gamma changes only rerun the orientation loop, detector changes rebuild the direction
+ * cosines and energy weights, and the master pattern stays in memory.  The engine also runs an automated
+ * Nelder-Mead fit of the refinable parameters against the experimental pattern.
+ */
+class PatternFitEngine : public QObject
+{
+  Q_OBJECT
+
+public:
+  PatternFitEngine(QObject* parent = nullptr);
+  ~PatternFitEngine() override;
+
+  using EnumType = unsigned int;
+  enum class Parameter : EnumType
+  {
+    ScintillatorDist = 0,
+    SampleOmegaAngle,
+    PatternCenterX,
+    PatternCenterY,
+    DetectorTiltAngle,
+    IntensityGamma,
+    Phi1,
+    Phi,
+    Phi2,
+    Count
+  };
+
+  static const size_t k_NumParameters = static_cast<size_t>(Parameter::Count);
+  using ParameterArray = std::array<double, k_NumParameters>;
+  using RefineArray = std::array<bool, k_NumParameters>;
+
+  /**
+   * @brief The DetectorSetup struct holds the detector values that are never refined
+   */
+  struct DetectorSetup
+  {
+    double scintillatorPixelSize = 0.0;
+    int numOfPixelsX = 0;
+    int numOfPixelsY = 0;
+    double beamCurrent = 0.0;
+    double dwellTime = 0.0;
+  };
+
+  struct FitSettings
+  {
+    ParameterArray start;        // Euler angles in degrees
+    ParameterArray stepSize;     // initial simplex step per parameter
+    RefineArray refine;          // which parameters are free
+    int maxEvaluations = 500;
+    double tolerance = 1.0E-6;   // spread of the simplex dot products at convergence
+    bool useCircularMask = false;
+  };
+
+  /**
+   * @brief setMasterPatternData Points the engine at the master pattern data; the data must outlive the engine.
+   * Calling this invalidates the cached detector tables.
+   * @param data
+   */
+  void setMasterPatternData(MasterPatternFileReader::MasterPatternData* data);
+
+  /**
+   * @brief setExperimentalPattern Sets the reference pattern used by the fit
+   * @param image
+   */
+  void setExperimentalPattern(const QImage& image);
+
+  /**
+   * @brief generatePattern Simulates one pattern, reusing the cached detector tables when possible
+   * @param setup
+   * @param parameters Euler angles in degrees
+   * @return
+   */
+  std::vector<float> generatePattern(const DetectorSetup& setup, const ParameterArray& parameters);
+
+  /**
+   * @brief dotProduct Normalized dot product between a simulated pattern and the experimental pattern
+   * @param pattern
+   * @param useCircularMask
+   * @return
+   */
+  double dotProduct(const std::vector<float>& pattern, bool useCircularMask) const;
+
+  /**
+   * @brief reserveFit Marks the engine as fitting before the worker thread starts, so the master pattern
+   * data cannot be replaced in between
+   * @return false if a fit is already running
+   */
+  bool reserveFit();
+
+  /**
+   * @brief fit Runs the Nelder-Mead fit; this is a blocking call meant to be run on a worker thread
+   * @param setup
+   * @param settings
+   */
+  void fit(const DetectorSetup& setup, const FitSettings& settings);
+
+  /**
+   * @brief cancelFit Requests the running fit to stop after the current evaluation
+   */
+  void cancelFit();
+
+  /**
+   * @brief isFitting
+   * @return
+   */
+  bool isFitting() const;
+
+signals:
+  void fitProgress(int evaluations, double dotProduct, QVector<double> parameters) const;
+  void fitFinished(int evaluations, double dotProduct, QVector<double> parameters) const;
+
+private:
+  MasterPatternFileReader::MasterPatternData* m_MPData = nullptr;
+  std::vector<float> m_ExpPattern;
+  int m_ExpPatternDims[2] = {0, 0};
+
+  std::vector<int32_t> m_IPar;
+  std::vector<float> m_FPar;
+  bool m_DetectorValid = false;
+
+  bool m_Cancel = false;
+  QMutex m_Mutex;
+  std::atomic<bool> m_CancelFit;
+  std::atomic<bool> m_Fitting;
+
+  /**
+   * @brief updateParameterArrays Rebuilds ipar/fpar and decides whether the detector tables are still valid
+   * @param setup
+   * @param parameters
+   */
+  void updateParameterArrays(const DetectorSetup& setup, const ParameterArray& parameters);
+
+public:
+  PatternFitEngine(const PatternFitEngine&) = delete;            // Copy Constructor Not Implemented
+  PatternFitEngine(PatternFitEngine&&) = delete;                 // Move Constructor Not Implemented
+  PatternFitEngine& operator=(const PatternFitEngine&) = delete; // Copy Assignment Not Implemented
+  PatternFitEngine& operator=(PatternFitEngine&&) = delete;      // Move Assignment Not Implemented
+};
@@ -35,6 +35,8 @@
 
 #include "PatternFit_UI.h"
 
+#include <algorithm>
+
 #include <QtCore/QDir>
 #include <QtCore/QFile>
 #include <QtCore/QFileInfo>
@@ -163,9 +165,6 @@ void PatternFit_UI::setupGui()
   patternFitViewer->setDisabled(true);
   hipassFilterLowCutOff->setDisabled(true);
 
-  // This button should be hidden until we have an automatic fit algorithm in place
-  startFitBtn->hide();
-
   validateData();
 }
 
@@ -398,6 +397,8 @@ void PatternFit_UI::createWidgetConnections()
   connect(m_Controller, &PatternFitController::errorMessageGenerated, this, &PatternFit_UI::notifyErrorMessage);
   connect(m_Controller, &PatternFitController::warningMessageGenerated, this, &PatternFit_UI::notifyWarningMessage);
   connect(m_Controller, SIGNAL(stdOutputMessageGenerated(QString)), this, SLOT(appendToStdOut(QString)));
+  connect(m_Controller, &PatternFitController::fitProgress, this, &PatternFit_UI::slot_fitProgress);
+  connect(m_Controller, &PatternFitController::fitFinished, this, &PatternFit_UI::slot_fitFinished);
 
   connect(patternControlsWidget, &PatternControlsWidget::patternChoiceChanged, this, &PatternFit_UI::slot_patternChoiceChanged);
   connect(patternControlsWidget, &PatternControlsWidget::rotationStepSizeChanged, this, [=](double rot) { updateRotationQuaternions(rot, detectorTiltAngle->text().toDouble()); });
@@ -587,6 +588,7 @@ void PatternFit_UI::setExperimentalPatternFilePath(const QString& filePath)
   }
 
   m_ReferencePattern.image = refPattern;
+  m_Controller->setExperimentalPattern(refPattern);
 
   if(!mpLabel->text().isEmpty())
   {
@@ -628,6 +630,104 @@ void PatternFit_UI::setMasterFilePath(const QString& filePath)
   validateData();
 }
 
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void PatternFit_UI::on_startFitBtn_clicked()
+{
+  if(m_Controller->isFitting())
+  {
+    m_Controller->cancelFit();
+    return;
+  }
+
+  using Parameter = PatternFitEngine::Parameter;
+  PatternFitEngine::ParameterArray stepSizes;
+  PatternFitEngine::RefineArray refine;
+  auto setParameter = [&](Parameter p, const QCheckBox* checkBox, const QLineEdit* fStep) {
+    refine[static_cast<size_t>(p)] = checkBox->isChecked();
+    stepSizes[static_cast<size_t>(p)] = fStep->text().toDouble();
+  };
+  setParameter(Parameter::ScintillatorDist, scintillatorDistCB, scintillatorDistFStep);
+  setParameter(Parameter::SampleOmegaAngle, omegaCB, omegaFStep);
+  setParameter(Parameter::PatternCenterX, centerXCB, centerXFStep);
+  setParameter(Parameter::PatternCenterY, centerYCB, centerYFStep);
+  setParameter(Parameter::DetectorTiltAngle, detectorTiltAngleCB, detectorTiltAngleFStep);
+  setParameter(Parameter::IntensityGamma, intensityGammaCB, intensityGammaFStep);
+  setParameter(Parameter::Phi1, phi1CB, phi1FStep);
+  setParameter(Parameter::Phi, phiCB, phiFStep);
+  setParameter(Parameter::Phi2, phi2CB, phi2FStep);
+
+  if(std::none_of(refine.begin(), refine.end(), [](bool b) { return b; }))
+  {
+    notifyWarningMessage(tr("No refinable parameters are checked; there is nothing to fit."));
+    return;
+  }
+
+  refinableDetectorParamsGB->setDisabled(true);
+  refinableSampleParamsGB->setDisabled(true);
+  nonRefinableParamsGB->setDisabled(true);
+  startFitBtn->setText(tr("Stop Fit"));
+
+  m_Controller->startFit(getSimulationData(), stepSizes, refine);
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void PatternFit_UI::setFitParameters(const QVector<double>& parameters)
+{
+  PatternFitController::SimulationData data = getSimulationData();
+  PatternFitController::ApplyFitParameters(parameters, data);
+
+  // the spin boxes are updated without triggering a regeneration for every value
+  QList<QAbstractSpinBox*> spinBoxes = {scintillatorDist, omega, patternCenterX, patternCenterY, detectorTiltAngle, intensityGamma, phi1, phi, phi2};
+  for(QAbstractSpinBox* spinBox : spinBoxes)
+  {
+    spinBox->blockSignals(true);
+  }
+  scintillatorDist->setValue(data.scintillatorDist);
+  omega->setValue(data.sampleOmegaAngle);
+  patternCenterX->setValue(data.patternCenterX);
+  patternCenterY->setValue(data.patternCenterY);
+  detectorTiltAngle->setValue(data.detectorTiltAngle);
+  intensityGamma->setValue(data.gammaValue);
+  phi1->setValue(data.angles[0] / EbsdLib::Constants::k_PiOver180D);
+  phi->setValue(data.angles[1] / EbsdLib::Constants::k_PiOver180D);
+  phi2->setValue(data.angles[2] / EbsdLib::Constants::k_PiOver180D);
+  for(QAbstractSpinBox* spinBox : spinBoxes)
+  {
+    spinBox->blockSignals(false);
+  }
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void PatternFit_UI::slot_fitProgress(int evaluations, double dotProduct, QVector<double> parameters)
+{
+  convergence->setText(QString::number(dotProduct, 'f', 6));
+  appendToStdOut(tr("Fit evaluation %1: dot product %2").arg(evaluations).arg(dotProduct, 0, 'f', 6));
+  setFitParameters(parameters);
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void PatternFit_UI::slot_fitFinished(int evaluations, double dotProduct, QVector<double> parameters)
+{
+  convergence->setText(QString::number(dotProduct, 'f', 6));
+  appendToStdOut(tr("Fit finished after %1 evaluations: dot product %2").arg(evaluations).arg(dotProduct, 0, 'f', 6));
+  setFitParameters(parameters);
+
+  refinableDetectorParamsGB->setEnabled(true);
+  refinableSampleParamsGB->setEnabled(true);
+  nonRefinableParamsGB->setEnabled(true);
+  startFitBtn->setText(tr("Start Fit"));
+
+  parametersChanged();
+}
+
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
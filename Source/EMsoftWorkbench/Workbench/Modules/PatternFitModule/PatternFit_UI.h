@@ -133,6 +133,27 @@ private slots:
    */
   void on_expPatternSelectBtn_clicked();
 
+  /**
+   * @brief on_startFitBtn_clicked Starts the automated fit, or stops the one that is running
+   */
+  void on_startFitBtn_clicked();
+
+  /**
+   * @brief slot_fitProgress
+   * @param evaluations
+   * @param dotProduct
+   * @param parameters
+   */
+  void slot_fitProgress(int evaluations, double dotProduct, QVector<double> parameters);
+
+  /**
+   * @brief slot_fitFinished
+   * @param evaluations
+   * @param dotProduct
+   * @param parameters
+   */
+  void slot_fitFinished(int evaluations, double dotProduct, QVector<double> parameters);
+
   void on_detectorTiltAngle_valueChanged(double value);
 
   void on_circularMask_toggled(bool checked);
@@ -191,6 +212,12 @@ private:
   bool m_FlickerIsChecked = false;
   PatternControlsWidget::PatternChoice m_BeforeFlickerChoice;
 
+  /**
+   * @brief setFitParameters Shows fitted parameter values in the spin boxes
+   * @param parameters
+   */
+  void setFitParameters(const QVector<double>& parameters);
+
   /**
    * @brief hasValidValues
    * @return
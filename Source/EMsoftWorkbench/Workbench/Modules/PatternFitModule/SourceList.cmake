@@ -45,6 +45,7 @@ set(EMsoftWorkbench_${MODULE_NAME}_Moc_HDRS
   ${${MODULE_NAME}_DIR}/PatternControlsWidget.h
   ${${MODULE_NAME}_DIR}/PatternFit_UI.h
   ${${MODULE_NAME}_DIR}/PatternFitController.h
+  ${${MODULE_NAME}_DIR}/PatternFitEngine.h
   ${${MODULE_NAME}_DIR}/PatternFitModule.h
   ${${MODULE_NAME}_DIR}/PatternFitViewer.h
 )
@@ -64,6 +65,7 @@ set(EMsoftWorkbench_${MODULE_NAME}_SRCS
   ${${MODULE_NAME}_DIR}/PatternControlsWidget.cpp
   ${${MODULE_NAME}_DIR}/PatternFit_UI.cpp
   ${${MODULE_NAME}_DIR}/PatternFitController.cpp
+  ${${MODULE_NAME}_DIR}/PatternFitEngine.cpp
   ${${MODULE_NAME}_DIR}/PatternFitModule.cpp
   ${${MODULE_NAME}_DIR}/PatternFitViewer.cpp
 )
@@ -7,6 +7,7 @@ set(${SUBDIR_NAME}_DIR "${EMsoftWorkbench_SOURCE_DIR}/${SUBDIR_NAME}")
 set(EMsoftWorkbench_${SUBDIR_NAME}_Moc_HDRS
   ${${SUBDIR_NAME}_DIR}/IModuleUI.h
   ${${SUBDIR_NAME}_DIR}/IWorkbenchModule.hpp
+  ${${SUBDIR_NAME}_DIR}/JobScheduler.h
 )
 
 # --------------------------------------------------------------------
@@ -28,6 +29,7 @@ set(EMsoftWorkbench_${SUBDIR_NAME}_HDRS
 set(EMsoftWorkbench_${SUBDIR_NAME}_SRCS
   ${${SUBDIR_NAME}_DIR}/IProcessController.cpp
   ${${SUBDIR_NAME}_DIR}/IModuleUI.cpp
+  ${${SUBDIR_NAME}_DIR}/JobScheduler.cpp
   ${${SUBDIR_NAME}_DIR}/ModuleManager.cpp
 )
 
@@ -38,6 +38,7 @@
 #include <QtCore/QDebug>
 #include <QtWidgets/QDockWidget>
 
+#include "Workbench/Modules/JobScheduler.h"
 #include "Workbench/SVStyle.h"
 
 // -----------------------------------------------------------------------------
@@ -64,6 +65,10 @@ void StatusBarWidget::setupGui()
   stdOutputBtn->setStyleSheet(style);
   issuesBtn->setStyleSheet(style);
   navigatorBtn->setStyleSheet(style);
+  jobsBtn->setStyleSheet(style);
+
+  connect(JobScheduler::Instance(), &JobScheduler::jobsChanged, this, &StatusBarWidget::updateJobsSummary);
+  updateJobsSummary();
 }
 
 // -----------------------------------------------------------------------------
@@ -186,6 +191,16 @@ void StatusBarWidget::navigatorVisibilityChanged(bool b)
   navigatorBtn->blockSignals(false);
 }
 
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void StatusBarWidget::jobsVisibilityChanged(bool b)
+{
+  jobsBtn->blockSignals(true);
+  jobsBtn->setChecked(b);
+  jobsBtn->blockSignals(false);
+}
+
 // -----------------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------------
@@ -211,6 +226,10 @@ void StatusBarWidget::setButtonAction(QDockWidget* dock, Button btn)
     connect(stdOutputBtn, SIGNAL(toggled(bool)), dock, SLOT(setVisible(bool)));
     connect(dock, SIGNAL(visibilityChanged(bool)), this, SLOT(stdOutputVisibilityChanged(bool)));
     break;
+  case Button::Jobs:
+    connect(jobsBtn, SIGNAL(toggled(bool)), dock, SLOT(setVisible(bool)));
+    connect(dock, SIGNAL(visibilityChanged(bool)), this, SLOT(jobsVisibilityChanged(bool)));
+    break;
   default:
     break;
   }
@@ -240,3 +259,33 @@ void StatusBarWidget::issuesTableHasErrors(bool b)
   QString style = generateStyleSheet(b);
   issuesBtn->setStyleSheet(style);
 }
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+void StatusBarWidget::updateJobsSummary()
+{
+  int running = 0;
+  int queued = 0;
+  QVector<JobScheduler::JobInfo> jobs = JobScheduler::Instance()->getJobs();
+  for(const JobScheduler::JobInfo& job : jobs)
+  {
+    if(job.state == JobScheduler::JobState::Running)
+    {
+      running++;
+    }
+    else if(job.state == JobScheduler::JobState::Queued)
+    {
+      queued++;
+    }
+  }
+
+  if(running == 0 && queued == 0)
+  {
+    jobsBtn->setText(tr("Jobs"));
+  }
+  else
+  {
+    jobsBtn->setText(tr("Jobs (%1 running, %2 queued)").arg(running).arg(queued));
+  }
+}
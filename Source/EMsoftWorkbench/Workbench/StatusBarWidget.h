@@ -57,7 +57,8 @@ public:
   {
     Issues = 0,
     StandardOutput = 1,
-    ModuleNavigator = 2
+    ModuleNavigator = 2,
+    Jobs = 3
   };
 
   /**
@@ -110,12 +111,23 @@ public slots:
    */
   void toolboxVisibilityChanged(bool b);
 
+  /**
+   * @brief jobsVisibilityChanged
+   * @param b
+   */
+  void jobsVisibilityChanged(bool b);
+
   /**
    * @brief issuesTableHasErrors
    * @param b
    */
   void issuesTableHasErrors(bool b);
 
+  /**
+   * @brief Shows the number of running and queued jobs on the Jobs button
+   */
+  void updateJobsSummary();
+
 protected:
   /**
    * @brief setupGui
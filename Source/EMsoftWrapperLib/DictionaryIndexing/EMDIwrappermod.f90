@@ -95,7 +95,9 @@
 ! ipar(49): paty
 ! ipar(50): numw (number of hipass parameters)
 ! ipar(51): numr (number of regions parameters)
-! ipar(52:wraparraysize) : 0 (unused for now)
+! ipar(52): nbtype (ADP map neighborhood type, 4 or 8; 0 = 4)
+! ipar(53): radius (ADP map neighborhood radius; 0 = 1)
+! ipar(54:wraparraysize) : 0 (unused for now)
 
 ! real(kind=dbl) :: fpar(wraparraysize)  components
 ! fpar(1) : sig
@@ -255,8 +257,8 @@ integer(kind=irg)                       :: ii=0, jj=0, kk=0, iii=0, maskpattern=
                                            binning=0, ipf_wd=0, ipf_ht=0, TID=0, itmpexpt=0, iunitexpt=0, recordsize_correct=0, &
                                            ierr=0, correctsize=0, recordsize=0, patsz=0, nregions=0, totnumexpt=0, istat=0, &
                                            nthreads=0, ROI(4), i=0, iiiend=0, iiistart=0, jjend=0, dn=0, cn=0, totn=0, wd=0, ht=0, &
-                                           nexpt=0, pindex=0
-real(kind=sgl)                          :: mi=0.0, ma=0.0, vlen=0.0, tmp=0.0, maskradius=0.0, dp=0.0
+                                           nexpt=0, nbtype=0, radius=0
+real(kind=sgl)                          :: mi=0.0, ma=0.0, vlen=0.0, tmp=0.0, maskradius=0.0
 real(kind=dbl)                          :: Jres=0.D0, w=0.D0
 real(kind=sgl),allocatable              :: imageexpt(:), tmpimageexpt(:), imagedict(:), masklin(:)
 integer(kind=irg),allocatable           :: EBSDpatterninteger(:,:), EBSDpatternad(:,:), EBSDpint(:,:)
@@ -265,7 +267,6 @@ real(kind=dbl),allocatable              :: ksqarray(:,:), rrdata(:,:), ffdata(:,
 complex(kind=dbl),allocatable           :: hpmask(:,:)
 complex(C_DOUBLE_COMPLEX),pointer       :: inp(:,:), outp(:,:)
 type(c_ptr),allocatable                 :: ip, op
-real(kind=sgl),allocatable              :: lstore(:,:), pstore(:,:), lp(:), cp(:)
 
 
 type(C_PTR)                             :: planf, HPplanf, HPplanb
@@ -307,6 +308,8 @@ CALL C_F_PROCPOINTER (cproc, proc)
 ! ROI(3)                ---> ipar(33)
 ! ROI(4)                ---> ipar(34)
 ! inputtype             ---> ipar(35)     2 = up1, 3 = up2, 4 = h5ebsd 
+! nbtype                ---> ipar(52)     ADP neighborhood type (4 or 8; 0 = 4)
+! radius                ---> ipar(53)     ADP neighborhood radius (0 = 1)
 
 ! floats:
 ! maskradius            ---> fpar(23) [pixels]
@@ -367,7 +370,8 @@ else
   ROI = (/ 0, 0, 0, 0 /)
 end if
 
-! define the mask if necessary
+! define the mask if necessary; the calling program must pass a mask of ones, since 
+! only the pixels outside the mask circle are set to zero here
 if (ipar(29).eq.1) then
   do ii = 1,biny
       do jj = 1,binx
@@ -398,6 +402,7 @@ select case(ipar(35))
 end select
 
 ! convert the mask to a linear (1D) array
+allocate(masklin(L))
 do ii = 1,biny
     do jj = 1,binx
         masklin((ii-1)*binx+jj) = mask(jj,ii)
@@ -495,13 +500,7 @@ else
   ht = ipar(27)
   nexpt = ipar(26) * ipar(27)
 end if
-allocate(lstore(L,wd), pstore(L,wd), lp(L), cp(L), imageexpt(L))
 ADPmap= 0.0
-pstore = 0.0
-lstore = 0.0
-lp = 0.0
-cp = 0.0
-pindex = 0
 
 !===================================================================================
 ! we do one row at a time
@@ -590,45 +589,11 @@ prepexperimentalloop: do iii = iiistart,iiiend
     end do
 !$OMP END DO
 
-! thread 0 writes the row of patterns to the file, and computes the ADP map
+! thread 0 writes the row of patterns to the file
     if (TID.eq.0) then
       do jj=1,jjend
         write(itmpexpt,rec=(iii-iiistart)*jjend + jj) exppatarray((jj-1)*patsz+1:jj*patsz)
-        imageexpt = exppatarray((jj-1)*patsz+1:jj*patsz)
-
-        pindex = pindex + 1
-    ! do we need to copy pstore into lstore ? (starts with second line)
-        if ((jj.eq.1).and.(iii.gt.iiistart)) lstore = pstore
-    ! determine to which dpmap entries we need to add the dot product
-        if (jj.eq.1) then
-          cp(1:L) = imageexpt(1:L)
-          pstore(1:L,jj) = cp(1:L)
-        else
-          lp = cp
-          cp(1:L) = imageexpt(1:L)
-          pstore(1:L,jj) = cp(1:L)
-          dp = 0.25 * sum(lp(1:L)*cp(1:L))
-          ADPmap(pindex-1) = ADPmap(pindex-1) + dp
-          ADPmap(pindex) = ADPmap(pindex) + dp
-        end if
-        if (jj.gt.1) then
-          dp = 0.25 * sum(lstore(1:L,jj)*cp(1:L))
-          ADPmap(pindex-wd+1) = ADPmap(pindex-wd+1) + dp
-          ADPmap(pindex) = ADPmap(pindex) + dp
-        end if
       end do
-
-      ! correct the lower corners and lower edge when we are done with the second row
-      if ((iii-iiistart).eq.1) then
-        ADPmap(1) = ADPmap(1) * 4.0
-        ADPmap(wd) = ADPmap(wd) * 2.0
-        ADPmap(2:wd-1) = ADPmap(2:wd-1) * 4.0/3.0
-      end if
-      ! once we've completed the third row, we can correct the edge points of the previous row
-      if ((iii-iiistart).ge.2) then
-        ADPmap(wd*(iii-iiistart-1)+1) = ADPmap(wd*(iii-iiistart-1)+1) * 4.0/3.0
-        ADPmap(wd*(iii-iiistart)) = ADPmap(wd*(iii-iiistart)) * 4.0/3.0
-      end if
     end if
 
 deallocate(tmpimageexpt, EBSDPat, rrdata, ffdata, EBSDpint)
@@ -649,15 +614,16 @@ call fftw_free(op)
 
 end do prepexperimentalloop
 
-! do final corrections to ADPmap
-! edge points of next to last line from the top
-ADPmap(wd*(ht-2)+1) = ADPmap(wd*(ht-2)+1) * 4.0/3.0
-ADPmap(wd*(ht-1)) = ADPmap(wd*(ht-1)) * 4.0/3.0
-
-! upper corners and edge
-ADPmap(nexpt) = ADPmap(nexpt) * 2.0
-ADPmap(nexpt-wd+1) = ADPmap(nexpt-wd+1) * 4.0/3.0
-ADPmap(nexpt-wd+2:nexpt-1) = ADPmap(nexpt-wd+2:nexpt-1) * 4.0/3.0
+! the ADP map is computed from the preprocessed pattern file with the same neighborhood 
+! engine as the EMgetADP program; the row-ordered records of that file are exactly what 
+! getADPmap expects
+if (cancel.eq.char(0)) then
+  nbtype = 4
+  if (ipar(52).ne.0) nbtype = ipar(52)
+  radius = 1
+  if (ipar(53).ne.0) radius = ipar(53)
+  call getADPmap(itmpexpt, nexpt, L, wd, ht, ADPmap, nbtype, radius)
+end if
 
 ! close both files
 call closeExpPatternFile(inputtype, iunitexpt)
@@ -896,6 +862,11 @@ call C2F_configuration_strings(C_LOC(spar), CS)
 
 call h5open_EMsoft(hdferr)
 
+numsx = ipar(19)
+numsy = ipar(20)
+ipf_wd = ipar(26)
+ipf_ht = ipar(27)
+numav = ipar(47)
 binx = ipar(19)
 biny = ipar(20)
 L = binx * biny
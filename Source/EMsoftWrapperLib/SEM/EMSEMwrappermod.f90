@@ -71,7 +71,8 @@
 ! ipar(24): binned y-dimension
 ! ipar(25): anglemode  (0 for quaternions, 1 for Euler angles)
 ! ipar(26): already initialized 
-! ipar(27:40) : 0 (unused for now)
+! ipar(27): number of energy clusters (0 = all energy bins)
+! ipar(28:40) : 0 (unused for now)
 
 ! real(kind=dbl) :: fpar(40)  components
 ! fpar(1) : sig
@@ -245,6 +246,7 @@ recursive subroutine EMsoftCgetEBSDPatterns(ipar, fpar, EBSDpattern, quats, accu
 ! ipar(24) = binned y-dimension
 ! ipar(25) = anglemode
 ! ipar(26) = already initialized
+! ipar(27) = number of energy clusters (0 = use all energy bins)
 
 ! fpar(1)  = enl%MCsig
 ! fpar(2)  = enl%omega
@@ -262,6 +264,7 @@ use constants
 use Lambert
 use quaternions
 use rotations
+use EBSDmod
 use,INTRINSIC :: ISO_C_BINDING
 
 IMPLICIT NONE
@@ -284,12 +287,14 @@ real(kind=irg),allocatable,save         :: accum_e_detector(:,:,:)
 real(kind=sgl),allocatable,save         :: rgx(:,:), rgy(:,:), rgz(:,:)
 real(kind=sgl),allocatable,save         :: mLPNHsum(:,:,:), mLPSHsum(:,:,:)
 real(kind=sgl),save                     :: prefactor
+type(EBSDEnergyClusterType),save        :: energyclusters
+integer(kind=irg),save                  :: nEsum
 real(kind=sgl),allocatable              :: scin_x(:), scin_y(:)                 ! scintillator coordinate arrays [microns]
 real(kind=sgl),parameter                :: dtor = 0.0174533  ! convert from degrees to radians
 real(kind=sgl)                          :: alp, ca, sa, cw, sw, quat(4)
 real(kind=sgl)                          :: L2, Ls, Lc     ! distances
 integer(kind=irg)                       :: nix, niy, binx, biny,  nixp, niyp, i, j, Emin, Emax, istat, k, ip, dn, cn, & 
-                                           ii, jj, binfac, ipx, ipy, epl      ! various parameters
+                                           ii, jj, binfac, ipx, ipy, epl, jpar(7)      ! various parameters
 real(kind=sgl)                          :: dc(3), scl, alpha, theta, gam, pcvec(3), dp, calpha           ! direction cosine array
 real(kind=sgl)                          :: sx, dx, dxm, dy, dym, rhos, x, bindx         ! various parameters
 real(kind=sgl)                          :: ixy(2)
@@ -431,6 +436,22 @@ if (ipar(26).eq.0) then
   end do 
   prefactor = 0.25D0 * nAmpere * fpar(20) * fpar(21)  * 1.0D-15 / sum(accum_e_detector)
   accum_e_detector = accum_e_detector * prefactor
+  nEsum = ipar(12)
+
+! optionally collapse the energy bins onto a few effective energy clusters; the clusters are kept 
+! as long as the detector weights and master patterns do not change
+  if (ipar(27).gt.0) then
+    jpar = (/ 1, int(ipar(19)), int(ipar(20)), int(ipar(17)), int(ipar(17)), int(ipar(12)), int(ipar(12)) /)
+    call InitEBSDEnergyClusters(jpar,accum_e_detector,mLPNHsum,mLPSHsum,Emin,Emax,int(ipar(27)),energyclusters)
+    nEsum = energyclusters%nclus
+    deallocate(accum_e_detector, mLPNHsum, mLPSHsum)
+    allocate(accum_e_detector(nEsum,ipar(19),ipar(20)))
+    allocate(mLPNHsum(-ipar(17):ipar(17), -ipar(17):ipar(17), nEsum))
+    allocate(mLPSHsum(-ipar(17):ipar(17), -ipar(17):ipar(17), nEsum))
+    accum_e_detector = energyclusters%accum
+    mLPNHsum = energyclusters%mLPNH
+    mLPSHsum = energyclusters%mLPSH
+  end if
 end if  ! initialize detector arrays 
 
 ! from here on, we simply compute the EBSD patterns by interpolation, using the above arrays
@@ -463,13 +484,13 @@ quatloop: do ip=1,ipar(21)
       call LambertgetInterpolation(dc, scl, int(ipar(17)), int(ipar(17)), nix, niy, nixp, niyp, dx, dy, dxm, dym)
 
       if (dc(3).gt.0.0) then ! we're in the Northern hemisphere
-        do k=1,ipar(12) 
+        do k=1,nEsum
           fullsizepattern(i,j) = fullsizepattern(i,j) + accum_e_detector(k,i,j) * ( mLPNHsum(nix,niy,k) * dxm * dym +&
                                       mLPNHsum(nixp,niy,k) * dx * dym + mLPNHsum(nix,niyp,k) * dxm * dy + &
                                       mLPNHsum(nixp,niyp,k) * dx * dy )
         end do
       else                   ! we're in the Southern hemisphere
-        do k=1,ipar(12) 
+        do k=1,nEsum
           fullsizepattern(i,j) = fullsizepattern(i,j) + accum_e_detector(k,i,j) * ( mLPSHsum(nix,niy,k) * dxm * dym +&
                                       mLPSHsum(nixp,niy,k) * dx * dym + mLPSHsum(nix,niyp,k) * dxm * dy + &
                                       mLPSHsum(nixp,niyp,k) * dx * dy )
@@ -337,6 +337,11 @@ real(kind=sgl),allocatable              :: energywf(:), eulerangles(:,:)
 real(kind=sgl),allocatable              :: tmLPNH(:,:,:) , tmLPSH(:,:,:)
 real(kind=sgl),allocatable              :: trgx(:,:), trgy(:,:), trgz(:,:)          ! auxiliary detector arrays needed for interpolation
 real(kind=sgl),allocatable              :: taccum(:,:,:)
+type(EBSDPixelTableType)                :: ptab                 ! packed detector table for CalcEBSDPatternMultiFull
+real(kind=sgl),allocatable              :: binnedq(:,:,:)       ! group of patterns computed by CalcEBSDPatternMultiFull
+integer(kind=irg),parameter             :: nqgroup = 8          ! number of orientations per CalcEBSDPatternMultiFull call
+integer(kind=irg)                       :: iq, nq
+type(EBSDEnergyClusterType)             :: energyclusters       ! collapsed master pattern for energyaverage > 0
 
 ! quaternion variables
 real(kind=dbl)                          :: qq(4), qq1(4), qq2(4), qq3(4)
@@ -363,8 +368,7 @@ character(kind=c_char),allocatable      :: batchpatterns(:,:,:), bpat(:,:), thre
 integer(kind=irg),allocatable           :: batchpatternsint(:,:,:), bpatint(:,:), threadbatchpatternsint(:,:,:) 
 real(kind=sgl),allocatable              :: batchpatterns32(:,:,:), threadbatchpatterns32(:,:,:), threadbatchpatterns32lin(:,:) 
 real(kind=sgl),allocatable              :: batchpatterns32lin(:,:)
-integer(kind=irg),allocatable           :: acc_array(:,:)
-real(kind=sgl),allocatable              :: master_arrayNH(:,:), master_arraySH(:,:), wf(:) 
+real(kind=sgl),allocatable              :: wf(:)
 character(len=3)                        :: outputformat
 character(fnlen, KIND=c_char),allocatable,TARGET :: stringarray(:)
 
@@ -777,31 +781,6 @@ end if
     end if
   end if
 
-!====================================
-! for dictionary computations, the patterns are usually rather small, so perhaps the explicit 
-! energy sums can be replaced by an averaged approximate approach, in which all the energy bins
-! are added together from the start, and all the master patterns are totaled as well...
-
-! this option is obsolete and will be removed in a later version of the code.  [MDG 02/19/2019]
-if (enl%energyaverage.eq.1) then
-  allocate(acc_array(enl%numsx,enl%numsy))
-  acc_array = sum(EBSDdetector%accum_e_detector,1)
-  allocate(wf(EBSDMCdata%numEbins))
-  wf = sum(sum(EBSDdetector%accum_e_detector,2),2)
-  wf = wf/sum(wf)
-
-! this is a straightforward sum; we should probably do a weighted sum instead
-  npy = mpnl%npx
-  allocate(master_arrayNH(-mpnl%npx:mpnl%npx,-npy:npy))
-  allocate(master_arraySH(-mpnl%npx:mpnl%npx,-npy:npy))
-  do k=Emin,Emax
-    EBSDMPdata%mLPNH(-mpnl%npx:mpnl%npx,-npy:npy,k) = EBSDMPdata%mLPNH(-mpnl%npx:mpnl%npx,-npy:npy,k) * wf(k)
-    EBSDMPdata%mLPSH(-mpnl%npx:mpnl%npx,-npy:npy,k) = EBSDMPdata%mLPSH(-mpnl%npx:mpnl%npx,-npy:npy,k) * wf(k)
-  end do
-  master_arrayNH = sum(EBSDMPdata%mLPNH,3)
-  master_arraySH = sum(EBSDMPdata%mLPSH,3)
-end if
-
 !====================================
 ! determine the scale factor for the Lambert interpolation
 scl = dble(mpnl%npx) 
@@ -816,6 +795,31 @@ ipar(5) = mpnl%npx
 ipar(6) = EBSDMCdata%numEbins
 ipar(7) = EBSDMCdata%numEbins
 
+!====================================
+! for an approximate computation, the energy bins Emin..Emax of the master pattern and the detector
+! weights are collapsed onto energyaverage effective energy clusters, which then replace the full arrays
+if (enl%energyaverage.gt.0) then
+  if (enl%includebackground.eq.'y') then
+    call InitEBSDEnergyClusters(ipar,EBSDdetector%accum_e_detector,EBSDMPdata%mLPNH,EBSDMPdata%mLPSH,Emin,Emax, &
+                                enl%energyaverage,energyclusters)
+  else
+    call InitEBSDEnergyClusters(ipar,EBSDdetector%accum_e_detector,EBSDMPdata%mLPNH,EBSDMPdata%mLPSH,Emin,Emax, &
+                                enl%energyaverage,energyclusters,removebackground='y')
+  end if
+  io_int(1:2) = (/ Emax-Emin+1, energyclusters%nclus /)
+  call WriteValue(' Number of energy bins collapsed onto number of energy clusters : ',io_int,2,"(I4,' -> ',I4)")
+  io_real(1:2) = (/ energyclusters%meanerr, energyclusters%maxerr /)
+  call WriteValue(' Energy cluster weight misfit (mean, max) : ',io_real,2)
+
+  call move_alloc(energyclusters%accum, EBSDdetector%accum_e_detector)
+  call move_alloc(energyclusters%mLPNH, EBSDMPdata%mLPNH)
+  call move_alloc(energyclusters%mLPSH, EBSDMPdata%mLPSH)
+  ipar(6) = energyclusters%nclus
+  ipar(7) = energyclusters%nclus
+  Emin = 1
+  Emax = energyclusters%nclus
+end if
+
 !====================================
 ! set the number of OpenMP threads 
 io_int(1) = nthreads
@@ -835,7 +839,7 @@ do ibatch=1,totnumbatches
 !$OMP PARALLEL default(shared)  PRIVATE(TID,iang,i,j,istat,EBSDpattern,binned,idum,bpat,ma,mi,threadbatchpatterns,bpatint)&
 !$OMP& PRIVATE(tmLPNH, tmLPSH, trgx, trgy, trgz, taccum, dims2, dims3, threadbatchpatternsint, threadbatchpatterns32)&
 !$OMP& PRIVATE(binnedvec, threadbatchpatterns32lin)&
-!$OMP& PRIVATE(Fmatrix_inverse, Fmatrix, gs2c)
+!$OMP& PRIVATE(Fmatrix_inverse, Fmatrix, gs2c, ptab, binnedq, iq, nq)
 
   NUMTHREADS = OMP_GET_NUM_THREADS()
   TID = OMP_GET_THREAD_NUM()
@@ -863,6 +867,17 @@ do ibatch=1,totnumbatches
   tmLPNH = EBSDMPdata%mLPNH
   tmLPSH = EBSDMPdata%mLPSH
 
+! without a deformation tensor the patterns are computed in groups of nqgroup orientations
+! from a packed copy of the detector arrays
+  if (includeFmatrix.eqv..FALSE.) then
+    if (enl%includebackground.eq.'y') then
+      call InitEBSDPixelTable(ipar,taccum,trgx,trgy,trgz,Emin,Emax,ptab)
+    else
+      call InitEBSDPixelTable(ipar,taccum,trgx,trgy,trgz,Emin,Emax,ptab,removebackground='y')
+    end if
+    allocate(binnedq(binx,biny,nqgroup),stat=istat)
+  end if
+
 ! allocate the arrays that will hold the computed pattern
   allocate(binned(binx,biny),stat=istat)
   if (trim(bitmode).eq.'char') then 
@@ -954,13 +969,13 @@ do ibatch=1,totnumbatches
                                      Emin,Emax,mask,prefactor,Fmatrix_inverse,removebackground='y',applynoise=idum)
      end if
     else
-     if (enl%includebackground.eq.'y') then
-      call CalcEBSDPatternSingleFull(ipar,angles%quatang(1:4,iang),taccum,tmLPNH,tmLPSH,trgx,trgy,trgz,binned, &
-                                     Emin,Emax,mask,prefactor,applynoise=idum)
-     else
-      call CalcEBSDPatternSingleFull(ipar,angles%quatang(1:4,iang),taccum,tmLPNH,tmLPSH,trgx,trgy,trgz,binned, &
-                                     Emin,Emax,mask,prefactor,removebackground='y',applynoise=idum)
+     iq = mod(iang-istart(TID,ibatch),nqgroup)+1
+     if (iq.eq.1) then
+      nq = min(nqgroup, istop(TID,ibatch)-iang+1)
+      call CalcEBSDPatternMultiFull(ipar,ptab,nq,angles%quatang(1:4,iang:iang+nq-1),tmLPNH,tmLPSH, &
+                                    binnedq(:,:,1:nq),mask,prefactor,applynoise=idum)
      end if
+     binned = binnedq(:,:,iq)
     end if
 
     if (enl%scalingmode .eq. 'gam') then
@@ -180,6 +180,7 @@ use ISO_C_BINDING
 use omp_lib
 use notifications
 use stringconstants
+use shardmod
  
 IMPLICIT NONE
 
@@ -194,11 +195,15 @@ integer(kind=irg)       :: isym,i,j,ik,npy,ipx,ipy,ipz,debug,iE,izz, izzmax, ieq
                            numk, timestart, timestop, numsites, nthreads, & ! number of independent incident beam directions
                            ir,nat(maxpasym),kk(3), skip, ijmax, one, NUMTHREADS, TID, SamplingType, &
                            numset,n,ix,iy,iz, io_int(6), nns, nnw, nref, Estart, &
-                           istat,gzero,ic,ip,ikk, totstrong, totweak, jh, ierr, nix, niy, nixp, niyp     ! counters
+                           istat,gzero,ic,ip,ikk, totstrong, totweak, jh, ierr, nix, niy, nixp, niyp, &  ! counters
+                           gE, gN, jE, jk, jcur, iEk, nk, itdone, nbatch, ibstart, ibend, cellEnergy, &   ! energy groups
+                           ckEnergy, ckNumE, ckBeams  ! checkpoint state
 real(kind=dbl)          :: tpi,Znsq, kkl, DBWF, kin, delta, h, lambda, omtl, srt, dc(3), xy(2), edge, scl, tmp, dx, dxm, dy, dym !
 real(kind=sgl)          :: io_real(5), selE, kn, FN(3), kkk(3), tstop, bp(4), nabsl, etotal, dens, avA, avZ
 real(kind=sgl),allocatable      :: EkeVs(:), svals(:), auxNH(:,:,:,:), auxSH(:,:,:,:), Z2percent(:)  ! results
 real(kind=sgl),allocatable      :: mLPNH(:,:,:,:), mLPSH(:,:,:,:), masterSPNH(:,:,:), masterSPSH(:,:,:)
+real(kind=sgl),allocatable      :: mLPNHg(:,:,:,:), mLPSHg(:,:,:,:), karrayt(:,:)
+integer(kind=irg),allocatable   :: kslot(:), nnsk(:), nnwk(:), kijt(:,:)
 real(kind=dbl),allocatable      :: LegendreArray(:), upd(:), diagonal(:)
 complex(kind=dbl)               :: czero
 complex(kind=dbl),allocatable   :: Lgh(:,:), Sgh(:,:,:)
@@ -209,16 +214,19 @@ character(fnlen)        :: xtalname
 integer(kind=irg)       :: numEbins, nsx, nsy, hdferr, nlines, lastEnergy    ! variables used in MC energy file
 integer(kind=irg),allocatable :: thick(:)
 real(kind=sgl),allocatable :: lambdaE(:,:)
-character(fnlen)        :: oldprogname, groupname, energyfile, outname, datagroupname, attributename, HDF_FileVersion
+character(fnlen)        :: oldprogname, groupname, energyfile, outname, datagroupname, attributename, HDF_FileVersion, &
+                           workname
 character(8)            :: MCscversion
 character(11)           :: dstr
 character(15)           :: tstrb
 character(15)           :: tstre
-logical                 :: f_exists, readonly, overwrite=.TRUE., insert=.TRUE., stereog, g_exists, xtaldataread, FL, doLegendre
+logical                 :: f_exists, readonly, overwrite=.TRUE., insert=.TRUE., stereog, g_exists, xtaldataread, FL, doLegendre, &
+                           resume, shardcompute, shardmerge
 character(fnlen, KIND=c_char),allocatable,TARGET :: stringarray(:)
 character(fnlen,kind=c_char)                     :: line2(1)
 
 type(unitcell)                  :: cell
+type(unitcell),allocatable      :: cellE(:)
 type(DynType),save              :: Dyn
 type(gnode),save                :: rlp
 type(reflisttype),pointer       :: reflist,firstw, rltmp
@@ -227,6 +235,8 @@ type(kvectorlist),pointer       :: khead, ktmp
 real(kind=sgl),allocatable      :: karray(:,:)
 integer(kind=irg),allocatable   :: kij(:,:)
 complex(kind=dbl),allocatable   :: DynMat(:,:)
+type(LghWorkspaceType)          :: LghWS
+type(ReflectionTableType)       :: reftab
 character(fnlen)                :: dataset, instring
 type(EBSDMCdataType)            :: EBSDMCdata
 type(MCCLNameListType)          :: mcnl
@@ -289,11 +299,32 @@ end do
 ! should we create a new file or open an existing file?
 !=============================================
   lastEnergy = -1
+  ckEnergy = -1
   outname = trim(EMsoft_getEMdatapathname())//trim(emnl%outname)
   outname = EMsoft_toNativePath(outname)
   energyfile = trim(EMsoft_getEMdatapathname())//trim(emnl%energyfile)
   energyfile = EMsoft_toNativePath(energyfile)
 
+! for a sharded run, each shard computes a subset of the beam directions and keeps its results (and
+! restart information) in its own shard file; the merge run (shard = 0) reads all shard files and 
+! produces the regular output file.
+  shardcompute = .FALSE.
+  shardmerge = .FALSE.
+  workname = outname
+  if ((emnl%nshards.gt.1).and.(emnl%uniform.eqv..FALSE.)) then 
+    if ((emnl%shard.lt.0).or.(emnl%shard.gt.emnl%nshards)) then 
+      call FatalError('ComputeMasterPattern','shard must be in the range [0,nshards]')
+    end if
+    if (emnl%shard.eq.0) then 
+      shardmerge = .TRUE.
+    else
+      shardcompute = .TRUE.
+      workname = getMasterShardName(outname, emnl%shard, emnl%nshards)
+      io_int(1:2) = (/ emnl%shard, emnl%nshards /)
+      call WriteValue(' Computing beam direction shard ', io_int, 2, "(I4,' of ',I4)")
+    end if
+  end if
+
 if (emnl%restart.eqv..TRUE.) then
 ! in this case we need to check whether or not the file exists, then open
 ! it and read the value of the last energy level that was simulated and written
@@ -301,7 +332,7 @@ if (emnl%restart.eqv..TRUE.) then
 ! know that there is at least one more level to be simulated.  If it is equal,
 ! then we can abort the program here.
 
-  inquire(file=trim(outname), exist=f_exists)
+  inquire(file=trim(workname), exist=f_exists)
   if (.not.f_exists) then 
     call FatalError('ComputeMasterPattern','restart HDF5 file does not exist')
   end if
@@ -316,7 +347,7 @@ if (emnl%restart.eqv..TRUE.) then
 
 ! Create a new file using the default properties.
   readonly = .TRUE.
-  hdferr =  HDF_openFile(outname, HDF_head, readonly)
+  hdferr =  HDF_openFile(workname, HDF_head, readonly)
 
 ! all we need to get from the file is the lastEnergy parameter
 groupname = SC_EMData
@@ -326,6 +357,20 @@ groupname = SC_EMData
 dataset = SC_lastEnergy
   call HDF_readDatasetInteger(dataset, HDF_head, hdferr, lastEnergy)
 
+! and the checkpoint state, if any; a checkpoint describes a group of ckNumE energy bins, starting
+! at bin ckEnergy, for which the first ckBeams entries of the beam direction work list are complete
+dataset = SC_checkpointEnergy
+  call H5Lexists_f(HDF_head%next%objectID,trim(dataset),g_exists, hdferr)
+  if (g_exists) then 
+    call HDF_readDatasetInteger(dataset, HDF_head, hdferr, ckEnergy)
+    if (ckEnergy.ne.-1) then
+dataset = SC_checkpointNumE
+      call HDF_readDatasetInteger(dataset, HDF_head, hdferr, ckNumE)
+dataset = SC_checkpointBeams
+      call HDF_readDatasetInteger(dataset, HDF_head, hdferr, ckBeams)
+    end if
+  end if
+
   call HDF_pop(HDF_head,.TRUE.)
 
 ! and close the fortran hdf interface
@@ -336,7 +381,7 @@ end if
 ! crystallography section; 
  !allocate(cell)        
  verbose = .TRUE.
- if (emnl%restart.eqv..TRUE.) then 
+ if ((emnl%restart.eqv..TRUE.).and.(lastEnergy.gt.1)) then 
    call Initialize_Cell(cell,Dyn,rlp,mcnl%xtalname, emnl%dmin, sngl(EkeVs(lastEnergy-1)), & 
                         nthreads=emnl%nthreads, verbose=verbose)
  else
@@ -491,7 +536,15 @@ deallocate(EBSDMCdata%accum_z)
 ! this will all be changed with the new version of the Bethe potentials
   call Set_Bethe_Parameters(BetheParameters,.TRUE.,emnl%BetheParametersFile)
 
-if (emnl%restart.eqv..FALSE.) then
+! a shard run only needs an empty shard file; all other output is generated by the merge run
+datagroupname = 'EBSDmaster'
+if ((emnl%restart.eqv..FALSE.).and.(shardcompute.eqv..TRUE.)) then
+  call h5open_EMsoft(hdferr)
+  call initMasterShard(workname, datagroupname, emnl%shard, emnl%nshards, emnl%npx, EBSDMCdata%numEbins, numsites)
+  call h5close_EMsoft(hdferr)
+end if
+
+if ((emnl%restart.eqv..FALSE.).and.(shardcompute.eqv..FALSE.)) then
 !=============================================
 ! create or update the HDF5 output file
 !=============================================
@@ -583,6 +636,15 @@ dataset = SC_lastEnergy
     hdferr = HDF_writeDatasetInteger(dataset, lastEnergy, HDF_head)
   end if
   
+! no checkpoint available yet (this also invalidates a checkpoint left by an earlier run)
+dataset = SC_checkpointEnergy
+  call H5Lexists_f(HDF_head%next%objectID,trim(dataset),g_exists, hdferr)
+  if (g_exists) then 
+    hdferr = HDF_writeDatasetInteger(dataset, lastEnergy, HDF_head, overwrite)
+  else
+    hdferr = HDF_writeDatasetInteger(dataset, lastEnergy, HDF_head)
+  end if
+  
 dataset = 'Z2percent'  ! SC_Z2percent
   call H5Lexists_f(HDF_head%next%objectID,trim(dataset),g_exists, hdferr)
   if (g_exists) then 
@@ -720,6 +782,24 @@ end if
 
 call Time_tick(timestart)
 
+! set the number of OpenMP threads 
+if (emnl%nthreads.eq.0) then 
+  nthreads = OMP_GET_MAX_THREADS()
+else
+  nthreads = emnl%nthreads
+end if
+call OMP_SET_NUM_THREADS(nthreads)
+io_int(1) = nthreads
+call WriteValue(' Attempting to set number of threads to ',io_int, 1, frm = "(I4)")
+
+! the energy bins are computed in groups of gN consecutive bins, starting at bin gE; all beam directions
+! of a group form a single work list for the OpenMP beam loop, so that the threads do not run out of 
+! work at the end of each energy bin when the number of beam directions per bin is small.
+! cellEnergy is the energy bin for which the cell structure currently holds the Fourier coefficients.
+gE = -1
+gN = 0
+cellEnergy = Estart
+
 energyloop: do iE=Estart,1,-1
  if (emnl%uniform.eqv..FALSE.) then
 ! is this a single-energy run ?
@@ -736,119 +816,231 @@ energyloop: do iE=Estart,1,-1
    call WriteValue('; energy [keV] = ',io_real,1,"(F6.2/)")
    selE = EkeVs(iE)
 
-! set the accelerating voltage
-   skip = 3
-   cell%voltage = dble(EkeVs(iE))
-   if(iE .ne. Estart) then
-   	verbose = .TRUE.
-   	call Initialize_Cell(cell,Dyn,rlp,mcnl%xtalname, emnl%dmin, EkeVs(iE), &
-                         nthreads=emnl%nthreads, verbose=verbose, initLUT=.TRUE.)
+! do we need to compute a new group of energy bins ?
+  if ((shardmerge.eqv..FALSE.).and.((iE.gt.gE).or.(iE.lt.gE-gN+1))) then 
+! can we resume from a checkpoint ?  We only do this once, for the group that contains the start energy
+   resume = .FALSE.
+   if (ckEnergy.ne.-1) then 
+     if ((iE.le.ckEnergy).and.(iE.ge.ckEnergy-ckNumE+1)) resume = .TRUE.
+   end if
+
+   if (resume.eqv..TRUE.) then 
+     gE = ckEnergy
+     gN = ckNumE
+     itdone = ckBeams
+     io_int(1:3) = (/ gE, gN, itdone /)
+     call WriteValue(' Resuming from checkpoint: start bin, number of bins, completed beam directions ', &
+                     io_int, 3, "(I4,',',I4,',',I10)")
+   else
+     gE = iE
+     gN = 1
+     itdone = 0
    end if
-   !call CalcWaveLength(cell, rlp, skip)
+   ckEnergy = -1
+
+   if (allocated(kij)) deallocate(karray, kij, nnsk, nnwk)
+   if (allocated(cellE)) deallocate(cellE)
+   if (allocated(mLPNHg)) deallocate(mLPNHg, mLPSHg)
 
 !=============================================
 ! ---------- create the incident beam directions list
 ! determine all independent incident beam directions (use a linked list starting at khead)
-! numk is the total number of k-vectors to be included in this computation;
-! note that this needs to be redone for each energy, since the wave vector changes with energy
-   nullify(khead)
-   if (doLegendre.eqv..FALSE.) then
-    if (usehex) then
-      call Calckvectors(khead,cell, (/ 0.D0, 0.D0, 1.D0 /), (/ 0.D0, 0.D0, 0.D0 /),0.D0,emnl%npx,npy,numk, &
-                  SamplingType,ijmax,'RoscaLambert',usehex)
-    else 
-      call Calckvectors(khead,cell, (/ 0.D0, 0.D0, 1.D0 /), (/ 0.D0, 0.D0, 0.D0 /),0.D0,emnl%npx,npy,numk, &
-                  SamplingType,ijmax,'RoscaLambert',usehex)
+! nk is the number of k-vectors for a given energy; since the wave vector changes with 
+! energy, this needs to be redone for each energy bin in the group; numk is the total 
+! number of k-vectors in the work list for the group.
+   numk = 0
+   jE = 0
+   groupbuild: do while (jE.lt.gN)
+    jE = jE + 1
+    iEk = gE - jE + 1
+
+! set the accelerating voltage
+    skip = 3
+    cell%voltage = dble(EkeVs(iEk))
+    if (iEk.ne.cellEnergy) then
+      verbose = .TRUE.
+      call Initialize_Cell(cell,Dyn,rlp,mcnl%xtalname, emnl%dmin, EkeVs(iEk), &
+                           nthreads=emnl%nthreads, verbose=verbose, initLUT=.TRUE.)
+      cellEnergy = iEk
     end if
-   else 
-    if (usehex) then
-      call Calckvectors(khead,cell, (/ 0.D0, 0.D0, 1.D0 /), (/ 0.D0, 0.D0, 0.D0 /),0.D0,emnl%npx,npy,numk, &
-                  SamplingType,ijmax,'RoscaLambertLegendre',usehex, LegendreArray)
+    !call CalcWaveLength(cell, rlp, skip)
+
+    nullify(khead)
+    if (doLegendre.eqv..FALSE.) then
+     if (usehex) then
+       call Calckvectors(khead,cell, (/ 0.D0, 0.D0, 1.D0 /), (/ 0.D0, 0.D0, 0.D0 /),0.D0,emnl%npx,npy,nk, &
+                   SamplingType,ijmax,'RoscaLambert',usehex)
+     else 
+       call Calckvectors(khead,cell, (/ 0.D0, 0.D0, 1.D0 /), (/ 0.D0, 0.D0, 0.D0 /),0.D0,emnl%npx,npy,nk, &
+                   SamplingType,ijmax,'RoscaLambert',usehex)
+     end if
     else 
-      call Calckvectors(khead,cell, (/ 0.D0, 0.D0, 1.D0 /), (/ 0.D0, 0.D0, 0.D0 /),0.D0,emnl%npx,npy,numk, &
-                  SamplingType,ijmax,'RoscaLambertLegendre',usehex, LegendreArray)
+     if (usehex) then
+       call Calckvectors(khead,cell, (/ 0.D0, 0.D0, 1.D0 /), (/ 0.D0, 0.D0, 0.D0 /),0.D0,emnl%npx,npy,nk, &
+                   SamplingType,ijmax,'RoscaLambertLegendre',usehex, LegendreArray)
+     else 
+       call Calckvectors(khead,cell, (/ 0.D0, 0.D0, 1.D0 /), (/ 0.D0, 0.D0, 0.D0 /),0.D0,emnl%npx,npy,nk, &
+                   SamplingType,ijmax,'RoscaLambertLegendre',usehex, LegendreArray)
+     end if
     end if
-   end if
-   io_int(1)=numk
-   call WriteValue('# independent beam directions to be considered = ', io_int, 1, "(I8)")
-
-! convert part of the kvector linked list into arrays for OpenMP
-  allocate(karray(4,numk), kij(3,numk),stat=istat)
+    io_int(1)=nk
+    io_int(2)=iEk
+    call WriteValue('# independent beam directions to be considered = ', io_int, 2, "(I8,' for energy bin ',I4)")
+
+! append this part of the kvector linked list to the work list arrays for OpenMP; the fourth
+! entry of kij is the slot index jE of the energy bin gE-jE+1 in the group arrays
+    allocate(karrayt(4,numk+nk), kijt(4,numk+nk), stat=istat)
+    if (numk.gt.0) then
+      karrayt(1:4,1:numk) = karray(1:4,1:numk)
+      kijt(1:4,1:numk) = kij(1:4,1:numk)
+      deallocate(karray, kij)
+    end if
+    call move_alloc(karrayt, karray)
+    call move_alloc(kijt, kij)
 ! point to the first beam direction
-  ktmp => khead
+    ktmp => khead
 ! and loop through the list, keeping k, kn, and i,j
-  karray(1:3,1) = sngl(ktmp%k(1:3))
-  karray(4,1) = sngl(ktmp%kn)
-  kij(1:3,1) = (/ ktmp%i, ktmp%j, ktmp%hs /)
-  do ik=2,numk
-    ktmp => ktmp%next
-    karray(1:3,ik) = sngl(ktmp%k(1:3))
-    karray(4,ik) = sngl(ktmp%kn)
-    kij(1:3,ik) = (/ ktmp%i, ktmp%j, ktmp%hs /)
-  end do
+    do ik=numk+1,numk+nk
+      if (ik.gt.numk+1) ktmp => ktmp%next
+      karray(1:3,ik) = sngl(ktmp%k(1:3))
+      karray(4,ik) = sngl(ktmp%kn)
+      kij(1:4,ik) = (/ ktmp%i, ktmp%j, ktmp%hs, jE /)
+    end do
+    numk = numk + nk
 ! and remove the linked list
-  call Delete_kvectorlist(khead)
+    call Delete_kvectorlist(khead)
+
+! once we know the number of beam directions for the first energy, we can decide how many 
+! energy bins to combine; we aim for at least 10 chunks of 100 beam directions per thread
+    if (jE.eq.1) then
+      if ((resume.eqv..FALSE.).and.(emnl%Esel.eq.-1)) then 
+        gN = max(1, (1000*nthreads+nk-1)/nk)
+        if (emnl%Econcurrent.gt.0) then 
+          gN = min(gN, emnl%Econcurrent)
+        else
+          gN = min(gN, 8)
+        end if
+        gN = min(gN, gE)
+      end if
+      allocate(cellE(gN))
+    end if
+    cellE(jE) = cell
+   end do groupbuild
 
-  verbose = .FALSE.
-  totstrong = 0
-  totweak = 0
+   allocate(nnsk(numk), nnwk(numk))
+   nnsk = 0
+   nnwk = 0
+
+   if (gN.gt.1) then
+     io_int(1) = gN
+     io_int(2) = numk
+     call WriteValue(' Number of energy bins computed concurrently = ',io_int, 2, "(I4,'; beam directions = ',I10)")
+   end if
 
 ! ---------- end of "create the incident beam directions list"
 !=============================================
 
-! here's where we introduce the OpenMP calls, to speed up the overall calculations...
+! allocate the master patterns for all energy bins in this group
+   allocate(mLPNHg(-emnl%npx:emnl%npx,-npy:npy,gN,1:numsites),stat=istat)
+   allocate(mLPSHg(-emnl%npx:emnl%npx,-npy:npy,gN,1:numsites),stat=istat)
+   mLPNHg = 0.0
+   mLPSHg = 0.0
+
+! when resuming, read the partial master patterns from the checkpoint datasets; the pixels 
+! that belong to beam directions that have not yet been computed are still zero
+   if ((resume.eqv..TRUE.).and.(itdone.gt.0)) then 
+     nullify(HDF_head%next)
+     call h5open_EMsoft(hdferr)
+     readonly = .TRUE.
+     hdferr =  HDF_openFile(workname, HDF_head, readonly)
+groupname = SC_EMData
+     hdferr = HDF_openGroup(groupname, HDF_head)
+     hdferr = HDF_openGroup(datagroupname, HDF_head)
+
+     cnt4 = (/ 2*emnl%npx+1, 2*emnl%npx+1, 1, numsites /)
+     do jE=1,gN
+       offset4 = (/ 0, 0, gE-jE, 0 /)
+dataset = SC_checkpointmLPNH
+       mLPNHg(:,:,jE:jE,:) = HDF_readHyperslabFloatArray4D(dataset, offset4, cnt4, HDF_head)
+dataset = SC_checkpointmLPSH
+       mLPSHg(:,:,jE:jE,:) = HDF_readHyperslabFloatArray4D(dataset, offset4, cnt4, HDF_head)
+     end do
 
-! set the number of OpenMP threads 
-  if (emnl%nthreads.eq.0) then 
-    nthreads = OMP_GET_MAX_THREADS()
-  else
-    nthreads = emnl%nthreads
-  end if
-  call OMP_SET_NUM_THREADS(nthreads)
-  io_int(1) = nthreads
-  call WriteValue(' Attempting to set number of threads to ',io_int, 1, frm = "(I4)")
+     call HDF_pop(HDF_head,.TRUE.)
+     call h5close_EMsoft(hdferr)
+   end if
+
+   verbose = .FALSE.
 
+! the work list is processed in batches of emnl%checkpoint beam directions; after each batch 
+! the partial master patterns are written to the output file
+   nbatch = numk
+   if (emnl%checkpoint.gt.0) nbatch = emnl%checkpoint
+
+! here's where we introduce the OpenMP calls, to speed up the overall calculations...
 ! use OpenMP to run on multiple cores ... 
 !$OMP PARALLEL COPYIN(rlp) &
-!$OMP& PRIVATE(DynMat,Sgh,Lgh,ik,FN,TID,kn,ipx,ipy,ix,iequiv,nequiv,reflist,firstw) &
-!$OMP& PRIVATE(kkk,nns,nnw,nref,svals,io_int)
+!$OMP& PRIVATE(DynMat,Sgh,Lgh,ik,FN,TID,kn,ipx,ipy,ipz,ix,iequiv,nequiv,reftab,jk,jcur,iEk,ibstart,ibend) &
+!$OMP& PRIVATE(kkk,nns,nnw,nref,svals,io_int,LghWS)
 
   allocate(svals(numset),stat=istat)
 
+! per-thread LAPACK work space for CalcLgh, kept for the entire beam direction loop (it grows as 
+! needed); without absorption the dynamical matrix is Hermitian and the cheaper ZHEEV solver is used
+  call InitLghWorkspace(LghWS, 0, hermitian=(rlp%absorption.eqv..FALSE.))
+
+! the per-thread contiguous reflection table depends on the energy, so it is (re)initialized 
+! from the cell copy of the energy bin whenever a thread moves on to another slot
+  jcur = 0
+
   NUMTHREADS = OMP_GET_NUM_THREADS()
   TID = OMP_GET_THREAD_NUM()
 
+  batchloop: do ibstart = itdone+1, numk, nbatch
+   ibend = min(ibstart+nbatch-1, numk)
+
 !$OMP DO SCHEDULE(DYNAMIC,100)    
 ! ---------- and here we start the beam direction loop
-   beamloop:do ik = 1,numk
+   beamloop:do ik = ibstart,ibend
+
+! skip the beam directions that belong to other shards
+     if (shardcompute.eqv..TRUE.) then
+       if (.not.inMasterShard(kij(1,ik), kij(2,ik), emnl%npx, emnl%shard, emnl%nshards)) CYCLE beamloop
+     end if
+
+     jk = kij(4,ik)
+     iEk = gE - jk + 1
+     if (jk.ne.jcur) then 
+       if (jcur.ne.0) call Delete_ReflectionTable(reftab)
+       call Initialize_ReflectionTable(cellE(jk), reftab, emnl%dmin)
+       jcur = jk
+     end if
 
 !=============================================
 ! ---------- create the master reflection list for this beam direction
-! Then we must determine the masterlist of reflections (also a linked list);
+! Then we must determine the masterlist of reflections (stored in the reflection table);
 ! This list basically samples a large reciprocal space volume; it does not 
 ! distinguish between zero and higher order Laue zones, since that 
 ! distinction becomes meaningless when we consider the complete 
 ! reciprocal lattice.  
-     nullify(reflist)
      kkk = karray(1:3,ik)
      FN = kkk
 
-     call Initialize_ReflectionList(cell, reflist, BetheParameters, FN, kkk, emnl%dmin, nref, verbose)
+     call Update_ReflectionTable(cellE(jk), reftab, BetheParameters, FN, kkk, nref)
 ! ---------- end of "create the master reflection list"
 !=============================================
 
 
 ! determine strong and weak reflections
-     nullify(firstw)
      nns = 0
      nnw = 0
-     call Apply_BethePotentials(cell, reflist, firstw, BetheParameters, nref, nns, nnw)
+     call Apply_BethePotentialsTable(cellE(jk), reftab, BetheParameters, nns, nnw)
 
 ! generate the dynamical matrix
      allocate(DynMat(nns,nns))
-     call GetDynMat(cell, reflist, firstw, rlp, DynMat, nns, nnw)
-     totstrong = totstrong + nns
-     totweak = totweak + nnw
+     call GetDynMatTable(cellE(jk), reftab, rlp, DynMat, nns, nnw)
+     nnsk(ik) = nns
+     nnwk(ik) = nnw
 
 ! then we need to initialize the Sgh and Lgh arrays
      if (allocated(Sgh)) deallocate(Sgh)
@@ -856,14 +1048,12 @@ energyloop: do iE=Estart,1,-1
      allocate(Sgh(nns,nns,numset),Lgh(nns,nns))
      Sgh = czero
      Lgh = czero
-     ! call CalcSgh(cell,reflist,nns,numset,Sgh,nat)
-     call getSghfromLUT(cell,reflist,nns,numset,nat,Sgh)
-!write(*,*) TID, maxval(abs(Sgh)), minval(abs(Sgh)), nat(1:numset),shape(Sgh),1.0/float(sum(nat(1:numset)))
-
+     ! call CalcSghTable(cellE(jk),reftab,nns,numset,Sgh)
+     call getSghfromLUTTable(cellE(jk),reftab,nns,numset,Sgh)
 
 ! solve the dynamical eigenvalue equation for this beam direction  
      kn = karray(4,ik)
-     call CalcLgh(DynMat,Lgh,dble(thick(iE)),dble(kn),nns,gzero,mcnl%depthstep,lambdaE(iE,1:izzmax),izzmax)
+     call CalcLgh(DynMat,Lgh,dble(thick(iEk)),dble(kn),nns,gzero,mcnl%depthstep,lambdaE(iEk,1:izzmax),izzmax,LghWS)
      deallocate(DynMat)
 
 ! sum over the element-wise (Hadamard) product of the Lgh and Sgh arrays 
@@ -887,38 +1077,130 @@ energyloop: do iE=Estart,1,-1
          call Apply3DPGSymmetry(cell,ipx,ipy,ipz,emnl%npx,iequiv,nequiv)
        end if
      end if
-!$OMP CRITICAL
+! no critical section needed here: the sets of equivalent pixels of different irreducible beam 
+! directions are disjoint, so each thread only writes to its own master pattern locations
   if (emnl%combinesites.eqv..FALSE.) then
      do ix=1,nequiv
-       if (iequiv(3,ix).eq.-1) mLPSH(iequiv(1,ix),iequiv(2,ix),1,1:numset) = svals(1:numset)
-       if (iequiv(3,ix).eq.1) mLPNH(iequiv(1,ix),iequiv(2,ix),1,1:numset) = svals(1:numset)
+       if (iequiv(3,ix).eq.-1) mLPSHg(iequiv(1,ix),iequiv(2,ix),jk,1:numset) = svals(1:numset)
+       if (iequiv(3,ix).eq.1) mLPNHg(iequiv(1,ix),iequiv(2,ix),jk,1:numset) = svals(1:numset)
      end do
   else
      do ix=1,nequiv
-       if (iequiv(3,ix).eq.-1) mLPSH(iequiv(1,ix),iequiv(2,ix),1,1) = sum(svals)
-       if (iequiv(3,ix).eq.1) mLPNH(iequiv(1,ix),iequiv(2,ix),1,1) = sum(svals)
+       if (iequiv(3,ix).eq.-1) mLPSHg(iequiv(1,ix),iequiv(2,ix),jk,1) = sum(svals)
+       if (iequiv(3,ix).eq.1) mLPNHg(iequiv(1,ix),iequiv(2,ix),jk,1) = sum(svals)
      end do
   end if
-!$OMP END CRITICAL
   
-! if (TID.eq.0) write (*,*) maxval(abs(mLPNH))
-
      if (mod(ik,5000).eq.0) then
        io_int(1) = ik
        io_int(2) = numk
        call WriteValue('  completed beam direction ',io_int, 2, "(I8,' of ',I8)")
      end if
 
-     call Delete_gvectorlist(reflist)
-
     end do beamloop
+!$OMP END DO
+
+! write a checkpoint; the implied barrier at the end of the beam loop guarantees that 
+! all beam directions up to ibend have been completed
+    if (emnl%checkpoint.gt.0) then 
+!$OMP SINGLE
+     nullify(HDF_head%next)
+     call h5open_EMsoft(hdferr)
+     hdferr =  HDF_openFile(workname, HDF_head)
+groupname = SC_EMData
+     hdferr = HDF_openGroup(groupname, HDF_head)
+     hdferr = HDF_openGroup(datagroupname, HDF_head)
+
+! invalidate the checkpoint while it is being updated
+dataset = SC_checkpointEnergy
+     ckEnergy = -1
+     call H5Lexists_f(HDF_head%next%objectID,trim(dataset),g_exists, hdferr)
+     if (g_exists) then 
+       hdferr = HDF_writeDatasetInteger(dataset, ckEnergy, HDF_head, overwrite)
+     else
+       hdferr = HDF_writeDatasetInteger(dataset, ckEnergy, HDF_head)
+     end if
+
+     dims4 = (/  2*emnl%npx+1, 2*emnl%npx+1, EBSDMCdata%numEbins, numsites /)
+     cnt4 = (/ 2*emnl%npx+1, 2*emnl%npx+1, 1, numsites /)
+     do jE=1,gN
+       offset4 = (/ 0, 0, gE-jE, 0 /)
+dataset = SC_checkpointmLPNH
+       call H5Lexists_f(HDF_head%next%objectID,trim(dataset),g_exists, hdferr)
+       if (g_exists) then 
+         hdferr = HDF_writeHyperslabFloatArray4D(dataset, mLPNHg(:,:,jE:jE,:), dims4, offset4, cnt4, HDF_head, insert)
+       else
+         hdferr = HDF_writeHyperslabFloatArray4D(dataset, mLPNHg(:,:,jE:jE,:), dims4, offset4, cnt4, HDF_head)
+       end if
+dataset = SC_checkpointmLPSH
+       call H5Lexists_f(HDF_head%next%objectID,trim(dataset),g_exists, hdferr)
+       if (g_exists) then 
+         hdferr = HDF_writeHyperslabFloatArray4D(dataset, mLPSHg(:,:,jE:jE,:), dims4, offset4, cnt4, HDF_head, insert)
+       else
+         hdferr = HDF_writeHyperslabFloatArray4D(dataset, mLPSHg(:,:,jE:jE,:), dims4, offset4, cnt4, HDF_head)
+       end if
+     end do
+
+dataset = SC_checkpointNumE
+     call H5Lexists_f(HDF_head%next%objectID,trim(dataset),g_exists, hdferr)
+     if (g_exists) then 
+       hdferr = HDF_writeDatasetInteger(dataset, gN, HDF_head, overwrite)
+     else
+       hdferr = HDF_writeDatasetInteger(dataset, gN, HDF_head)
+     end if
+dataset = SC_checkpointBeams
+     call H5Lexists_f(HDF_head%next%objectID,trim(dataset),g_exists, hdferr)
+     if (g_exists) then 
+       hdferr = HDF_writeDatasetInteger(dataset, ibend, HDF_head, overwrite)
+     else
+       hdferr = HDF_writeDatasetInteger(dataset, ibend, HDF_head)
+     end if
+! and validate the checkpoint again
+dataset = SC_checkpointEnergy
+     hdferr = HDF_writeDatasetInteger(dataset, gE, HDF_head, overwrite)
+
+     call HDF_pop(HDF_head,.TRUE.)
+     call h5close_EMsoft(hdferr)
+
+     io_int(1) = ibend
+     io_int(2) = numk
+     call WriteValue('  checkpoint written after beam direction ',io_int, 2, "(I10,' of ',I10)")
+!$OMP END SINGLE
+    end if
+  end do batchloop
 
   deallocate(svals)
+  call DeleteLghWorkspace(LghWS)
+  if (jcur.ne.0) call Delete_ReflectionTable(reftab)
   
 ! end of OpenMP portion
 !$OMP END PARALLEL
+  end if   ! new group of energy bins
+
+  if (shardmerge.eqv..TRUE.) then 
+! add together the master patterns of all shards for this energy bin
+    call h5open_EMsoft(hdferr)
+    call readMasterShards(outname, datagroupname, emnl%nshards, iE, emnl%npx, EBSDMCdata%numEbins, numsites, mLPNH, mLPSH)
+    call h5close_EMsoft(hdferr)
+    nk = 0
+  else
+! extract the master patterns for this energy bin from the group arrays
+    jE = gE - iE + 1
+    mLPNH(:,:,1,1:numsites) = mLPNHg(:,:,jE,1:numsites)
+    mLPSH(:,:,1,1:numsites) = mLPSHg(:,:,jE,1:numsites)
+    nk = count((kij(4,:).eq.jE).and.(nnsk.gt.0))
+    totstrong = sum(nnsk, mask=(kij(4,:).eq.jE))
+    totweak = sum(nnwk, mask=(kij(4,:).eq.jE))
+  end if
 
-  deallocate(karray, kij)
+! a shard run only stores the unprocessed master patterns in its shard file
+  if (shardcompute.eqv..TRUE.) then 
+    call h5open_EMsoft(hdferr)
+    call writeMasterShard(workname, datagroupname, iE, emnl%npx, EBSDMCdata%numEbins, numsites, mLPNH, mLPSH)
+    call h5close_EMsoft(hdferr)
+    call Message('Shard data stored in file '//trim(workname), frm = "(A/)")
+    CYCLE energyloop
+  end if
 
   if (usehex) then
 ! and finally, we convert the hexagonally sampled array to a square Lambert projection which will be used 
@@ -991,10 +1273,13 @@ energyloop: do iE=Estart,1,-1
 ! since these computations can take a long time, here we store 
 ! all the output at the end of each pass through the energyloop.
 
-  io_int(1) = nint(float(totstrong)/float(numk))
-  call WriteValue(' -> Average number of strong reflections = ',io_int, 1, "(I5)")
-  io_int(1) = nint(float(totweak)/float(numk))
-  call WriteValue(' -> Average number of weak reflections   = ',io_int, 1, "(I5)")
+! (beam directions that were computed before a restart are not included in the averages)
+  if (nk.gt.0) then
+    io_int(1) = nint(float(totstrong)/float(nk))
+    call WriteValue(' -> Average number of strong reflections = ',io_int, 1, "(I5)")
+    io_int(1) = nint(float(totweak)/float(nk))
+    call WriteValue(' -> Average number of weak reflections   = ',io_int, 1, "(I5)")
+  end if
 
 ! and here is where the major changes are for version 5.0: all output now in HDF5 format
   call timestamp(datestring=dstr, timestring=tstre)
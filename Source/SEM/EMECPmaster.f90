@@ -132,6 +132,7 @@ use ISO_C_BINDING
 use notifications
 use stringconstants
 use timing 
+use shardmod
 
 IMPLICIT NONE
 
@@ -159,6 +160,8 @@ real(kind=sgl), allocatable :: thick(:), mLPNH(:,:,:), mLPSH(:,:,:), svals(:), l
 real(kind=dbl)          :: intthick, dc(3), dx, dxm, dy, dym, edge, scl, xy(2), Radius
 complex(kind=dbl),allocatable   :: Lgh(:,:),Sgh(:,:),Sghtmp(:,:,:)
 complex(kind=dbl),allocatable   :: DynMat(:,:)
+type(LghWorkspaceType)          :: LghWS
+type(ReflectionTableType)       :: reftab
 complex(kind=dbl)       :: czero
 
 integer(kind=irg)       :: nt, nns, nnw, tots, totw ! thickness array and BetheParameters strong and weak beams
@@ -168,7 +171,7 @@ integer(kind=irg),allocatable   :: kij(:,:)
 integer(kind=irg)       :: nat(maxpasym)
 real(kind=dbl)          :: res(2), xyz(3), ind, nabsl
 
-character(fnlen)        :: oldprogname, energyfile, outname
+character(fnlen)        :: oldprogname, energyfile, outname, workname
 character(fnlen)        :: xtalname, groupname, datagroupname, HDF_FileVersion, attributename
 character(8)            :: MCscversion
 character(4)            :: MCmode
@@ -181,7 +184,7 @@ character(fnlen, KIND=c_char),allocatable,TARGET :: stringarray(:)
 character(fnlen,kind=c_char)                     :: line2(1)
 
 
-logical                             :: verbose, usehex, switchmirror
+logical                             :: verbose, usehex, switchmirror, shardcompute, shardmerge
 
 type(unitcell)                      :: cell
 type(gnode),save                    :: rlp
@@ -484,6 +487,32 @@ mLPSH = 0.0
 masterSPNH = 0.0
 masterSPSH = 0.0
 
+! in a sharded run, shards 1..nshards each compute part of the beam directions and store them in
+! a shard file next to the Monte Carlo file; shard 0 adds these together and writes the ECPmaster data
+shardcompute = .FALSE.
+shardmerge = .FALSE.
+workname = energyfile
+if (ecpnl%nshards.gt.1) then 
+  if ((ecpnl%shard.lt.0).or.(ecpnl%shard.gt.ecpnl%nshards)) then 
+    call FatalError('ECmasterpattern','shard must be in the range [0,nshards]')
+  end if
+  if (ecpnl%shard.eq.0) then 
+    shardmerge = .TRUE.
+  else
+    shardcompute = .TRUE.
+    workname = getMasterShardName(energyfile, ecpnl%shard, ecpnl%nshards)
+    io_int(1:2) = (/ ecpnl%shard, ecpnl%nshards /)
+    call WriteValue(' Computing beam direction shard ', io_int, 2, "(I4,' of ',I4)")
+  end if
+end if
+
+if (shardcompute.eqv..TRUE.) then 
+! the Monte Carlo file is left alone by the shards; the merge run writes all the output
+  call h5open_EMsoft(hdferr)
+  call initMasterShard(workname, datagroupname, ecpnl%shard, ecpnl%nshards, ecpnl%npx, 1, numsites)
+  call h5close_EMsoft(hdferr)
+else
+
 nullify(HDF_head%next)
 ! Initialize FORTRAN interface.
 call h5open_EMsoft(hdferr)
@@ -628,6 +657,15 @@ call HDF_pop(HDF_head,.TRUE.)
 ! and close the fortran hdf interface
 call h5close_EMsoft(hdferr)
 
+end if  ! (shardcompute.eqv..TRUE.)
+
+! the merge run adds together the master patterns of all shards instead of computing them
+if (shardmerge.eqv..TRUE.) then 
+  call h5open_EMsoft(hdferr)
+  call readMasterShards(energyfile, datagroupname, ecpnl%nshards, 1, ecpnl%npx, 1, numsites, mLPNH, mLPSH)
+  call h5close_EMsoft(hdferr)
+else
+
 call OMP_SET_NUM_THREADS(ecpnl%nthreads)
 io_int(1) = ecpnl%nthreads
 call WriteValue(' Attempting to set number of threads to ',io_int, 1, frm = "(I4)")
@@ -635,8 +673,8 @@ call WriteValue(' Attempting to set number of threads to ',io_int, 1, frm = "(I4
 
 !!$OMP PARALLEL default(shared) COPYIN(rlp) &
 !$OMP PARALLEL COPYIN(rlp) &
-!$OMP& PRIVATE(DynMat,Sgh,Sghtmp,Lgh,i,FN,TID,kn,ipx,ipy,ix,ip,iequiv,nequiv,reflist,firstw) &
-!$OMP& PRIVATE(kk,nns,nnw,nref,io_int,io_int_sgl,nthreads,svals) 
+!$OMP& PRIVATE(DynMat,Sgh,Sghtmp,Lgh,i,FN,TID,kn,ipx,ipy,ix,ip,iequiv,nequiv,reftab) &
+!$OMP& PRIVATE(kk,nns,nnw,nref,io_int,io_int_sgl,nthreads,svals,LghWS) REDUCTION(+:tots,totw)
 !!!!$OMP& SHARED(mLPNH,mLPSH,tots,totw)
 
 nthreads = OMP_GET_NUM_THREADS()
@@ -648,27 +686,36 @@ if (TID .eq. 0) call WriteValue('Setting number of threads to ', io_int_sgl, 1,
 
 allocate(svals(numset))
 
+! per-thread LAPACK work space for CalcLgh, kept for the entire beam direction loop (it grows as 
+! needed); without absorption the dynamical matrix is Hermitian and the cheaper ZHEEV solver is used
+call InitLghWorkspace(LghWS, 0, hermitian=(rlp%absorption.eqv..FALSE.))
+
+! per-thread contiguous reflection table; the candidate reflections inside the dmin sphere are
+! the same for all beam directions, so only the excitation errors are recomputed in the loop
+call Initialize_ReflectionTable(cell, reftab, ecpnl%dmin)
+
 !$OMP DO SCHEDULE(DYNAMIC)
 
 beamloop: do i = 1, numk
+    if (shardcompute.eqv..TRUE.) then
+      if (.not.inMasterShard(kij(1,i), kij(2,i), ecpnl%npx, ecpnl%shard, ecpnl%nshards)) CYCLE beamloop
+    end if
+
     kk = klist(1:3,i)
     FN = kk
 
-    nullify(reflist)
-
-    call Initialize_ReflectionList(cell, reflist, BetheParameters, FN, kk, ecpnl%dmin, nref)
+    call Update_ReflectionTable(cell, reftab, BetheParameters, FN, kk, nref)
 
 ! determine strong and weak reflections
-    nullify(firstw)
     nns = 0
     nnw = 0
-    call Apply_BethePotentials(cell, reflist, firstw, BetheParameters, nref, nns, nnw)
+    call Apply_BethePotentialsTable(cell, reftab, BetheParameters, nns, nnw)
 
 ! write (*,*) i, nref, nns, nnw 
 
     allocate(DynMat(nns,nns))
 
-    call GetDynMat(cell, reflist, firstw, rlp, DynMat, nns, nnw)
+    call GetDynMatTable(cell, reftab, rlp, DynMat, nns, nnw)
 
 ! then we need to initialize the Sgh and Lgh arrays
     if (allocated(Lgh)) deallocate(Lgh)
@@ -678,12 +725,12 @@ beamloop: do i = 1, numk
 
     Lgh = czero
     Sghtmp = czero
-    call CalcSgh(cell,reflist,nns,numset,Sghtmp,nat)
+    call CalcSghTable(cell,reftab,nns,numset,Sghtmp)
 
 ! solve the dynamical eigenvalue equation
     kn = knlist(i)
 
-    call CalcLgh(DynMat,Lgh,intthick,dble(kn),nns,gzero,depthstep,lambdaZ,izz)
+    call CalcLgh(DynMat,Lgh,intthick,dble(kn),nns,gzero,depthstep,lambdaZ,izz,LghWS)
     deallocate(DynMat)
 
 ! dynamical contributions
@@ -730,10 +777,11 @@ beamloop: do i = 1, numk
         call WriteValue('  completed beam direction ',io_int, 1, "(I8)")
     end if
 
-    call Delete_gvectorlist(reflist)
-
 end do beamloop
 
+call DeleteLghWorkspace(LghWS)
+call Delete_ReflectionTable(reftab)
+
 !$OMP END PARALLEL
 
 io_int(1) = nint(float(tots)/float(numk))
@@ -741,6 +789,17 @@ call WriteValue(' -> Average number of strong reflections = ',io_int, 1, "(I5)")
 io_int(1) = nint(float(totw)/float(numk))
 call WriteValue(' -> Average number of weak reflections   = ',io_int, 1, "(I5)")
 
+! a shard only stores the unprocessed master patterns in its shard file
+if (shardcompute.eqv..TRUE.) then 
+  call h5open_EMsoft(hdferr)
+  call writeMasterShard(workname, datagroupname, 1, ecpnl%npx, 1, numsites, mLPNH, mLPSH)
+  call h5close_EMsoft(hdferr)
+  call Message('Shard data stored in file '//trim(workname), frm = "(A/)")
+  return
+end if
+
+end if  ! (shardmerge.eqv..TRUE.)
+
 
  if (usehex.eqv..TRUE.) then
 ! and finally, we convert the hexagonally sampled array to a square Lambert projection which will be used 
@@ -98,6 +98,7 @@ program EMHREBSD
     use rotations
     use HDFsupport
     use timing
+    use omp_lib
 
     integer(kind=irg), INTENT(IN)                       :: numangles
     real(kind=dbl), INTENT(IN)                          :: Euler_Angle(3, numangles)
@@ -108,30 +109,29 @@ program EMHREBSD
     character(fnlen)                                    :: ename, image_filenam, datafile, groupname, dataset, datagroupname
     integer(kind=irg)                                   :: ROI_size, iunitexpt, recordsize, ierr, kk, ii, jj, i, j, numr, numw, &
                                                         binx, biny, xoffset, yoffset, io_int(2), istat, L, patsz , hdferr, nx, ny, &
-                                                        interp_size, interp_grid, N_pattern, tick, tock, tickstart
+                                                        interp_size, interp_grid, N_pattern, tick, tock, tickstart, NP, &
+                                                        nn(2), inembed(2), onembed(2), TID
     integer(HSIZE_T)                                    :: dims2(2), dims3(3), offset3(3), offset(3)
     logical                                             :: f_exists
     real(kind=sgl)                                      :: mi, ma, io_real(1), ave, std, q(2), interp_step, C(6,6), Distance(2), &
-                                                          R_x, R_y
+                                                          R_x, R_y, cosang, sinang
     real(kind=sgl),parameter                            :: dtor = 0.0174533  ! convert from degrees to radians
     real(kind=dbl)                                      :: x, y, val, Ftensor(9), R_sample(3,3), Smatrix(3,3), w(3,3), &
                                                           R_tilt(3,3), F_sample(3,3), R_detector(3,3), strain_sample(3,3), &
-                                                          strain(3,3,numangles), rotation(3,3,numangles), minf(numangles), &
-                                                          shift_data(3,21,numangles), beta_sample(3,3), mea, sdev, fROI
-    real(kind=sgl),allocatable                          :: window(:,:), expt(:), expt_ref(:), pattern(:,:), pattern_test(:,:), &
-                                                        hpvals(:), lpvals(:), sumexpt(:), pcopy_ROI(:,:), q_shift(:,:), &
-                                                        ref_p(:,:), pcopy_ROI_test(:,:), interp_ngrid(:), ngrid(:), &
+                                                          beta_sample(3,3), xcfscale
+    real(kind=dbl),allocatable                          :: strain(:,:,:), rotation(:,:,:), minf(:), shift_data(:,:,:)
+    real(kind=sgl),allocatable                          :: window(:,:), expt(:), expt_ref(:), q_shift(:,:), &
+                                                        ref_p(:,:), interp_ngrid(:), ngrid(:), &
                                                         z_peak(:,:), test_p(:,:), r(:,:)
-    real(kind=dbl),allocatable                          :: XCF(:,:), ref_rotated(:,:)
-    integer(kind=irg),allocatable                       :: nrvals(:), pint(:,:), ppp(:,:), pint_test(:,:), XCFint(:,:), &
-                                                          roi_centre(:,:)
-    type(C_PTR)                                         :: planf, planb
+    real(kind=dbl),allocatable                          :: XCF(:,:), hpmask(:,:), lpmask(:,:)
+    integer(kind=irg),allocatable                       :: roi_centre(:,:), nlstatus(:)
+    type(C_PTR)                                         :: planf, planb, planr2c, planc2r
     real(kind=sgl),allocatable                          :: hpmask_shifted(:,:), lpmask_shifted(:,:)
-    complex(C_DOUBLE_COMPLEX),pointer                   :: inp(:,:), outp(:,:)
-    type(c_ptr), allocatable                            :: ip, op
+    complex(C_DOUBLE_COMPLEX),pointer                   :: inp(:,:), outp(:,:), xc(:,:,:)
+    real(C_DOUBLE),pointer                              :: xr(:,:,:)
+    complex(C_DOUBLE_COMPLEX),allocatable               :: refspec(:,:,:)
+    type(c_ptr)                                         :: ip, op, xrp, xcp
     type(HDFobjectStackType)                            :: HDF_head
-    real(kind=dbl),allocatable                          :: rrdata(:,:), ffdata(:,:), ksqarray(:,:)
-    real(kind=dbl),allocatable                          :: rrdata_test(:,:), ffdata_test(:,:)
     integer(kind=irg)                                   :: max_pos(2), size_interp
     ! declare variables for use in object oriented image module
     integer                                             :: iostat
@@ -159,9 +159,8 @@ program EMHREBSD
     
     ! size of region of interest
     ROI_size=2**enl%size_ROI
-    fROI = 1.D0/ROI_size**2
 
-    allocate(expt(patsz), expt_ref(patsz))
+    allocate(expt_ref(patsz))
     dims3 = (/ binx, biny, 1 /)
 
     ! open the file with reference experimental pattern
@@ -172,22 +171,14 @@ program EMHREBSD
         call FatalError("MasterSubroutine:", "Fatal error handling experimental pattern file")
     end if
   
-  ! and read the pattern (again)
+  ! and read the pattern (again); the file remains open for the test patterns
     offset = (/ 0, 0, enl%paty * enl%ipf_wd + enl%patx /)
   
     call getSingleExpPattern(enl%paty, enl%ipf_wd, patsz, L, dims3, offset, iunitexpt, enl%inputtype, enl%HDFstrings, expt_ref)
-    
-    ! and close the pattern file
-    call closeExpPatternFile(enl%inputtype, iunitexpt)
 
     dims2=(/ROI_size, ROI_size/)
 
-  ! use the center of the diffraction pattern to get ROI and turn it into a 2D pattern
-    allocate(pattern(dims2(1),dims2(2)), pattern_test(dims2(1),dims2(2)), XCF(2*dims2(1)-1,2*dims2(1)-1), stat=ierr)
-    allocate(test_p(biny, binx), ref_p(biny, binx), stat=ierr)
-    allocate(ref_rotated(biny, binx), stat=ierr)
-    allocate(pint(dims2(1),dims2(2)), pint_test(dims2(1),dims2(2)), ppp(dims2(1),dims2(2)), stat=ierr)
-    allocate(pcopy_ROI(dims2(1),dims2(2)), XCFint(2*dims2(1)+1,2*dims2(1)+1), stat=ierr)
+    allocate(ref_p(biny, binx), stat=ierr)
   
   ! turn the expt 1D array to 2D patterns
     do kk=1,biny
@@ -204,33 +195,13 @@ program EMHREBSD
     interp_grid = 4
   
     allocate(ngrid(interp_grid+1))
-    allocate(z_peak(interp_grid+1,interp_grid+1))
-    allocate(q_shift(3, enl%N_ROI), r(3,enl%N_ROI), roi_centre(enl%N_ROI, 2) )
+    allocate(r(3,enl%N_ROI), roi_centre(enl%N_ROI, 2) )
 
     ngrid =  (/ ((i-interp_grid/2-1.0), i=1,(interp_grid+1))/)
     interp_step= 0.01
     interp_size= interp_grid/interp_step+1;
     interp_ngrid =  (/ (-interp_grid/2+(i-1)*interp_step, i=1,interp_size)/)
   
-  
-    ! next we need to set up the high-pass filter fftw plans
-    allocate(hpmask_shifted(ROI_size, ROI_size), lpmask_shifted(ROI_size, ROI_size), stat=istat)  
-  
-    if (istat .ne. 0) stop 'could not allocate hpmask, inp, outp arrays'
-  
-    allocate(rrdata(ROI_size, ROI_size),ffdata(ROI_size, ROI_size),stat=istat)
-    if (istat .ne. 0) stop 'could not allocate rrdata, ffdata arrays'
-    
-    ! use the fftw_alloc routine to create the inp and outp arrays
-    ip = fftw_alloc_complex(int(ROI_size**2,C_SIZE_T))
-    call c_f_pointer(ip, inp, [ROI_size, ROI_size])
-    
-    op = fftw_alloc_complex(int(ROI_size**2,C_SIZE_T))
-    call c_f_pointer(op, outp, [ROI_size, ROI_size])
-    
-    inp = cmplx(0.D0,0D0)
-    outp = cmplx(0.D0,0.D0)
-  
     ! allocate the Hann windowing function array
     allocate(window(ROI_size,ROI_size))
     window=0.0
@@ -276,25 +247,89 @@ program EMHREBSD
       write(*,*) C(i, :)
     end do
 
+    ! rotation matrix to sample frame
+    R_tilt = eu2om((/0.D0, real(-enl%totaltilt*dtor,8), 0.D0/))
+
+    ! geometric factors for the pattern center refinement (this assumes that the tilt is perfect 70 degree)
+    cosang = cos(70.0*dtor)  ! cosd is an intel compiler extension
+    sinang = sin(70.0*dtor)  ! sind is an intel compiler extension
+
+    ! the cross-correlation functions of all ROIs of a pattern are computed with a single pair of 
+    ! batched real-to-complex/complex-to-real transforms; the ROIs are zero-padded to NP = 2*ROI_size,
+    ! which avoids wrap-around (the linear correlation has 2*ROI_size-1 points) and keeps the 
+    ! transform size a power of two.  Note that fftw expects the dimensions in row-major order.
+    NP = 2*ROI_size
+    nn = (/ NP, NP /)
+    inembed = (/ NP, NP /)
+    onembed = (/ NP, NP/2+1 /)
+    xcfscale = 1.D0/(dble(NP)**2 * dble(ROI_size)**2)
+
+    ! the spectra of the reference ROIs are the same for all patterns and are computed only once
+    allocate(refspec(NP/2+1, NP, enl%N_ROI))
+    allocate(strain(3,3,numangles), rotation(3,3,numangles), minf(numangles), shift_data(3,enl%N_ROI,numangles))
+    allocate(nlstatus(numangles))
+
+    call OMP_SET_NUM_THREADS(enl%nthreads)
+    io_int(1) = enl%nthreads
+    call WriteValue(' Number of threads used for cross-correlation : ', io_int, 1)
+
+!$OMP PARALLEL DEFAULT(SHARED) PRIVATE(TID, i, j, kk, offset3, expt, test_p, ave, std, ip, op, inp, outp, xrp, xcp, xr, xc, &
+!$OMP& planf, planb, planr2c, planc2r, hpmask_shifted, lpmask_shifted, hpmask, lpmask, XCF, max_pos, z_peak, q, q_shift, &
+!$OMP& Distance, R_x, R_y, Ftensor, R_detector, Smatrix, F_sample, R_sample, w, beta_sample, strain_sample)
+
+    TID = OMP_GET_THREAD_NUM()
+
+    ! per-thread work arrays, band pass filter masks and fftw buffers
+    allocate(expt(patsz), test_p(biny, binx), q_shift(3, enl%N_ROI), XCF(2*ROI_size-1,2*ROI_size-1), &
+             z_peak(interp_grid+1,interp_grid+1), hpmask_shifted(ROI_size, ROI_size), lpmask_shifted(ROI_size, ROI_size), &
+             hpmask(ROI_size, ROI_size), lpmask(ROI_size, ROI_size))
+
+    ! use the fftw_alloc routine to create the inp and outp arrays for the band pass filter
+    ip = fftw_alloc_complex(int(ROI_size**2,C_SIZE_T))
+    call c_f_pointer(ip, inp, [ROI_size, ROI_size])
+    
+    op = fftw_alloc_complex(int(ROI_size**2,C_SIZE_T))
+    call c_f_pointer(op, outp, [ROI_size, ROI_size])
+
+    ! and the batched arrays for the cross-correlation functions
+    xrp = fftw_alloc_real(int(NP*NP*enl%N_ROI,C_SIZE_T))
+    call c_f_pointer(xrp, xr, [NP, NP, enl%N_ROI])
+
+    xcp = fftw_alloc_complex(int((NP/2+1)*NP*enl%N_ROI,C_SIZE_T))
+    call c_f_pointer(xcp, xc, [NP/2+1, NP, enl%N_ROI])
+
+    ! the fftw planner is not thread-safe, so the plans are created one thread at a time;
+    ! FFTW_MEASURE overwrites the arrays, so this must be done before they are filled
+!$OMP CRITICAL (HREBSD_fftw)
+    inp = cmplx(0.D0,0D0)
+    outp = cmplx(0.D0,0.D0)
+    call init_BandPassFilter((/ROI_size, ROI_size/), enl%highpass, enl%lowpass, hpmask_shifted, &
+                             lpmask_shifted, inp, outp, planf, planb) 
+    planr2c = fftw_plan_many_dft_r2c(2, nn, enl%N_ROI, xr, inembed, 1, NP*NP, &
+                                     xc, onembed, 1, (NP/2+1)*NP, FFTW_MEASURE)
+    planc2r = fftw_plan_many_dft_c2r(2, nn, enl%N_ROI, xc, onembed, 1, (NP/2+1)*NP, &
+                                     xr, inembed, 1, NP*NP, FFTW_MEASURE)
+!$OMP END CRITICAL (HREBSD_fftw)
+    hpmask = dble(hpmask_shifted)
+    lpmask = dble(lpmask_shifted)
+
+    ! spectra of the filtered reference ROIs
+!$OMP SINGLE
+    call HREBSD_ROIbatch(enl, ref_p, biny, binx, roi_centre, ROI_size, NP, window, hpmask, lpmask, &
+                         inp, outp, planf, planb, .FALSE., xr)
+    call fftw_execute_dft_r2c(planr2c, xr, xc)
+    refspec = xc
+!$OMP END SINGLE
+
     ! loop through patterns
+!$OMP DO SCHEDULE(DYNAMIC)
     do j = 1, numangles  
-      write(*,*)
-      write(*,*) "Number of pattern = ", j
       ! position of the pattern to be used
       offset3 = (/ 0, 0, j-1 /)
-      
-      ! open the file with reference experimental pattern
-      istat = openExpPatternFile(enl%exptfile, enl%ipf_wd, L, enl%inputtype, recordsize, iunitexpt, enl%HDFstrings)
-    
-      if (istat.ne.0) then
-          call patternmod_errormessage(istat)
-          call FatalError("MasterSubroutine:", "Fatal error handling experimental pattern file")
-      end if
 
+!$OMP CRITICAL (HREBSD_read)
       call getSingleExpPattern(enl%paty, enl%ipf_wd, patsz, L, dims3, offset3, iunitexpt, enl%inputtype, enl%HDFstrings, expt)
-      
-      ! and close the pattern file
-      call closeExpPatternFile(enl%inputtype, iunitexpt)
+!$OMP END CRITICAL (HREBSD_read)
       
       ! test pattern (intensity normalization)
       do kk=1,biny
@@ -304,49 +339,20 @@ program EMHREBSD
       std=sqrt(sum((test_p-ave)**2)/size(test_p))
       test_p=(test_p-ave)/std
 
+      ! filtered and flipped test ROIs; the product of their spectra with the reference 
+      ! spectra is the Fourier transform of all the cross correlation functions
+      call HREBSD_ROIbatch(enl, test_p, biny, binx, roi_centre, ROI_size, NP, window, hpmask, lpmask, &
+                           inp, outp, planf, planb, .TRUE., xr)
+      call fftw_execute_dft_r2c(planr2c, xr, xc)
+      xc = xc * refspec
+      call fftw_execute_dft_c2r(planc2r, xc, xr)
+
       do i = 1, enl%N_ROI  ! loop through all the ROIs
 
-        ! region of interest of reference pattern
-        pcopy_ROI=ref_p(roi_centre(i,2)-ROI_size/2:roi_centre(i,2)+ROI_size/2-1,&
-        roi_centre(i,1)-ROI_size/2:roi_centre(i,1)+ROI_size/2-1)
-        
-        ! region of interest of test pattern
-        pcopy_ROI_test=test_p(roi_centre(i,2)-ROI_size/2:roi_centre(i,2)+ROI_size/2-1,&
-        roi_centre(i,1)-ROI_size/2:roi_centre(i,1)+ROI_size/2-1)
-        
-        ! initialize band pass fitlers (low pass and high pass)
-        call init_BandPassFilter((/ROI_size, ROI_size/), enl%highpass, enl%lowpass, hpmask_shifted, &
-        lpmask_shifted, inp, outp, planf, planb) 
-        
-        ! apply the windowing function on the reference ROI
-        pattern = window*pcopy_ROI
-        rrdata = dble(pattern)
-
-        ! apply the windowing function on the test ROI
-        pattern_test = window*pcopy_ROI_test
-        rrdata_test = dble(pattern_test)
-
-        ! apply the band pass fitlers on the reference ROI
-        ffdata = applyBandPassFilter(rrdata, (/ ROI_size, ROI_size/), dble(hpmask_shifted), &
-          dble(lpmask_shifted), inp, outp, planf, planb)
-    mea = sum(ffdata)*fROI
-    sdev = sqrt( sum( (ffdata-mea)**2)*fROI )
-    ffdata = (ffdata-mea) / sdev
-
-        ! apply the band pass fitlers on the test ROI
-        ffdata_test = applyBandPassFilter(rrdata_test, (/ ROI_size, ROI_size/), dble(hpmask_shifted), &
-        dble(lpmask_shifted), inp, outp, planf, planb)
-    mea = sum(ffdata_test)*fROI
-    sdev = sqrt( sum( (ffdata_test-mea)**2)*fROI )
-    ffdata_test = (ffdata_test-mea) / sdev
-
-        ! convert to single precision 
-        pattern = (sngl(ffdata))
-        pattern_test = (sngl(ffdata_test))
-
-        ! compute the cross correlation function in the Fourier space
-        call cross_correlation_function((/ ROI_size, ROI_size/), dble(pattern), dble(pattern_test), XCF, max_pos) 
-   write (*,*) i, maxval(XCF)       
+        ! cross correlation function and the location of its maximum
+        XCF = xr(1:2*ROI_size-1,1:2*ROI_size-1,i) * xcfscale
+        max_pos = maxloc(XCF)
+
         ! now crop out a small region around the peak of xcf
         z_peak=XCF(max_pos(1)-interp_grid/2:max_pos(1)+interp_grid/2,max_pos(2)-interp_grid/2:max_pos(2)+interp_grid/2)
       
@@ -355,7 +361,6 @@ program EMHREBSD
         
         ! we can then find the shift vectors associated with the ROI with subpixel accuracy
         q_shift(:,i) = (/-q(1), -q(2), 0.0/)
-write (*,*) i, q_shift(:,i)
         
         ! pattern center refinement (geometrically corrected, this assumes that the titlt is perfect 70 degree)
         ! reference: Britton et al, 2011, Ultramicroscopy
@@ -367,21 +372,14 @@ write (*,*) i, q_shift(:,i)
           R_x = roi_centre(i,1)
           R_y = enl%numsy-roi_centre(i,2)
           ! diffraction pattern shift
-          cosang = cos(70.0*dtor)  ! cosd is an intel compiler extension
-          sinang = sin(70.0*dtor)  ! sind is an intel compiler extension
           q_shift(2,i) = q_shift(2,i)-Distance(2)/(0.000001*enl%delta)*(sinang-(enl%numsy/2-R_y)*cosang/enl%PC(3))
           q_shift(1,i) = q_shift(1,i)-1/(0.000001*enl%delta)*(-Distance(1)+(enl%numsx/2-R_x)*Distance(2)*cosang/enl%PC(3))    
         end if
       end do
-
-      ! rotation matrix to sample frame
-      R_tilt = eu2om((/0.D0, real(-enl%totaltilt*dtor,8), 0.D0/))
-
-  write (*,*) 'R_tilt : ', R_tilt
    
       ! optimization routine
       call main_minf(enl%N_ROI, real(r,8), real(q_shift,8), Euler_Angle(:,j), real(C,8), &
-      Ftensor, minf(j), reshape(R_tilt,(/9/)))
+      Ftensor, minf(j), reshape(R_tilt,(/9/)), nlstatus(j))
 
       ! polar decomposition of the deformation tensor
       call getPolarDecomposition(reshape(Ftensor,(/3,3/)), R_detector, Smatrix)
@@ -396,8 +394,6 @@ write (*,*) i, q_shift(:,i)
       w = 0.D0
       call Rot2LatRot(R_sample, w)
 
-      write (*,*) 'Rot2LatRot : ', w
-
       ! distortion tensor
       beta_sample = F_sample-reshape((/1.D0,0.D0,0.D0,0.D0,1.D0,0.D0,0.D0,0.D0,1.D0/),(/3,3/))
       strain_sample = 0.5*(transpose(beta_sample)+beta_sample)
@@ -408,23 +404,55 @@ write (*,*) i, q_shift(:,i)
       shift_data(:,:,j) = q_shift
       
       ! print rotation and strain tensor 
+!$OMP CRITICAL (HREBSD_print)
+      write(*,*)
+      write(*,*) "Number of pattern = ", j
+      write(*,*)
+      if (nlstatus(j).lt.0) then
+        write(*,*) 'nlopt failed with status ', nlstatus(j), '; this pattern is flagged in nloptStatus'
+      else
+        write(*,*) 'found min at x = ', Ftensor
+        write(*,*) 'min |f(x)| = ', minf(j)
+      end if
       write(*,*)
       write(*,*) 'Lattice Rotation Matrix (w) = '
-      do i = 1, ubound(w, 1)
-        write(*,*) w(i, :)
+      do kk = 1, ubound(w, 1)
+        write(*,*) w(kk, :)
       end do
       write(*,*)
       write(*,*) 'Strain Tensor (e) = '
-      do i = 1, ubound(strain_sample, 1)
-        write(*,*) strain_sample(i, :)
+      do kk = 1, ubound(strain_sample, 1)
+        write(*,*) strain_sample(kk, :)
       end do
+!$OMP END CRITICAL (HREBSD_print)
       
       ! if (enl%Remap.eq.'y') then
       !   call fRemapbicubic(binx, biny, R_detector, real(enl%PC,8), real(ref_p,8), ref_rotated)
       ! end if
 
-      
     end do
+!$OMP END DO
+
+!$OMP CRITICAL (HREBSD_fftw)
+    call fftw_destroy_plan(planf)
+    call fftw_destroy_plan(planb)
+    call fftw_destroy_plan(planr2c)
+    call fftw_destroy_plan(planc2r)
+!$OMP END CRITICAL (HREBSD_fftw)
+    call fftw_free(ip)
+    call fftw_free(op)
+    call fftw_free(xrp)
+    call fftw_free(xcp)
+    deallocate(expt, test_p, q_shift, XCF, z_peak, hpmask_shifted, lpmask_shifted, hpmask, lpmask)
+!$OMP END PARALLEL
+
+    ! and close the pattern file
+    call closeExpPatternFile(enl%inputtype, iunitexpt)
+
+    if (any(nlstatus.lt.0)) then
+      io_int(1) = count(nlstatus.lt.0)
+      call WriteValue(' Number of patterns for which nlopt failed (negative nloptStatus) : ', io_int, 1)
+    end if
 
     ! save output data
     tstop = Time_tock(tickstart) 
@@ -459,7 +487,7 @@ write (*,*) i, q_shift(:,i)
     if (hdferr.ne.0) call HDF_handleError(hdferr,'HDF_writeDatasetArray2D euler angles data')
 
     dataset = 'Shift'
-    hdferr = HDF_writeDatasetFloatArray3D(dataset, sngl(shift_data), 3, 21, numangles, HDF_head) 
+    hdferr = HDF_writeDatasetFloatArray3D(dataset, sngl(shift_data), 3, enl%N_ROI, numangles, HDF_head) 
     if (hdferr.ne.0) call HDF_handleError(hdferr,'HDF_writeDatasetArray3D pattern shift data')
 
     dataset = 'Strain'
@@ -482,6 +510,10 @@ write (*,*) i, q_shift(:,i)
     hdferr = HDF_writeDatasetFloatArray1D(dataset, sngl(minf), numangles, HDF_head) 
     if (hdferr.ne.0) call HDF_handleError(hdferr,'HDF_writeDatasetArray1D minf')
 
+    dataset = 'nloptStatus'
+    hdferr = HDF_writeDatasetIntegerArray1D(dataset, nlstatus, numangles, HDF_head) 
+    if (hdferr.ne.0) call HDF_handleError(hdferr,'HDF_writeDatasetIntegerArray1D nloptStatus')
+
     dataset = 'PixelSize'
     hdferr = HDF_writeDatasetFloat(dataset, enl%delta, HDF_head) 
     if (hdferr.ne.0) call HDF_handleError(hdferr,'HDF_writeDatasetFloat PixelSize')
@@ -496,98 +528,71 @@ write (*,*) i, q_shift(:,i)
 
     call HDF_pop(HDF_head)
     call h5close_EMsoft(hdferr)
-    call fftw_free(ip)
-    call fftw_free(op)
     call fftw_cleanup()
+
+  contains
+
+    subroutine HREBSD_ROIbatch(enl, p, biny, binx, roi_centre, ROI_size, NP, window, hpmask, lpmask, &
+                               inp, outp, planf, planb, flip, xr)
+    ! this routine prepares all the ROIs of a pattern for a batched cross-correlation
+    ! INPUT
+    ! p(biny,binx): intensity normalized pattern
+    ! roi_centre(N_ROI,2): ROI coordinates
+    ! window, hpmask, lpmask: Hann window and band pass filter masks (ROI_size x ROI_size)
+    ! inp, outp, planf, planb: band pass filter arrays and plans from init_BandPassFilter
+    ! flip: flip the ROIs (test pattern) or not (reference pattern)
+    ! OUTPUT
+    ! xr(NP,NP,N_ROI): windowed, filtered and normalized ROIs, zero-padded to NP x NP
+    use local
+    use filters
+    use NameListTypedefs
+    use FFTW3mod
+
+    IMPLICIT NONE
+
+    type(HREBSDNameListType),intent(in)                         :: enl
+    integer(kind=irg),intent(in)                                :: biny, binx, ROI_size, NP, roi_centre(enl%N_ROI,2)
+    real(kind=sgl),intent(in)                                   :: p(biny,binx), window(ROI_size,ROI_size)
+    real(kind=dbl),intent(in)                                   :: hpmask(ROI_size,ROI_size), lpmask(ROI_size,ROI_size)
+    complex(C_DOUBLE_COMPLEX),pointer,intent(inout)             :: inp(:,:), outp(:,:)
+    type(C_PTR),intent(in)                                      :: planf, planb
+    logical,intent(in)                                          :: flip
+    real(C_DOUBLE),intent(inout)                                :: xr(NP,NP,enl%N_ROI)
+    real(kind=dbl), allocatable                                 :: rrdata(:,:), ffdata(:,:)
+    real(kind=dbl)                                              :: mea, sdev, fROI
+    integer(kind=irg)                                           :: i, x0, y0
+
+    allocate(rrdata(ROI_size,ROI_size), ffdata(ROI_size,ROI_size))
+    fROI = 1.D0/ROI_size**2
+    xr = 0.D0
+
+    do i = 1, enl%N_ROI
+      y0 = roi_centre(i,2)-ROI_size/2
+      x0 = roi_centre(i,1)-ROI_size/2
+
+      ! apply the windowing function on the ROI
+      rrdata = dble(window*p(y0:y0+ROI_size-1,x0:x0+ROI_size-1))
+
+      ! apply the band pass filters and normalize
+      ffdata = applyBandPassFilter(rrdata, (/ ROI_size, ROI_size/), hpmask, lpmask, inp, outp, planf, planb)
+      mea = sum(ffdata)*fROI
+      sdev = sqrt( sum( (ffdata-mea)**2)*fROI )
+      ffdata = (ffdata-mea) / sdev
+
+      ! zero-padded copy; the product of the spectra of a and the flipped b is the cross-correlation of a and b
+      if (flip.eqv..TRUE.) then
+        xr(1:ROI_size,1:ROI_size,i) = ffdata(ROI_size:1:-1,ROI_size:1:-1)
+      else
+        xr(1:ROI_size,1:ROI_size,i) = ffdata
+      end if
+    end do
+
+    deallocate(rrdata, ffdata)
+    end subroutine
+
   end subroutine
   
   
-  subroutine cross_correlation_function(dims,a,b,c,max_pos) 
-  ! this routine assumes that a and b have the same input dimension
-  ! INPUT
-  ! dims: dimension of the array to be cross-correlated 
-  ! a(dims): reference image array
-  ! b(dims): test image  array  
-  ! OUTPUT
-  ! c(2*dims-1): cross-correlation function of a and b
-  ! max_pos(2): location of the maximum value in the cross-correlation function
-  use local   
-  use FFTW3mod
-  
-  IMPLICIT NONE
-  
-  integer(kind=irg),intent(in)                                :: dims(2)
-  real(kind=dbl),intent(in)                                   :: a(dims(1),dims(2)), b(dims(1),dims(2))
-  real(kind=dbl),intent(out)                                  :: c(2*dims(1)-1,2*dims(1)-1)
-  integer(kind=irg),intent(out)                               :: max_pos(2)
-  type(C_PTR)                                                 :: plan, cplan
-  complex(C_DOUBLE_COMPLEX),pointer                           :: inp(:,:), outp(:,:)
-  type(c_ptr), allocatable                                    :: ip, op
-  complex(C_DOUBLE_COMPLEX), allocatable                      :: ffta(:,:), fftb(:,:), fftc(:,:)
-  integer(kind=irg)                                           :: cdims(2), i, j
-  real(kind=dbl), allocatable                                 :: apad(:,:), bpad(:,:) 
-  
-  ! matrix dimensions
-  cdims=2*dims-1
-  
-  ! allocate arrays for cross-correlation in Fourier space
-  allocate(apad(cdims(1),cdims(2)),bpad(cdims(1),cdims(2)))
-  apad = 0.D0
-  bpad = 0.D0
-  apad(1:dims(1),1:dims(2)) = a
-  bpad(1:dims(1),1:dims(2)) = b(dims(1):1:-1,dims(2):1:-1)
-  
-  ! set up the fftw
-  ip = fftw_alloc_complex(int(cdims(1)*cdims(2),C_SIZE_T))
-  call c_f_pointer(ip, inp, [cdims(1),cdims(2)])
-  
-  op = fftw_alloc_complex(int(cdims(1)*cdims(2),C_SIZE_T))
-  call c_f_pointer(op, outp, [cdims(1),cdims(2)])
-  
-  allocate(ffta(dims(1),dims(2)),fftb(dims(1),dims(2)),fftc(cdims(1),cdims(2)))
-  
-  inp = cmplx(0.D0,0D0)
-  outp = cmplx(0.D0,0.D0)
-  ! create plan for forward Fourier transform
-  plan = fftw_plan_dft_2d(cdims(1),cdims(2), inp, outp, FFTW_FORWARD, FFTW_ESTIMATE)
-  do j=1,cdims(1)
-      do i=1, cdims(2)
-       inp(j,i) = cmplx(apad(j,i),0.D0)    
-      end do
-  end do
-  
-  ! compute the Forward Fourier transform of a
-  call fftw_execute_dft(plan, inp, outp)
-  ffta=outp
-  
-  ! compute the Forward Fourier transform of b
-  inp = cmplx(0.D0,0D0)
-  outp = cmplx(0.D0,0.D0)
-  do j=1,cdims(1)
-      do i=1, cdims(2)
-       inp(j,i) = cmplx(bpad(j,i),0.D0)    
-      end do
-  end do
-  call fftw_execute_dft(plan, inp, outp)
-  fftb=outp
-  
-  ! compute the inverse Fourier transform of invF(F(a)*F(b))
-  fftc = ffta*fftb
-  inp = cmplx(0.D0,0D0)
-  outp = cmplx(0.D0,0.D0)
-  
-  cplan = fftw_plan_dft_2d(cdims(1),cdims(2), inp, outp, FFTW_BACKWARD, FFTW_ESTIMATE)
-  
-  call fftw_execute_dft(cplan, fftc, outp)
-  c=real(outp)/real(product(cdims))/real(product(dims))
-  max_pos=maxloc(c)
-  
-  deallocate(ffta, fftb, fftc, apad, bpad)
-  call fftw_free(ip)
-  call fftw_free(op)
-  call fftw_cleanup()
-  end subroutine
-  
   subroutine peak_interpolation(max_pos, z, z_size, interp_step, interp_size, ngrid, size_interp, interp_ngrid, q)
     use local 
     use Grid_Interpolation
@@ -598,21 +603,15 @@ write (*,*) i, q_shift(:,i)
     real(kind=sgl),intent(in)    :: ngrid(interp_size), interp_step
     real(kind=sgl),intent(inout) :: interp_ngrid(size_interp), z(interp_size,interp_size)                       
     real(kind=sgl),intent(out)   :: q(2)
-    integer(kind=irg)            :: md, ixi, iyi, ier, max_pos_interp(2), interp_half
-    real(kind=sgl)               :: zi(size_interp,size_interp)
+    integer(kind=irg)            :: ier, max_pos_interp(2), interp_half
+    real(kind=sgl),allocatable   :: zi(:,:)
   
-    do  iyi = 1, size_interp
-      do  ixi = 1, size_interp
-        if (ixi == 1.AND.iyi == 1) then
-          md = 1
-        else
-          md = 2
-        end if
-        ! Rectangular-grid bivariate interpolation
-        call rgbi3p(md, interp_size, interp_size, ngrid, ngrid, z, 1, interp_ngrid(ixi), interp_ngrid(iyi), zi(ixi,iyi), ier)
-        if (ier > 0) stop
-      end do
-    end do
+    allocate(zi(size_interp,size_interp))
+
+    ! Rectangular-grid bivariate interpolation on the entire fine grid in a single call, so that 
+    ! the partial derivatives are estimated only once and no state is kept between calls
+    call rgsf3p(1, interp_size, interp_size, ngrid, ngrid, z, size_interp, interp_ngrid, size_interp, interp_ngrid, zi, ier)
+    if (ier > 0) stop
     ! location of the maximum value on the interpolated surface
     max_pos_interp = maxloc(zi)
   
@@ -656,11 +655,14 @@ write (*,*) i, q_shift(:,i)
   end subroutine
 
   ! the main subroutine for computing the bouned constrained optimization
-  subroutine main_minf(N, r, q, Euler_Angle, C_c, Ftensor, minf, R_tilt)
+  ! this routine is called from within an OpenMP parallel region, so it does not write anything;
+  ! the nlopt result code is returned in status (negative: failed)
+  subroutine main_minf(N, r, q, Euler_Angle, C_c, Ftensor, minf, R_tilt, status)
     use local
     use math
     implicit NONE
     real(kind=dbl), INTENT(out)   :: Ftensor(9), minf
+    integer(kind=irg), INTENT(out) :: status
     integer(kind=irg), INTENT(in) :: N
     real(kind=dbl), INTENT(in)  :: r(3, N), q(3, N), Euler_Angle(3), C_c(6,6), R_tilt(9)
     external myfunc, myconstraint
@@ -748,14 +750,7 @@ write (*,*) i, q_shift(:,i)
     call nlo_optimize(ires, opt, x, minf)
      
     Ftensor = x
-    if (ires.lt.0) then
-      write(*,*) 'nlopt failed!'
-      stop 1
-    else
-
-      write(*,*) 'found min at x = ', x
-      write(*,*) 'min |f(x)| = ', minf
-    endif
+    status = ires
   
     call nlo_destroy(opt)
   
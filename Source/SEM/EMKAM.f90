@@ -70,11 +70,12 @@ IMPLICIT NONE
 character(fnlen)                        :: nmldeffile, progname, progdesc
 type(KAMNameListType)                   :: enl
 type(EBSDIndexingNameListType)          :: ebsdnl
-type(EBSDDIdataType)                    :: EBSDDIdata
+type(EBSDDotProductFileType)            :: DPF
 
 logical                                 :: stat, readonly, noindex
 integer(kind=irg)                       :: hdferr, nlines, FZcnt, Nexp, nnm, nnk, Pmdims, i, j, k, olabel, Nd, Ne, ipar(10), &
-                                           ipar2(6), pgnum, ipat, ipf_wd, ipf_ht, idims2(2), io_int(2)
+                                           ipar2(6), pgnum, ipat, ipf_wd, ipf_ht, idims2(2), io_int(2), row1, nrows, &
+                                           npb, nband, nav
 character(fnlen)                        :: groupname, dataset, dpfile, energyfile, masterfile, efile, fname, image_filename
 integer(HSIZE_T)                        :: dims2(2)
 type(dicttype)                          :: dict
@@ -114,73 +115,61 @@ call GetKAMNameList(nmldeffile,enl)
 !====================================
 ! read the relevant fields from the dot product HDF5 file
 
-! open the fortran HDF interface
+! open the fortran HDF interface and the dot product file
 call h5open_EMsoft(hdferr)
 
-call readEBSDDotProductFile(enl%dotproductfile, ebsdnl, hdferr, EBSDDIdata, &
-                            getEulerAngles=.TRUE., &
-                            getTopDotProductList=.TRUE., &
-                            getTopMatchIndices=.TRUE.) 
-
-write (*,*) 'completed reading data file '
-
-Nexp = EBSDDIdata%Nexp
-FZcnt = EBSDDIdata%FZcnt
-dims2(1) = ebsdnl%nnk
-allocate(Eulervals(3,FZcnt))
-do i=1,FZcnt
-  Eulervals(1:3,i) = EBSDDIdata%EulerAngles(1:3,i)
-end do
-deallocate(EBSDDIdata%EulerAngles)
-Eulervals = Eulervals * sngl(cPi)/180.0
-
-allocate(dplist(dims2(1),Nexp))
-do i=1,Nexp
-  dplist(1:dims2(1),i) = EBSDDIdata%TopDotProductList(1:dims2(1),i)
-end do
-deallocate(EBSDDIdata%TopDotProductList)
-nnm = dims2(1)
-
-allocate(tmi(nnm,Nexp))
-do i=1,Nexp
-  tmi(1:nnm,i) = EBSDDIdata%TopMatchIndices(1:nnm,i)
-end do
-deallocate(EBSDDIdata%TopMatchIndices)
-
-! and next we compute the KAM map (kam)
-allocate(kam(ebsdnl%ipf_wd,ebsdnl%ipf_ht),eulers(3,Nexp))
+call openEBSDDotProductFile(enl%dotproductfile, ebsdnl, DPF, hdferr)
+
+ipf_wd = DPF%wd
+ipf_ht = DPF%ht
+Nexp = ipf_wd*ipf_ht
+FZcnt = DPF%FZcnt
+allocate(kam(ipf_wd,ipf_ht),eulers(3,Nexp))
 
 ! do we need to do an orientation average first ?
 if (enl%orav.ne.0) then
-  ipar2(1) = EBSDDIdata%pgnum
-  ipar2(2) = FZcnt
-  ipar2(3) = Nexp
-  ipar2(4) = ebsdnl%nnk
-  ipar2(5) = Nexp*ceiling(float(ipf_wd*ipf_ht)/float(Nexp))
-  ! to average we need at least two values so check the value of orav
-  if (enl%orav.eq.1) then
-    ipar2(6) = 2
-  else
-    ipar2(6) = enl%orav
-  end if 
+! to average we need at least two values so check the value of orav
+  nav = min(max(2, enl%orav), DPF%nnk)
+
+! the averages are taken over the dictionary orientations of the top matches (in degrees in the file)
+  dataset = SC_DictionaryEulerAngles
+  call HDF_readDatasetFloatArray2D(dataset, dims2, DPF%HDF_head, hdferr, Eulervals)
+  Eulervals = Eulervals * sngl(cPi)/180.0
+
+! only the first nav top matches and dot products are needed; read them in bands of rows
   call Message('Computing orientation averages ... ')
-  call EBSDgetAverageOrientations(ipar2, Eulervals, tmi, dplist, eulers)
-  eulers = eulers*sngl(cPi)/180.0
-else
-  do i=1,Nexp
-    eulers(1:3,i) = Eulervals(1:3,tmi(1,i))
+  nband = max(262144/ipf_wd, 1)
+  dataset = SC_TopDotProductList
+  do row1=1,ipf_ht,nband
+    nrows = min(nband, ipf_ht-row1+1)
+    npb = nrows*ipf_wd
+    tmi = readEBSDDotProductTopMatches(DPF, row1, nrows, nav)
+    dplist = readEBSDDotProductRows2D(DPF, dataset, nav, row1, nrows)
+    ipar2 = (/ DPF%pgnum, FZcnt, npb, nav, npb, nav /)
+    allocate(avEuler(3,npb))
+    call EBSDgetAverageOrientations(ipar2, Eulervals, tmi, dplist, avEuler)
+    eulers(1:3,(row1-1)*ipf_wd+1:(row1-1)*ipf_wd+npb) = avEuler*sngl(cPi)/180.0
+    deallocate(tmi, dplist, avEuler)
   end do
+  deallocate(Eulervals)
+else
+! the EulerAngles data set holds the best match for each pattern (in radians)
+  dataset = SC_EulerAngles
+  eulers = readEBSDDotProductRows2D(DPF, dataset, 3, 1, ipf_ht)
 end if
 
+call closeEBSDDotProductFile(DPF)
+call h5close_EMsoft(hdferr)
+
 ! compute the Kernel Average Misorientation map
 dict%Num_of_init = 3
 dict%Num_of_iterations = 30
-dict%pgnum = EBSDDIdata%pgnum
+dict%pgnum = DPF%pgnum
 call DI_Init(dict,'nil') 
 
 call Message('Computing KAM map... ')
 call Message('')
-call EBSDgetKAMMap(Nexp, eulers, ebsdnl%ipf_wd, ebsdnl%ipf_ht, dict, kam)
+call EBSDgetKAMMap(Nexp, eulers, ipf_wd, ipf_ht, dict, kam, enl%nbtype, enl%radius)
 kam = kam*180.0/sngl(cPi)
 
 where (kam.gt.enl%kamcutoff) kam = enl%kamcutoff
@@ -194,11 +183,11 @@ image_filename = trim(EMsoft_getEMdatapathname())//trim(enl%kamtiff)
 image_filename = EMsoft_toNativePath(image_filename)
 
 ! allocate memory for image
-allocate(TIFF_image(ebsdnl%ipf_wd,ebsdnl%ipf_ht))
+allocate(TIFF_image(ipf_wd,ipf_ht))
 
 ! fill the image with whatever data you have (between 0 and 255)
- do i=1,ebsdnl%ipf_wd
-  do j=1,ebsdnl%ipf_ht
+ do i=1,ipf_wd
+  do j=1,ipf_ht
    TIFF_image(i,j) = kam(i,j)
   end do
  end do
@@ -174,6 +174,7 @@ type(unitcell)                  :: cell
 type(DynType),save              :: Dyn
 type(gnode),save                :: rlp
 type(reflisttype),pointer       :: reflist,firstw, rltmp
+type(ReflectionTableType)       :: reftab
 type(BetheParameterType)        :: BetheParameters
 type(kvectorlist),pointer       :: khead, ktmp
 real(kind=sgl),allocatable      :: karray(:,:)
@@ -447,39 +448,41 @@ call Message('Starting computation', frm = "(/A)")
 
 ! use OpenMP to run on multiple cores ... 
 !$OMP PARALLEL COPYIN(rlp) &
-!$OMP& PRIVATE(DynMat,ik,FN,TID,kn,ipx,ipy,ix,iequiv,nequiv,reflist,firstw) &
-!$OMP& PRIVATE(kkk,nns,nnw,nref,io_int,Iz)
+!$OMP& PRIVATE(DynMat,ik,FN,TID,kn,ipx,ipy,ix,iequiv,nequiv,reftab) &
+!$OMP& PRIVATE(kkk,nns,nnw,nref,io_int,Iz) REDUCTION(+:totstrong,totweak)
 
   NUMTHREADS = OMP_GET_NUM_THREADS()
   TID = OMP_GET_THREAD_NUM()
 
+! per-thread contiguous reflection table; the candidate reflections inside the dmin sphere are
+! the same for all beam directions, so only the excitation errors are recomputed in the loop
+  call Initialize_ReflectionTable(cell, reftab, kmnl%dmin)
+
 !$OMP DO SCHEDULE(DYNAMIC,100)    
 ! ---------- and here we start the beam direction loop
    beamloop:do ik = 1,numk
 
 !=============================================
 ! ---------- create the master reflection list for this beam direction
-! Then we must determine the masterlist of reflections (also a linked list);
+! Then we must determine the masterlist of reflections (stored in the reflection table);
 ! This list basically samples a large reciprocal space volume; it does not 
 ! distinguish between zero and higher order Laue zones, since that 
 ! distinction becomes meaningless when we consider the complete 
 ! reciprocal lattice.  
-     nullify(reflist)
      kkk = karray(1:3,ik)
      FN = kkk
-     call Initialize_ReflectionList(cell, reflist, BetheParameters, FN, kkk, kmnl%dmin, nref, verbose)
+     call Update_ReflectionTable(cell, reftab, BetheParameters, FN, kkk, nref)
 ! ---------- end of "create the master reflection list"
 !=============================================
 
 ! determine strong and weak reflections
-     nullify(firstw)
      nns = 0
      nnw = 0
-     call Apply_BethePotentials(cell, reflist, firstw, BetheParameters, nref, nns, nnw)
+     call Apply_BethePotentialsTable(cell, reftab, BetheParameters, nns, nnw)
 
 ! generate the dynamical matrix
      allocate(DynMat(nns,nns))
-     call GetDynMat(cell, reflist, firstw, rlp, DynMat, nns, nnw)
+     call GetDynMatTable(cell, reftab, rlp, DynMat, nns, nnw)
      totstrong = totstrong + nns
      totweak = totweak + nnw
 
@@ -497,7 +500,6 @@ call Message('Starting computation', frm = "(/A)")
      ipy = kij(2,ik)
      ipz = kij(3,ik)
 !
-!$OMP CRITICAL
      if (usehex) then 
        call Apply3DPGSymmetry(cell,ipx,ipy,ipz,kmnl%npx,iequiv,nequiv,usehex)
      else
@@ -507,6 +509,8 @@ call Message('Starting computation', frm = "(/A)")
          call Apply3DPGSymmetry(cell,ipx,ipy,ipz,kmnl%npx,iequiv,nequiv)
        end if
      end if
+! Apply3DPGSymmetry is thread safe and the equivalent pixel sets of distinct beam directions are
+! disjoint, so the scatter into the master arrays does not need a critical section
      if (kmnl%Kosselmode.eq.'normal') then
       do ix=1,nequiv
        if (iequiv(3,ix).eq.-1) mLPSH(iequiv(1,ix),iequiv(2,ix),1:numthick) = Iz(1:numthick)
@@ -517,17 +521,16 @@ call Message('Starting computation', frm = "(/A)")
         trange(iequiv(1,ix),iequiv(2,ix)) = Iz(1)
       end do
      end if
-!$OMP END CRITICAL
      
      if (mod(ik,5000).eq.0) then
        io_int(1) = ik
        call WriteValue('  completed beam direction ',io_int, 1, "(I8)")
      end if
 
-     call Delete_gvectorlist(reflist)
-
     end do beamloop
 
+  call Delete_ReflectionTable(reftab)
+
 ! end of OpenMP portion
 !$OMP END PARALLEL
 
@@ -150,6 +150,10 @@ integer(kind=irg)       :: numzbins     ! number of depth bins
 integer(kind=irg)       :: nel          ! number of electrons per thread
 integer(kind=irg)       :: NUMTHREADS   ! number of allocated threads
 integer,parameter       :: k12 = selected_int_kind(15)
+integer(kind=k12),parameter :: chunk = 100000  ! number of electrons per work unit in the 'electron' rngmode
+integer(kind=k12)       :: totel, el0, elrange(2) ! electron count, first electron id and range for one work unit
+integer(kind=irg)       :: ich, nchunks
+logical                 :: counter      ! .TRUE. for per-electron counter-based random number streams
 real(kind=dbl)          :: Ze           ! average atomic number
 real(kind=dbl)          :: density      ! density in g/cm^3
 real(kind=dbl)          :: at_wt        ! average atomic weight in g/mole
@@ -162,6 +166,7 @@ real(kind=sgl)          :: dens, avA, avZ, io_real(3), dmin ! used with CalcDens
 
 ! variables used for parallel random number generator (based on http://http://jblevins.org/log/openmp)
 type(rng_t), allocatable :: rngs(:)
+type(rng_block_t)        :: rngb
 
 ! various allocatable arrays, energy histogram is first index, x,y on scintillator 2nd and 3rd indices
 integer(kind=irg),allocatable   :: accum_e(:,:,:), acc_e(:,:,:), accum_z(:,:,:,:), acc_z(:,:,:,:)
@@ -205,12 +210,30 @@ character(100)                    :: c
 ! allocate the accumulator arrays for number of electrons and energy
  numEbins =  int((mcnl%EkeV-mcnl%Ehistmin)/mcnl%Ebinsize)+1
  numzbins =  int(mcnl%depthmax/mcnl%depthstep)+1
- mcnl%totnum_el = mcnl%num_el * mcnl%nthreads
  mcnl%mode = 'full'
  nx = (mcnl%numsx-1)/2
  allocate(accum_e(numEbins,-nx:nx,-nx:nx),accum_z(numEbins,numzbins,-nx/10:nx/10,-nx/10:nx/10),stat=istat)
+ accum_e = 0
+ accum_z = 0
  allocate(rngs(mcnl%nthreads),stat=istat)
 
+! with rngmode = 'electron', every electron has its own counter-based random number stream, identified
+! by its global number; this run then covers batches firstbatch .. firstbatch+nbatches-1 of num_el electrons 
+! each, independent of the number of threads, and runs over different batches can be added together.
+! Otherwise, each thread simulates num_el electrons with its own random number stream.
+ counter = (trim(mcnl%rngmode).eq.'electron')
+ if (counter.eqv..TRUE.) then
+   if ((mcnl%firstbatch.lt.1).or.(mcnl%nbatches.lt.1)) then
+     call FatalError('DoMCsimulation','firstbatch and nbatches must be positive')
+   end if
+   mcnl%totnum_el = mcnl%num_el
+   totel = int(mcnl%num_el,kind=k12) * int(mcnl%nbatches,kind=k12)
+   el0 = int(mcnl%firstbatch-1,kind=k12) * int(mcnl%num_el,kind=k12)
+   nchunks = int((totel + chunk - 1_k12) / chunk)
+ else
+   mcnl%totnum_el = mcnl%num_el * mcnl%nthreads
+ end if
+
 ! now put most of these variables in an array to be passed to the single_run subroutine
  varpas = (/ dble(mcnl%sig), dble(mcnl%numsx), dble(numsy), dble(mcnl%num_el), mcnl%EkeV, &
            Ze, density, at_wt, mcnl%Ehistmin, mcnl%Ebinsize, mcnl%depthmax, mcnl%depthstep, dble(mcnl%omega)/)
@@ -222,8 +245,8 @@ character(100)                    :: c
 
 ! use OpenMP to run on multiple cores ... 
  nel = mcnl%num_el
-!$OMP PARALLEL  PRIVATE(i,TID,acc_e,acc_z,istat) &
-!$OMP& SHARED(NUMTHREADS,varpas,accum_e,accum_z,nel,numEbins,numzbins)
+!$OMP PARALLEL  PRIVATE(i,TID,acc_e,acc_z,istat,rngb,ich,elrange,io_int) &
+!$OMP& SHARED(NUMTHREADS,varpas,accum_e,accum_z,nel,numEbins,numzbins,counter,totel,el0,nchunks)
 
  NUMTHREADS = OMP_GET_NUM_THREADS()
  TID = OMP_GET_THREAD_NUM()
@@ -232,6 +255,30 @@ character(100)                    :: c
 
 ! allocate memory for the accumulator arrays in each thread
  allocate(acc_e(numEbins,-nx:nx,-nx:nx),acc_z(numEbins,numzbins,-nx/10:nx/10,-nx/10:nx/10),stat=istat)
+ acc_e = 0
+ acc_z = 0
+
+ if (counter.eqv..TRUE.) then
+! the electrons are handed out in work units; since each electron's trajectory only depends on its
+! number, the scheduling has no effect on the result
+!$OMP DO SCHEDULE(DYNAMIC,1)    
+  do ich=1,nchunks
+   elrange(1) = el0 + int(ich-1,kind=k12) * chunk
+   elrange(2) = min(chunk, totel - int(ich-1,kind=k12) * chunk)
+   if (mcnl%blocksize.gt.0) then
+     call block_run(varpas,rngb,acc_e,acc_z,nx,numEbins,numzbins,mcnl%blocksize,elrange,mcnl%primeseed)
+   else
+     call single_run(varpas,rngs(1),acc_e,acc_z,nx,numEbins,numzbins,elrange,mcnl%primeseed)
+   end if
+   if ((TID.eq.0).and.(mod(ich,10).eq.0)) then
+     io_int(1) = ich
+     call WriteValue(' Started work unit # ',io_int, 1, "(I10)",advance="no")
+     io_int(1) = nchunks
+     call WriteValue(' of ',io_int, 1, "(I10)")
+   end if
+  end do
+!$OMP END DO
+ else
 
 ! each thread gets to execute the entire single_run function just once
 !$OMP DO SCHEDULE(STATIC,1)    
@@ -240,18 +287,24 @@ character(100)                    :: c
 ! get a unique seed for this thread  (take the primeseed and add the thread ID)
   call rng_seed(rngs(i), mcnl%primeseed + i)
 
-! do the Monte Carlo run  
-  call single_run(varpas,rngs(i),acc_e,acc_z,nx,numEbins,numzbins)
+! do the Monte Carlo run, either one electron at a time or with blocks of electrons in lockstep
+  if (mcnl%blocksize.gt.0) then
+    call rng_block_seed(rngb, mcnl%primeseed + i, mcnl%blocksize)
+    call block_run(varpas,rngb,acc_e,acc_z,nx,numEbins,numzbins,mcnl%blocksize)
+  else
+    call single_run(varpas,rngs(i),acc_e,acc_z,nx,numEbins,numzbins)
+  end if
+ end do
+!$OMP END DO
+ end if
 
-! make sure that only one thread copies its contents into the main accumulator arrays at any given time
+! make sure that only one thread copies its contents into the main accumulator arrays at any given time;
+! these are integer counts, so the order in which the threads do this does not affect the result
 !$OMP CRITICAL
   accum_e = accum_e + acc_e
   accum_z = accum_z + acc_z
 !$OMP END CRITICAL  
 
- end do
-!$OMP END DO
-
 !$OMP END PARALLEL
 
 ! output in .h5 format.
@@ -309,12 +362,16 @@ hdferr = HDF_createGroup(datagroupname, HDF_head)
 dataset = SC_numzbins
 hdferr = HDF_writeDatasetInteger(dataset, numzbins, HDF_head)
 
-! modified using multiplier
+! modified using multiplier; in the 'electron' rngmode the number of batches is the multiplier
 dataset = SC_totnumel
-hdferr = HDF_writeDatasetInteger(dataset, mcnl%num_el*mcnl%nthreads, HDF_head)
+hdferr = HDF_writeDatasetInteger(dataset, mcnl%totnum_el, HDF_head)
 
 dataset = SC_multiplier
-hdferr = HDF_writeDatasetInteger(dataset, one, HDF_head)
+if (counter.eqv..TRUE.) then
+  hdferr = HDF_writeDatasetInteger(dataset, mcnl%nbatches, HDF_head)
+else
+  hdferr = HDF_writeDatasetInteger(dataset, one, HDF_head)
+end if
 
 dataset = SC_numEbins
 hdferr = HDF_writeDatasetInteger(dataset, numEbins, HDF_head)
@@ -334,8 +391,15 @@ call h5close_EMsoft(hdferr)
  call Message(' ',"(A)")
  call Message(' All threads complete; saving data to file '//trim(mcnl%dataname), frm = "(A)")
 
- io_int(1) = mcnl%num_el*NUMTHREADS
- call WriteValue(' Total number of electrons generated = ',io_int, 1, "(I15)")
+ if (counter.eqv..TRUE.) then
+   io_int(1) = mcnl%num_el
+   call WriteValue(' Total number of electrons generated = ',io_int, 1, "(I15)",advance="no")
+   io_int(1) = mcnl%nbatches
+   call WriteValue(' x ',io_int, 1, "(I8)")
+ else
+   io_int(1) = mcnl%num_el*NUMTHREADS
+   call WriteValue(' Total number of electrons generated = ',io_int, 1, "(I15)")
+ end if
  io_int(1) = sum(accum_e)
  call WriteValue(' Number of electrons on detector       = ',io_int, 1, "(I15)")
 
@@ -356,6 +420,8 @@ contains
 !> @param accum_z depth accumulator array
 !> @param numEbins number of energy bins
 !> @param numzbins number of depth bins
+!> @param elrange (optional) first electron number and number of electrons, for per-electron streams
+!> @param seed (optional) seed for the per-electron streams
 !
 !> @date 11/**/12  PGC 1.0 IDL version
 !> @date 12/04/12  MDG 1.1 conversion to Fortran-90
@@ -366,7 +432,7 @@ contains
 !> @date 07/31/13  MDG 3.2 corrected off-by-one error in energy binning
 !> @date 10/13/17  MDG 4.0 reverted some older changes to get program functioning again
 !--------------------------------------------------------------------------
-recursive subroutine  single_run(varpas,rngt,accum_e,accum_z,nx,numEbins,numzbins)
+recursive subroutine  single_run(varpas,rngt,accum_e,accum_z,nx,numEbins,numzbins,elrange,seed)
 
 use local
 use rng
@@ -374,11 +440,14 @@ use Lambert
 
 IMPLICIT NONE
 
+integer,parameter       :: k12 = selected_int_kind(15)
 real(kind=dbl),INTENT(IN)       :: varpas(13)
 type(rng_t), INTENT(INOUT)      :: rngt
 integer(kind=irg),INTENT(IN)    :: nx
 integer(kind=irg),INTENT(IN)    :: numEbins, numzbins
-integer(kind=irg),INTENT(OUT)   :: accum_e(numEbins,-nx:nx,-nx:nx), accum_z(numEbins,numzbins,-nx/10:nx/10,-nx/10:nx/10)
+integer(kind=irg),INTENT(INOUT) :: accum_e(numEbins,-nx:nx,-nx:nx), accum_z(numEbins,numzbins,-nx/10:nx/10,-nx/10:nx/10)
+integer(kind=k12),INTENT(IN),OPTIONAL :: elrange(2)
+integer(kind=irg),INTENT(IN),OPTIONAL :: seed
 
 ! all geometrical parameters for the scintillator setup
 real(kind=dbl)          :: sig          ! TD sample tile angle [degrees]
@@ -411,9 +480,10 @@ integer(kind=irg)       :: idxy(2),px,py, io_int(2)                ! scintillato
 ! auxiliary variables
 integer(kind=irg)       :: num                  ! number of scattering events to try
 integer(kind=irg)       :: bsct                 ! back-scattered electron counter
-integer,parameter       :: k12 = selected_int_kind(15)
 integer(kind=k12)       :: num_el               ! total number of electrons to try
 integer(kind=k12)       :: el                   ! electron counter
+integer(kind=k12)       :: elid                 ! electron number for the per-electron streams
+logical                 :: counter              ! .TRUE. for per-electron streams
 integer(kind=irg)       :: traj                 ! trajectory counter
 integer(kind=irg)       :: ierr                 ! Lambert projection error status flag
 
@@ -425,7 +495,7 @@ real(kind=dbl)          :: at_wt                ! average atomic weight in g/mol
 integer(kind=irg)               :: TID
 
 ! parallel random number variable 
-real(kind=dbl)                  :: rr   ! random number
+real(kind=dbl)                  :: rr, rphi, rpsi, rstep   ! random numbers
 
 real(kind=dbl), parameter :: cDtoR = 0.017453293D0
 
@@ -446,6 +516,8 @@ real(kind=dbl), parameter :: cDtoR = 0.017453293D0
  depthmax = varpas(11)
  depthstep = varpas(12)
  omega = varpas(13)
+ counter = present(elrange)
+ if (counter) num_el = elrange(2)
 
  Emin = Ehistmin - Ebinsize/2.D0
 
@@ -491,7 +563,13 @@ real(kind=dbl), parameter :: cDtoR = 0.017453293D0
     step = Ec*(Ec+1024.D0)/Ze/(Ec+511.D0)               ! step is used here as a dummy variable
     sige =  presig * step * step * alpha * (1.D0+alpha)
     lambda = pre * sige
-    rr = rng_uniform(rngt)
+    if (counter) then
+! draw 0 of this electron's stream is used for the first step, draw n for scattering event n
+      elid = elrange(1) + el - 1
+      call rng_philox(seed, elid, 0, rr, rphi, rpsi, rstep)
+    else
+      rr = rng_uniform(rngt)
+    end if
     step = - lambda * log(rr)
  
     cxyz = (/ cxstart, 0.D0, czstart /)         ! direction cosines for beam on tilted sample
@@ -508,15 +586,22 @@ real(kind=dbl), parameter :: cDtoR = 0.017453293D0
 
 ! here we exit the trajloop (using the f90 EXIT command) if the energy becomes low enough
     if (Ec.lt.min_energy) EXIT trajloop
+
+! the three random numbers for this scattering event
+    if (counter) then
+      call rng_philox(seed, elid, traj+1, rphi, rpsi, rstep, rr)
+    else
+      rphi = rng_uniform(rngt)
+      rpsi = rng_uniform(rngt)
+      rstep = rng_uniform(rngt)
+    end if
     
 !  Find the angle the electron is deflected through by the scattering event.
-    rr = rng_uniform(rngt)
-    cphi = 1.D0-2.D0*alpha*rr/(1.D0+alpha-rr)
+    cphi = 1.D0-2.D0*alpha*rphi/(1.D0+alpha-rphi)
     sphi = dsin(dacos(cphi)) !  dsqrt(1.D0-cphi*cphi)
 
 ! Find the azimuthal scattering angle psi
-    rr = rng_uniform(rngt)
-    psi = tpi * rr
+    psi = tpi * rpsi
     spsi = dsin(psi)
     cpsi = dcos(psi)
 
@@ -543,8 +628,7 @@ real(kind=dbl), parameter :: cDtoR = 0.017453293D0
     sige =  presig * step * step * alpha * (1.D0+alpha)
     lambda = pre * sige
 
-    rr = rng_uniform(rngt)
-    step = - lambda * log(rr)
+    step = - lambda * log(rstep)
 
 ! apply the step to the next location    
     xyzn = xyz + step * scaled * cxyzp 
@@ -595,4 +679,228 @@ end do mainloop
 
 end subroutine single_run
 
+!--------------------------------------------------------------------------
+!
+! SUBROUTINE:block_run
+!
+!> @brief same simulation as single_run, but with a block of nb electrons that are advanced in lockstep
+!
+!> @details The trajectory state of the block is kept as a structure of arrays and each scattering 
+!> step is carried out for all lanes in a single SIMD loop, with a mask for the lanes that are idle;
+!> each lane has its own random number stream.  Backscattered electrons are binned in a short scalar
+!> pass after every step, and a lane whose electron has left the sample or has been absorbed is
+!> immediately refilled with a new incident electron.  The physics is identical to that of single_run,
+!> so the accumulated histograms have the same distribution.  With the optional elrange argument the
+!> lanes use the per-electron counter-based streams instead of rngb, with the same draw numbering 
+!> as in single_run.
+!
+!> @param varpas variable list
+!> @param rngb block of random number streams, one per lane
+!> @param accum_e energy accumulator array
+!> @param accum_z depth accumulator array
+!> @param nx half the number of Lambert pixels along x
+!> @param numEbins number of energy bins
+!> @param numzbins number of depth bins
+!> @param nb number of lanes in the block
+!> @param elrange (optional) first electron number and number of electrons, for per-electron streams
+!> @param seed (optional) seed for the per-electron streams
+!--------------------------------------------------------------------------
+recursive subroutine  block_run(varpas,rngb,accum_e,accum_z,nx,numEbins,numzbins,nb,elrange,seed)
+
+use local
+use rng
+use Lambert
+
+IMPLICIT NONE
+
+real(kind=dbl),INTENT(IN)       :: varpas(13)
+type(rng_block_t), INTENT(INOUT):: rngb
+integer(kind=irg),INTENT(IN)    :: nx
+integer(kind=irg),INTENT(IN)    :: numEbins, numzbins
+integer(kind=irg),INTENT(INOUT) :: accum_e(numEbins,-nx:nx,-nx:nx), accum_z(numEbins,numzbins,-nx/10:nx/10,-nx/10:nx/10)
+integer(kind=irg),INTENT(IN)    :: nb
+integer(kind=selected_int_kind(15)),INTENT(IN),OPTIONAL :: elrange(2)
+integer(kind=irg),INTENT(IN),OPTIONAL :: seed
+
+! parameters (see single_run for a description)
+real(kind=dbl)          :: sig, omega, Ehistmin, Ebinsize, Emin, depthstep, EkeV, Ze, density, at_wt
+real(kind=dbl)          :: scaled = 1.0D8, min_energy = 0.D0, presig = 1.5273987D19
+real(kind=dbl)          :: pre, prealpha, predEds, J, tpi, tano, delta, cxstart, czstart, alpha0, lambda0, t
+integer(kind=irg)       :: num, iE, iz, px, py, idxy(2), ierr, io_int(1), TID, l, nlive
+integer,parameter       :: k12 = selected_int_kind(15)
+integer(kind=k12)       :: num_el, nstarted
+real(kind=dbl), parameter :: cDtoR = 0.017453293D0
+real(kind=dbl)          :: dxy(2), edis, cxyzp(3)
+
+! per-lane trajectory state (structure of arrays) and per-lane scratch variables
+real(kind=dbl)          :: x(nb), y(nb), z(nb), cx(nb), cy(nb), cz(nb), Ec(nb), step(nb), alpha(nb)
+real(kind=dbl)          :: r0(nb), r1(nb), r2(nb), r3(nb), r4(nb)
+integer(kind=irg)       :: traj(nb), status(nb)
+integer(kind=k12)       :: elid(nb)
+logical                 :: live(nb), counter
+real(kind=dbl)          :: dE, cphi, sphi, cpsi, spsi, dsq, dsqi, cxp, cyp, czp, dd, sige, xn, yn, zn
+
+ TID = OMP_GET_THREAD_NUM()
+
+ sig = varpas(1)
+ num_el = int(varpas(4),kind=k12)
+ EkeV = varpas(5)
+ Ze = varpas(6) 
+ density = varpas(7) 
+ at_wt = varpas(8)
+ Ehistmin = varpas(9)
+ Ebinsize = varpas(10)
+ depthstep = varpas(12)
+ omega = varpas(13)
+ Emin = 0.D0
+ counter = present(elrange)
+ if (counter) num_el = elrange(2)
+
+ pre =  at_wt/cAvogadro/density
+ prealpha = 3.4D-3 * Ze**(0.67) 
+ J = (9.76D0 * Ze+58.5D0 / Ze**(0.19D0) )*1.0D-3 / 1.166
+ J = 1.D0/J
+ predEds = -78500.0D0 * density * Ze / at_wt 
+ num = 500
+ tpi = 2.D0 * cPi
+ tano = tan(omega * cDtoR)
+ delta = dble(nx)
+ cxstart = dcos( (90.D0-sig) * cDtoR)
+ czstart = -dsin( (90.D0-sig) * cDtoR)
+
+! the mean free path is the same for all incident electrons
+ alpha0 = prealpha / EkeV
+ t = EkeV*(EkeV+1024.D0)/Ze/(EkeV+511.D0)
+ lambda0 = pre * presig * t * t * alpha0 * (1.D0+alpha0)
+
+ live = .FALSE.
+ status = 0
+ elid = 0
+ nlive = 0
+ nstarted = 0
+
+! lanes are (re)filled whenever they are idle, until all electrons have been started
+ blockloop: do 
+   if (nstarted.lt.num_el) then
+     if ((counter.eqv..FALSE.).and.(count(.not.live).gt.0)) call rng_block_uniform(rngb, r0)
+     do l=1,nb
+       if ((live(l).eqv..FALSE.).and.(nstarted.lt.num_el)) then
+         nstarted = nstarted + 1
+         if (counter) then 
+           elid(l) = elrange(1) + nstarted - 1
+           call rng_philox(seed, elid(l), 0, r0(l), r1(l), r2(l), r3(l))
+         end if
+         Ec(l) = EkeV
+         alpha(l) = alpha0
+         step(l) = - lambda0 * log(r0(l))
+         cx(l) = cxstart
+         cy(l) = 0.D0
+         cz(l) = czstart
+         x(l) = step(l) * scaled * cxstart
+         y(l) = 0.D0
+         z(l) = step(l) * scaled * czstart
+         traj(l) = 0
+         live(l) = .TRUE.
+         nlive = nlive + 1
+         if ((TID.eq.0).and.(mod(nstarted,1000000_k12).eq.0)) then
+           io_int(1) = nstarted
+           call WriteValue(' Completed electron # ',io_int, 1, "(I15)",advance="no")
+           io_int(1) = sum(accum_e)
+           call WriteValue('; BSE hits = ',io_int, 1, frm = "(I15)")
+         end if
+       end if
+     end do
+   end if
+   if (nlive.eq.0) EXIT blockloop
+
+   if (counter) then
+     call rng_philox(seed, elid, traj+1, r1, r2, r3, r4)
+   else
+     call rng_block_uniform(rngb, r1)
+     call rng_block_uniform(rngb, r2)
+     call rng_block_uniform(rngb, r3)
+   end if
+
+! one scattering step for all live lanes; status becomes 1 for a backscattered electron,
+! and 2 for an electron that is absorbed or has reached the maximum number of steps
+!$OMP SIMD PRIVATE(dE,cphi,sphi,cpsi,spsi,dsq,dsqi,cxp,cyp,czp,dd,sige,xn,yn,zn)
+   do l=1,nb
+     if (live(l)) then 
+       dE = predEds * log( Ec(l) * J + 1.0D0 ) / Ec(l) * step(l)
+       Ec(l) = Ec(l) + dE
+       if (Ec(l).lt.min_energy) then 
+         status(l) = 2
+       else
+         cphi = 1.D0-2.D0*alpha(l)*r1(l)/(1.D0+alpha(l)-r1(l))
+         sphi = sqrt(max(0.D0, 1.D0-cphi*cphi))
+         cpsi = cos(tpi * r2(l))
+         spsi = sin(tpi * r2(l))
+         if (abs(cz(l)).gt.0.99999D0) then
+           cxp = sphi * cpsi
+           cyp = sphi * spsi
+           czp = sign(cphi, cz(l))
+         else 
+           dsq = sqrt(1.D0-cz(l)*cz(l))
+           dsqi = 1.D0/dsq
+           cxp = sphi * (cx(l) * cz(l) * cpsi - cy(l) * spsi) * dsqi + cx(l) * cphi
+           cyp = sphi * (cy(l) * cz(l) * cpsi + cx(l) * spsi) * dsqi + cy(l) * cphi
+           czp = -sphi * cpsi * dsq + cz(l) * cphi
+         end if
+         dd = 1.D0/sqrt(cxp*cxp + cyp*cyp + czp*czp)
+         cx(l) = cxp * dd
+         cy(l) = cyp * dd
+         cz(l) = czp * dd
+
+         alpha(l) = prealpha / Ec(l)
+         sige = Ec(l)*(Ec(l)+1024.D0)/Ze/(Ec(l)+511.D0)
+         sige =  presig * sige * sige * alpha(l) * (1.D0+alpha(l))
+         step(l) = - pre * sige * log(r3(l))
+
+         xn = x(l) + step(l) * scaled * cx(l)
+         yn = y(l) + step(l) * scaled * cy(l)
+         zn = z(l) + step(l) * scaled * cz(l)
+! the last scattering point (x,y,z) is kept for a backscattered electron
+         if (zn.gt.yn*tano) then
+           status(l) = 1
+         else
+           x(l) = xn
+           y(l) = yn
+           z(l) = zn
+           traj(l) = traj(l) + 1
+           if (traj(l).ge.num) status(l) = 2
+         end if
+       end if
+     end if
+   end do
+
+! bin the backscattered electrons and free up the lanes of all finished electrons
+   do l=1,nb
+     if (status(l).eq.0) CYCLE
+     if (status(l).eq.1) then 
+       cxyzp = (/ cx(l), cy(l), cz(l) /)
+       dxy = delta * LambertSphereToSquare( cxyzp, ierr )       
+       idxy = (/ nint(dxy(2)), nint(-dxy(1)) /)
+       if (maxval(abs(idxy)).le.nx) then
+         if (Ec(l).gt.Emin) then     
+           iE = nint((Ec(l)-Ehistmin)/Ebinsize)+1
+           edis = dabs(z(l)/cz(l))
+           iz = nint(edis*0.1D0/depthstep) +1
+           if ( (iz.gt.0).and.(iz.le.numzbins) ) then
+             px = nint(idxy(1)/10.0)
+             py = nint(idxy(2)/10.0)
+             accum_z(iE,iz,px,py) = accum_z(iE,iz,px,py) + 1
+           end if
+           accum_e(iE,idxy(1),idxy(2)) = accum_e(iE,idxy(1),idxy(2)) + 1
+         end if
+       end if
+     end if
+     status(l) = 0
+     live(l) = .FALSE.
+     nlive = nlive - 1
+   end do
+
+ end do blockloop
+
+end subroutine block_run
+
 end subroutine DoMCsimulation
@@ -122,6 +122,7 @@ use ISO_C_BINDING
 use omp_lib
 use math
 use stringconstants
+use shardmod
 
 IMPLICIT NONE
 
@@ -151,12 +152,14 @@ integer(kind=irg)       :: numEbins, numzbins, nsx, nsy, hdferr, nlines, lastEne
 real(kind=dbl)          :: EkeV, Ehistmin, Ebinsize, depthmax, depthstep, etotal, nabsl ! enery variables from MC program
 integer(kind=irg),allocatable :: accum_e(:,:,:), accum_z(:,:,:,:), thick(:), acc_z(:,:,:,:)
 real(kind=sgl),allocatable :: lambdaE(:,:)
-character(fnlen)        :: oldprogname, groupname, energyfile, outname, datagroupname, attributename, HDF_FileVersion
+character(fnlen)        :: oldprogname, groupname, energyfile, outname, datagroupname, attributename, HDF_FileVersion, &
+                           workname
 character(8)            :: MCscversion
 character(11)           :: dstr
 character(15)           :: tstrb
 character(15)           :: tstre
-logical                 :: f_exists, readonly, overwrite=.TRUE., insert=.TRUE., stereog, g_exists, xtaldataread, FL
+logical                 :: f_exists, readonly, overwrite=.TRUE., insert=.TRUE., stereog, g_exists, xtaldataread, FL, &
+                           shardcompute, shardmerge
 character(fnlen, KIND=c_char),allocatable,TARGET :: stringarray(:)
 character(fnlen,kind=c_char)                     :: line2(1)
 
@@ -169,6 +172,8 @@ type(kvectorlist),pointer       :: khead, ktmp
 real(kind=sgl),allocatable      :: karray(:,:)
 integer(kind=irg),allocatable   :: kij(:,:)
 complex(kind=dbl),allocatable   :: DynMat(:,:)
+type(LghWorkspaceType)          :: LghWS
+type(ReflectionTableType)       :: reftab
 character(fnlen)                :: dataset, instring
 
 type(HDFobjectStackType)          :: HDF_head
@@ -500,6 +505,25 @@ deallocate(accum_z)
   outname = trim(EMsoft_getEMdatapathname())//trim(emnl%outname)
   outname = EMsoft_toNativePath(outname)
 
+! in a sharded run, shards 1..nshards each compute part of the beam directions and write them to
+! their own file (which is also the file used for a restart); shard 0 merges these files
+  shardcompute = .FALSE.
+  shardmerge = .FALSE.
+  workname = outname
+  if ((emnl%nshards.gt.1).and.(emnl%uniform.eqv..FALSE.)) then 
+    if ((emnl%shard.lt.0).or.(emnl%shard.gt.emnl%nshards)) then 
+      call FatalError('ComputeMasterPattern','shard must be in the range [0,nshards]')
+    end if
+    if (emnl%shard.eq.0) then 
+      shardmerge = .TRUE.
+    else
+      shardcompute = .TRUE.
+      workname = getMasterShardName(outname, emnl%shard, emnl%nshards)
+      io_int(1:2) = (/ emnl%shard, emnl%nshards /)
+      call WriteValue(' Computing beam direction shard ', io_int, 2, "(I4,' of ',I4)")
+    end if
+  end if
+
 if (emnl%restart.eqv..TRUE.) then
 ! in this case we need to check whether or not the file exists, then open
 ! it and read the value of the last energy level that was simulated and written
@@ -507,7 +531,7 @@ if (emnl%restart.eqv..TRUE.) then
 ! know that there is at least one more level to be simulated.  If it is equal,
 ! then we can abort the program here.
 
-  inquire(file=trim(outname), exist=f_exists)
+  inquire(file=trim(workname), exist=f_exists)
   if (.not.f_exists) then 
     call FatalError('ComputeMasterPattern','restart HDF5 file does not exist')
   end if
@@ -520,7 +544,7 @@ if (emnl%restart.eqv..TRUE.) then
 
 ! Create a new file using the default properties.
   readonly = .TRUE.
-  hdferr =  HDF_openFile(outname, HDF_head, readonly)
+  hdferr =  HDF_openFile(workname, HDF_head, readonly)
 
 ! all we need to get from the file is the lastEnergy parameter
 groupname = SC_EMData
@@ -532,6 +556,12 @@ dataset = SC_lastEnergy
 
   call HDF_pop(HDF_head,.TRUE.)
 
+else if (shardcompute.eqv..TRUE.) then
+
+! a shard only needs an empty shard file; everything else is written by the merge run
+  datagroupname = 'TKDmaster'
+  call initMasterShard(workname, datagroupname, emnl%shard, emnl%nshards, emnl%npx, numEbins, numsites)
+
 else
 
 !=============================================
@@ -750,6 +780,13 @@ energyloop: do iE=Estart,1,-1
    call WriteValue('; energy [keV] = ',io_real,1,"(F6.2/)")
    selE = EkeVs(iE)
 
+! the merge run adds together the master patterns of all shards instead of computing them
+   datagroupname = 'TKDmaster'
+   if (shardmerge.eqv..TRUE.) then 
+     call readMasterShards(outname, datagroupname, emnl%nshards, iE, emnl%npx, numEbins, numsites, mLPNH, mLPSH)
+     numk = 0
+   else
+
 ! set the accelerating voltage
    skip = 3
    cell%voltage = dble(EkeVs(iE))
@@ -804,8 +841,16 @@ energyloop: do iE=Estart,1,-1
 
 ! use OpenMP to run on multiple cores ... 
 !$OMP PARALLEL COPYIN(rlp) &
-!$OMP& PRIVATE(DynMat,Sgh,Lgh,ik,FN,TID,kn,ipx,ipy,ix,iequiv,nequiv,reflist,firstw) &
-!$OMP& PRIVATE(kkk,nns,nnw,nref,svals,io_int)
+!$OMP& PRIVATE(DynMat,Sgh,Lgh,ik,FN,TID,kn,ipx,ipy,ix,iequiv,nequiv,reftab) &
+!$OMP& PRIVATE(kkk,nns,nnw,nref,svals,io_int,LghWS) REDUCTION(+:totstrong,totweak)
+
+! per-thread LAPACK work space for CalcLgh, kept for the entire beam direction loop (it grows as 
+! needed); without absorption the dynamical matrix is Hermitian and the cheaper ZHEEV solver is used
+  call InitLghWorkspace(LghWS, 0, hermitian=(rlp%absorption.eqv..FALSE.))
+
+! per-thread contiguous reflection table; the candidate reflections inside the dmin sphere are
+! the same for all beam directions, so only the excitation errors are recomputed in the loop
+  call Initialize_ReflectionTable(cell, reftab, emnl%dmin)
 
   NUMTHREADS = OMP_GET_NUM_THREADS()
   TID = OMP_GET_THREAD_NUM()
@@ -814,31 +859,34 @@ energyloop: do iE=Estart,1,-1
 ! ---------- and here we start the beam direction loop
    beamloop:do ik = 1,numk
 
+! skip the beam directions that belong to other shards
+     if (shardcompute.eqv..TRUE.) then
+       if (.not.inMasterShard(kij(1,ik), kij(2,ik), emnl%npx, emnl%shard, emnl%nshards)) CYCLE beamloop
+     end if
+
 !=============================================
 ! ---------- create the master reflection list for this beam direction
-! Then we must determine the masterlist of reflections (also a linked list);
+! Then we must determine the masterlist of reflections (stored in the reflection table);
 ! This list basically samples a large reciprocal space volume; it does not 
 ! distinguish between zero and higher order Laue zones, since that 
 ! distinction becomes meaningless when we consider the complete 
 ! reciprocal lattice.  
-     nullify(reflist)
      kkk = karray(1:3,ik)
      FN = kkk
 
-     call Initialize_ReflectionList(cell, reflist, BetheParameters, FN, kkk, emnl%dmin, nref, verbose)
+     call Update_ReflectionTable(cell, reftab, BetheParameters, FN, kkk, nref)
 ! ---------- end of "create the master reflection list"
 !=============================================
 
 
 ! determine strong and weak reflections
-     nullify(firstw)
      nns = 0
      nnw = 0
-     call Apply_BethePotentials(cell, reflist, firstw, BetheParameters, nref, nns, nnw)
+     call Apply_BethePotentialsTable(cell, reftab, BetheParameters, nns, nnw)
 
 ! generate the dynamical matrix
      allocate(DynMat(nns,nns))
-     call GetDynMat(cell, reflist, firstw, rlp, DynMat, nns, nnw)
+     call GetDynMatTable(cell, reftab, rlp, DynMat, nns, nnw)
      totstrong = totstrong + nns
      totweak = totweak + nnw
 
@@ -848,14 +896,14 @@ energyloop: do iE=Estart,1,-1
      allocate(Sgh(nns,nns,numset),Lgh(nns,nns))
      Sgh = czero
      Lgh = czero
-     ! call CalcSgh(cell,reflist,nns,numset,Sgh,nat)
-     call getSghfromLUT(cell,reflist,nns,numset,nat,Sgh)
+     ! call CalcSghTable(cell,reftab,nns,numset,Sgh)
+     call getSghfromLUTTable(cell,reftab,nns,numset,Sgh)
 !write(*,*) TID, maxval(abs(Sgh)), minval(abs(Sgh)), nat(1:numset),shape(Sgh),1.0/float(sum(nat(1:numset)))
 
 
 ! solve the dynamical eigenvalue equation for this beam direction  
      kn = karray(4,ik)
-     call CalcLgh(DynMat,Lgh,dble(thick(iE)),dble(kn),nns,gzero,depthstep,lambdaE(iE,1:izzmax),izzmax)
+     call CalcLgh(DynMat,Lgh,dble(thick(iE)),dble(kn),nns,gzero,depthstep,lambdaE(iE,1:izzmax),izzmax,LghWS)
      deallocate(DynMat)
 
 ! sum over the element-wise (Hadamard) product of the Lgh and Sgh arrays 
@@ -879,7 +927,7 @@ energyloop: do iE=Estart,1,-1
          call Apply3DPGSymmetry(cell,ipx,ipy,ipz,emnl%npx,iequiv,nequiv)
        end if
      end if
-!$OMP CRITICAL
+! equivalent pixels of different beam directions never overlap, so this scatter is done without a lock
      if (emnl%combinesites.eqv..FALSE.) then
        do ix=1,nequiv
          if (iequiv(3,ix).eq.-1) mLPSH(iequiv(1,ix),iequiv(2,ix),1,1:numset) = svals(1:numset)
@@ -891,7 +939,6 @@ energyloop: do iE=Estart,1,-1
          if (iequiv(3,ix).eq.1) mLPNH(iequiv(1,ix),iequiv(2,ix),1,1) = sum(svals)
        end do
      end if
-!$OMP END CRITICAL
   
 ! if (TID.eq.0) write (*,*) maxval(abs(mLPNH))
 
@@ -900,15 +947,24 @@ energyloop: do iE=Estart,1,-1
        call WriteValue('  completed beam direction ',io_int, 1, "(I8)")
      end if
 
-     call Delete_gvectorlist(reflist)
-
     end do beamloop
 
+  call DeleteLghWorkspace(LghWS)
+  call Delete_ReflectionTable(reftab)
+
 ! end of OpenMP portion
 !$OMP END PARALLEL
 
   deallocate(karray, kij)
 
+! a shard only stores the unprocessed master patterns for this energy in its shard file
+  if (shardcompute.eqv..TRUE.) then 
+    call writeMasterShard(workname, datagroupname, iE, emnl%npx, numEbins, numsites, mLPNH, mLPSH)
+    call Message('Shard data stored in file '//trim(workname), frm = "(A/)")
+    CYCLE energyloop
+  end if
+   end if  ! (shardmerge.eqv..TRUE.)
+
 if (usehex) then
 ! and finally, we convert the hexagonally sampled array to a square Lambert projection which will be used 
 ! for all EBSD pattern interpolations;  we need to do this for both the Northern and Southern hemispheres
@@ -980,10 +1036,12 @@ mLPSH(-emnl%npx:emnl%npx, emnl%npx,1,1:numsites) = mLPNH(-emnl%npx:emnl%npx, emn
 ! since these computations can take a long time, here we store 
 ! all the output at the end of each pass through the energyloop.
 
-  io_int(1) = nint(float(totstrong)/float(numk))
-  call WriteValue(' -> Average number of strong reflections = ',io_int, 1, "(I5)")
-  io_int(1) = nint(float(totweak)/float(numk))
-  call WriteValue(' -> Average number of weak reflections   = ',io_int, 1, "(I5)")
+  if (numk.gt.0) then
+    io_int(1) = nint(float(totstrong)/float(numk))
+    call WriteValue(' -> Average number of strong reflections = ',io_int, 1, "(I5)")
+    io_int(1) = nint(float(totweak)/float(numk))
+    call WriteValue(' -> Average number of weak reflections   = ',io_int, 1, "(I5)")
+  end if
 
 ! and here is where the major changes are for version 5.0: all output now in HDF5 format
   call timestamp(datestring=dstr, timestring=tstre)
@@ -0,0 +1,181 @@
+! ###################################################################
+! Copyright (c) 2016-2024, Marc De Graef Research Group/Carnegie Mellon University
+! All rights reserved.
+!
+! Redistribution and use in source and binary forms, with or without modification, are
+! permitted provided that the following conditions are met:
+!
+!     - Redistributions of source code must retain the above copyright notice, this list
+!        of conditions and the following disclaimer.
+!     - Redistributions in binary form must reproduce the above copyright notice, this
+!        list of conditions and the following disclaimer in the documentation and/or
+!        other materials provided with the distribution.
+!     - Neither the names of Marc De Graef, Carnegie Mellon University nor the names
+!        of its contributors may be used to endorse or promote products derived from
+!        this software without specific prior written permission.
+!
+! THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+! AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+! IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+! ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+! LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+! DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+! SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+! CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+! OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+! USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+! ###################################################################
+!--------------------------------------------------------------------------
+! EMsoft:ADPmapTest.f90
+!--------------------------------------------------------------------------
+!
+! MODULE: ADPmapTest
+!
+!> @author Marc De Graef, Carnegie Mellon University
+!
+!> @brief test module for the pattern preprocessing wrapper that produces the Workbench ADP map
+!
+!> @details A small Binary pattern file with smooth, slowly varying patterns is preprocessed 
+!> with a mask of ones (no circular mask); the resulting ADP map must be strictly positive and
+!> can not exceed 1, since the preprocessed patterns are non-negative and normalized.
+!--------------------------------------------------------------------------
+
+module ADPmapTest
+
+contains 
+
+subroutine ADPmapProgress(objAddress, loopCompleted, totalLoops) bind(C)
+
+use,INTRINSIC :: ISO_C_BINDING
+
+IMPLICIT NONE
+
+integer(c_size_t),INTENT(IN), VALUE     :: objAddress
+integer(KIND=4), INTENT(IN), VALUE      :: loopCompleted
+integer(KIND=4), INTENT(IN), VALUE      :: totalLoops
+
+end subroutine ADPmapProgress
+
+subroutine ADPmapExecuteTest(res) &
+           bind(c, name='ADPmapExecuteTest')    ! this routine is callable from a C/C++ program
+!DEC$ ATTRIBUTES DLLEXPORT :: ADPmapExecuteTest
+
+use,INTRINSIC :: ISO_C_BINDING
+use local
+use EMDIwrappermod
+
+IMPLICIT NONE
+
+integer(C_INT32_T),INTENT(OUT)  :: res
+
+integer(kind=irg),parameter     :: numsx = 32, numsy = 32, wd = 4, ht = 3
+integer(c_int32_t)              :: ipar(wraparraysize)
+real(kind=sgl)                  :: fpar(wraparraysize), mask(numsx,numsy), exptIQ(wd*ht), ADPmap(wd*ht), pattern(numsx*numsy)
+character(kind=c_char, len=1), target :: spar(wraparraysize*fnlen)
+character(len=1)                :: cancel
+character(fnlen)                :: tmppath, patternfile, tmpfile
+character(len=1)                :: EMsoftnativedelimiter
+integer(kind=irg)               :: i, j, k, ierr
+
+EMsoftnativedelimiter = EMsoft_getEMsoftnativedelimiter()
+tmppath = EMsoft_getEMsofttestpath()
+patternfile = trim(tmppath)//EMsoftnativedelimiter//'ADPtest_patterns.data'
+tmpfile = trim(tmppath)//EMsoftnativedelimiter//'ADPtest_preprocessed.data'
+
+!====================================
+! create a Binary pattern file with one pattern per record; the patterns 
+! change slowly across the scan, so that neighboring patterns are similar
+open(unit=dataunit, file=trim(patternfile), status='unknown', form='unformatted', access='direct', &
+     recl=4*numsx*numsy, iostat=ierr)
+if (ierr.ne.0) then
+  res = 1
+  return
+end if
+
+do k=1,wd*ht
+  do j=1,numsy
+    do i=1,numsx
+      pattern((j-1)*numsx+i) = 100.0 + 60.0*sin(0.4*float(i) + 0.25*float(j) + 0.05*float(k)) + 20.0*cos(0.3*float(j))
+    end do
+  end do
+  write(dataunit, rec=k) pattern
+end do
+close(unit=dataunit, status='keep')
+
+!====================================
+! parameters for EMsoftCpreprocessEBSDPatterns
+ipar = 0
+ipar(18) = 2                ! nthreads
+ipar(19) = numsx
+ipar(20) = numsy
+ipar(22) = 1                ! binning
+ipar(23) = numsx
+ipar(24) = numsy
+ipar(26) = wd
+ipar(27) = ht
+ipar(28) = 4                ! nregions
+ipar(29) = 0                ! maskpattern
+ipar(30) = 0                ! useROI
+ipar(35) = 1                ! Binary input
+
+fpar = 0.0
+fpar(23) = float(numsx/2)   ! maskradius
+fpar(24) = 0.05             ! hipassw
+
+! strings 31 and 32 are the (absolute) preprocessed and input pattern file names
+spar = char(0)
+do i=1,len_trim(tmpfile)
+  spar(30*fnlen+i) = tmpfile(i:i)
+end do
+do i=1,len_trim(patternfile)
+  spar(31*fnlen+i) = patternfile(i:i)
+end do
+
+! the caller must provide a mask of ones
+mask = 1.0
+exptIQ = 0.0
+ADPmap = 0.0
+cancel = char(0)
+
+call EMsoftCpreprocessEBSDPatterns(ipar, fpar, spar, mask, exptIQ, ADPmap, C_FUNLOC(ADPmapProgress), 0_c_size_t, cancel)
+
+!====================================
+! the mask must be unchanged when no circular mask is requested
+if (minval(mask).ne.1.0) then
+  res = 2
+  return
+end if
+
+! every pixel of the ADP map must have a positive average dot product 
+write (*,*) 'ADP map range : ', minval(ADPmap), maxval(ADPmap)
+if (minval(ADPmap).le.0.0) then
+  res = 3
+  return
+end if
+
+! the map is a neighborhood average of dot products between normalized patterns, so it 
+! can not exceed 1, also not on the edges and corners of the scan
+if (maxval(ADPmap).gt.1.0001) then
+  res = 4
+  return
+end if
+
+!====================================
+! repeat with the 8-neighborhood of radius 2, whose halo spans most of the 3-row scan
+ipar(52) = 8
+ipar(53) = 2
+ADPmap = 0.0
+
+call EMsoftCpreprocessEBSDPatterns(ipar, fpar, spar, mask, exptIQ, ADPmap, C_FUNLOC(ADPmapProgress), 0_c_size_t, cancel)
+
+write (*,*) 'ADP map range (8-neighborhood, radius 2) : ', minval(ADPmap), maxval(ADPmap)
+if ((minval(ADPmap).le.0.0).or.(maxval(ADPmap).gt.1.0001)) then
+  res = 5
+  return
+end if
+
+res = 0
+
+end subroutine ADPmapExecuteTest
+
+end module ADPmapTest
@@ -63,7 +63,7 @@ character(fnlen)                :: HDFfilename, tmppath, groupname, dataset, tex
 
 integer(kind=irg)               :: i1, i2, i3, i4, dim1, dim2, dim3, dim4, hdferr, isum 
 
-integer(HSIZE_T)                :: dims2(2), dims3(3), dims4(4), cnt2(2), cnt3(3), cnt4(4), offset2(2), offset3(3), offset4(4), &
+integer(HSIZE_T)                :: dims1(1), dims2(2), dims3(3), dims4(4), cnt2(2), cnt3(3), cnt4(4), offset1(1), offset2(2), offset3(3), offset4(4), &
                                    rm2(2), rm3(3), rm4(4), rn2(2), rn3(3), rn4(4), olddims2(2), olddims3(3), olddims4(4)
 logical                         :: overwrite
 
@@ -76,8 +76,8 @@ integer(kind=irg),allocatable   :: iarr2(:,:), iarr3(:,:,:), iarr4(:,:,:,:)
 integer(kind=irg),allocatable   :: iarr2_save(:,:), iarr3_save(:,:,:), iarr4_save(:,:,:,:)
 
 ! float arrays
-real(kind=sgl),allocatable      :: farr2(:,:), farr3(:,:,:), farr4(:,:,:,:)
-real(kind=sgl),allocatable      :: farr2_save(:,:), farr3_save(:,:,:), farr4_save(:,:,:,:)
+real(kind=sgl),allocatable      :: farr1(:), farr2(:,:), farr3(:,:,:), farr4(:,:,:,:)
+real(kind=sgl),allocatable      :: farr1_save(:), farr2_save(:,:), farr3_save(:,:,:), farr4_save(:,:,:,:)
 
 ! double arrays
 real(kind=dbl),allocatable      :: darr2(:,:), darr3(:,:,:), darr4(:,:,:,:)
@@ -101,6 +101,7 @@ ALLOCATE (carr4(dim1,dim2,dim3,dim4))
 ALLOCATE (iarr2(dim1,dim2))
 ALLOCATE (iarr3(dim1,dim2,dim3))
 ALLOCATE (iarr4(dim1,dim2,dim3,dim4))
+ALLOCATE (farr1(dim4))
 ALLOCATE (farr2(dim1,dim2))
 ALLOCATE (farr3(dim1,dim2,dim3))
 ALLOCATE (farr4(dim1,dim2,dim3,dim4))
@@ -115,6 +116,7 @@ carr4 = char(0)
 iarr2 = 0
 iarr3 = 0
 iarr4 = 0
+farr1 = 0.0
 farr2 = 0.0
 farr3 = 0.0
 farr4 = 0.0
@@ -255,6 +257,9 @@ call h5close_EMsoft(hdferr)
 
 !====================================
 ! populate the arrays with data
+do i4=1,dim4
+  farr1(i4) = real(i4 * i4)
+end do
 do i1=1,dim1
   do i2=1,dim2
     carr2(i1,i2) = char(mod(i1 + i2,128))
@@ -283,6 +288,7 @@ ALLOCATE (carr4_save(dim1,dim2,dim3,dim4))
 ALLOCATE (iarr2_save(dim1,dim2))
 ALLOCATE (iarr3_save(dim1,dim2,dim3))
 ALLOCATE (iarr4_save(dim1,dim2,dim3,dim4))
+ALLOCATE (farr1_save(dim4))
 ALLOCATE (farr2_save(dim1,dim2))
 ALLOCATE (farr3_save(dim1,dim2,dim3))
 ALLOCATE (farr4_save(dim1,dim2,dim3,dim4))
@@ -296,6 +302,7 @@ carr4_save = carr4
 iarr2_save = iarr2
 iarr3_save = iarr3
 iarr4_save = iarr4
+farr1_save = farr1
 farr2_save = farr2
 farr3_save = farr3
 farr4_save = farr4
@@ -458,6 +465,14 @@ if (hdferr.ne.0) then
   return
 end if
 
+! the 1D float array is written in full; only its reader works with hyperslabs
+dataset = SC_hyperfarr1
+hdferr = HDF_writeDatasetFloatArray1D(dataset, farr1, size(farr1), HDF_head)
+if (hdferr.ne.0) then
+  res = 38
+  return
+end if
+
 call HDF_pop(HDF_head,.TRUE.)
 
 ! and close the fortran hdf interface
@@ -467,7 +482,7 @@ call h5close_EMsoft(hdferr)
 
 !====================================
 ! deallocate the arrays (they will be recreated upon reading)
-deallocate( carr2, carr3, carr4, iarr2, iarr3, iarr4, farr2, farr3, farr4, darr2, darr3, darr4)
+deallocate( carr2, carr3, carr4, iarr2, iarr3, iarr4, farr1, farr2, farr3, farr4, darr2, darr3, darr4)
 !====================================
 
 !====================================
@@ -542,6 +557,15 @@ if (hdferr.ne.0) then
 end if
 
 ! float
+dataset = SC_hyperfarr1
+dims1 = (/ dim4 /)
+offset1 = (/ 8 /)
+farr1 = HDF_readHyperslabFloatArray1D(dataset, offset1, dims1, HDF_head)
+if (hdferr.ne.0) then
+  res = 39
+  return
+end if
+
 dataset = SC_hyperfarr2
 farr2 = HDF_readHyperslabFloatArray2D(dataset, offset2, dims2, HDF_head)
 if (hdferr.ne.0) then
@@ -615,6 +639,13 @@ if (all(darr2.eq.darr2_save(rm2(1):rn2(1),rm2(2):rn2(2))).eqv..FALSE.) isum = is
 if (all(darr3.eq.darr3_save(rm3(1):rn3(1),rm3(2):rn3(2),rm3(3):rn3(3))).eqv..FALSE.) isum = isum + 1024
 if (all(darr4.eq.darr4_save(rm4(1):rn4(1),rm4(2):rn4(2),rm4(3):rn4(3),rm4(4):rn4(4))).eqv..FALSE.) isum = isum + 2048
 
+! the 1D array was written in full, so a zero-based offset corresponds to the next array index
+if (size(farr1).ne.dim4) then
+  isum = isum + 4096
+else if (all(farr1.eq.farr1_save(offset1(1)+1:offset1(1)+dim4)).eqv..FALSE.) then
+  isum = isum + 4096
+end if
+
 if (isum.eq.40) then
   res = 0
 else
@@ -0,0 +1,162 @@
+! ###################################################################
+! Copyright (c) 2016-2024, Marc De Graef Research Group/Carnegie Mellon University
+! All rights reserved.
+!
+! Redistribution and use in source and binary forms, with or without modification, are
+! permitted provided that the following conditions are met:
+!
+!     - Redistributions of source code must retain the above copyright notice, this list
+!        of conditions and the following disclaimer.
+!     - Redistributions in binary form must reproduce the above copyright notice, this
+!        list of conditions and the following disclaimer in the documentation and/or
+!        other materials provided with the distribution.
+!     - Neither the names of Marc De Graef, Carnegie Mellon University nor the names
+!        of its contributors may be used to endorse or promote products derived from
+!        this software without specific prior written permission.
+!
+! THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+! AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+! IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+! ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+! LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+! DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+! SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+! CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+! OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+! USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+! ###################################################################
+!--------------------------------------------------------------------------
+! EMsoft:MasterScatterTest.f90
+!--------------------------------------------------------------------------
+!
+! MODULE: MasterScatterTest
+!
+!> @author Marc De Graef, Carnegie Mellon University
+!
+!> @brief thread-scaling benchmark for the master pattern scatter step
+!
+!> @details The EBSD, TKD and Kossel master programs write the values of each irreducible beam
+!> direction into all of its symmetry-equivalent mLPNH/mLPSH pixels from within the parallel beam 
+!> loop.  The equivalent pixel sets of different beams are disjoint, so these writes need no critical
+!> section.  This test replays that loop on a 1001x1001 Lambert grid with 48 equivalents per beam 
+!> (a fixed scrambled partition of the pixels stands in for Apply3DPGSymmetry) for 1 to 64 threads, 
+!> once with and once without a critical section around the scatter.  It prints the wall clock 
+!> times and fails if any run differs from the serial result.
+!--------------------------------------------------------------------------
+
+module MasterScatterTest
+
+contains 
+
+recursive subroutine MasterScatterRun(nt, locked, npx, nE, nequiv, nbeams, mLPNH, mLPSH)
+
+use local
+use omp_lib
+
+IMPLICIT NONE
+
+integer(kind=irg),INTENT(IN)    :: nt, npx, nE, nequiv, nbeams
+logical,INTENT(IN)              :: locked
+real(kind=sgl),INTENT(INOUT)    :: mLPNH(-npx:npx,-npx:npx,nE), mLPSH(-npx:npx,-npx:npx,nE)
+
+! stride through the pixel list; coprime with the number of pixels, so every pixel gets one beam
+integer(kind=8),parameter       :: stride = 1000003_8
+integer(kind=irg)               :: jk, ik, ix, p, q, nsq, iequiv(3,48)
+real(kind=sgl)                  :: sval
+
+nsq = (2*npx+1)**2
+call OMP_SET_NUM_THREADS(nt)
+
+do jk=1,nE
+!$OMP PARALLEL DEFAULT(SHARED) PRIVATE(ik, ix, p, q, iequiv, sval)
+!$OMP DO SCHEDULE(DYNAMIC,100)
+  do ik=1,nbeams
+! stand-in for the value computed for this beam direction
+    sval = sin(0.001*real(ik)) + real(jk)
+
+! stand-in for Apply3DPGSymmetry
+    do ix=1,nequiv
+      p = int(mod(int((ik-1)*nequiv+ix-1,8)*stride, int(2*nsq,8)))
+      q = mod(p, nsq)
+      iequiv(1,ix) = mod(q, 2*npx+1) - npx
+      iequiv(2,ix) = q/(2*npx+1) - npx
+      iequiv(3,ix) = 1
+      if (p.ge.nsq) iequiv(3,ix) = -1
+    end do
+
+    if (locked.eqv..TRUE.) then
+!$OMP CRITICAL
+      do ix=1,nequiv
+        if (iequiv(3,ix).eq.-1) mLPSH(iequiv(1,ix),iequiv(2,ix),jk) = sval
+        if (iequiv(3,ix).eq.1) mLPNH(iequiv(1,ix),iequiv(2,ix),jk) = sval
+      end do
+!$OMP END CRITICAL
+    else
+      do ix=1,nequiv
+        if (iequiv(3,ix).eq.-1) mLPSH(iequiv(1,ix),iequiv(2,ix),jk) = sval
+        if (iequiv(3,ix).eq.1) mLPNH(iequiv(1,ix),iequiv(2,ix),jk) = sval
+      end do
+    end if
+  end do
+!$OMP END DO
+!$OMP END PARALLEL
+end do
+
+end subroutine MasterScatterRun
+
+subroutine MasterScatterExecuteTest(res) &
+           bind(c, name='MasterScatterExecuteTest')    ! this routine is callable from a C/C++ program
+!DEC$ ATTRIBUTES DLLEXPORT :: MasterScatterExecuteTest
+
+use,INTRINSIC :: ISO_C_BINDING
+use local
+use omp_lib
+
+IMPLICIT NONE
+
+integer(C_INT32_T),INTENT(OUT)  :: res
+
+integer(kind=irg),parameter     :: npx = 500, nE = 4, nequiv = 48, nruns = 7
+integer(kind=irg),parameter     :: nthr(nruns) = (/ 1, 2, 4, 8, 16, 32, 64 /)
+real(kind=sgl),allocatable      :: mLPNH(:,:,:), mLPSH(:,:,:), refNH(:,:,:), refSH(:,:,:)
+integer(kind=irg)               :: ir, il, nbeams
+real(kind=dbl)                  :: t(2,nruns), tstart
+logical                         :: locked
+
+nbeams = 2*(2*npx+1)**2/nequiv
+
+allocate(mLPNH(-npx:npx,-npx:npx,nE), mLPSH(-npx:npx,-npx:npx,nE))
+allocate(refNH(-npx:npx,-npx:npx,nE), refSH(-npx:npx,-npx:npx,nE))
+
+! serial reference
+refNH = 0.0
+refSH = 0.0
+call MasterScatterRun(1, .FALSE., npx, nE, nequiv, nbeams, refNH, refSH)
+
+res = 0
+do ir=1,nruns
+  do il=1,2
+    locked = (il.eq.1)
+    mLPNH = 0.0
+    mLPSH = 0.0
+    tstart = OMP_GET_WTIME()
+    call MasterScatterRun(nthr(ir), locked, npx, nE, nequiv, nbeams, mLPNH, mLPSH)
+    t(il,ir) = OMP_GET_WTIME() - tstart
+    if (any(mLPNH.ne.refNH).or.any(mLPSH.ne.refSH)) then
+      write (*,*) 'scatter result differs from the serial one for ',nthr(ir),' threads; critical = ',locked
+      res = 10*ir + il
+    end if
+  end do
+end do
+
+write (*,"(A,I6,A,I3,A,I2,A)") ' master pattern scatter: ',nbeams,' beams, ',nequiv,' equivalents, ',nE,' energies'
+write (*,"(A)") ' threads   critical [s]  lock-free [s]   lock-free speedup'
+do ir=1,nruns
+  write (*,"(I8,2F15.4,F20.2)") nthr(ir), t(1,ir), t(2,ir), t(2,1)/t(2,ir)
+end do
+
+deallocate(mLPNH, mLPSH, refNH, refSH)
+
+end subroutine MasterScatterExecuteTest
+
+end module MasterScatterTest
@@ -139,9 +139,11 @@ end do
 
 ! and here we compute the disorientation angle from a quaternion product...
 call Message('Computing disorientations')
+!$OMP PARALLEL DO DEFAULT(SHARED) PRIVATE(i) SCHEDULE(DYNAMIC,64)
 do i=1,nump
   call getDisorientationAngle(LUT(1:3,i), LUT(4:6,i), dict, LUT(7,i), ax(1:3,i))
 end do
+!$OMP END PARALLEL DO
 
 LUT = LUT *180.0/cPi
 